@@ -0,0 +1,292 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* A collection of unit tests for util/disk_cache.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util/disk_cache.h"
+
+#define DRIVER_ID "cache_test"
+
+bool error = false;
+
+static void
+expect_true(bool result, const char *test)
+{
+   if (!result) {
+      fprintf(stderr, "Error: Test '%s' failed: Expected=true"
+              ", Actual=false\n", test);
+      error = true;
+   }
+}
+
+static void
+expect_null(void *ptr, const char *test)
+{
+   if (ptr != NULL) {
+      fprintf(stderr, "Error: Test '%s' failed: Result=%p, but expected NULL.\n",
+              test, ptr);
+      error = true;
+   }
+}
+
+static void
+expect_non_null(void *ptr, const char *test)
+{
+   if (ptr == NULL) {
+      fprintf(stderr, "Error: Test '%s' failed: Result=NULL, but expected something else.\n",
+              test);
+      error = true;
+   }
+}
+
+static void
+expect_equal_bytes(const void *expected, const void *actual, size_t size,
+                   const char *test)
+{
+   if (expected == NULL || actual == NULL ||
+       memcmp(expected, actual, size) != 0) {
+      fprintf(stderr, "Error: Test '%s' failed: contents differ.\n", test);
+      error = true;
+   }
+}
+
+/* Remove the cache directory created for the test, two levels deep. */
+static void
+rmrf_cache(const char *path)
+{
+   DIR *dir = opendir(path);
+   struct dirent *ent;
+   char buf[4096];
+
+   if (!dir)
+      return;
+
+   while ((ent = readdir(dir)) != NULL) {
+      struct stat sb;
+
+      if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+         continue;
+
+      snprintf(buf, sizeof(buf), "%s/%s", path, ent->d_name);
+      if (stat(buf, &sb) == 0 && S_ISDIR(sb.st_mode))
+         rmrf_cache(buf);
+      else
+         unlink(buf);
+   }
+
+   closedir(dir);
+   rmdir(path);
+}
+
+/* Flip one byte of the payload of every entry below the cache root. */
+static void
+corrupt_entries(const char *path)
+{
+   DIR *dir = opendir(path);
+   struct dirent *ent;
+   char buf[4096];
+
+   if (!dir)
+      return;
+
+   while ((ent = readdir(dir)) != NULL) {
+      struct stat sb;
+
+      if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+         continue;
+
+      snprintf(buf, sizeof(buf), "%s/%s", path, ent->d_name);
+      if (stat(buf, &sb) != 0)
+         continue;
+
+      if (S_ISDIR(sb.st_mode)) {
+         corrupt_entries(buf);
+      } else if (sb.st_size > 0) {
+         int fd = open(buf, O_RDWR);
+         char c;
+
+         if (fd < 0)
+            continue;
+         if (pread(fd, &c, 1, sb.st_size - 1) == 1) {
+            c ^= 0xff;
+            if (pwrite(fd, &c, 1, sb.st_size - 1) != 1)
+               error = true;
+         }
+         close(fd);
+      }
+   }
+
+   closedir(dir);
+}
+
+static void
+test_disable(void)
+{
+   struct disk_cache *cache;
+
+   setenv("MESA_GLSL_CACHE_DISABLE", "true", 1);
+   cache = disk_cache_create(DRIVER_ID);
+   expect_null(cache, "disk_cache_create with MESA_GLSL_CACHE_DISABLE");
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+}
+
+static void
+test_put_and_get(const char *path)
+{
+   static const char blob[] = "This is a blob of thirty-seven bytes";
+   static const char other[] = "Another blob";
+   struct disk_cache *cache;
+   cache_key blob_key, other_key, marker_key;
+   size_t size;
+   char *result;
+
+   cache = disk_cache_create(DRIVER_ID);
+   expect_non_null(cache, "disk_cache_create");
+   if (!cache)
+      return;
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_compute_key(cache, other, sizeof(other), other_key);
+   disk_cache_compute_key(cache, "marker", 6, marker_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "disk_cache_get with non-existent item");
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob));
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_bytes(blob, result, sizeof(blob), "disk_cache_get of existing item");
+   expect_true(size == sizeof(blob), "disk_cache_get size");
+   free(result);
+
+   disk_cache_put(cache, other_key, other, sizeof(other));
+   result = disk_cache_get(cache, other_key, &size);
+   expect_equal_bytes(other, result, sizeof(other), "2nd disk_cache_get of existing item");
+   free(result);
+
+   expect_true(!disk_cache_has_key(cache, marker_key),
+               "disk_cache_has_key before disk_cache_put_key");
+   disk_cache_put_key(cache, marker_key);
+   expect_true(disk_cache_has_key(cache, marker_key),
+               "disk_cache_has_key after disk_cache_put_key");
+
+   disk_cache_destroy(cache);
+
+   /* A second cache object with the same driver ID sees the same entries,
+    * one with a different driver ID computes different keys.
+    */
+   cache = disk_cache_create(DRIVER_ID);
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_bytes(blob, result, sizeof(blob), "disk_cache_get after re-creation");
+   free(result);
+   disk_cache_destroy(cache);
+
+   cache = disk_cache_create(DRIVER_ID "-other");
+   disk_cache_compute_key(cache, blob, sizeof(blob), marker_key);
+   expect_true(memcmp(marker_key, blob_key, sizeof(cache_key)) != 0,
+               "disk_cache_compute_key depends on the driver ID");
+   disk_cache_destroy(cache);
+
+   /* Corrupted entries are detected and dropped. */
+   cache = disk_cache_create(DRIVER_ID);
+   corrupt_entries(path);
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "disk_cache_get of corrupted item");
+   disk_cache_destroy(cache);
+}
+
+static void
+test_eviction(void)
+{
+   char blob[600];
+   struct disk_cache *cache;
+   cache_key first_key, second_key;
+   char *result;
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1K", 1);
+   cache = disk_cache_create(DRIVER_ID);
+   unsetenv("MESA_GLSL_CACHE_MAX_SIZE");
+   expect_non_null(cache, "disk_cache_create with MESA_GLSL_CACHE_MAX_SIZE");
+   if (!cache)
+      return;
+
+   memset(blob, 'a', sizeof(blob));
+   disk_cache_compute_key(cache, "first", 5, first_key);
+   disk_cache_put(cache, first_key, blob, sizeof(blob));
+
+   memset(blob, 'b', sizeof(blob));
+   disk_cache_compute_key(cache, "second", 6, second_key);
+   disk_cache_put(cache, second_key, blob, sizeof(blob));
+
+   result = disk_cache_get(cache, first_key, NULL);
+   expect_null(result, "disk_cache_get of evicted item");
+   free(result);
+
+   result = disk_cache_get(cache, second_key, NULL);
+   expect_equal_bytes(blob, result, sizeof(blob),
+                      "disk_cache_get of item written after eviction");
+   free(result);
+
+   disk_cache_destroy(cache);
+}
+
+int
+main(void)
+{
+   char path[] = "/tmp/mesa-cache-test-XXXXXX";
+
+   if (!mkdtemp(path)) {
+      fprintf(stderr, "Error: cannot create temporary directory\n");
+      return 1;
+   }
+   setenv("MESA_GLSL_CACHE_DIR", path, 1);
+
+   test_disable();
+
+   test_put_and_get(path);
+
+   rmrf_cache(path);
+   if (!mkdtemp(strcpy(path, "/tmp/mesa-cache-test-XXXXXX"))) {
+      fprintf(stderr, "Error: cannot create temporary directory\n");
+      return 1;
+   }
+   setenv("MESA_GLSL_CACHE_DIR", path, 1);
+
+   test_eviction();
+
+   rmrf_cache(path);
+
+   return error ? 1 : 0;
+}
@@ -71,6 +71,7 @@ struct tgsi_buffer;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
+struct draw_vs_threads;
 
 
 /**
@@ -273,6 +274,9 @@ struct draw_context
          struct tgsi_buffer *buffer;
       } tgsi;
 
+      /** Worker threads for the TGSI interpreter, NULL if disabled */
+      struct draw_vs_threads *threads;
+
       struct translate *fetch;
       struct translate_cache *fetch_cache;
       struct translate *emit;
@@ -390,6 +394,9 @@ void draw_new_instance(struct draw_context *draw);
 boolean draw_vs_init( struct draw_context *draw );
 void draw_vs_destroy( struct draw_context *draw );
 
+void draw_vs_threads_init( struct draw_context *draw );
+void draw_vs_threads_destroy( struct draw_context *draw );
+
 
 /*******************************************************************************
  * Geometry shading code:
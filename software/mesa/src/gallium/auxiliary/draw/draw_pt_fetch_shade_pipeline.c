@@ -215,14 +215,27 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
       (struct vertex_header *)MALLOC(output_verts->vertex_size *
                                      align(output_verts->count, 4));
 
-   vshader->run_linear(vshader,
-                       (const float (*)[4])input_verts->verts->data,
-                       (      float (*)[4])output_verts->verts->data,
-                       constants,
-                       const_size,
-                       input_verts->count,
-                       input_verts->vertex_size,
-                       input_verts->vertex_size);
+   if (draw_vs_threads_enabled(vshader->draw, vshader, input_verts->count)) {
+      draw_vs_threads_run(vshader->draw,
+                          vshader,
+                          (const float (*)[4])input_verts->verts->data,
+                          (      float (*)[4])output_verts->verts->data,
+                          constants,
+                          const_size,
+                          input_verts->count,
+                          input_verts->vertex_size,
+                          input_verts->vertex_size);
+   }
+   else {
+      vshader->run_linear(vshader,
+                          (const float (*)[4])input_verts->verts->data,
+                          (      float (*)[4])output_verts->verts->data,
+                          constants,
+                          const_size,
+                          input_verts->count,
+                          input_verts->vertex_size,
+                          input_verts->vertex_size);
+   }
 }
 
 
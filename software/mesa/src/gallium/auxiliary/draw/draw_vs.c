@@ -153,6 +153,8 @@ draw_vs_init( struct draw_context *draw )
       draw->vs.tgsi.machine = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
       if (!draw->vs.tgsi.machine)
          return FALSE;
+
+      draw_vs_threads_init(draw);
    }
 
    draw->vs.emit_cache = translate_cache_create();
@@ -175,8 +177,10 @@ draw_vs_destroy( struct draw_context *draw )
    if (draw->vs.emit_cache)
       translate_cache_destroy(draw->vs.emit_cache);
 
-   if (!draw->llvm)
+   if (!draw->llvm) {
+      draw_vs_threads_destroy(draw);
       tgsi_exec_machine_destroy(draw->vs.tgsi.machine);
+   }
 }
 
 
@@ -142,6 +142,19 @@ struct draw_vertex_shader {
 		       unsigned input_stride,
 		       unsigned output_stride );
 
+   /* Same as run_linear, but on the private interpreter of the given
+    * worker thread.  NULL if the shader can't be run concurrently.
+    */
+   void (*run_linear_thread)( struct draw_vertex_shader *shader,
+                              unsigned thread,
+                              const float (*input)[4],
+                              float (*output)[4],
+                              const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                              const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                              unsigned count,
+                              unsigned input_stride,
+                              unsigned output_stride );
+
 
    void (*delete)( struct draw_vertex_shader * );
 };
@@ -170,6 +183,33 @@ draw_create_vs_llvm(struct draw_context *draw,
 #endif
 
 
+/********************************************************************************
+ * Running the interpreted vertex shader on worker threads, see
+ * draw_vs_threads.c.
+ */
+boolean
+draw_vs_threads_enabled( struct draw_context *draw,
+                         const struct draw_vertex_shader *shader,
+                         unsigned count );
+
+void
+draw_vs_threads_run( struct draw_context *draw,
+                     struct draw_vertex_shader *shader,
+                     const float (*input)[4],
+                     float (*output)[4],
+                     const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                     const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                     unsigned count,
+                     unsigned input_stride,
+                     unsigned output_stride );
+
+struct tgsi_exec_machine *
+draw_vs_threads_machine( struct draw_context *draw, unsigned thread );
+
+unsigned
+draw_vs_threads_count( const struct draw_context *draw );
+
+
 /********************************************************************************
  * Helpers for vs implementations that don't do their own fetch/emit variants.
  * Means these can be shared between shaders.
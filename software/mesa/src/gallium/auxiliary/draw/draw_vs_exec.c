@@ -84,17 +84,16 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
  * it's time to try doing all the other stuff separately.
  */
 static void
-vs_exec_run_linear( struct draw_vertex_shader *shader,
-		    const float (*input)[4],
-		    float (*output)[4],
-                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
-                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
-		    unsigned count,
-		    unsigned input_stride,
-		    unsigned output_stride )
+vs_exec_run_machine( struct draw_vertex_shader *shader,
+                     struct tgsi_exec_machine *machine,
+                     const float (*input)[4],
+                     float (*output)[4],
+                     const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                     const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                     unsigned count,
+                     unsigned input_stride,
+                     unsigned output_stride )
 {
-   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
-   struct tgsi_exec_machine *machine = evs->machine;
    unsigned int i, j;
    unsigned slot;
    boolean clamp_vertex_color = shader->draw->rasterizer->clamp_vertex_color;
@@ -207,10 +206,85 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 
 
 
+static void
+vs_exec_run_linear( struct draw_vertex_shader *shader,
+		    const float (*input)[4],
+		    float (*output)[4],
+                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+		    unsigned count,
+		    unsigned input_stride,
+		    unsigned output_stride )
+{
+   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
+
+   vs_exec_run_machine(shader, evs->machine, input, output,
+                       constants, const_size, count,
+                       input_stride, output_stride);
+}
+
+
+/* Called from a draw_vs_threads worker.  Each worker owns its machine,
+ * so binding the shader here doesn't race with the other threads.
+ */
+static void
+vs_exec_run_linear_thread( struct draw_vertex_shader *shader,
+                           unsigned thread,
+                           const float (*input)[4],
+                           float (*output)[4],
+                           const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                           const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                           unsigned count,
+                           unsigned input_stride,
+                           unsigned output_stride )
+{
+   struct draw_context *draw = shader->draw;
+   struct tgsi_exec_machine *machine = draw_vs_threads_machine(draw, thread);
+
+   if (machine->Tokens != shader->state.tokens) {
+      tgsi_exec_machine_bind_shader(machine,
+                                    shader->state.tokens,
+                                    draw->vs.tgsi.sampler,
+                                    draw->vs.tgsi.image,
+                                    draw->vs.tgsi.buffer);
+   }
+
+   vs_exec_run_machine(shader, machine, input, output,
+                       constants, const_size, count,
+                       input_stride, output_stride);
+}
+
+
+/* Samplers, images and buffers are owned by the driver and aren't
+ * reentrant, and vertex ids are numbered from the start of each run, so
+ * shaders using any of them stay on the application thread.
+ */
+static boolean
+vs_exec_can_run_threaded( const struct tgsi_shader_info *info )
+{
+   return info->file_count[TGSI_FILE_SAMPLER] == 0 &&
+          info->file_count[TGSI_FILE_SAMPLER_VIEW] == 0 &&
+          info->file_count[TGSI_FILE_IMAGE] == 0 &&
+          info->file_count[TGSI_FILE_BUFFER] == 0 &&
+          !info->uses_vertexid &&
+          !info->uses_vertexid_nobase;
+}
+
 
 static void
 vs_exec_delete( struct draw_vertex_shader *dvs )
 {
+   unsigned i;
+
+   /* make sure no worker keeps pointing at the freed tokens */
+   for (i = 0; i < draw_vs_threads_count(dvs->draw); i++) {
+      struct tgsi_exec_machine *machine =
+         draw_vs_threads_machine(dvs->draw, i);
+
+      if (machine->Tokens == dvs->state.tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -238,6 +312,8 @@ draw_create_vs_exec(struct draw_context *draw,
    vs->base.draw = draw;
    vs->base.prepare = vs_exec_prepare;
    vs->base.run_linear = vs_exec_run_linear;
+   if (vs_exec_can_run_threaded(&vs->base.info))
+      vs->base.run_linear_thread = vs_exec_run_linear_thread;
    vs->base.delete = vs_exec_delete;
    vs->base.create_variant = draw_vs_create_variant_generic;
    vs->machine = draw->vs.tgsi.machine;
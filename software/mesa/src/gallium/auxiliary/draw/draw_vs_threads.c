@@ -0,0 +1,247 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Run the interpreted vertex shader on a pool of worker threads.
+ *
+ * The vertices of each segment handed to the fetch/shade/pipeline middle
+ * end are cut into contiguous chunks which are shaded concurrently, each
+ * worker on its own tgsi_exec_machine.  Chunks are written in place into
+ * the segment's output buffer and joined before clipping and emit, so
+ * primitive order and provoking vertices are the same as when shading
+ * serially.
+ *
+ * The number of workers comes from the DRAW_VS_THREADS environment
+ * variable; 0 (the default) keeps everything on the application thread.
+ */
+
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "draw_private.h"
+#include "draw_context.h"
+#include "draw_vs.h"
+
+
+#define DRAW_MAX_VS_THREADS 16
+
+/** Don't split segments into chunks smaller than this */
+#define DRAW_VS_MIN_CHUNK 64
+
+
+struct draw_vs_job {
+   struct draw_vertex_shader *shader;
+   const float (*input)[4];
+   float (*output)[4];
+   const void **constants;
+   const unsigned *const_size;
+   unsigned count;
+   unsigned input_stride;
+   unsigned output_stride;
+
+   struct util_queue_fence fence;
+};
+
+
+struct draw_vs_threads {
+   unsigned num_threads;
+   struct util_queue queue;
+   struct tgsi_exec_machine *machine[DRAW_MAX_VS_THREADS];
+   struct draw_vs_job job[DRAW_MAX_VS_THREADS];
+};
+
+
+static void
+draw_vs_job_execute(void *data, int thread_index)
+{
+   struct draw_vs_job *job = (struct draw_vs_job *) data;
+
+   job->shader->run_linear_thread(job->shader,
+                                  thread_index,
+                                  job->input,
+                                  job->output,
+                                  job->constants,
+                                  job->const_size,
+                                  job->count,
+                                  job->input_stride,
+                                  job->output_stride);
+}
+
+
+/**
+ * Should this many vertices of the given shader be split across the
+ * worker threads?
+ */
+boolean
+draw_vs_threads_enabled(struct draw_context *draw,
+                        const struct draw_vertex_shader *shader,
+                        unsigned count)
+{
+   return draw->vs.threads &&
+          shader->run_linear_thread &&
+          count >= 2 * DRAW_VS_MIN_CHUNK;
+}
+
+
+/**
+ * Shade count vertices, the first chunk on the calling thread and the
+ * rest on the workers.  Returns once all of them are done.
+ */
+void
+draw_vs_threads_run(struct draw_context *draw,
+                    struct draw_vertex_shader *shader,
+                    const float (*input)[4],
+                    float (*output)[4],
+                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                    unsigned count,
+                    unsigned input_stride,
+                    unsigned output_stride)
+{
+   struct draw_vs_threads *threads = draw->vs.threads;
+   const unsigned num_chunks = MIN2(threads->num_threads + 1,
+                                    count / DRAW_VS_MIN_CHUNK);
+   const unsigned chunk = align(DIV_ROUND_UP(count, num_chunks),
+                                MAX_TGSI_VERTICES);
+   unsigned start, i, nr_jobs = 0;
+
+   for (start = chunk; start < count; start += chunk) {
+      struct draw_vs_job *job = &threads->job[nr_jobs++];
+
+      assert(nr_jobs <= threads->num_threads);
+
+      job->shader = shader;
+      job->input = (const float (*)[4])
+         ((const char *)input + start * input_stride);
+      job->output = (float (*)[4])
+         ((char *)output + start * output_stride);
+      job->constants = constants;
+      job->const_size = const_size;
+      job->count = MIN2(chunk, count - start);
+      job->input_stride = input_stride;
+      job->output_stride = output_stride;
+
+      util_queue_add_job(&threads->queue, job, &job->fence,
+                         draw_vs_job_execute, NULL);
+   }
+
+   shader->run_linear(shader, input, output, constants, const_size,
+                      MIN2(chunk, count), input_stride, output_stride);
+
+   for (i = 0; i < nr_jobs; i++)
+      util_queue_job_wait(&threads->job[i].fence);
+}
+
+
+struct tgsi_exec_machine *
+draw_vs_threads_machine(struct draw_context *draw, unsigned thread)
+{
+   assert(draw->vs.threads);
+   assert(thread < draw->vs.threads->num_threads);
+   return draw->vs.threads->machine[thread];
+}
+
+
+unsigned
+draw_vs_threads_count(const struct draw_context *draw)
+{
+   return draw->vs.threads ? draw->vs.threads->num_threads : 0;
+}
+
+
+static void
+draw_vs_threads_free(struct draw_vs_threads *threads)
+{
+   unsigned i;
+
+   if (util_queue_is_initialized(&threads->queue))
+      util_queue_destroy(&threads->queue);
+
+   for (i = 0; i < DRAW_MAX_VS_THREADS; i++) {
+      if (threads->machine[i])
+         tgsi_exec_machine_destroy(threads->machine[i]);
+      util_queue_fence_destroy(&threads->job[i].fence);
+   }
+
+   FREE(threads);
+}
+
+
+/**
+ * Start the worker threads, if any were requested.  Failing to do so
+ * isn't fatal, the vertex shader then just runs on the calling thread.
+ */
+void
+draw_vs_threads_init(struct draw_context *draw)
+{
+   struct draw_vs_threads *threads;
+   unsigned num_threads, i;
+
+   num_threads = debug_get_num_option("DRAW_VS_THREADS", 0);
+   num_threads = MIN2(num_threads, DRAW_MAX_VS_THREADS);
+   if (!num_threads)
+      return;
+
+   threads = CALLOC_STRUCT(draw_vs_threads);
+   if (!threads)
+      return;
+
+   for (i = 0; i < DRAW_MAX_VS_THREADS; i++)
+      util_queue_fence_init(&threads->job[i].fence);
+
+   for (i = 0; i < num_threads; i++) {
+      threads->machine[i] = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+      if (!threads->machine[i])
+         goto fail;
+   }
+
+   if (!util_queue_init(&threads->queue, "drawvs", num_threads, num_threads))
+      goto fail;
+
+   /* the queue may have started fewer threads than asked for */
+   threads->num_threads = threads->queue.num_threads;
+   draw->vs.threads = threads;
+   return;
+
+fail:
+   debug_printf("draw: failed to start %u vertex shader threads\n",
+                num_threads);
+   draw_vs_threads_free(threads);
+}
+
+
+void
+draw_vs_threads_destroy(struct draw_context *draw)
+{
+   if (draw->vs.threads) {
+      draw_vs_threads_free(draw->vs.threads);
+      draw->vs.threads = NULL;
+   }
+}
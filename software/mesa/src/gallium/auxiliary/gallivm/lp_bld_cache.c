@@ -0,0 +1,216 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * On-disk cache of MCJIT object code.
+ *
+ * The key is computed from the module's IR before optimization, so any
+ * state that ends up in the generated code is accounted for without the
+ * callers having to describe it.  Modules which embed host addresses
+ * (e.g. calls to C fallbacks through lp_build_const_func_pointer) only
+ * hit as long as those addresses don't change between runs.
+ */
+
+
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_atomic.h"
+#include "os/os_thread.h"
+
+#include "lp_bld_debug.h"
+#include "lp_bld_init.h"
+#include "lp_bld_misc.h"
+#include "lp_bld_type.h"
+#include "lp_bld_cache.h"
+
+#include <llvm-c/Core.h>
+
+
+/**
+ * Code generation state mixed into every key, besides the IR itself.
+ */
+struct lp_cache_key_header
+{
+   char cpu_name[64];
+   struct util_cpu_caps caps;
+   unsigned native_vector_width;
+   unsigned optlevel;
+   unsigned pointer_size;
+};
+
+
+static struct disk_cache *lp_disk_cache = NULL;
+static once_flag lp_disk_cache_once = ONCE_FLAG_INIT;
+static struct lp_cache_stats lp_cache_stats;
+
+
+/**
+ * The cache is shared by all gallivm users in the process and lives until
+ * the process exits.
+ */
+static void
+create_disk_cache(void)
+{
+   char driver_id[128];
+   uint32_t timestamp = 0;
+
+   disk_cache_get_function_timestamp((void *) create_disk_cache, &timestamp);
+
+   util_snprintf(driver_id, sizeof driver_id,
+                 "gallivm LLVM %u.%u"
+#ifdef MESA_LLVM_VERSION_PATCH
+                 ".%u"
+#endif
+                 " %u",
+                 HAVE_LLVM >> 8, HAVE_LLVM & 0xff,
+#ifdef MESA_LLVM_VERSION_PATCH
+                 MESA_LLVM_VERSION_PATCH,
+#endif
+                 timestamp);
+
+   lp_disk_cache = disk_cache_create(driver_id);
+}
+
+
+static void
+print_stats(const char *what, const char *name, size_t size)
+{
+   debug_printf("gallivm cache: %s %s (%u bytes), "
+                "%u hits, %u misses, %u stores, "
+                "%llu bytes loaded, %llu bytes stored\n",
+                what, name ? name : "object", (unsigned) size,
+                lp_cache_stats.hits, lp_cache_stats.misses,
+                lp_cache_stats.stores,
+                (unsigned long long) lp_cache_stats.bytes_loaded,
+                (unsigned long long) lp_cache_stats.bytes_stored);
+}
+
+
+/**
+ * Compute the key of the gallivm module and fetch its object code.
+ * Must be called before the module is optimized.
+ *
+ * \return NULL if there is no cache, otherwise the cache state of the
+ *         module, with data set when the object code was found.
+ */
+struct lp_cached_code *
+lp_build_cache_lookup(struct gallivm_state *gallivm, unsigned optlevel)
+{
+   struct lp_cache_key_header header;
+   struct lp_cached_code *cached;
+   char *ir;
+   size_t ir_size;
+   uint8_t *buf;
+
+   call_once(&lp_disk_cache_once, create_disk_cache);
+   if (!lp_disk_cache)
+      return NULL;
+
+   memset(&header, 0, sizeof header);
+   lp_get_host_cpu_name(header.cpu_name, sizeof header.cpu_name);
+   header.caps = util_cpu_caps;
+   header.caps.nr_cpus = 0;
+   header.native_vector_width = lp_native_vector_width;
+   header.optlevel = optlevel;
+   header.pointer_size = sizeof(void *);
+
+   ir = LLVMPrintModuleToString(gallivm->module);
+   if (!ir)
+      return NULL;
+   ir_size = strlen(ir);
+
+   buf = MALLOC(sizeof header + ir_size);
+   cached = CALLOC_STRUCT(lp_cached_code);
+   if (!buf || !cached) {
+      FREE(buf);
+      FREE(cached);
+      LLVMDisposeMessage(ir);
+      return NULL;
+   }
+
+   memcpy(buf, &header, sizeof header);
+   memcpy(buf + sizeof header, ir, ir_size);
+   LLVMDisposeMessage(ir);
+
+   disk_cache_compute_key(lp_disk_cache, buf, sizeof header + ir_size,
+                          cached->key);
+   FREE(buf);
+
+   cached->data = disk_cache_get(lp_disk_cache, cached->key,
+                                 &cached->data_size);
+   if (cached->data) {
+      p_atomic_inc(&lp_cache_stats.hits);
+      p_atomic_add(&lp_cache_stats.bytes_loaded, cached->data_size);
+      if (gallivm_debug & GALLIVM_DEBUG_CACHE)
+         print_stats("hit", gallivm->module_name, cached->data_size);
+   } else {
+      p_atomic_inc(&lp_cache_stats.misses);
+      if (gallivm_debug & GALLIVM_DEBUG_CACHE)
+         print_stats("miss", gallivm->module_name, 0);
+   }
+
+   return cached;
+}
+
+
+/**
+ * Store the object code MCJIT produced on a miss.
+ */
+void
+lp_build_cache_store(struct lp_cached_code *cached,
+                     const void *data, size_t size)
+{
+   assert(lp_disk_cache);
+   assert(!cached->data);
+
+   disk_cache_put(lp_disk_cache, cached->key, data, size);
+
+   p_atomic_inc(&lp_cache_stats.stores);
+   p_atomic_add(&lp_cache_stats.bytes_stored, size);
+   if (gallivm_debug & GALLIVM_DEBUG_CACHE)
+      print_stats("stored", NULL, size);
+}
+
+
+void
+lp_build_cache_free(struct lp_cached_code *cached)
+{
+   if (cached) {
+      free(cached->data);
+      FREE(cached);
+   }
+}
+
+
+void
+lp_build_cache_get_stats(struct lp_cache_stats *stats)
+{
+   *stats = lp_cache_stats;
+}
@@ -0,0 +1,98 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * On-disk cache of MCJIT object code.
+ *
+ * Modules are keyed by their unoptimized IR together with everything that
+ * influences code generation (LLVM version, host CPU, enabled CPU features,
+ * native vector width).  On a hit the optimization passes and the LLVM
+ * back-end are skipped and MCJIT loads, maps and relocates the cached
+ * object through the shader memory manager instead.
+ */
+
+
+#ifndef LP_BLD_CACHE_H
+#define LP_BLD_CACHE_H
+
+
+#include "pipe/p_compiler.h"
+#include "util/disk_cache.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct gallivm_state;
+
+
+/**
+ * Cache state of one module.
+ */
+struct lp_cached_code
+{
+   cache_key key;
+
+   /** Object code found in the cache, or NULL on a miss */
+   void *data;
+   size_t data_size;
+};
+
+
+struct lp_cache_stats
+{
+   unsigned hits;
+   unsigned misses;
+   unsigned stores;
+   uint64_t bytes_loaded;
+   uint64_t bytes_stored;
+};
+
+
+struct lp_cached_code *
+lp_build_cache_lookup(struct gallivm_state *gallivm, unsigned optlevel);
+
+void
+lp_build_cache_store(struct lp_cached_code *cached,
+                     const void *data, size_t size);
+
+void
+lp_build_cache_free(struct lp_cached_code *cached);
+
+void
+lp_build_cache_get_stats(struct lp_cache_stats *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* !LP_BLD_CACHE_H */
@@ -37,6 +37,7 @@
 #include "lp_bld_debug.h"
 #include "lp_bld_misc.h"
 #include "lp_bld_init.h"
+#include "lp_bld_cache.h"
 
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Transforms/Scalar.h>
@@ -67,6 +68,7 @@ static const struct debug_named_value lp_bld_debug_flags[] = {
    { "no_quad_lod", GALLIVM_DEBUG_NO_QUAD_LOD, NULL },
    { "gc",     GALLIVM_DEBUG_GC, NULL },
    { "dumpbc", GALLIVM_DEBUG_DUMP_BC, NULL },
+   { "cache",  GALLIVM_DEBUG_CACHE, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -96,6 +98,18 @@ enum LLVM_CodeGenOpt_Level {
 };
 
 
+static enum LLVM_CodeGenOpt_Level
+get_optlevel(const struct gallivm_state *gallivm)
+{
+   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) || gallivm->unoptimized) {
+      return None;
+   }
+   else {
+      return Default;
+   }
+}
+
+
 /**
  * Create the LLVM (optimization) pass manager and install
  * relevant optimization passes.
@@ -145,7 +159,7 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMSetDataLayout(gallivm->module, "");
 #endif
 
-   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0) {
+   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0 && !gallivm->unoptimized) {
       /* These are the passes currently listed in llvm-c/Transforms/Scalar.h,
        * but there are more on SVN.
        * TODO: Add more passes.
@@ -201,6 +215,9 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    if (gallivm->builder)
       LLVMDisposeBuilder(gallivm->builder);
 
+   /* Only needed until the engine has generated the code */
+   lp_build_cache_free(gallivm->cache);
+
    /* The LLVMContext should be owned by the parent of gallivm. */
 
    gallivm->engine = NULL;
@@ -210,6 +227,7 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    gallivm->passmgr = NULL;
    gallivm->context = NULL;
    gallivm->builder = NULL;
+   gallivm->cache = NULL;
 }
 
 
@@ -232,21 +250,15 @@ static boolean
 init_gallivm_engine(struct gallivm_state *gallivm)
 {
    if (1) {
-      enum LLVM_CodeGenOpt_Level optlevel;
+      enum LLVM_CodeGenOpt_Level optlevel = get_optlevel(gallivm);
       char *error = NULL;
       int ret;
 
-      if (gallivm_debug & GALLIVM_DEBUG_NO_OPT) {
-         optlevel = None;
-      }
-      else {
-         optlevel = Default;
-      }
-
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
+                                                    gallivm->cache,
                                                     (unsigned) optlevel,
                                                     USE_MCJIT,
                                                     &error);
@@ -507,6 +519,29 @@ gallivm_create(const char *name, LLVMContextRef context)
 }
 
 
+/**
+ * Create a new gallivm_state object whose code is generated without
+ * optimizations, as with GALLIVM_DEBUG=nopt.  The code is slower, but
+ * compiles several times faster.
+ */
+struct gallivm_state *
+gallivm_create_unoptimized(const char *name, LLVMContextRef context)
+{
+   struct gallivm_state *gallivm;
+
+   gallivm = CALLOC_STRUCT(gallivm_state);
+   if (gallivm) {
+      gallivm->unoptimized = TRUE;
+      if (!init_gallivm_state(gallivm, name, context)) {
+         FREE(gallivm);
+         gallivm = NULL;
+      }
+   }
+
+   return gallivm;
+}
+
+
 /**
  * Destroy a gallivm_state object.
  */
@@ -561,37 +596,47 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       gallivm->builder = NULL;
    }
 
-   if (gallivm_debug & GALLIVM_DEBUG_PERF)
-      time_begin = os_time_get();
+   /*
+    * MCJIT can load the module's object code from the on-disk cache, in
+    * which case the code is already optimized.
+    */
+   if (USE_MCJIT) {
+      gallivm->cache = lp_build_cache_lookup(gallivm, get_optlevel(gallivm));
+   }
 
-   /* Run optimization passes */
-   LLVMInitializeFunctionPassManager(gallivm->passmgr);
-   func = LLVMGetFirstFunction(gallivm->module);
-   while (func) {
-      if (0) {
-         debug_printf("optimizing func %s...\n", LLVMGetValueName(func));
-      }
+   if (!gallivm->cache || !gallivm->cache->data) {
+      if (gallivm_debug & GALLIVM_DEBUG_PERF)
+         time_begin = os_time_get();
+
+      /* Run optimization passes */
+      LLVMInitializeFunctionPassManager(gallivm->passmgr);
+      func = LLVMGetFirstFunction(gallivm->module);
+      while (func) {
+         if (0) {
+            debug_printf("optimizing func %s...\n", LLVMGetValueName(func));
+         }
 
-   /* Disable frame pointer omission on debug/profile builds */
-   /* XXX: And workaround http://llvm.org/PR21435 */
+      /* Disable frame pointer omission on debug/profile builds */
+      /* XXX: And workaround http://llvm.org/PR21435 */
 #if HAVE_LLVM >= 0x0307 && \
     (defined(DEBUG) || defined(PROFILE) || \
      defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64))
-      LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim", "true");
-      LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
+         LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim", "true");
+         LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
 #endif
 
-      LLVMRunFunctionPassManager(gallivm->passmgr, func);
-      func = LLVMGetNextFunction(func);
-   }
-   LLVMFinalizeFunctionPassManager(gallivm->passmgr);
-
-   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
-      int64_t time_end = os_time_get();
-      int time_msec = (int)(time_end - time_begin) / 1000;
-      assert(gallivm->module_name);
-      debug_printf("optimizing module %s took %d msec\n",
-                   gallivm->module_name, time_msec);
+         LLVMRunFunctionPassManager(gallivm->passmgr, func);
+         func = LLVMGetNextFunction(func);
+      }
+      LLVMFinalizeFunctionPassManager(gallivm->passmgr);
+
+      if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+         int64_t time_end = os_time_get();
+         int time_msec = (int)(time_end - time_begin) / 1000;
+         assert(gallivm->module_name);
+         debug_printf("optimizing module %s took %d msec\n",
+                      gallivm->module_name, time_msec);
+      }
    }
 
    /* Dump byte code to a file */
@@ -50,7 +50,9 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code *cache;
    unsigned compiled;
+   boolean unoptimized;
 };
 
 
@@ -61,6 +63,9 @@ lp_build_init(void);
 struct gallivm_state *
 gallivm_create(const char *name, LLVMContextRef context);
 
+struct gallivm_state *
+gallivm_create_unoptimized(const char *name, LLVMContextRef context);
+
 void
 gallivm_destroy(struct gallivm_state *gallivm);
 
@@ -71,6 +71,10 @@
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #endif
+#if HAVE_LLVM >= 0x0303
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/PrettyStackTrace.h>
@@ -96,8 +100,10 @@
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_string.h"
 
 #include "lp_bld_misc.h"
+#include "lp_bld_cache.h"
 
 namespace {
 
@@ -389,12 +395,22 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
       typedef std::vector<void *> Vec;
       Vec FunctionBody, ExceptionTable;
       BaseMemoryManager *TheMM;
+#if HAVE_LLVM >= 0x0303
+      llvm::ObjectCache *Cache;
+#endif
 
       GeneratedCode(BaseMemoryManager *MM) {
          TheMM = MM;
+#if HAVE_LLVM >= 0x0303
+         Cache = NULL;
+#endif
       }
 
       ~GeneratedCode() {
+#if HAVE_LLVM >= 0x0303
+         delete Cache;
+#endif
+
          /*
           * Deallocate things as previously requested and
           * free shared manager when no longer used.
@@ -441,6 +457,17 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
          delete (GeneratedCode *) code;
       }
 
+#if HAVE_LLVM >= 0x0303
+      /*
+       * The execution engine doesn't take ownership of its object cache,
+       * so keep it alive for as long as the generated code.
+       */
+      static void setObjectCache(struct lp_generated_code *code,
+                                 llvm::ObjectCache *Cache) {
+         ((GeneratedCode *) code)->Cache = Cache;
+      }
+#endif
+
 #if HAVE_LLVM < 0x0304
       virtual void deallocateExceptionTable(void *ET) {
          // remember for later deallocation
@@ -455,10 +482,65 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
 };
 
 
+#if HAVE_LLVM >= 0x0303
+/**
+ * Object cache backed by the gallivm on-disk cache.
+ *
+ * MCJIT asks for the module's object before compiling it.  When the module
+ * was found in the cache the object is handed over as is and MCJIT only
+ * has to load it and apply the relocations, allocating the sections through
+ * the ShaderMemoryManager like for freshly compiled code.  Otherwise the
+ * object produced by the back-end is stored for the next run.
+ */
+class ShaderObjectCache : public llvm::ObjectCache {
+
+   struct lp_cached_code *cached;
+
+   public:
+
+      ShaderObjectCache(struct lp_cached_code *cached) {
+         this->cached = cached;
+      }
+
+#if HAVE_LLVM >= 0x0306
+      virtual void notifyObjectCompiled(const llvm::Module *M,
+                                        llvm::MemoryBufferRef Obj) {
+         lp_build_cache_store(cached, Obj.getBufferStart(),
+                              Obj.getBufferSize());
+      }
+
+      virtual std::unique_ptr<llvm::MemoryBuffer>
+      getObject(const llvm::Module *M) {
+         if (!cached->data)
+            return nullptr;
+         return llvm::MemoryBuffer::getMemBufferCopy(
+                   llvm::StringRef((const char *) cached->data,
+                                   cached->data_size));
+      }
+#else
+      virtual void notifyObjectCompiled(const llvm::Module *M,
+                                        const llvm::MemoryBuffer *Obj) {
+         lp_build_cache_store(cached, Obj->getBufferStart(),
+                              Obj->getBufferSize());
+      }
+
+      virtual llvm::MemoryBuffer *getObject(const llvm::Module *M) {
+         if (!cached->data)
+            return NULL;
+         return llvm::MemoryBuffer::getMemBufferCopy(
+                   llvm::StringRef((const char *) cached->data,
+                                   cached->data_size));
+      }
+#endif
+};
+#endif /* HAVE_LLVM >= 0x0303 */
+
+
 /**
  * Same as LLVMCreateJITCompilerForModule, but:
  * - allows using MCJIT and enabling AVX feature where available.
  * - set target options
+ * - load and store the object code through the on-disk cache
  *
  * See also:
  * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
@@ -471,6 +553,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         lp_generated_code **OutCode,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef CMM,
+                                        struct lp_cached_code *Cache,
                                         unsigned OptLevel,
                                         int useMCJIT,
                                         char **OutError)
@@ -660,6 +743,13 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0303
+      if (useMCJIT && Cache) {
+         ShaderObjectCache *OC = new ShaderObjectCache(Cache);
+         ShaderMemoryManager::setObjectCache(*OutCode, OC);
+         JIT->setObjectCache(OC);
+      }
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -698,6 +788,17 @@ lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr)
    delete reinterpret_cast<BaseMemoryManager*>(memorymgr);
 }
 
+extern "C" void
+lp_get_host_cpu_name(char *name, unsigned size)
+{
+#if HAVE_LLVM >= 0x0305
+   std::string cpu = llvm::sys::getHostCPUName().str();
+#else
+   std::string cpu = llvm::sys::getHostCPUName();
+#endif
+   util_snprintf(name, size, "%s", cpu.c_str());
+}
+
 extern "C" void
 lp_add_attr_dereferenceable(LLVMValueRef val, uint64_t bytes)
 {
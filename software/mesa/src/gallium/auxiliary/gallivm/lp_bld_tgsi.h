@@ -67,6 +67,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -170,6 +171,10 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef prim_id;
    LLVMValueRef basevertex;
    LLVMValueRef invocation_id;
+   LLVMValueRef thread_id[3];    /**< vectors, one invocation per element */
+   LLVMValueRef block_id[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef block_size[3];
 };
 
 
@@ -230,7 +235,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -425,6 +431,30 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Memory and synchronization of compute shaders.  Shader buffers and
+ * shared memory are plain byte ranges, which LOAD, STORE and the atomic
+ * opcodes access with bounds checking.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   /** Get the base pointer (i8*) and size in bytes (i32) of a buffer */
+   void (*buffer)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                  struct gallivm_state *gallivm,
+                  unsigned unit,
+                  LLVMValueRef *base,
+                  LLVMValueRef *size);
+   /** Get the base pointer (i8*) and size in bytes (i32) of the shared
+    * memory of the work group */
+   void (*shared_memory)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                         struct gallivm_state *gallivm,
+                         LLVMValueRef *base,
+                         LLVMValueRef *size);
+   /** Wait for the other invocations of the work group */
+   void (*barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                   struct gallivm_state *gallivm);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -433,6 +463,7 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
@@ -1672,6 +1672,36 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_id[swizzle]) :
+         bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.grid_size[swizzle]) :
+         bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_size[swizzle]) :
+         bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -3735,6 +3765,339 @@ cont_emit(
    lp_exec_continue(&bld->exec_mask);
 }
 
+/**
+ * Get the base pointer and size in bytes of the buffer or the shared
+ * memory accessed by a LOAD, STORE or atomic instruction.
+ */
+static void
+get_mem_range(struct lp_build_tgsi_soa_context *bld,
+              unsigned file, unsigned index,
+              LLVMValueRef *base, LLVMValueRef *size)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+
+   if (file == TGSI_FILE_MEMORY)
+      bld->cs_iface->shared_memory(bld->cs_iface, gallivm, base, size);
+   else
+      bld->cs_iface->buffer(bld->cs_iface, gallivm, index, base, size);
+}
+
+
+/**
+ * Compute a pointer to the dword at byte \p offset for every element.
+ * Elements that are inactive or out of bounds get \p dummy instead, a
+ * private dword, so the accesses need no branches.
+ * Returns the mask of the elements that access the memory.
+ */
+static LLVMValueRef
+get_mem_ptrs(struct lp_build_tgsi_soa_context *bld,
+             LLVMValueRef base, LLVMValueRef size,
+             LLVMValueRef offset, LLVMValueRef exec_mask,
+             LLVMValueRef dummy,
+             LLVMValueRef ptrs[LP_MAX_VECTOR_LENGTH])
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMTypeRef ptr_type =
+      LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+   LLVMValueRef four = lp_build_const_int32(gallivm, 4);
+   LLVMValueRef limit, mask;
+   unsigned i;
+
+   /* offset + 4 <= size, without overflow */
+   limit = LLVMBuildSelect(builder,
+                           LLVMBuildICmp(builder, LLVMIntUGE, size, four, ""),
+                           LLVMBuildSub(builder, size,
+                                        lp_build_const_int32(gallivm, 3), ""),
+                           lp_build_const_int32(gallivm, 0), "");
+   mask = lp_build_cmp(uint_bld, PIPE_FUNC_LESS, offset,
+                       lp_build_broadcast_scalar(uint_bld, limit));
+   mask = LLVMBuildAnd(builder, mask, exec_mask, "");
+
+   for (i = 0; i < uint_bld->type.length; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      LLVMValueRef elem_offset =
+         LLVMBuildExtractElement(builder, offset, index, "");
+      LLVMValueRef active =
+         LLVMBuildICmp(builder, LLVMIntNE,
+                       LLVMBuildExtractElement(builder, mask, index, ""),
+                       lp_build_const_int32(gallivm, 0), "");
+      LLVMValueRef ptr = LLVMBuildGEP(builder, base, &elem_offset, 1, "");
+
+      ptr = LLVMBuildBitCast(builder, ptr, ptr_type, "");
+      ptrs[i] = LLVMBuildSelect(builder, active, ptr, dummy, "");
+   }
+
+   return mask;
+}
+
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base, size, offset, exec_mask, dummy;
+   unsigned chan;
+
+   get_mem_range(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                 &base, &size);
+
+   offset = lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X);
+   offset = LLVMBuildBitCast(builder, offset, uint_bld->vec_type, "");
+   exec_mask = mask_vec(bld_base);
+   dummy = lp_build_alloca(gallivm, LLVMInt32TypeInContext(gallivm->context),
+                           "dummy");
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef ptrs[LP_MAX_VECTOR_LENGTH];
+      LLVMValueRef chan_offset, mask, res;
+      unsigned i;
+
+      chan_offset = lp_build_add(uint_bld, offset,
+                                 lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                        4 * chan));
+      mask = get_mem_ptrs(bld, base, size, chan_offset, exec_mask, dummy, ptrs);
+
+      res = uint_bld->undef;
+      for (i = 0; i < uint_bld->type.length; i++) {
+         res = LLVMBuildInsertElement(builder, res,
+                                      LLVMBuildLoad(builder, ptrs[i], ""),
+                                      lp_build_const_int32(gallivm, i), "");
+      }
+      res = lp_build_select(uint_bld, mask, res, uint_bld->zero);
+
+      emit_data->output[chan] =
+         LLVMBuildBitCast(builder, res, bld_base->base.vec_type, "");
+   }
+}
+
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base, size, offset, exec_mask, dummy;
+   unsigned chan;
+
+   get_mem_range(bld, inst->Dst[0].Register.File, inst->Dst[0].Register.Index,
+                 &base, &size);
+
+   offset = lp_build_emit_fetch(bld_base, inst, 0, TGSI_CHAN_X);
+   offset = LLVMBuildBitCast(builder, offset, uint_bld->vec_type, "");
+   exec_mask = mask_vec(bld_base);
+   dummy = lp_build_alloca(gallivm, LLVMInt32TypeInContext(gallivm->context),
+                           "dummy");
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef ptrs[LP_MAX_VECTOR_LENGTH];
+      LLVMValueRef chan_offset, value;
+      unsigned i;
+
+      value = lp_build_emit_fetch(bld_base, inst, 1, chan);
+      value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+
+      chan_offset = lp_build_add(uint_bld, offset,
+                                 lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                        4 * chan));
+      get_mem_ptrs(bld, base, size, chan_offset, exec_mask, dummy, ptrs);
+
+      for (i = 0; i < uint_bld->type.length; i++) {
+         LLVMBuildStore(builder,
+                        LLVMBuildExtractElement(builder, value,
+                                                lp_build_const_int32(gallivm, i),
+                                                ""),
+                        ptrs[i]);
+      }
+   }
+}
+
+
+static void
+atomic_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const unsigned opcode = inst->Instruction.Opcode;
+   LLVMAtomicRMWBinOp op = LLVMAtomicRMWBinOpAdd;
+   LLVMValueRef base, size, offset, exec_mask, dummy;
+   unsigned chan;
+
+   switch (opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+      op = LLVMAtomicRMWBinOpAdd;
+      break;
+   case TGSI_OPCODE_ATOMXCHG:
+      op = LLVMAtomicRMWBinOpXchg;
+      break;
+   case TGSI_OPCODE_ATOMAND:
+      op = LLVMAtomicRMWBinOpAnd;
+      break;
+   case TGSI_OPCODE_ATOMOR:
+      op = LLVMAtomicRMWBinOpOr;
+      break;
+   case TGSI_OPCODE_ATOMXOR:
+      op = LLVMAtomicRMWBinOpXor;
+      break;
+   case TGSI_OPCODE_ATOMUMIN:
+      op = LLVMAtomicRMWBinOpUMin;
+      break;
+   case TGSI_OPCODE_ATOMUMAX:
+      op = LLVMAtomicRMWBinOpUMax;
+      break;
+   case TGSI_OPCODE_ATOMIMIN:
+      op = LLVMAtomicRMWBinOpMin;
+      break;
+   case TGSI_OPCODE_ATOMIMAX:
+      op = LLVMAtomicRMWBinOpMax;
+      break;
+   case TGSI_OPCODE_ATOMCAS:
+      break;
+   default:
+      assert(0);
+      return;
+   }
+
+   get_mem_range(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                 &base, &size);
+
+   offset = lp_build_emit_fetch(bld_base, inst, 1, TGSI_CHAN_X);
+   offset = LLVMBuildBitCast(builder, offset, uint_bld->vec_type, "");
+   exec_mask = mask_vec(bld_base);
+   dummy = lp_build_alloca(gallivm, LLVMInt32TypeInContext(gallivm->context),
+                           "dummy");
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef ptrs[LP_MAX_VECTOR_LENGTH];
+      LLVMValueRef chan_offset, mask, value, value2 = NULL, res;
+      unsigned i;
+
+      value = lp_build_emit_fetch(bld_base, inst, 2, chan);
+      value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+      if (opcode == TGSI_OPCODE_ATOMCAS) {
+         value2 = lp_build_emit_fetch(bld_base, inst, 3, chan);
+         value2 = LLVMBuildBitCast(builder, value2, uint_bld->vec_type, "");
+      }
+
+      chan_offset = lp_build_add(uint_bld, offset,
+                                 lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                        4 * chan));
+      mask = get_mem_ptrs(bld, base, size, chan_offset, exec_mask, dummy, ptrs);
+
+      res = uint_bld->undef;
+      for (i = 0; i < uint_bld->type.length; i++) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, i);
+         LLVMValueRef elem = LLVMBuildExtractElement(builder, value, index, "");
+         LLVMValueRef old;
+
+         if (opcode == TGSI_OPCODE_ATOMCAS) {
+#if HAVE_LLVM >= 0x0309
+            LLVMValueRef elem2 =
+               LLVMBuildExtractElement(builder, value2, index, "");
+            old = LLVMBuildAtomicCmpXchg(builder, ptrs[i], elem, elem2,
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         FALSE);
+            old = LLVMBuildExtractValue(builder, old, 0, "");
+#else
+            /* Not atomic.  Without LLVMBuildAtomicCmpXchg and
+             * LLVMBuildFence llvmpipe doesn't expose compute shaders or
+             * shader buffers, so nothing else can access the memory.
+             */
+            LLVMValueRef elem2 =
+               LLVMBuildExtractElement(builder, value2, index, "");
+            LLVMValueRef equal;
+            old = LLVMBuildLoad(builder, ptrs[i], "");
+            equal = LLVMBuildICmp(builder, LLVMIntEQ, old, elem, "");
+            LLVMBuildStore(builder,
+                           LLVMBuildSelect(builder, equal, elem2, old, ""),
+                           ptrs[i]);
+#endif
+         }
+         else {
+            old = LLVMBuildAtomicRMW(builder, op, ptrs[i], elem,
+                                     LLVMAtomicOrderingSequentiallyConsistent,
+                                     FALSE);
+         }
+
+         res = LLVMBuildInsertElement(builder, res, old, index, "");
+      }
+      res = lp_build_select(uint_bld, mask, res, uint_bld->zero);
+
+      emit_data->output[chan] =
+         LLVMBuildBitCast(builder, res, bld_base->base.vec_type, "");
+   }
+}
+
+
+static void
+resq_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef base, size;
+   unsigned chan;
+
+   get_mem_range(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                 &base, &size);
+
+   size = lp_build_broadcast_scalar(&bld_base->uint_bld, size);
+   size = LLVMBuildBitCast(builder, size, bld_base->base.vec_type, "");
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = size;
+   }
+}
+
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   bld->cs_iface->barrier(bld->cs_iface, bld_base->base.gallivm);
+}
+
+
+static void
+membar_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+#if HAVE_LLVM >= 0x0309
+   LLVMBuildFence(bld_base->base.gallivm->builder,
+                  LLVMAtomicOrderingSequentiallyConsistent, FALSE, "");
+#endif
+}
+
 static void emit_prologue(struct lp_build_tgsi_context * bld_base)
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
@@ -3878,7 +4241,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -4019,6 +4383,25 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_RESQ].emit = resq_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUADD].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXCHG].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMCAS].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMAND].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMOR].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXOR].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMIN].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMAX].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMIN].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMAX].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = membar_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
@@ -96,6 +96,27 @@ static inline void pipe_thread_setname( const char *name )
    (void)name;
 }
 
+/**
+ * Restrict the calling thread to run on the given CPU only.
+ * Returns FALSE if that isn't supported or the CPU doesn't exist.
+ */
+static inline boolean pipe_thread_set_cpu( unsigned cpu )
+{
+#if defined(HAVE_PTHREAD) && defined(PIPE_OS_LINUX) && defined(CPU_SET)
+   cpu_set_t set;
+
+   if (cpu >= CPU_SETSIZE)
+      return FALSE;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+   return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#else
+   (void)cpu;
+   return FALSE;
+#endif
+}
+
 
 /* pipe_mutex
  */
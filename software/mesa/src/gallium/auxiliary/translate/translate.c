@@ -42,10 +42,12 @@ struct translate *translate_create( const struct translate_key *key )
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
-#else
-   (void)translate;
 #endif
 
+   translate = translate_simd_create( key );
+   if (translate)
+      return translate;
+
    return translate_generic_create( key );
 }
 
@@ -0,0 +1,417 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Portable batched vertex fetch/emit.
+ *
+ * translate_generic converts one attribute of one vertex at a time through
+ * a pair of u_format function pointers.  Here vertices are processed in
+ * batches, attribute by attribute, with a kernel specialised for the
+ * (input format, output format) pair.  Each kernel is a plain C loop with
+ * fixed channel counts and no calls, which the compiler can unroll and
+ * vectorize for whatever the host has (SSE, NEON, ...), so no run-time
+ * code generation is needed.
+ *
+ * Only the common pairs have kernels; translate_simd_create() returns NULL
+ * for any other key and the caller falls back to translate_generic.  The
+ * conversions are the same as u_format's, so the results are identical to
+ * translate_generic's.
+ */
+
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "pipe/p_state.h"
+#include "translate.h"
+
+
+/** Vertices converted per kernel call */
+#define SIMD_BATCH 64
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(no_simd, "TRANSLATE_NO_SIMD", FALSE)
+
+
+typedef void (*simd_kernel)(const uint8_t * const *src,
+                            unsigned count,
+                            uint8_t *dst,
+                            unsigned dst_stride);
+
+
+struct translate_simd {
+   struct translate translate;
+
+   struct {
+      enum translate_element_type type;
+      simd_kernel kernel;
+      unsigned buffer;
+      unsigned input_offset;
+      unsigned instance_divisor;
+      unsigned output_offset;
+      boolean float_instance_id;
+
+      const uint8_t *input_ptr;
+      unsigned input_stride;
+      unsigned max_index;
+   } attrib[TRANSLATE_MAX_ATTRIBS];
+
+   unsigned nr_attrib;
+};
+
+
+static struct translate_simd *translate_simd( struct translate *translate )
+{
+   return (struct translate_simd *)translate;
+}
+
+
+/*
+ * Kernels.
+ */
+
+#define COPY_KERNEL(SIZE)                                               \
+static void                                                             \
+copy_##SIZE(const uint8_t * const *src, unsigned count,                 \
+            uint8_t *dst, unsigned dst_stride)                          \
+{                                                                       \
+   unsigned i;                                                          \
+   for (i = 0; i < count; i++)                                          \
+      memcpy(dst + i * dst_stride, src[i], SIZE);                       \
+}
+
+COPY_KERNEL(4)
+COPY_KERNEL(8)
+COPY_KERNEL(12)
+COPY_KERNEL(16)
+
+
+/**
+ * NR 32-bit floats to float4, missing channels filled with (0, 0, 0, 1).
+ */
+#define FLOAT_KERNEL(NAME, NR)                                          \
+static void                                                             \
+NAME(const uint8_t * const *src, unsigned count,                        \
+     uint8_t *dst, unsigned dst_stride)                                 \
+{                                                                       \
+   unsigned i, c;                                                       \
+   for (i = 0; i < count; i++) {                                        \
+      float in[NR];                                                     \
+      float out[4] = { 0.0f, 0.0f, 0.0f, 1.0f };                        \
+      memcpy(in, src[i], sizeof(in));                                   \
+      for (c = 0; c < NR; c++)                                          \
+         out[c] = in[c];                                                \
+      memcpy(dst + i * dst_stride, out, sizeof(out));                   \
+   }                                                                    \
+}
+
+FLOAT_KERNEL(fetch_R32_FLOAT, 1)
+FLOAT_KERNEL(fetch_R32G32_FLOAT, 2)
+FLOAT_KERNEL(fetch_R32G32B32_FLOAT, 3)
+
+
+/**
+ * Four 8-bit channels to float4.  R, G, B, A are the byte offsets of the
+ * channels, CONV the per channel conversion.
+ */
+#define UBYTE4_KERNEL(NAME, R, G, B, A, TYPE, CONV)                     \
+static void                                                             \
+NAME(const uint8_t * const *src, unsigned count,                        \
+     uint8_t *dst, unsigned dst_stride)                                 \
+{                                                                       \
+   unsigned i;                                                          \
+   for (i = 0; i < count; i++) {                                        \
+      const TYPE *in = (const TYPE *) src[i];                           \
+      float out[4];                                                     \
+      out[0] = CONV(in[R]);                                             \
+      out[1] = CONV(in[G]);                                             \
+      out[2] = CONV(in[B]);                                             \
+      out[3] = CONV(in[A]);                                             \
+      memcpy(dst + i * dst_stride, out, sizeof(out));                   \
+   }                                                                    \
+}
+
+#define FROM_8_UNORM(x)    ubyte_to_float(x)
+#define FROM_8_USCALED(x)  ((float) (x))
+#define FROM_8_SNORM(x)    ((float) ((x) * (1.0f / 0x7f)))
+
+UBYTE4_KERNEL(fetch_R8G8B8A8_UNORM, 0, 1, 2, 3, uint8_t, FROM_8_UNORM)
+UBYTE4_KERNEL(fetch_B8G8R8A8_UNORM, 2, 1, 0, 3, uint8_t, FROM_8_UNORM)
+UBYTE4_KERNEL(fetch_R8G8B8A8_USCALED, 0, 1, 2, 3, uint8_t, FROM_8_USCALED)
+UBYTE4_KERNEL(fetch_R8G8B8A8_SNORM, 0, 1, 2, 3, int8_t, FROM_8_SNORM)
+
+
+static simd_kernel
+get_kernel(enum pipe_format input_format, enum pipe_format output_format)
+{
+   if (input_format == output_format) {
+      const struct util_format_description *desc =
+         util_format_description(input_format);
+
+      if (desc->block.width != 1 || desc->block.height != 1)
+         return NULL;
+
+      switch (desc->block.bits) {
+      case 32:
+         return copy_4;
+      case 64:
+         return copy_8;
+      case 96:
+         return copy_12;
+      case 128:
+         return copy_16;
+      default:
+         return NULL;
+      }
+   }
+
+   /* emit: float4 down to fewer float channels */
+   if (input_format == PIPE_FORMAT_R32G32B32A32_FLOAT) {
+      switch (output_format) {
+      case PIPE_FORMAT_R32G32B32_FLOAT:
+         return copy_12;
+      case PIPE_FORMAT_R32G32_FLOAT:
+         return copy_8;
+      case PIPE_FORMAT_R32_FLOAT:
+         return copy_4;
+      default:
+         return NULL;
+      }
+   }
+
+   /* fetch: anything up to float4 */
+   if (output_format != PIPE_FORMAT_R32G32B32A32_FLOAT)
+      return NULL;
+
+   switch (input_format) {
+   case PIPE_FORMAT_R32G32B32_FLOAT:
+      return fetch_R32G32B32_FLOAT;
+   case PIPE_FORMAT_R32G32_FLOAT:
+      return fetch_R32G32_FLOAT;
+   case PIPE_FORMAT_R32_FLOAT:
+      return fetch_R32_FLOAT;
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+      return fetch_R8G8B8A8_UNORM;
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+      return fetch_B8G8R8A8_UNORM;
+   case PIPE_FORMAT_R8G8B8A8_USCALED:
+      return fetch_R8G8B8A8_USCALED;
+   case PIPE_FORMAT_R8G8B8A8_SNORM:
+      return fetch_R8G8B8A8_SNORM;
+   default:
+      return NULL;
+   }
+}
+
+
+/**
+ * Convert up to SIMD_BATCH vertices given by their element indices.
+ */
+static void
+simd_run_batch( struct translate_simd *ts,
+                const unsigned *elts,
+                unsigned count,
+                unsigned start_instance,
+                unsigned instance_id,
+                uint8_t *vert )
+{
+   const unsigned stride = ts->translate.key.output_stride;
+   const uint8_t *src[SIMD_BATCH];
+   unsigned attr, i;
+
+   for (attr = 0; attr < ts->nr_attrib; attr++) {
+      uint8_t *dst = vert + ts->attrib[attr].output_offset;
+
+      if (ts->attrib[attr].type == TRANSLATE_ELEMENT_NORMAL) {
+         const uint8_t *ptr = ts->attrib[attr].input_ptr;
+         const unsigned input_stride = ts->attrib[attr].input_stride;
+
+         if (ts->attrib[attr].instance_divisor) {
+            /* see generic_run_one() about the missing clamp */
+            const unsigned index = start_instance +
+               instance_id / ts->attrib[attr].instance_divisor;
+
+            for (i = 0; i < count; i++)
+               src[i] = ptr + (ptrdiff_t)input_stride * index;
+         }
+         else {
+            const unsigned max_index = ts->attrib[attr].max_index;
+
+            for (i = 0; i < count; i++)
+               src[i] = ptr + (ptrdiff_t)input_stride * MIN2(elts[i], max_index);
+         }
+
+         ts->attrib[attr].kernel(src, count, dst, stride);
+      }
+      else if (ts->attrib[attr].float_instance_id) {
+         const float id = (float) instance_id;
+
+         for (i = 0; i < count; i++)
+            memcpy(dst + i * stride, &id, 4);
+      }
+      else {
+         for (i = 0; i < count; i++)
+            memcpy(dst + i * stride, &instance_id, 4);
+      }
+   }
+}
+
+
+#define SIMD_RUN_ELTS(NAME, TYPE)                                       \
+static void PIPE_CDECL NAME( struct translate *translate,               \
+                             const TYPE *elts,                          \
+                             unsigned count,                            \
+                             unsigned start_instance,                   \
+                             unsigned instance_id,                      \
+                             void *output_buffer )                      \
+{                                                                       \
+   struct translate_simd *ts = translate_simd(translate);               \
+   uint8_t *vert = output_buffer;                                       \
+   unsigned idx[SIMD_BATCH];                                            \
+   unsigned i, n;                                                       \
+                                                                        \
+   while (count) {                                                      \
+      n = MIN2(count, SIMD_BATCH);                                      \
+      for (i = 0; i < n; i++)                                           \
+         idx[i] = elts[i];                                              \
+      simd_run_batch(ts, idx, n, start_instance, instance_id, vert);    \
+      elts += n;                                                        \
+      count -= n;                                                       \
+      vert += n * translate->key.output_stride;                         \
+   }                                                                    \
+}
+
+SIMD_RUN_ELTS(simd_run_elts, unsigned)
+SIMD_RUN_ELTS(simd_run_elts16, uint16_t)
+SIMD_RUN_ELTS(simd_run_elts8, uint8_t)
+
+
+static void PIPE_CDECL simd_run( struct translate *translate,
+                                 unsigned start,
+                                 unsigned count,
+                                 unsigned start_instance,
+                                 unsigned instance_id,
+                                 void *output_buffer )
+{
+   struct translate_simd *ts = translate_simd(translate);
+   uint8_t *vert = output_buffer;
+   unsigned idx[SIMD_BATCH];
+   unsigned i, n;
+
+   while (count) {
+      n = MIN2(count, SIMD_BATCH);
+      for (i = 0; i < n; i++)
+         idx[i] = start + i;
+      simd_run_batch(ts, idx, n, start_instance, instance_id, vert);
+      start += n;
+      count -= n;
+      vert += n * translate->key.output_stride;
+   }
+}
+
+
+static void simd_set_buffer( struct translate *translate,
+                             unsigned buf,
+                             const void *ptr,
+                             unsigned stride,
+                             unsigned max_index )
+{
+   struct translate_simd *ts = translate_simd(translate);
+   unsigned i;
+
+   for (i = 0; i < ts->nr_attrib; i++) {
+      if (ts->attrib[i].buffer == buf) {
+         ts->attrib[i].input_ptr = ((const uint8_t *)ptr +
+                                    ts->attrib[i].input_offset);
+         ts->attrib[i].input_stride = stride;
+         ts->attrib[i].max_index = max_index;
+      }
+   }
+}
+
+
+static void simd_release( struct translate *translate )
+{
+   FREE(translate);
+}
+
+
+struct translate *translate_simd_create( const struct translate_key *key )
+{
+   struct translate_simd *ts;
+   unsigned i;
+
+   if (debug_get_option_no_simd())
+      return NULL;
+
+   ts = CALLOC_STRUCT(translate_simd);
+   if (!ts)
+      return NULL;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   ts->translate.key = *key;
+   ts->translate.release = simd_release;
+   ts->translate.set_buffer = simd_set_buffer;
+   ts->translate.run_elts = simd_run_elts;
+   ts->translate.run_elts16 = simd_run_elts16;
+   ts->translate.run_elts8 = simd_run_elts8;
+   ts->translate.run = simd_run;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *elem = &key->element[i];
+
+      ts->attrib[i].type = elem->type;
+      ts->attrib[i].output_offset = elem->output_offset;
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+         if (elem->output_format == PIPE_FORMAT_R32_FLOAT)
+            ts->attrib[i].float_instance_id = TRUE;
+         else if (elem->output_format != PIPE_FORMAT_R32_USCALED &&
+                  elem->output_format != PIPE_FORMAT_R32_SSCALED)
+            goto fail;
+         continue;
+      }
+
+      ts->attrib[i].kernel = get_kernel(elem->input_format,
+                                        elem->output_format);
+      if (!ts->attrib[i].kernel)
+         goto fail;
+
+      ts->attrib[i].buffer = elem->input_buffer;
+      ts->attrib[i].input_offset = elem->input_offset;
+      ts->attrib[i].instance_divisor = elem->instance_divisor;
+   }
+
+   ts->nr_attrib = key->nr_elements;
+
+   return &ts->translate;
+
+fail:
+   FREE(ts);
+   return NULL;
+}
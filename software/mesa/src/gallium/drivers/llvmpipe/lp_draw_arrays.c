@@ -39,6 +39,7 @@
 #include "lp_context.h"
 #include "lp_state.h"
 #include "lp_query.h"
+#include "lp_flush.h"
 
 #include "draw/draw_context.h"
 
@@ -112,6 +113,22 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    draw_set_mapped_so_targets(draw, lp->num_so_targets,
                               lp->so_targets);
 
+   /* Vertex and geometry shaders sample on this thread, the rasterizer
+    * may still be rendering into their textures.
+    */
+   for (i = 0; i < lp->num_sampler_views[PIPE_SHADER_VERTEX]; i++) {
+      struct pipe_sampler_view *view = lp->sampler_views[PIPE_SHADER_VERTEX][i];
+      if (view)
+         llvmpipe_flush_resource(pipe, view->texture, 0, TRUE, TRUE, FALSE,
+                                 "vertex sampling");
+   }
+   for (i = 0; i < lp->num_sampler_views[PIPE_SHADER_GEOMETRY]; i++) {
+      struct pipe_sampler_view *view = lp->sampler_views[PIPE_SHADER_GEOMETRY][i];
+      if (view)
+         llvmpipe_flush_resource(pipe, view->texture, 0, TRUE, TRUE, FALSE,
+                                 "geometry sampling");
+   }
+
    llvmpipe_prepare_vertex_sampling(lp,
                                     lp->num_sampler_views[PIPE_SHADER_VERTEX],
                                     lp->sampler_views[PIPE_SHADER_VERTEX]);
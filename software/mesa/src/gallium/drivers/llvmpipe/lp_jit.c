@@ -34,11 +34,15 @@
 
 
 #include "util/u_memory.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_format.h"
 #include "lp_context.h"
+#include "lp_screen.h"
 #include "lp_jit.h"
+#include "lp_state_cs.h"
 
 
 static void
@@ -230,14 +234,55 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen)
 {
-   /* nothing */
+   unsigned i;
+
+   if (util_queue_is_initialized(&screen->jit_queue)) {
+      util_queue_destroy(&screen->jit_queue);
+      memset(&screen->jit_queue, 0, sizeof screen->jit_queue);
+   }
+
+   for (i = 0; i < screen->num_jit_threads; i++) {
+      if (screen->jit_context[i])
+         LLVMContextDispose(screen->jit_context[i]);
+   }
+   screen->num_jit_threads = 0;
 }
 
 
 boolean
 lp_jit_screen_init(struct llvmpipe_screen *screen)
 {
-   return lp_build_init();
+   unsigned num_jit_threads;
+   unsigned i;
+
+   if (!lp_build_init())
+      return FALSE;
+
+   num_jit_threads = util_cpu_caps.nr_cpus > 1 ? 1 : 0;
+#ifdef PIPE_SUBSYSTEM_EMBEDDED
+   num_jit_threads = 0;
+#endif
+   num_jit_threads = debug_get_num_option("LP_NUM_JIT_THREADS",
+                                          num_jit_threads);
+   num_jit_threads = MIN2(num_jit_threads, LP_MAX_JIT_THREADS);
+
+   if (num_jit_threads) {
+      for (i = 0; i < num_jit_threads; i++) {
+         screen->jit_context[i] = LLVMContextCreate();
+         if (!screen->jit_context[i])
+            break;
+      }
+      screen->num_jit_threads = i;
+
+      /* Without the queue every variant is just compiled synchronously. */
+      if (i < num_jit_threads ||
+          !util_queue_init(&screen->jit_queue, "lpjit",
+                           LP_MAX_SHADER_VARIANTS, num_jit_threads)) {
+         lp_jit_screen_cleanup(screen);
+      }
+   }
+
+   return TRUE;
 }
 
 
@@ -247,3 +292,67 @@ lp_jit_init_types(struct lp_fragment_shader_variant *lp)
    if (!lp->jit_context_ptr_type)
       lp_jit_create_types(lp);
 }
+
+
+static void
+lp_jit_create_cs_types(struct lp_compute_shader_variant *lp)
+{
+   struct gallivm_state *gallivm = lp->gallivm;
+   LLVMContextRef lc = gallivm->context;
+
+   /* struct lp_jit_cs_context */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_CTX_COUNT];
+      LLVMTypeRef barrier_args[1];
+      LLVMTypeRef context_type;
+
+      barrier_args[0] = LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+
+      elem_types[LP_JIT_CS_CTX_CONSTANTS] =
+         LLVMArrayType(LLVMPointerType(LLVMFloatTypeInContext(lc), 0), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_NUM_CONSTANTS] =
+            LLVMArrayType(LLVMInt32TypeInContext(lc), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_SSBOS] =
+         LLVMArrayType(LLVMPointerType(LLVMInt8TypeInContext(lc), 0), PIPE_MAX_SHADER_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_NUM_SSBOS] =
+            LLVMArrayType(LLVMInt32TypeInContext(lc), PIPE_MAX_SHADER_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_BARRIER] =
+         LLVMPointerType(LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                          barrier_args, 1, 0), 0);
+
+      context_type = LLVMStructTypeInContext(lc, elem_types,
+                                             ARRAY_SIZE(elem_types), 0);
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, num_constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_NUM_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, ssbos,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_SSBOS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, num_ssbos,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_NUM_SSBOS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, barrier,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_BARRIER);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_context,
+                           gallivm->target, context_type);
+
+      lp->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+   }
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMDumpModule(gallivm->module);
+   }
+}
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp)
+{
+   if (!lp->jit_context_ptr_type)
+      lp_jit_create_cs_types(lp);
+}
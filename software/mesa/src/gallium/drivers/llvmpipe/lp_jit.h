@@ -45,6 +45,7 @@
 
 struct lp_build_format_cache;
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
 struct llvmpipe_screen;
 
 
@@ -254,6 +255,93 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * This structure is passed directly to the generated compute shader.
+ *
+ * It contains the derived state of the compute stage.
+ *
+ * Changes here must be reflected in the lp_jit_cs_context_* macros.
+ * Changes to the ordering should be avoided.
+ */
+struct lp_jit_cs_context
+{
+   const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
+   int num_constants[LP_MAX_TGSI_CONST_BUFFERS];
+
+   uint8_t *ssbos[PIPE_MAX_SHADER_BUFFERS];
+   uint32_t num_ssbos[PIPE_MAX_SHADER_BUFFERS];
+
+   /* Called by the BARRIER instruction with the barrier_data argument. */
+   void (*barrier)(void *data);
+};
+
+
+/**
+ * These enum values must match the position of the fields in the
+ * lp_jit_cs_context struct above.
+ */
+enum {
+   LP_JIT_CS_CTX_CONSTANTS = 0,
+   LP_JIT_CS_CTX_NUM_CONSTANTS,
+   LP_JIT_CS_CTX_SSBOS,
+   LP_JIT_CS_CTX_NUM_SSBOS,
+   LP_JIT_CS_CTX_BARRIER,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_CONSTANTS, "constants")
+
+#define lp_jit_cs_context_num_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_CONSTANTS, "num_constants")
+
+#define lp_jit_cs_context_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_SSBOS, "ssbos")
+
+#define lp_jit_cs_context_num_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_SSBOS, "num_ssbos")
+
+#define lp_jit_cs_context_barrier(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_BARRIER, "barrier")
+
+
+/**
+ * typedef for compute shader function
+ *
+ * Runs invocations [first_invocation, first_invocation + vector length)
+ * of the work group at (block_x, block_y, block_z).
+ *
+ * @param context           jit context
+ * @param block_x           work group x
+ * @param block_y           work group y
+ * @param block_z           work group z
+ * @param grid_x            number of work groups in x
+ * @param grid_y            number of work groups in y
+ * @param grid_z            number of work groups in z
+ * @param block_size_x      work group width
+ * @param block_size_y      work group height
+ * @param block_size_z      work group depth
+ * @param first_invocation  linear index of the first invocation
+ * @param shared_mem        work group shared memory
+ * @param barrier_data      passed to the context barrier callback
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  uint32_t block_x,
+                  uint32_t block_y,
+                  uint32_t block_z,
+                  uint32_t grid_x,
+                  uint32_t grid_y,
+                  uint32_t grid_z,
+                  uint32_t block_size_x,
+                  uint32_t block_size_y,
+                  uint32_t block_size_z,
+                  uint32_t first_invocation,
+                  uint8_t *shared_mem,
+                  void *barrier_data);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -266,4 +354,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp);
+
+
 #endif /* LP_JIT_H */
@@ -61,7 +61,19 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Upper limit for the number of rasterizer threads.  The per-thread state
+ * is allocated for the number of threads actually in use, so this is only
+ * a sanity limit for LP_NUM_THREADS and the size of the debug counters.
+ */
+#define LP_MAX_THREADS 256
+
+
+/**
+ * Upper limit for the number of threads compiling optimized fragment shader
+ * variants in the background (LP_NUM_JIT_THREADS).
+ */
+#define LP_MAX_JIT_THREADS 4
 
 
 /**
@@ -45,7 +45,7 @@ void
 lp_print_counters(void)
 {
    if (LP_DEBUG & DEBUG_COUNTERS) {
-      unsigned total_64, total_16, total_4;
+      unsigned total_64, total_16, total_4, i;
       float p1, p2, p3, p4, p5, p6;
 
       debug_printf("llvmpipe: nr_triangles:                 %9u\n", lp_count.nr_tris);
@@ -106,5 +106,18 @@ lp_print_counters(void)
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
 
+      for (i = 0; i < LP_MAX_THREADS; i++) {
+         int64_t busy = lp_count.thread_busy_time[i];
+         int64_t idle = lp_count.thread_idle_time[i];
+
+         if (!busy && !idle)
+            continue;
+
+         debug_printf("llvmpipe: thread %2u: %9u bins, busy %.3f sec, idle %.3f sec (%3.0f%% busy)\n",
+                      i, lp_count.thread_bins[i],
+                      busy / 1000000.0, idle / 1000000.0,
+                      100.0 * (double) busy / (double) (busy + idle));
+      }
+
    }
 }
@@ -34,6 +34,7 @@
 #define LP_PERF_H
 
 #include "pipe/p_compiler.h"
+#include "lp_limits.h"
 
 /**
  * Various counters
@@ -62,6 +63,11 @@ struct lp_counters
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   /** Per rasterizer thread, times in microseconds */
+   int64_t thread_busy_time[LP_MAX_THREADS];  /**< rasterizing bins */
+   int64_t thread_idle_time[LP_MAX_THREADS];  /**< waiting for the others */
+   unsigned thread_bins[LP_MAX_THREADS];
 };
 
 
@@ -60,7 +60,17 @@ llvmpipe_create_query(struct pipe_context *pipe,
    pq = CALLOC_STRUCT( llvmpipe_query );
 
    if (pq) {
+      struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+
       pq->type = type;
+      pq->num_counters = MAX2(1, screen->num_threads);
+      pq->counters = align_malloc(pq->num_counters * sizeof pq->counters[0],
+                                  sizeof pq->counters[0]);
+      if (!pq->counters) {
+         FREE(pq);
+         return NULL;
+      }
+      memset(pq->counters, 0, pq->num_counters * sizeof pq->counters[0]);
    }
 
    return (struct pipe_query *) pq;
@@ -85,6 +95,7 @@ llvmpipe_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
       lp_fence_reference(&pq->fence, NULL);
    }
 
+   align_free(pq->counters);
    FREE(pq);
 }
 
@@ -95,9 +106,8 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
                           boolean wait,
                           union pipe_query_result *vresult)
 {
-   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
-   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
+   unsigned num_threads = pq->num_counters;
    uint64_t *result = (uint64_t *)vresult;
    int i;
 
@@ -121,19 +131,19 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
       for (i = 0; i < num_threads; i++) {
-         *result += pq->end[i];
+         *result += pq->counters[i].end;
       }
       break;
    case PIPE_QUERY_OCCLUSION_PREDICATE:
       for (i = 0; i < num_threads; i++) {
          /* safer (still not guaranteed) when there's an overflow */
-         vresult->b = vresult->b || pq->end[i];
+         vresult->b = vresult->b || pq->counters[i].end;
       }
       break;
    case PIPE_QUERY_TIMESTAMP:
       for (i = 0; i < num_threads; i++) {
-         if (pq->end[i] > *result) {
-            *result = pq->end[i];
+         if (pq->counters[i].end > *result) {
+            *result = pq->counters[i].end;
          }
       }
       break;
@@ -169,7 +179,7 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
          (struct pipe_query_data_pipeline_statistics *)vresult;
       /* only ps_invocations come from binned query */
       for (i = 0; i < num_threads; i++) {
-         pq->stats.ps_invocations += pq->end[i];
+         pq->stats.ps_invocations += pq->counters[i].end;
       }
       pq->stats.ps_invocations *= LP_RASTER_BLOCK_SIZE * LP_RASTER_BLOCK_SIZE;
       *stats = pq->stats;
@@ -199,8 +209,7 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->counters, 0, pq->num_counters * sizeof pq->counters[0]);
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -41,9 +41,20 @@
 struct llvmpipe_context;
 
 
+/**
+ * The counter values of one rasterizer thread, padded to a cache line so
+ * the threads don't write to the same line.
+ */
+struct lp_query_counter {
+   uint64_t start;                  /* start count value */
+   uint64_t end;                    /* end count value */
+   uint8_t pad[64 - 2 * sizeof(uint64_t)];
+};
+
+
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   struct lp_query_counter *counters; /* one for each thread */
+   unsigned num_counters;
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
@@ -26,6 +26,8 @@
  **************************************************************************/
 
 #include <limits.h>
+#include <stdio.h>
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
@@ -69,16 +71,34 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_threads > 1,
+                            rast->num_bin_queues );
 }
 
 
+/**
+ * Finish rasterizing a scene and hand it back to setup.
+ * Called once per scene by one thread, after all threads are done.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
+   struct lp_scene *scene = rast->curr_scene;
+   struct lp_fence *fence = NULL;
+
+   lp_fence_reference(&fence, scene->fence);
+
+   lp_scene_end_rasterization( scene );
 
    rast->curr_scene = NULL;
+
+   /* Setup may reuse the scene as soon as the fence is signalled, so
+    * this must be the last thing we do with it.
+    */
+   if (fence) {
+      lp_fence_signal(fence);
+      lp_fence_reference(&fence, NULL);
+   }
 }
 
 
@@ -486,10 +506,10 @@ lp_rast_begin_query(struct lp_rasterizer_task *task,
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
-      pq->start[task->thread_index] = task->thread_data.vis_counter;
+      pq->counters[task->thread_index].start = task->thread_data.vis_counter;
       break;
    case PIPE_QUERY_PIPELINE_STATISTICS:
-      pq->start[task->thread_index] = task->ps_invocations;
+      pq->counters[task->thread_index].start = task->ps_invocations;
       break;
    default:
       assert(0);
@@ -508,21 +528,20 @@ lp_rast_end_query(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
    struct llvmpipe_query *pq = arg.query_obj;
+   struct lp_query_counter *counter = &pq->counters[task->thread_index];
 
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
-      pq->end[task->thread_index] +=
-         task->thread_data.vis_counter - pq->start[task->thread_index];
-      pq->start[task->thread_index] = 0;
+      counter->end += task->thread_data.vis_counter - counter->start;
+      counter->start = 0;
       break;
    case PIPE_QUERY_TIMESTAMP:
-      pq->end[task->thread_index] = os_time_get_nano();
+      counter->end = os_time_get_nano();
       break;
    case PIPE_QUERY_PIPELINE_STATISTICS:
-      pq->end[task->thread_index] +=
-         task->ps_invocations - pq->start[task->thread_index];
-      pq->start[task->thread_index] = 0;
+      counter->end += task->ps_invocations - counter->start;
+      counter->start = 0;
       break;
    default:
       assert(0);
@@ -681,11 +700,25 @@ rasterize_scene(struct lp_rasterizer_task *task,
       {
          struct cmd_bin *bin;
          int i, j;
+         unsigned nr_bins = 0;
+         int64_t start = 0;
+
+         if (LP_DEBUG & DEBUG_COUNTERS)
+            start = os_time_get();
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin( bin ))
+         while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                              &i, &j))) {
+            if (!is_empty_bin( bin )) {
                rasterize_bin(task, bin, i, j);
+               nr_bins++;
+            }
+         }
+
+         if (LP_DEBUG & DEBUG_COUNTERS) {
+            lp_count.thread_busy_time[task->thread_index] +=
+               os_time_get() - start;
+            lp_count.thread_bins[task->thread_index] += nr_bins;
          }
       }
    }
@@ -705,10 +738,6 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
-   if (scene->fence) {
-      lp_fence_signal(scene->fence);
-   }
-
    task->scene = NULL;
 }
 
@@ -745,6 +774,8 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
       /* threaded rendering! */
       unsigned i;
 
+      lp_fence_reference(&rast->last_fence, scene->fence);
+
       lp_scene_enqueue( rast->full_scenes, scene );
 
       /* signal the threads that there's work to do */
@@ -757,20 +788,61 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Wait until all the queued scenes are rasterized.
+ * Like lp_rast_queue_scene(), must be called with the screen's rast_mutex
+ * held.
+ */
 void
 lp_rast_finish( struct lp_rasterizer *rast )
 {
    if (rast->num_threads == 0) {
       /* nothing to do */
    }
-   else {
-      int i;
+   else if (rast->last_fence) {
+      /* scenes are rasterized in order */
+      lp_fence_wait(rast->last_fence);
+   }
+}
 
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
+
+/**
+ * Run func(data, thread_index) once on every rasterizer thread and wait
+ * for all of them to return.  Queued scenes are finished first so the
+ * job has the threads to itself.  Used for compute shader dispatch.
+ * Like lp_rast_queue_scene(), must be called with the screen's rast_mutex
+ * held.
+ */
+void
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data )
+{
+   unsigned i;
+
+   if (rast->num_threads == 0) {
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+      func(data, 0);
+      util_fpstate_set(fpstate);
+      return;
+   }
+
+   lp_rast_finish(rast);
+
+   rast->job_func = func;
+   rast->job_data = data;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      pipe_semaphore_signal(&rast->tasks[i].work_ready);
+   }
+   for (i = 0; i < rast->num_threads; i++) {
+      pipe_semaphore_wait(&rast->job_done);
    }
+
+   rast->job_func = NULL;
+   rast->job_data = NULL;
 }
 
 
@@ -792,6 +864,10 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
    util_snprintf(thread_name, sizeof thread_name, "llvmpipe-%u", task->thread_index);
    pipe_thread_setname(thread_name);
 
+   if (task->cpu >= 0 && !pipe_thread_set_cpu(task->cpu))
+      debug_printf("llvmpipe: couldn't bind thread %u to cpu %d\n",
+                   task->thread_index, task->cpu);
+
    /* Make sure that denorms are treated like zeros. This is 
     * the behavior required by D3D10. OpenGL doesn't care.
     */
@@ -807,6 +883,12 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       if (rast->exit_flag)
          break;
 
+      if (rast->job_func) {
+         rast->job_func(rast->job_data, task->thread_index);
+         pipe_semaphore_signal(&rast->job_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -829,19 +911,23 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
                       rast->curr_scene);
       
       /* wait for all threads to finish with this scene */
-      pipe_barrier_wait( &rast->barrier );
+      if (LP_DEBUG & DEBUG_COUNTERS) {
+         /* time spent here is the load imbalance between the threads */
+         int64_t start = os_time_get();
+         pipe_barrier_wait( &rast->barrier );
+         lp_count.thread_idle_time[task->thread_index] +=
+            os_time_get() - start;
+      }
+      else {
+         pipe_barrier_wait( &rast->barrier );
+      }
 
-      /* XXX: shouldn't be necessary:
-       */
       if (task->thread_index == 0) {
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -852,6 +938,102 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
 }
 
 
+#if defined(PIPE_OS_LINUX)
+/**
+ * Read an integer from the sysfs topology of a CPU, -1 if unknown.
+ */
+static int
+read_cpu_topology(unsigned cpu, const char *name)
+{
+   char path[128];
+   FILE *f;
+   int value = -1;
+
+   util_snprintf(path, sizeof path,
+                 "/sys/devices/system/cpu/cpu%u/topology/%s", cpu, name);
+   f = fopen(path, "r");
+   if (f) {
+      if (fscanf(f, "%d", &value) != 1)
+         value = -1;
+      fclose(f);
+   }
+
+   return value;
+}
+#endif
+
+
+struct cpu_slot {
+   int cpu;
+   int smt;      /**< index of this hardware thread within its core */
+   int package;
+   int core;
+};
+
+
+static int
+compare_cpu_slots(const void *a, const void *b)
+{
+   const struct cpu_slot *sa = (const struct cpu_slot *) a;
+   const struct cpu_slot *sb = (const struct cpu_slot *) b;
+
+   if (sa->smt != sb->smt)
+      return sa->smt - sb->smt;
+   if (sa->package != sb->package)
+      return sa->package - sb->package;
+   if (sa->core != sb->core)
+      return sa->core - sb->core;
+   return sa->cpu - sb->cpu;
+}
+
+
+/**
+ * Choose the CPU each rasterizer thread is bound to.  The threads go to
+ * one hardware thread of every physical core first, package by package,
+ * and only then to the second hardware thread of the cores.  So threads
+ * don't share a core until they have to, and neighbouring threads, which
+ * own neighbouring tiles, share the caches of their package.
+ */
+static void
+assign_thread_cpus(struct lp_rasterizer *rast)
+{
+   const unsigned nr_cpus = util_cpu_caps.nr_cpus;
+   struct cpu_slot *slots;
+   unsigned i, j;
+
+   slots = MALLOC(nr_cpus * sizeof *slots);
+   if (!slots)
+      return;
+
+   for (i = 0; i < nr_cpus; i++) {
+      slots[i].cpu = i;
+      slots[i].smt = 0;
+#if defined(PIPE_OS_LINUX)
+      slots[i].package = read_cpu_topology(i, "physical_package_id");
+      slots[i].core = read_cpu_topology(i, "core_id");
+#else
+      slots[i].package = -1;
+      slots[i].core = -1;
+#endif
+      if (slots[i].core < 0)
+         slots[i].core = i;
+
+      for (j = 0; j < i; j++) {
+         if (slots[j].package == slots[i].package &&
+             slots[j].core == slots[i].core)
+            slots[i].smt++;
+      }
+   }
+
+   qsort(slots, nr_cpus, sizeof *slots, compare_cpu_slots);
+
+   for (i = 0; i < rast->num_threads; i++)
+      rast->tasks[i].cpu = slots[i % nr_cpus].cpu;
+
+   FREE(slots);
+}
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
@@ -892,10 +1074,17 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof rast->tasks[0]);
+   rast->threads = CALLOC(MAX2(1, num_threads), sizeof rast->threads[0]);
+   if (!rast->tasks || !rast->threads) {
+      goto no_tasks;
+   }
+
    for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
+      task->cpu = -1;
       task->thread_data.cache = align_malloc(sizeof(struct lp_build_format_cache),
                                              16);
       if (!task->thread_data.cache) {
@@ -907,11 +1096,20 @@ lp_rast_create( unsigned num_threads )
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
+   /* Give every thread its own tiles, see lp_scene_bin_iter_begin() */
+   rast->num_bin_queues = 1;
+   if (num_threads > 1 && debug_get_bool_option("LP_TILE_AFFINITY", TRUE))
+      rast->num_bin_queues = num_threads;
+
+   if (num_threads > 0 && debug_get_bool_option("LP_THREAD_AFFINITY", FALSE))
+      assign_thread_cpus(rast);
+
    create_rast_threads(rast);
 
    /* for synchronizing rasterization threads */
    if (rast->num_threads > 0) {
       pipe_barrier_init( &rast->barrier, rast->num_threads );
+      pipe_semaphore_init( &rast->job_done, 0 );
    }
 
    memset(lp_dummy_tile, 0, sizeof lp_dummy_tile);
@@ -919,12 +1117,14 @@ lp_rast_create( unsigned num_threads )
    return rast;
 
 no_thread_data_cache:
-   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+   for (i = 0; i < MAX2(1, num_threads); i++) {
       if (rast->tasks[i].thread_data.cache) {
          align_free(rast->tasks[i].thread_data.cache);
       }
    }
-
+no_tasks:
+   FREE(rast->threads);
+   FREE(rast->tasks);
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
@@ -971,10 +1171,15 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
    /* for synchronizing rasterization threads */
    if (rast->num_threads > 0) {
       pipe_barrier_destroy( &rast->barrier );
+      pipe_semaphore_destroy( &rast->job_done );
    }
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   lp_fence_reference(&rast->last_fence, NULL);
+
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 }
 
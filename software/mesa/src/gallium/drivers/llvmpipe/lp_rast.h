@@ -170,6 +170,17 @@ void
 lp_rast_finish( struct lp_rasterizer *rast );
 
 
+/**
+ * A job run once by every rasterizer thread, see lp_rast_run_job().
+ */
+typedef void (*lp_rast_job_func)( void *data, unsigned thread_index );
+
+void
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data );
+
+
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
    struct {
@@ -102,6 +102,9 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /** CPU the thread is bound to, or -1 */
+   int cpu;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -123,14 +126,25 @@ struct lp_rasterizer
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
 
+   /** Fence of the last scene queued, see lp_rast_finish() */
+   struct lp_fence *last_fence;
+
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   pipe_thread threads[LP_MAX_THREADS];
+   pipe_thread *threads;
+
+   /** Number of bin queues, num_threads with tile affinity, otherwise 1 */
+   unsigned num_bin_queues;
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
+
+   /** Job run instead of a scene, see lp_rast_run_job() */
+   lp_rast_job_func job_func;
+   void *job_data;
+   pipe_semaphore job_done;
 };
 
 
@@ -27,6 +27,7 @@
 
 #include "util/u_framebuffer.h"
 #include "util/u_math.h"
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
@@ -48,10 +49,10 @@ struct resource_ref {
 
 /**
  * Create a new scene object.
- * \param queue  the queue to put newly rendered/emptied scenes into
+ * \param num_queues  max number of bin queues, one per rasterizer thread
  */
 struct lp_scene *
-lp_scene_create( struct pipe_context *pipe )
+lp_scene_create( struct pipe_context *pipe, unsigned num_queues )
 {
    struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
    if (!scene)
@@ -59,11 +60,17 @@ lp_scene_create( struct pipe_context *pipe )
 
    scene->pipe = pipe;
 
+   scene->max_queues = MAX2(1, num_queues);
+   scene->queues = align_malloc(scene->max_queues * sizeof scene->queues[0],
+                                sizeof scene->queues[0]);
+   if (!scene->queues) {
+      FREE(scene);
+      return NULL;
+   }
+
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   pipe_mutex_init(scene->mutex);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -90,9 +97,10 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
-   assert(scene->data.head->next == NULL);
+   /* a part scene may have handed its blocks over, see lp_scene_append_part */
+   assert(!scene->data.head || scene->data.head->next == NULL);
    FREE(scene->data.head);
+   align_free(scene->queues);
    FREE(scene);
 }
 
@@ -138,6 +146,7 @@ lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y)
    struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
 
    bin->last_state = NULL;
+   bin->num_cmds = 0;
    bin->head = bin->tail;
    if (bin->tail) {
       bin->tail->next = NULL;
@@ -204,12 +213,13 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 /**
- * Free all the temporary data in a scene.
+ * Unmap the framebuffer.  Called by the rasterizer when it is done with
+ * the scene, the scene is only reset by lp_scene_retire().
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -232,6 +242,17 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene, so that it can be reused.
+ * Called by setup once the rasterizer has finished with the scene.
+ */
+void
+lp_scene_retire(struct lp_scene *scene )
+{
+   int i, j;
 
    /* Reset all command lists:
     */
@@ -241,6 +262,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
          bin->head = NULL;
          bin->tail = NULL;
          bin->last_state = NULL;
+         bin->num_cmds = 0;
       }
    }
 
@@ -449,61 +471,166 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+static int
+compare_bin_keys(const void *a, const void *b)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
+   const uint32_t ka = *(const uint32_t *) a;
+   const uint32_t kb = *(const uint32_t *) b;
+
+   /* descending */
+   return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+
+/**
+ * Sort bin_order[begin..end) so that the bins with the most commands come
+ * first.  The keys hold the command count in the high 16 bits and the
+ * inverted bin index in the low bits, so bins of equal cost stay in
+ * raster order.
+ */
+static void
+sort_bins_by_cost( struct lp_scene *scene, unsigned begin, unsigned end )
+{
+   uint32_t *order = &scene->bin_order[begin];
+   const unsigned n = end - begin;
+   unsigned i;
+
+   STATIC_ASSERT(TILES_X * TILES_Y <= 0x10000);
+
+   if (n < 2)
+      return;
+
+   for (i = 0; i < n; i++) {
+      const unsigned index = order[i];
+      const struct cmd_bin *bin =
+         lp_scene_get_bin(scene, index % scene->tiles_x,
+                          index / scene->tiles_x);
+      order[i] = (MIN2(bin->num_cmds, 0xffff) << 16) | (0xffff - index);
    }
-   return TRUE;
+
+   qsort(order, n, sizeof order[0], compare_bin_keys);
+
+   for (i = 0; i < n; i++)
+      order[i] = 0xffff - (order[i] & 0xffff);
+}
+
+
+/**
+ * The queue (rasterizer thread) that owns tile (x, y).  Tiles are dealt
+ * out round robin in blocks of LP_OWNER_BLOCK x LP_OWNER_BLOCK, so that a
+ * thread gets the same tiles every frame as long as the framebuffer size
+ * doesn't change, and the tiles of each thread are spread over the
+ * whole framebuffer.
+ */
+static inline unsigned
+bin_owner( const struct lp_scene *scene, unsigned x, unsigned y,
+           unsigned num_queues )
+{
+   const unsigned blocks_x = DIV_ROUND_UP(scene->tiles_x, LP_OWNER_BLOCK);
+
+   return ((y / LP_OWNER_BLOCK) * blocks_x + x / LP_OWNER_BLOCK) %
+          num_queues;
 }
 
 
+/**
+ * Build the lists of bins to rasterize.
+ * Empty bins are left out.  With several queues every bin goes to the
+ * queue of its owner, see bin_owner(), and a thread only takes bins from
+ * another queue once its own is empty.  With \p sort_by_cost the bins
+ * with the most commands are handed out first, so that with several
+ * threads the expensive bins don't end up as the tail of the frame.
+ * Otherwise the bins go in raster order.
+ * Called once per scene by one thread.
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, boolean sort_by_cost,
+                         unsigned num_queues )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned x, y, q, n = 0;
+
+   num_queues = MAX2(1, MIN2(num_queues, scene->max_queues));
+
+   /* count the bins of each queue */
+   for (q = 0; q < num_queues; q++)
+      scene->queues[q].end = 0;
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         if (bin->head)
+            scene->queues[bin_owner(scene, x, y, num_queues)].end++;
+      }
+   }
+
+   for (q = 0; q < num_queues; q++) {
+      scene->queues[q].curr = n;
+      n += scene->queues[q].end;
+   }
+
+   /* place them, which leaves curr at the end of each queue */
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         if (bin->head) {
+            struct lp_bin_queue *queue =
+               &scene->queues[bin_owner(scene, x, y, num_queues)];
+            scene->bin_order[queue->curr++] = y * scene->tiles_x + x;
+         }
+      }
+   }
+
+   n = 0;
+   for (q = 0; q < num_queues; q++) {
+      struct lp_bin_queue *queue = &scene->queues[q];
+
+      queue->end = queue->curr;
+      queue->curr = n;
+      if (sort_by_cost)
+         sort_bins_by_cost(scene, n, queue->end);
+      n = queue->end;
+   }
+
+   scene->num_queues = num_queues;
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  A thread takes the bins of its own queue
+ * first and then helps out with the others.  This is lock-free, the
+ * queue position is advanced atomically.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned queue_index,
+                        int *x, int *y )
 {
-   struct cmd_bin *bin = NULL;
+   unsigned k;
 
-   pipe_mutex_lock(scene->mutex);
+   for (k = 0; k < scene->num_queues; k++) {
+      struct lp_bin_queue *queue =
+         &scene->queues[(queue_index + k) % scene->num_queues];
+      unsigned index;
+      int i;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+      /* don't keep bumping the position of an exhausted queue */
+      if (p_atomic_read(&queue->curr) >= (int) queue->end)
+         continue;
+
+      i = p_atomic_inc_return(&queue->curr) - 1;
+      if (i >= (int) queue->end)
+         continue;
+
+      index = scene->bin_order[i];
+      *x = index % scene->tiles_x;
+      *y = index / scene->tiles_x;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      return lp_scene_get_bin(scene, *x, *y);
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+   /* no more bins left */
+   return NULL;
 }
 
 
@@ -562,3 +689,126 @@ void lp_scene_end_binning( struct lp_scene *scene )
          lp_debug_bins( scene );
    }
 }
+
+
+/**
+ * Prepare \p part for binning a slice of a draw into \p scene.
+ * Binning into \p part may use up to \p budget bytes of scene memory.
+ * \return FALSE if out of memory
+ */
+boolean
+lp_scene_begin_part( struct lp_scene *part,
+                     const struct lp_scene *scene,
+                     unsigned budget )
+{
+   assert(lp_scene_is_empty(part));
+
+   if (!part->data.head) {
+      part->data.head = CALLOC_STRUCT(data_block);
+      if (!part->data.head)
+         return FALSE;
+   }
+
+   /* what the triangle setup code looks at */
+   part->tiles_x = scene->tiles_x;
+   part->tiles_y = scene->tiles_y;
+   part->fb_max_layer = scene->fb_max_layer;
+   part->had_queries = scene->had_queries;
+   part->discard = scene->discard;
+   pipe_surface_reference(&part->fb.zsbuf, scene->fb.zsbuf);
+
+   /* make lp_scene_new_data_block() fail once the budget is used up */
+   budget = MIN2(budget, LP_SCENE_MAX_SIZE);
+   part->part_base_size = LP_SCENE_MAX_SIZE - budget;
+   part->scene_size = part->part_base_size;
+   part->alloc_failed = FALSE;
+
+   return TRUE;
+}
+
+
+/**
+ * Append the commands of every bin of \p part to the same bin of \p scene
+ * and hand the memory they live in over to \p scene.
+ */
+void
+lp_scene_append_part( struct lp_scene *scene, struct lp_scene *part )
+{
+   struct data_block *block;
+   unsigned x, y;
+
+   for (y = 0; y < part->tiles_y; y++) {
+      for (x = 0; x < part->tiles_x; x++) {
+         struct cmd_bin *src = lp_scene_get_bin(part, x, y);
+         struct cmd_bin *dst;
+
+         if (!src->head)
+            continue;
+
+         dst = lp_scene_get_bin(scene, x, y);
+         if (dst->tail)
+            dst->tail->next = src->head;
+         else
+            dst->head = src->head;
+         dst->tail = src->tail;
+         dst->last_state = src->last_state;
+         dst->num_cmds += src->num_cmds;
+
+         src->head = NULL;
+         src->tail = NULL;
+         src->last_state = NULL;
+         src->num_cmds = 0;
+      }
+   }
+
+   /* Keep the current block of the scene at the head of its list, so
+    * that it goes on filling it.
+    */
+   block = part->data.head;
+   if (block->used || block->next) {
+      while (block->next)
+         block = block->next;
+      block->next = scene->data.head->next;
+      scene->data.head->next = part->data.head;
+      part->data.head = NULL;
+
+      scene->scene_size += part->scene_size - part->part_base_size +
+                           sizeof *block;
+   }
+
+   part->scene_size = 0;
+   pipe_surface_reference(&part->fb.zsbuf, NULL);
+}
+
+
+/**
+ * Throw away everything binned into \p part.
+ */
+void
+lp_scene_discard_part( struct lp_scene *part )
+{
+   struct data_block *block, *tmp;
+   unsigned x, y;
+
+   for (y = 0; y < part->tiles_y; y++) {
+      for (x = 0; x < part->tiles_x; x++) {
+         struct cmd_bin *bin = lp_scene_get_bin(part, x, y);
+         bin->head = NULL;
+         bin->tail = NULL;
+         bin->last_state = NULL;
+         bin->num_cmds = 0;
+      }
+   }
+
+   if (part->data.head) {
+      for (block = part->data.head->next; block; block = tmp) {
+         tmp = block->next;
+         FREE(block);
+      }
+      part->data.head->next = NULL;
+      part->data.head->used = 0;
+   }
+
+   part->scene_size = 0;
+   pipe_surface_reference(&part->fb.zsbuf, NULL);
+}
@@ -97,6 +97,7 @@ struct cmd_bin {
    const struct lp_rast_state *last_state;       /* most recent state set in bin */
    struct cmd_block *head;
    struct cmd_block *tail;
+   unsigned num_cmds;   /**< commands binned, the cost estimate of the bin */
 };
    
 
@@ -117,6 +118,25 @@ struct data_block_list {
 
 struct resource_ref;
 
+/**
+ * Tiles are owned by the rasterizer threads in square blocks of this many
+ * tiles on a side, see lp_scene_bin_iter_begin().
+ */
+#define LP_OWNER_BLOCK 2
+
+
+/**
+ * The bins owned by one rasterizer thread, bin_order[curr..end).
+ * Threads take the next entry by atomically incrementing curr.  Padded
+ * to a cache line so the threads don't contend on each other's queue.
+ */
+struct lp_bin_queue {
+   int curr;
+   unsigned end;
+   uint8_t pad[64 - sizeof(int) - sizeof(unsigned)];
+};
+
+
 /**
  * All bins and bin data are contained here.
  * Per-bin data goes into the 'tile' bins.
@@ -165,6 +185,11 @@ struct lp_scene {
     */
    unsigned resource_reference_size;
 
+   /** For the private scenes of the binning threads: scene_size when
+    * binning into them began, see lp_scene_begin_part().
+    */
+   unsigned part_base_size;
+
    boolean alloc_failed;
    boolean discard;
    /**
@@ -173,8 +198,15 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   /**
+    * Bins to rasterize, as y * tiles_x + x, in the order they are handed
+    * out to the rasterizer threads.  The entries are grouped by queue,
+    * see lp_scene_bin_iter_begin().
+    */
+   uint32_t bin_order[TILES_X * TILES_Y];
+   struct lp_bin_queue *queues;
+   unsigned num_queues;
+   unsigned max_queues;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -182,7 +214,8 @@ struct lp_scene {
 
 
 
-struct lp_scene *lp_scene_create(struct pipe_context *pipe);
+struct lp_scene *lp_scene_create(struct pipe_context *pipe,
+                                 unsigned num_queues);
 
 void lp_scene_destroy(struct lp_scene *scene);
 
@@ -323,6 +356,7 @@ lp_scene_bin_command( struct lp_scene *scene,
       tail->arg[i] = arg;
       tail->count++;
    }
+   bin->num_cmds++;
    
    return TRUE;
 }
@@ -379,10 +413,12 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, boolean sort_by_cost,
+                         unsigned num_queues );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned queue_index,
+                        int *x, int *y );
 
 
 
@@ -397,6 +433,21 @@ void
 lp_scene_end_binning( struct lp_scene *scene );
 
 
+/* Parallel binning: each binning thread bins a slice of a draw into a
+ * private "part" scene, which is then appended to the real scene.
+ */
+boolean
+lp_scene_begin_part( struct lp_scene *part,
+                     const struct lp_scene *scene,
+                     unsigned budget );
+
+void
+lp_scene_append_part( struct lp_scene *scene, struct lp_scene *part );
+
+void
+lp_scene_discard_part( struct lp_scene *part );
+
+
 /* Begin/end rasterization of a scene
  */
 void
@@ -405,6 +456,9 @@ lp_scene_begin_rasterization(struct lp_scene *scene);
 void
 lp_scene_end_rasterization(struct lp_scene *scene );
 
+void
+lp_scene_retire(struct lp_scene *scene );
+
 
 
 
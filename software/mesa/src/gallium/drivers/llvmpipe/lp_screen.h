@@ -37,7 +37,9 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
+#include "lp_limits.h"
 
 
 struct sw_winsys;
@@ -50,6 +52,7 @@ struct llvmpipe_screen
    struct sw_winsys *winsys;
 
    unsigned num_threads;
+   unsigned num_bin_threads;  /**< per context, see lp_setup_parallel.c */
 
    /* Increments whenever textures are modified.  Contexts can track this.
     */
@@ -57,6 +60,13 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /* Background compilation of optimized fragment shader variants, with
+    * one LLVMContext per thread.  See generate_variant().
+    */
+   unsigned num_jit_threads;
+   struct util_queue jit_queue;
+   LLVMContextRef jit_context[LP_MAX_JIT_THREADS];
 };
 
 
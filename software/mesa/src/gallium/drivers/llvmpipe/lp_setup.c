@@ -64,6 +64,24 @@ static boolean set_scene_state( struct lp_setup_context *, enum setup_state,
 static boolean try_update_scene_state( struct lp_setup_context *setup );
 
 
+/**
+ * Reset the scenes the rasterizer has finished with.
+ */
+static void
+lp_setup_retire_scenes(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      if (setup->scene_fences[i] &&
+          lp_fence_signalled(setup->scene_fences[i])) {
+         lp_scene_retire(setup->scenes[i]);
+         lp_fence_reference(&setup->scene_fences[i], NULL);
+      }
+   }
+}
+
+
 static void
 lp_setup_get_empty_scene(struct lp_setup_context *setup)
 {
@@ -74,12 +92,14 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
 
    setup->scene = setup->scenes[setup->scene_idx];
 
-   if (setup->scene->fence) {
+   if (setup->scene_fences[setup->scene_idx]) {
       if (LP_DEBUG & DEBUG_SETUP)
          debug_printf("%s: wait for scene %d\n",
-                      __FUNCTION__, setup->scene->fence->id);
+                      __FUNCTION__,
+                      setup->scene_fences[setup->scene_idx]->id);
 
-      lp_fence_wait(setup->scene->fence);
+      lp_fence_wait(setup->scene_fences[setup->scene_idx]);
+      lp_setup_retire_scenes(setup);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
@@ -147,7 +167,21 @@ void lp_setup_reset( struct lp_setup_context *setup )
 }
 
 
-/** Rasterize all scene's bins */
+static boolean
+scene_renders_to_buffer(const struct lp_scene *scene)
+{
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      const struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      if (cbuf && !llvmpipe_resource_is_texture(cbuf->texture))
+         return TRUE;
+   }
+   return FALSE;
+}
+
+
+/** Queue the scene for rasterization */
 static void
 lp_setup_rasterize_scene( struct lp_setup_context *setup )
 {
@@ -165,23 +199,22 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
-   pipe_mutex_lock(screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
+   /* The scene is rasterized while we go on binning into the next one.
+    * Whoever needs the results waits on the fence, and the scene is only
+    * reset once the fence is signalled, see lp_setup_retire_scenes().
     */
+   lp_fence_reference(&setup->scene_fences[setup->scene_idx], scene->fence);
+
+   pipe_mutex_lock(screen->rast_mutex);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    pipe_mutex_unlock(screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
+   /* Buffers bound as render targets are read by the draw module without
+    * any check, so don't leave them to the rasterizer.
+    */
+   if (scene_renders_to_buffer(scene))
+      lp_fence_wait(scene->fence);
+
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -201,7 +234,7 @@ begin_binning( struct lp_setup_context *setup )
 
    /* Always create a fence:
     */
-   scene->fence = lp_fence_create(MAX2(1, setup->num_threads));
+   scene->fence = lp_fence_create(1);
    if (!scene->fence)
       return FALSE;
 
@@ -967,10 +1000,10 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
  * being rendered and the current scene being built.
  */
 unsigned
-lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
+lp_setup_is_resource_referenced( struct lp_setup_context *setup,
                                 const struct pipe_resource *texture )
 {
-   unsigned i;
+   unsigned i, j;
 
    /* check the render targets */
    for (i = 0; i < setup->fb.nr_cbufs; i++) {
@@ -981,9 +1014,23 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
+   lp_setup_retire_scenes(setup);
+
    for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
+      const struct lp_scene *scene = setup->scenes[i];
+
+      /* check the render targets of the scenes still being rasterized */
+      if (setup->scene_fences[i]) {
+         for (j = 0; j < scene->fb.nr_cbufs; j++) {
+            if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
+               return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+         }
+         if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture)
+            return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      }
+
+      /* check textures referenced by the scene */
+      if (lp_scene_is_resource_referenced(scene, texture)) {
          return LP_REFERENCED_FOR_READ;
       }
    }
@@ -1283,14 +1330,17 @@ lp_setup_destroy( struct lp_setup_context *setup )
       pipe_resource_reference(&setup->constants[i].current.buffer, NULL);
    }
 
-   /* free the scenes in the 'empty' queue */
-   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
-      struct lp_scene *scene = setup->scenes[i];
+   lp_setup_destroy_bin_threads(setup);
 
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
+   /* wait for the scenes still being rasterized and free them */
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      if (setup->scene_fences[i])
+         lp_fence_wait(setup->scene_fences[i]);
+   }
+   lp_setup_retire_scenes(setup);
 
-      lp_scene_destroy(scene);
+   for (i = 0; i < ARRAY_SIZE(setup->scenes); i++) {
+      lp_scene_destroy(setup->scenes[i]);
    }
 
    lp_fence_reference(&setup->last_fence, NULL);
@@ -1317,14 +1367,16 @@ lp_setup_create( struct pipe_context *pipe,
       goto no_setup;
    }
 
-   lp_setup_init_vbuf(setup);
-   
    /* Used only in update_state():
     */
    setup->pipe = pipe;
 
 
    setup->num_threads = screen->num_threads;
+
+   lp_setup_init_bin_threads(setup, screen->num_bin_threads);
+   lp_setup_init_vbuf(setup);
+
    setup->vbuf = draw_vbuf_stage(draw, &setup->base);
    if (!setup->vbuf) {
       goto no_vbuf;
@@ -1335,7 +1387,7 @@ lp_setup_create( struct pipe_context *pipe,
 
    /* create some empty scenes */
    for (i = 0; i < MAX_SCENES; i++) {
-      setup->scenes[i] = lp_scene_create( pipe );
+      setup->scenes[i] = lp_scene_create( pipe, setup->num_threads );
       if (!setup->scenes[i]) {
          goto no_scenes;
       }
@@ -1358,6 +1410,7 @@ no_scenes:
 
    setup->vbuf->destroy(setup->vbuf);
 no_vbuf:
+   lp_setup_destroy_bin_threads(setup);
    FREE(setup);
 no_setup:
    return NULL;
@@ -1434,7 +1487,7 @@ lp_setup_end_query(struct lp_setup_context *setup, struct llvmpipe_query *pq)
              * If there's a zero width/height framebuffer, there's no bins and
              * hence no rast task is ever run. So fill in something here instead.
              */
-            pq->end[0] = os_time_get_nano();
+            pq->counters[0].end = os_time_get_nano();
          }
 
          if (!lp_scene_bin_everywhere(setup->scene,
@@ -136,7 +136,7 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
                                     struct pipe_sampler_state **samplers);
 
 unsigned
-lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
+lp_setup_is_resource_referenced( struct lp_setup_context *setup,
                                 const struct pipe_resource *texture );
 
 void
@@ -43,6 +43,7 @@
 #include "draw/draw_vbuf.h"
 #include "util/u_rect.h"
 #include "util/u_pack_color.h"
+#include "util/u_queue.h"
 
 #define LP_SETUP_NEW_FS          0x01
 #define LP_SETUP_NEW_CONSTANTS   0x02
@@ -52,11 +53,18 @@
 
 
 struct lp_setup_variant;
+struct lp_setup_bin_job;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/** Max number of scenes.  One can be binned while the other is being
+ * rasterized.
+ */
+#define MAX_SCENES 2
+
+/** Max number of threads binning triangles in parallel with the
+ * application thread.
+ */
+#define LP_MAX_BIN_THREADS 8
 
 
 
@@ -91,6 +99,10 @@ struct lp_setup_context
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
 
+   /** fences of the scenes handed to the rasterizer, to wait for before
+    * a scene is reused */
+   struct lp_fence *scene_fences[MAX_SCENES];
+
    struct lp_fence *last_fence;
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned active_binned_queries;
@@ -155,6 +167,16 @@ struct lp_setup_context
 
    unsigned dirty;   /**< bitmask of LP_SETUP_NEW_x bits */
 
+   /** Parallel binning of large triangle batches, see lp_setup_parallel.c */
+   struct {
+      struct util_queue queue;
+      struct lp_setup_bin_job *jobs[LP_MAX_BIN_THREADS + 1];
+      unsigned num_threads;
+   } bin;
+
+   boolean bin_worker;  /**< this is a binning job's copy of the context */
+   boolean bin_failed;  /**< the binning job ran out of scene memory */
+
    void (*point)( struct lp_setup_context *,
                   const float (*v0)[4]);
 
@@ -189,6 +211,18 @@ void lp_setup_choose_point( struct lp_setup_context *setup );
 
 void lp_setup_init_vbuf(struct lp_setup_context *setup);
 
+void lp_setup_init_bin_threads(struct lp_setup_context *setup,
+                               unsigned num_threads);
+
+void lp_setup_destroy_bin_threads(struct lp_setup_context *setup);
+
+boolean
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                unsigned stride,
+                                const ushort *indices,
+                                unsigned nr);
+
 boolean lp_setup_update_state( struct lp_setup_context *setup,
                             boolean update_scene);
 
@@ -0,0 +1,280 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Parallel binning.
+ *
+ * Triangle setup and binning of a large batch of triangles is split into
+ * slices, one per binning job.  Each job works on its own copy of the
+ * setup context and bins into a private "part" scene, so the jobs share
+ * nothing but the vertices and the state already stored in the scene.
+ * The application thread runs the first slice itself.  Once all jobs are
+ * done, the bins of every part are appended to the bins of the scene in
+ * slice order, which keeps the commands of every bin in API order.
+ *
+ * If any job runs out of scene memory all parts are thrown away and the
+ * batch is binned serially, which knows how to flush and restart the
+ * scene.
+ */
+
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "lp_context.h"
+#include "lp_scene.h"
+#include "lp_setup_context.h"
+
+
+/** Don't bother splitting batches into slices smaller than this */
+#define LP_MIN_BIN_SLICE 128
+
+
+struct lp_setup_bin_job
+{
+   struct util_queue_fence fence;
+
+   /** private copy of the context, setup.scene points to part */
+   struct lp_setup_context setup;
+   struct lp_scene *part;
+
+   const void *vertex_buffer;
+   const ushort *indices;
+   unsigned stride;
+
+   /** triangles [first, last) of the batch */
+   unsigned first, last;
+};
+
+
+typedef const float (*const_float4_ptr)[4];
+
+static inline const_float4_ptr
+get_vert(const struct lp_setup_bin_job *job, unsigned i)
+{
+   if (job->indices)
+      i = job->indices[i];
+   return (const_float4_ptr)((const char *)job->vertex_buffer +
+                             i * job->stride);
+}
+
+
+/**
+ * Bin one slice of the batch, must match the triangle and triangle strip
+ * cases of lp_setup_draw_arrays() and lp_setup_draw_elements().
+ */
+static void
+bin_job_execute(void *data, int thread_index)
+{
+   struct lp_setup_bin_job *job = (struct lp_setup_bin_job *) data;
+   struct lp_setup_context *setup = &job->setup;
+   unsigned t;
+
+   if (setup->prim == PIPE_PRIM_TRIANGLES) {
+      for (t = job->first; t < job->last && !setup->bin_failed; t++) {
+         const unsigned i = 3 * t + 2;
+         setup->triangle( setup,
+                          get_vert(job, i-2),
+                          get_vert(job, i-1),
+                          get_vert(job, i-0) );
+      }
+   }
+   else if (setup->flatshade_first) {
+      for (t = job->first; t < job->last && !setup->bin_failed; t++) {
+         const unsigned i = t + 2;
+         /* emit first triangle vertex as first triangle vertex */
+         setup->triangle( setup,
+                          get_vert(job, i-2),
+                          get_vert(job, i+(i&1)-1),
+                          get_vert(job, i-(i&1)) );
+      }
+   }
+   else {
+      for (t = job->first; t < job->last && !setup->bin_failed; t++) {
+         const unsigned i = t + 2;
+         /* emit last triangle vertex as last triangle vertex */
+         setup->triangle( setup,
+                          get_vert(job, i+(i&1)-2),
+                          get_vert(job, i-(i&1)-1),
+                          get_vert(job, i-0) );
+      }
+   }
+}
+
+
+/**
+ * Bin a batch of triangles or a triangle strip with several threads.
+ * \param indices  the vertex indices, NULL for non-indexed batches
+ * \param nr  number of vertices or indices
+ * \return FALSE if the batch wasn't binned and the caller has to do it
+ */
+boolean
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                unsigned stride,
+                                const ushort *indices,
+                                unsigned nr)
+{
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   struct lp_scene *scene = setup->scene;
+   unsigned num_tris, num_jobs, budget, i;
+   boolean failed = FALSE;
+
+   if (!setup->bin.num_threads)
+      return FALSE;
+
+   if (setup->prim == PIPE_PRIM_TRIANGLES)
+      num_tris = nr / 3;
+   else if (setup->prim == PIPE_PRIM_TRIANGLE_STRIP)
+      num_tris = nr > 2 ? nr - 2 : 0;
+   else
+      return FALSE;
+
+   num_jobs = MIN2(num_tris / LP_MIN_BIN_SLICE, setup->bin.num_threads + 1);
+   if (num_jobs < 2)
+      return FALSE;
+
+   /* The triangle functions count primitives for the pipeline statistics
+    * queries in the context, and culling everything needs no binning.
+    */
+   if (lp_context->active_statistics_queries ||
+       setup->cullmode == PIPE_FACE_FRONT_AND_BACK)
+      return FALSE;
+
+   assert(setup->state == SETUP_ACTIVE);
+   assert(scene);
+
+   /* what first_triangle() would do on the first triangle */
+   lp_setup_choose_triangle(setup);
+
+   budget = scene->scene_size < LP_SCENE_MAX_SIZE ?
+            (LP_SCENE_MAX_SIZE - scene->scene_size) / num_jobs : 0;
+
+   for (i = 0; i < num_jobs; i++) {
+      struct lp_setup_bin_job *job = setup->bin.jobs[i];
+
+      if (!lp_scene_begin_part(job->part, scene, budget)) {
+         while (i--)
+            lp_scene_discard_part(setup->bin.jobs[i]->part);
+         return FALSE;
+      }
+
+      job->setup = *setup;
+      job->setup.scene = job->part;
+      job->setup.bin_worker = TRUE;
+      job->setup.bin_failed = FALSE;
+
+      job->vertex_buffer = vertex_buffer;
+      job->indices = indices;
+      job->stride = stride;
+      job->first = num_tris * i / num_jobs;
+      job->last = num_tris * (i + 1) / num_jobs;
+   }
+
+   for (i = 1; i < num_jobs; i++) {
+      util_queue_add_job(&setup->bin.queue, setup->bin.jobs[i],
+                         &setup->bin.jobs[i]->fence, bin_job_execute, NULL);
+   }
+
+   bin_job_execute(setup->bin.jobs[0], 0);
+
+   for (i = 1; i < num_jobs; i++)
+      util_queue_job_wait(&setup->bin.jobs[i]->fence);
+
+   for (i = 0; i < num_jobs; i++)
+      failed |= setup->bin.jobs[i]->setup.bin_failed;
+
+   for (i = 0; i < num_jobs; i++) {
+      if (failed)
+         lp_scene_discard_part(setup->bin.jobs[i]->part);
+      else
+         lp_scene_append_part(scene, setup->bin.jobs[i]->part);
+   }
+
+   return !failed;
+}
+
+
+/**
+ * Start the binning threads.  With \p num_threads zero, or if anything
+ * fails, all binning stays on the application thread.
+ */
+void
+lp_setup_init_bin_threads(struct lp_setup_context *setup,
+                          unsigned num_threads)
+{
+   unsigned i;
+
+   num_threads = MIN2(num_threads, LP_MAX_BIN_THREADS);
+   if (!num_threads)
+      return;
+
+   for (i = 0; i < num_threads + 1; i++) {
+      struct lp_setup_bin_job *job = CALLOC_STRUCT(lp_setup_bin_job);
+      if (!job)
+         goto fail;
+      setup->bin.jobs[i] = job;
+
+      job->part = lp_scene_create(setup->pipe, 1);
+      if (!job->part)
+         goto fail;
+      util_queue_fence_init(&job->fence);
+   }
+
+   if (!util_queue_init(&setup->bin.queue, "llvmpipe-bin",
+                        2 * num_threads, num_threads))
+      goto fail;
+
+   setup->bin.num_threads = num_threads;
+   return;
+
+fail:
+   lp_setup_destroy_bin_threads(setup);
+}
+
+
+void
+lp_setup_destroy_bin_threads(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   if (setup->bin.num_threads)
+      util_queue_destroy(&setup->bin.queue);
+   setup->bin.num_threads = 0;
+
+   for (i = 0; i < ARRAY_SIZE(setup->bin.jobs); i++) {
+      struct lp_setup_bin_job *job = setup->bin.jobs[i];
+
+      if (!job)
+         continue;
+
+      if (job->part) {
+         util_queue_fence_destroy(&job->fence);
+         lp_scene_destroy(job->part);
+      }
+      FREE(job);
+      setup->bin.jobs[i] = NULL;
+   }
+}
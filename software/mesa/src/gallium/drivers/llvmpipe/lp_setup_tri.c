@@ -978,6 +978,12 @@ static void retry_triangle_ccw( struct lp_setup_context *setup,
 {
    if (!do_triangle_ccw( setup, position, v0, v1, v2, front ))
    {
+      if (setup->bin_worker) {
+         /* can't flush from a binning job, the batch is redone serially */
+         setup->bin_failed = TRUE;
+         return;
+      }
+
       if (!lp_setup_flush_and_restart(setup))
          return;
 
@@ -46,6 +46,12 @@
 #define LP_MAX_VBUF_INDEXES 1024
 #define LP_MAX_VBUF_SIZE    4096
 
+/* Larger batches when binning in parallel, so that there is enough work
+ * to split between the binning threads.
+ */
+#define LP_MAX_VBUF_INDEXES_PARALLEL (16 * 1024)
+#define LP_MAX_VBUF_SIZE_PARALLEL    (64 * 1024)
+
   
 
 /** cast wrapper */
@@ -184,6 +190,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          indices, nr))
+         break;
       for (i = 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, indices[i-2], stride),
@@ -193,6 +202,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLE_STRIP:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          indices, nr))
+         break;
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first triangle vertex as first triangle vertex */
@@ -382,6 +394,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          NULL, nr))
+         break;
       for (i = 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, i-2, stride),
@@ -391,6 +406,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLE_STRIP:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          NULL, nr))
+         break;
       if (flatshade_first) {
          for (i = 2; i < nr; i++) {
             /* emit first triangle vertex as first triangle vertex */
@@ -585,8 +603,14 @@ lp_setup_pipeline_statistics(
 void
 lp_setup_init_vbuf(struct lp_setup_context *setup)
 {
-   setup->base.max_indices = LP_MAX_VBUF_INDEXES;
-   setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   if (setup->bin.num_threads) {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES_PARALLEL;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE_PARALLEL;
+   }
+   else {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   }
 
    setup->base.get_vertex_info = lp_setup_get_vertex_info;
    setup->base.allocate_vertices = lp_setup_allocate_vertices;
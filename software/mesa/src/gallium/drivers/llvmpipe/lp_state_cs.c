@@ -0,0 +1,961 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compute shaders.
+ *
+ * The TGSI of a compute shader is translated to a function that runs one
+ * vector of invocations of a work group.  launch_grid() hands the work
+ * groups out to the rasterizer threads, each of which runs the vectors of
+ * the groups it takes with its own shared memory.
+ *
+ * BARRIER needs every invocation of the group to reach it before any goes
+ * on.  When a group spans several vectors, each vector runs as a fiber and
+ * the barrier switches back to a scheduler, which resumes the next fiber.
+ */
+
+#include <limits.h>
+#include "util/u_atomic.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_inlines.h"
+#include "util/u_string.h"
+#include "pipe/p_defines.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+#ifdef LP_CS_FIBERS
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+/** Stack size of the fibers running the vectors of a work group */
+#define LP_CS_FIBER_STACK_SIZE (64 * 1024)
+
+
+struct lp_cs_fiber
+{
+#ifdef LP_CS_FIBERS
+   ucontext_t context;
+#endif
+   void *stack;
+   boolean done;
+};
+
+
+/**
+ * Compute state of a rasterizer thread, kept across launches.
+ */
+struct lp_cs_thread
+{
+   uint8_t *shared_mem;
+   unsigned shared_mem_size;
+
+   struct lp_cs_fiber *fibers;
+   unsigned num_fibers;
+
+#ifdef LP_CS_FIBERS
+   ucontext_t scheduler;
+#endif
+
+   /** The work group being run */
+   const struct lp_cs_job *job;
+   unsigned block[3];
+
+   /** The fiber being run */
+   unsigned current;
+};
+
+
+/**
+ * A launch_grid() call, shared by all the rasterizer threads.
+ */
+struct lp_cs_job
+{
+   const struct lp_compute_shader_variant *variant;
+   struct lp_jit_cs_context jit_context;
+
+   unsigned grid[3];
+   unsigned block[3];
+   unsigned num_groups;
+
+   /** Number of jit_function calls per work group */
+   unsigned num_chunks;
+
+   boolean use_fibers;
+
+   /** Next work group to run */
+   int next_group;
+
+   struct lp_cs_thread *threads;
+};
+
+
+/*
+ * Code generation.
+ */
+
+struct lp_cs_llvm_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef context_ptr;
+   LLVMValueRef shared_mem;
+   unsigned shared_size;
+   LLVMValueRef barrier_data;
+};
+
+
+static inline const struct lp_cs_llvm_iface *
+lp_cs_llvm_iface(const struct lp_build_tgsi_cs_iface *iface)
+{
+   return (const struct lp_cs_llvm_iface *)iface;
+}
+
+
+static void
+cs_iface_buffer(const struct lp_build_tgsi_cs_iface *cs_iface,
+                struct gallivm_state *gallivm,
+                unsigned unit,
+                LLVMValueRef *base,
+                LLVMValueRef *size)
+{
+   const struct lp_cs_llvm_iface *iface = lp_cs_llvm_iface(cs_iface);
+   LLVMValueRef index = lp_build_const_int32(gallivm, unit);
+
+   assert(unit < PIPE_MAX_SHADER_BUFFERS);
+
+   *base = lp_build_array_get(gallivm,
+                              lp_jit_cs_context_ssbos(gallivm,
+                                                      iface->context_ptr),
+                              index);
+   *size = lp_build_array_get(gallivm,
+                              lp_jit_cs_context_num_ssbos(gallivm,
+                                                          iface->context_ptr),
+                              index);
+}
+
+
+static void
+cs_iface_shared_memory(const struct lp_build_tgsi_cs_iface *cs_iface,
+                       struct gallivm_state *gallivm,
+                       LLVMValueRef *base,
+                       LLVMValueRef *size)
+{
+   const struct lp_cs_llvm_iface *iface = lp_cs_llvm_iface(cs_iface);
+
+   *base = iface->shared_mem;
+   *size = lp_build_const_int32(gallivm, iface->shared_size);
+}
+
+
+static void
+cs_iface_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+                 struct gallivm_state *gallivm)
+{
+   const struct lp_cs_llvm_iface *iface = lp_cs_llvm_iface(cs_iface);
+   LLVMValueRef barrier, args[1];
+
+   barrier = lp_jit_cs_context_barrier(gallivm, iface->context_ptr);
+   args[0] = iface->barrier_data;
+   LLVMBuildCall(gallivm->builder, barrier, args, ARRAY_SIZE(args), "");
+}
+
+
+static void
+generate_compute(struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+   LLVMTypeRef arg_types[13];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr;
+   LLVMValueRef block_id[3], grid_size[3], block_size[3];
+   LLVMValueRef first_invocation, shared_mem, barrier_data;
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef linear, tmp, mask_val;
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   LLVMBasicBlockRef block;
+   LLVMBuilderRef builder;
+   struct lp_type cs_type;
+   struct lp_build_context uint_bld;
+   struct lp_build_mask_context mask;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_cs_llvm_iface iface;
+   char func_name[64];
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = variant->vector_length;
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u", shader->no);
+
+   arg_types[0] = variant->jit_context_ptr_type;       /* context */
+   arg_types[1] = int32_type;                          /* block_x */
+   arg_types[2] = int32_type;                          /* block_y */
+   arg_types[3] = int32_type;                          /* block_z */
+   arg_types[4] = int32_type;                          /* grid_x */
+   arg_types[5] = int32_type;                          /* grid_y */
+   arg_types[6] = int32_type;                          /* grid_z */
+   arg_types[7] = int32_type;                          /* block_size_x */
+   arg_types[8] = int32_type;                          /* block_size_y */
+   arg_types[9] = int32_type;                          /* block_size_z */
+   arg_types[10] = int32_type;                         /* first_invocation */
+   arg_types[11] = int8_ptr_type;                      /* shared_mem */
+   arg_types[12] = int8_ptr_type;                      /* barrier_data */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   context_ptr = LLVMGetParam(function, 0);
+   for (i = 0; i < 3; i++) {
+      block_id[i] = LLVMGetParam(function, 1 + i);
+      grid_size[i] = LLVMGetParam(function, 4 + i);
+      block_size[i] = LLVMGetParam(function, 7 + i);
+   }
+   first_invocation = LLVMGetParam(function, 10);
+   shared_mem = LLVMGetParam(function, 11);
+   barrier_data = LLVMGetParam(function, 12);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(block_id[0], "block_x");
+   lp_build_name(block_id[1], "block_y");
+   lp_build_name(block_id[2], "block_z");
+   lp_build_name(grid_size[0], "grid_x");
+   lp_build_name(grid_size[1], "grid_y");
+   lp_build_name(grid_size[2], "grid_z");
+   lp_build_name(block_size[0], "block_size_x");
+   lp_build_name(block_size[1], "block_size_y");
+   lp_build_name(block_size[2], "block_size_z");
+   lp_build_name(first_invocation, "first_invocation");
+   lp_build_name(shared_mem, "shared_mem");
+   lp_build_name(barrier_data, "barrier_data");
+
+   /*
+    * Function body
+    */
+
+   block = LLVMAppendBasicBlockInContext(lc, function, "entry");
+   builder = gallivm->builder;
+   assert(builder);
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   /* Linear index of the invocation in the work group, per element */
+   for (i = 0; i < cs_type.length; i++) {
+      elems[i] = lp_build_const_int32(gallivm, i);
+   }
+   linear = lp_build_add(&uint_bld,
+                         lp_build_broadcast_scalar(&uint_bld, first_invocation),
+                         LLVMConstVector(elems, cs_type.length));
+
+   memset(&system_values, 0, sizeof(system_values));
+   for (i = 0; i < 3; i++) {
+      system_values.block_id[i] = block_id[i];
+      system_values.grid_size[i] = grid_size[i];
+      system_values.block_size[i] = block_size[i];
+   }
+
+   tmp = lp_build_broadcast_scalar(&uint_bld, block_size[0]);
+   system_values.thread_id[0] = lp_build_mod(&uint_bld, linear, tmp);
+   linear = lp_build_div(&uint_bld, linear, tmp);
+   tmp = lp_build_broadcast_scalar(&uint_bld, block_size[1]);
+   system_values.thread_id[1] = lp_build_mod(&uint_bld, linear, tmp);
+   system_values.thread_id[2] = lp_build_div(&uint_bld, linear, tmp);
+
+   /* The last vector of the group may be partial */
+   mask_val = lp_build_cmp(&uint_bld, PIPE_FUNC_LESS,
+                           system_values.thread_id[2],
+                           lp_build_broadcast_scalar(&uint_bld, block_size[2]));
+
+   lp_build_mask_begin(&mask, gallivm, cs_type, mask_val);
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, context_ptr);
+   num_consts_ptr = lp_jit_cs_context_num_constants(gallivm, context_ptr);
+
+   memset(&iface, 0, sizeof iface);
+   iface.base.buffer = cs_iface_buffer;
+   iface.base.shared_memory = cs_iface_shared_memory;
+   iface.base.barrier = cs_iface_barrier;
+   iface.context_ptr = context_ptr;
+   iface.shared_mem = shared_mem;
+   iface.shared_size = shader->req_local_mem;
+   iface.barrier_data = barrier_data;
+
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_tgsi_soa(gallivm, shader->tokens, cs_type, &mask,
+                     consts_ptr, num_consts_ptr, &system_values,
+                     NULL, /* inputs */
+                     outputs, context_ptr,
+                     NULL, /* thread data */
+                     NULL, /* sampler */
+                     &shader->info,
+                     NULL, /* gs_iface */
+                     &iface.base);
+
+   lp_build_mask_end(&mask);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static struct lp_compute_shader_variant *
+generate_variant(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader)
+{
+   struct lp_compute_shader_variant *variant;
+   char module_name[64];
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u", shader->no);
+
+   variant->gallivm = gallivm_create(module_name, lp->context);
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->vector_length = MIN2(lp_native_vector_width / 32, 16);
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs = lp_build_count_ir_module(variant->gallivm->module);
+
+   variant->jit_function = (lp_jit_cs_func)
+         gallivm_jit_function(variant->gallivm, variant->function);
+
+   gallivm_free_ir(variant->gallivm);
+
+   return variant;
+}
+
+
+static void
+destroy_variant(struct lp_compute_shader_variant *variant)
+{
+   gallivm_destroy(variant->gallivm);
+   FREE(variant);
+}
+
+
+/*
+ * Execution.
+ */
+
+static void
+cs_run_chunk(const struct lp_cs_job *job,
+             const unsigned block[3],
+             unsigned chunk,
+             uint8_t *shared_mem,
+             void *barrier_data)
+{
+   job->variant->jit_function(&job->jit_context,
+                              block[0], block[1], block[2],
+                              job->grid[0], job->grid[1], job->grid[2],
+                              job->block[0], job->block[1], job->block[2],
+                              chunk * job->variant->vector_length,
+                              shared_mem,
+                              barrier_data);
+}
+
+
+/**
+ * BARRIER when the work group fits in one vector, or without fibers.
+ */
+static void
+cs_barrier_noop(void *data)
+{
+}
+
+
+#ifdef LP_CS_FIBERS
+
+/**
+ * Fiber entrypoint.  makecontext() only passes ints, so the thread
+ * pointer comes in two halves.
+ */
+static void
+cs_fiber_main(int lo, int hi)
+{
+   uint64_t bits = ((uint64_t)(uint32_t)hi << 32) | (uint32_t)lo;
+   struct lp_cs_thread *thread = (struct lp_cs_thread *)(uintptr_t)bits;
+   unsigned chunk = thread->current;
+
+   cs_run_chunk(thread->job, thread->block, chunk, thread->shared_mem, thread);
+
+   /* returns to the scheduler through uc_link */
+   thread->fibers[chunk].done = TRUE;
+}
+
+
+/**
+ * BARRIER: suspend the vector and go back to the scheduler.
+ */
+static void
+cs_fiber_barrier(void *data)
+{
+   struct lp_cs_thread *thread = (struct lp_cs_thread *)data;
+
+   swapcontext(&thread->fibers[thread->current].context, &thread->scheduler);
+}
+
+
+/**
+ * Run all the vectors of a work group, switching between them at each
+ * barrier.  Barriers are in uniform control flow, so every vector reaches
+ * the same barriers in the same order.
+ */
+static void
+cs_run_group_fibers(struct lp_cs_thread *thread)
+{
+   const unsigned num_chunks = thread->job->num_chunks;
+   uint64_t bits = (uintptr_t)thread;
+   unsigned remaining = num_chunks;
+   unsigned i;
+
+   for (i = 0; i < num_chunks; i++) {
+      struct lp_cs_fiber *fiber = &thread->fibers[i];
+
+      getcontext(&fiber->context);
+      fiber->context.uc_stack.ss_sp = fiber->stack;
+      fiber->context.uc_stack.ss_size = LP_CS_FIBER_STACK_SIZE;
+      fiber->context.uc_link = &thread->scheduler;
+      fiber->done = FALSE;
+      makecontext(&fiber->context, (void (*)(void))cs_fiber_main, 2,
+                  (int)(uint32_t)bits, (int)(uint32_t)(bits >> 32));
+   }
+
+   while (remaining) {
+      for (i = 0; i < num_chunks; i++) {
+         if (thread->fibers[i].done)
+            continue;
+
+         thread->current = i;
+         swapcontext(&thread->scheduler, &thread->fibers[i].context);
+
+         if (thread->fibers[i].done)
+            remaining--;
+      }
+   }
+}
+
+#endif /* LP_CS_FIBERS */
+
+
+/**
+ * Run by every rasterizer thread: take work groups until none are left.
+ */
+static void
+cs_job_func(void *data, unsigned thread_index)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *)data;
+   struct lp_cs_thread *thread = &job->threads[thread_index];
+
+   thread->job = job;
+
+   while (1) {
+      unsigned group = p_atomic_inc_return(&job->next_group) - 1;
+      unsigned chunk;
+
+      if (group >= job->num_groups)
+         break;
+
+      thread->block[0] = group % job->grid[0];
+      thread->block[1] = (group / job->grid[0]) % job->grid[1];
+      thread->block[2] = group / (job->grid[0] * job->grid[1]);
+
+#ifdef LP_CS_FIBERS
+      if (job->use_fibers) {
+         cs_run_group_fibers(thread);
+         continue;
+      }
+#endif
+
+      for (chunk = 0; chunk < job->num_chunks; chunk++) {
+         cs_run_chunk(job, thread->block, chunk, thread->shared_mem, NULL);
+      }
+   }
+
+   thread->job = NULL;
+}
+
+
+/**
+ * Allocate a fiber stack with an inaccessible guard page below it, so a
+ * shader overflowing the stack faults instead of overwriting the heap.
+ */
+static void *
+cs_fiber_stack_alloc(void)
+{
+#ifdef LP_CS_FIBERS
+   const size_t page_size = sysconf(_SC_PAGESIZE);
+   uint8_t *map;
+
+   map = mmap(NULL, page_size + LP_CS_FIBER_STACK_SIZE,
+              PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (map == MAP_FAILED)
+      return NULL;
+
+   if (mprotect(map, page_size, PROT_NONE) != 0) {
+      munmap(map, page_size + LP_CS_FIBER_STACK_SIZE);
+      return NULL;
+   }
+
+   return map + page_size;
+#else
+   return NULL;
+#endif
+}
+
+
+static void
+cs_fiber_stack_free(void *stack)
+{
+#ifdef LP_CS_FIBERS
+   const size_t page_size = sysconf(_SC_PAGESIZE);
+
+   if (stack)
+      munmap((uint8_t *)stack - page_size,
+             page_size + LP_CS_FIBER_STACK_SIZE);
+#endif
+}
+
+
+/**
+ * Make sure every thread has the shared memory and fiber stacks the
+ * launch needs.  These are kept for later launches.
+ */
+static boolean
+cs_prepare_threads(struct llvmpipe_context *lp,
+                   unsigned num_threads,
+                   unsigned shared_mem_size,
+                   unsigned num_fibers)
+{
+   unsigned i, j;
+
+   if (!lp->cs_threads) {
+      lp->cs_threads = CALLOC(num_threads, sizeof lp->cs_threads[0]);
+      if (!lp->cs_threads)
+         return FALSE;
+      lp->num_cs_threads = num_threads;
+   }
+
+   assert(lp->num_cs_threads == num_threads);
+
+   for (i = 0; i < num_threads; i++) {
+      struct lp_cs_thread *thread = &lp->cs_threads[i];
+
+      if (thread->shared_mem_size < shared_mem_size) {
+         align_free(thread->shared_mem);
+         thread->shared_mem_size = 0;
+         thread->shared_mem = align_malloc(shared_mem_size, 16);
+         if (!thread->shared_mem)
+            return FALSE;
+         thread->shared_mem_size = shared_mem_size;
+      }
+
+      if (thread->num_fibers < num_fibers) {
+         struct lp_cs_fiber *fibers;
+
+         fibers = REALLOC(thread->fibers,
+                          thread->num_fibers * sizeof fibers[0],
+                          num_fibers * sizeof fibers[0]);
+         if (!fibers)
+            return FALSE;
+         thread->fibers = fibers;
+
+         for (j = thread->num_fibers; j < num_fibers; j++) {
+            memset(&fibers[j], 0, sizeof fibers[j]);
+            fibers[j].stack = cs_fiber_stack_alloc();
+            if (!fibers[j].stack)
+               return FALSE;
+            thread->num_fibers = j + 1;
+         }
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+cs_update_jit_context(struct llvmpipe_context *lp,
+                      struct lp_jit_cs_context *jit_context)
+{
+   static const float fake_const_buf[4];
+   unsigned i;
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; i++) {
+      const struct pipe_constant_buffer *cb =
+         &lp->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data = NULL;
+
+      if (cb->buffer) {
+         data = (const ubyte *) llvmpipe_resource_data(cb->buffer);
+      }
+      else if (cb->user_buffer) {
+         data = (const ubyte *) cb->user_buffer;
+      }
+
+      if (data) {
+         unsigned size = MIN2(cb->buffer_size, LP_MAX_TGSI_CONST_BUFFER_SIZE);
+
+         jit_context->constants[i] =
+            (const float *) (data + cb->buffer_offset);
+         jit_context->num_constants[i] = size / (sizeof(float) * 4);
+      }
+      else {
+         jit_context->constants[i] = fake_const_buf;
+         jit_context->num_constants[i] = 0;
+      }
+   }
+
+   for (i = 0; i < PIPE_MAX_SHADER_BUFFERS; i++) {
+      const struct pipe_shader_buffer *sb = &lp->ssbos[PIPE_SHADER_COMPUTE][i];
+
+      if (sb->buffer && sb->buffer_offset < sb->buffer->width0) {
+         jit_context->ssbos[i] =
+            (uint8_t *) llvmpipe_resource_data(sb->buffer) + sb->buffer_offset;
+         jit_context->num_ssbos[i] =
+            MIN2(sb->buffer_size, sb->buffer->width0 - sb->buffer_offset);
+      }
+      else {
+         jit_context->ssbos[i] = NULL;
+         jit_context->num_ssbos[i] = 0;
+      }
+   }
+}
+
+
+static void
+cs_get_grid_size(struct pipe_context *pipe,
+                 const struct pipe_grid_info *info,
+                 unsigned grid[3])
+{
+   struct pipe_transfer *transfer;
+   const uint32_t *params;
+
+   if (!info->indirect) {
+      grid[0] = info->grid[0];
+      grid[1] = info->grid[1];
+      grid[2] = info->grid[2];
+      return;
+   }
+
+   params = pipe_buffer_map_range(pipe, info->indirect,
+                                  info->indirect_offset,
+                                  3 * sizeof(uint32_t),
+                                  PIPE_TRANSFER_READ,
+                                  &transfer);
+   if (!params) {
+      grid[0] = grid[1] = grid[2] = 0;
+      return;
+   }
+
+   grid[0] = params[0];
+   grid[1] = params[1];
+   grid[2] = params[2];
+   pipe_buffer_unmap(pipe, transfer);
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *cs = lp->cs;
+   const unsigned num_threads = MAX2(1, screen->num_threads);
+   struct lp_cs_job job;
+   uint64_t num_groups;
+   unsigned invocations;
+   unsigned i;
+
+   if (!cs)
+      return;
+
+   memset(&job, 0, sizeof job);
+
+   cs_get_grid_size(pipe, info, job.grid);
+   for (i = 0; i < 3; i++) {
+      job.block[i] = cs->block[i] ? cs->block[i] : info->block[i];
+   }
+
+   num_groups = (uint64_t)job.grid[0] * job.grid[1] * job.grid[2];
+   invocations = job.block[0] * job.block[1] * job.block[2];
+   if (!num_groups || !invocations)
+      return;
+
+   if (num_groups > INT_MAX) {
+      debug_printf("llvmpipe: compute grid of %"PRIu64" work groups "
+                   "is too large\n", num_groups);
+      return;
+   }
+
+   if (!cs->variant) {
+      cs->variant = generate_variant(lp, cs);
+      if (!cs->variant)
+         return;
+   }
+
+   job.variant = cs->variant;
+   job.num_groups = (unsigned) num_groups;
+   job.num_chunks = DIV_ROUND_UP(invocations, cs->variant->vector_length);
+   job.threads = NULL;
+
+   if (cs->has_barrier && job.num_chunks > 1) {
+#ifdef LP_CS_FIBERS
+      job.use_fibers = TRUE;
+#else
+      /* PIPE_CAP_COMPUTE is 0 without fibers */
+      debug_printf("llvmpipe: compute shader barriers spanning more than "
+                   "%u invocations need fibers\n",
+                   cs->variant->vector_length);
+      return;
+#endif
+   }
+
+   if (!cs_prepare_threads(lp, num_threads, cs->req_local_mem,
+                           job.use_fibers ? job.num_chunks : 0))
+      return;
+   job.threads = lp->cs_threads;
+
+   /* Rendering to the buffers must be done before the shader reads them */
+   llvmpipe_flush(pipe, NULL, __FUNCTION__);
+
+   cs_update_jit_context(lp, &job.jit_context);
+#ifdef LP_CS_FIBERS
+   job.jit_context.barrier = job.use_fibers ? cs_fiber_barrier :
+                                              cs_barrier_noop;
+#else
+   job.jit_context.barrier = cs_barrier_noop;
+#endif
+
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_rast_run_job(screen->rast, cs_job_func, &job);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   if (lp->active_statistics_queries) {
+      lp->pipeline_statistics.cs_invocations += num_groups * invocations;
+   }
+}
+
+
+/*
+ * State functions.
+ */
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   static unsigned shader_no = 0;
+   struct lp_compute_shader *shader;
+
+   if (templ->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = shader_no++;
+
+   shader->tokens = tgsi_dup_tokens(templ->prog);
+   if (!shader->tokens) {
+      FREE(shader);
+      return NULL;
+   }
+
+   tgsi_scan_shader(shader->tokens, &shader->info);
+
+   shader->block[0] =
+      shader->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_WIDTH];
+   shader->block[1] =
+      shader->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_HEIGHT];
+   shader->block[2] =
+      shader->info.properties[TGSI_PROPERTY_CS_FIXED_BLOCK_DEPTH];
+   shader->req_local_mem = templ->req_local_mem;
+   shader->has_barrier = shader->info.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %u %p:\n",
+                   shader->no, (void *) shader);
+      tgsi_dump(shader->tokens, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe,
+                            void *cs)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+
+   lp->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe,
+                              void *cs)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = (struct lp_compute_shader *) cs;
+
+   if (lp->cs == shader)
+      lp->cs = NULL;
+
+   if (shader->variant)
+      destroy_variant(shader->variant);
+
+   FREE(shader->tokens);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe,
+                            enum pipe_shader_type shader,
+                            unsigned start_slot, unsigned count,
+                            const struct pipe_shader_buffer *buffers)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= PIPE_MAX_SHADER_BUFFERS);
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &lp->ssbos[shader][start_slot + i];
+
+      if (buffers && buffers[i].buffer) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      }
+      else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
+
+
+/**
+ * Free the compute state of the context.
+ */
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *llvmpipe)
+{
+   unsigned i, j;
+
+   for (i = 0; i < PIPE_SHADER_TYPES; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_BUFFERS; j++) {
+         pipe_resource_reference(&llvmpipe->ssbos[i][j].buffer, NULL);
+      }
+   }
+
+   for (i = 0; i < llvmpipe->num_cs_threads; i++) {
+      struct lp_cs_thread *thread = &llvmpipe->cs_threads[i];
+
+      align_free(thread->shared_mem);
+      for (j = 0; j < thread->num_fibers; j++) {
+         cs_fiber_stack_free(thread->fibers[j].stack);
+      }
+      FREE(thread->fibers);
+   }
+   FREE(llvmpipe->cs_threads);
+   llvmpipe->cs_threads = NULL;
+   llvmpipe->num_cs_threads = 0;
+}
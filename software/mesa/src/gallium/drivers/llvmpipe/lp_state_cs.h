@@ -0,0 +1,99 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef LP_STATE_CS_H_
+#define LP_STATE_CS_H_
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "gallivm/lp_bld.h"
+#include "lp_jit.h"
+
+
+struct tgsi_token;
+
+
+/**
+ * A BARRIER in a work group wider than one vector needs each vector to run
+ * as a fiber, built on ucontext.  Without fibers compute isn't exposed.
+ */
+#if defined(PIPE_OS_LINUX) && !defined(PIPE_OS_ANDROID)
+#define LP_CS_FIBERS 1
+#endif
+
+/* ATOMCAS and MEMBAR need LLVMBuildAtomicCmpXchg and LLVMBuildFence */
+#if HAVE_LLVM >= 0x0309 && defined(LP_CS_FIBERS)
+#define LP_HAVE_COMPUTE 1
+#else
+#define LP_HAVE_COMPUTE 0
+#endif
+
+
+struct lp_compute_shader_variant
+{
+   struct gallivm_state *gallivm;
+
+   LLVMTypeRef jit_context_ptr_type;
+
+   LLVMValueRef function;
+
+   lp_jit_cs_func jit_function;
+
+   /** Number of invocations run by one call of jit_function */
+   unsigned vector_length;
+
+   /* Total number of LLVM instructions generated */
+   unsigned nr_instrs;
+};
+
+
+/** Subclass of pipe_compute_state */
+struct lp_compute_shader
+{
+   struct tgsi_token *tokens;
+   struct tgsi_shader_info info;
+
+   /** Work group size from the CS_FIXED_BLOCK properties, 0 if unset */
+   unsigned block[3];
+
+   /** Size of the shared memory of a work group */
+   unsigned req_local_mem;
+
+   /** Does the shader use BARRIER? */
+   boolean has_barrier;
+
+   /** Compiled on first launch */
+   struct lp_compute_shader_variant *variant;
+
+   /* For debugging/profiling purposes */
+   unsigned no;
+};
+
+
+#endif /* LP_STATE_CS_H_ */
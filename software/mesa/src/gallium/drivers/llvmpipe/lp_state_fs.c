@@ -67,6 +67,7 @@
 #include "util/u_string.h"
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
+#include "util/u_atomic.h"
 #include "os/os_time.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
@@ -101,6 +102,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -477,7 +479,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
                      outputs, context_ptr, thread_data_ptr,
-                     sampler, &shader->info.base, NULL);
+                     sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2177,8 +2179,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2566,18 +2567,144 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+/**
+ * Generate and compile the code of a fragment shader variant into its
+ * gallivm.
+ */
+static void
+compile_variant(struct lp_fragment_shader_variant *variant)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+
+   lp_jit_init_types(variant);
+   
+   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+      generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->jit_function[RAST_WHOLE] == NULL) {
+      if (variant->opaque) {
+         /* Specialized shader, which doesn't need to read the color buffer. */
+         generate_fragment(shader, variant, RAST_WHOLE);
+      }
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   gallivm_free_ir(variant->gallivm);
+}
+
+
+struct lp_fs_variant_job
+{
+   struct llvmpipe_screen *screen;
+   struct lp_fragment_shader_variant *variant;
+};
+
+
+/**
+ * Compile the optimized code of a variant on a JIT queue thread.
+ *
+ * The code is generated into a private copy of the variant, in the
+ * thread's own LLVMContext, and the resulting functions then replace the
+ * unoptimized ones.  Scenes already binned with the variant may be
+ * rasterized concurrently and pick up either version.
+ */
+static void
+optimize_variant(void *data, int thread_index)
+{
+   struct lp_fs_variant_job *job = (struct lp_fs_variant_job *) data;
+   struct lp_fragment_shader_variant *variant = job->variant;
+   struct lp_fragment_shader *shader = variant->shader;
+   struct lp_fragment_shader_variant *opt;
+   char module_name[64];
+   int64_t t0 = 0;
+
+   opt = CALLOC_STRUCT(lp_fragment_shader_variant);
+   if (!opt)
+      return;
+
+   util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+                 shader->no, variant->no);
+
+   opt->gallivm = gallivm_create(module_name,
+                                 job->screen->jit_context[thread_index]);
+   if (!opt->gallivm) {
+      FREE(opt);
+      return;
+   }
+
+   memcpy(&opt->key, &variant->key, shader->variant_key_size);
+   opt->opaque = variant->opaque;
+   opt->ps_inv_multiplier = variant->ps_inv_multiplier;
+   opt->shader = shader;
+   opt->no = variant->no;
+
+   if (LP_DEBUG & DEBUG_FS)
+      t0 = os_time_get();
+
+   compile_variant(opt);
+
+   if (LP_DEBUG & DEBUG_FS) {
+      debug_printf("llvmpipe: fs #%u variant #%u optimized in %u msec\n",
+                   shader->no, variant->no,
+                   (unsigned) ((os_time_get() - t0) / 1000));
+   }
+
+   variant->opt_gallivm = opt->gallivm;
+   p_atomic_set(&variant->jit_function[RAST_EDGE_TEST],
+                opt->jit_function[RAST_EDGE_TEST]);
+   p_atomic_set(&variant->jit_function[RAST_WHOLE],
+                opt->jit_function[RAST_WHOLE]);
+
+   FREE(opt);
+}
+
+
+static void
+free_variant_job(void *data, int thread_index)
+{
+   FREE(data);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ *
+ * With a JIT queue the variant is first compiled without optimizations,
+ * which is several times faster, and the optimized code is compiled in
+ * the background, so that new state combinations don't stall the draw.
  */
 static struct lp_fragment_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
+   boolean async;
    char module_name[64];
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
@@ -2587,12 +2714,18 @@ generate_variant(struct llvmpipe_context *lp,
    util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
                  shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   async = util_queue_is_initialized(&screen->jit_queue);
+   if (async)
+      variant->gallivm = gallivm_create_unoptimized(module_name, lp->context);
+   else
+      variant->gallivm = gallivm_create(module_name, lp->context);
    if (!variant->gallivm) {
       FREE(variant);
       return NULL;
    }
 
+   util_queue_fence_init(&variant->opt_fence);
+
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2631,42 +2764,18 @@ generate_variant(struct llvmpipe_context *lp,
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+   compile_variant(variant);
 
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
+   if (async) {
+      struct lp_fs_variant_job *job = CALLOC_STRUCT(lp_fs_variant_job);
+      if (job) {
+         job->screen = screen;
+         job->variant = variant;
+         util_queue_add_job(&screen->jit_queue, job, &variant->opt_fence,
+                            optimize_variant, free_variant_job);
       }
    }
 
-   /*
-    * Compile everything
-    */
-
-   gallivm_compile_module(variant->gallivm);
-
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
-
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
-   }
-
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
-   }
-
-   gallivm_free_ir(variant->gallivm);
-
    return variant;
 }
 
@@ -2802,7 +2911,13 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants);
    }
 
+   /* the optimized code may still be compiling */
+   util_queue_job_wait(&variant->opt_fence);
+   util_queue_fence_destroy(&variant->opt_fence);
+
    gallivm_destroy(variant->gallivm);
+   if (variant->opt_gallivm)
+      gallivm_destroy(variant->opt_gallivm);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -2894,7 +3009,7 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
       draw_set_mapped_constant_buffer(llvmpipe->draw, shader,
                                       index, data, size);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
    }
 
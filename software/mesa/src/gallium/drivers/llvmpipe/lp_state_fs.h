@@ -33,6 +33,7 @@
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "util/u_queue.h"
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
@@ -110,6 +111,14 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /*
+    * Variants compiled asynchronously start out with unoptimized code in
+    * jit_function[], which is replaced by the code of opt_gallivm once the
+    * background compile signals opt_fence.
+    */
+   struct gallivm_state *opt_gallivm;
+   struct util_queue_fence opt_fence;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
@@ -0,0 +1,569 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \brief  Direct CPU blits
+ *
+ * Blits are done straight on the mapped texture storage instead of
+ * drawing a textured quad through util_blitter.  Rows are processed with
+ * one of three kernels:
+ *  - a raw pixel copy when source and destination formats are the same
+ *    (this also covers depth/stencil and MSAA resolves, since softpipe
+ *    only stores one sample),
+ *  - a byte shuffle between 8-bit RGBA/BGRA/RGBX style formats,
+ *  - an unpack to float / filter / pack path for everything else.
+ * Scaling (nearest or linear), flips and scissoring are handled by the
+ * per-column and per-row source coordinates computed up front.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "sp_blit.h"
+#include "sp_context.h"
+
+
+enum sp_blit_mode {
+   SP_BLIT_COPY,
+   SP_BLIT_SWIZZLE,
+   SP_BLIT_FLOAT
+};
+
+
+/**
+ * Source column/row positions for each destination column/row.
+ * pos0 is used for nearest filtering; pos0, pos1 and weight for linear.
+ */
+struct sp_blit_coords {
+   int *pos0;
+   int *pos1;
+   float *weight;
+   int min, max;
+};
+
+
+static boolean
+sp_blit_coords_init(struct sp_blit_coords *c, int src_start, int src_size,
+                    unsigned dst_size, unsigned src_limit, boolean linear)
+{
+   const float scale = (float) src_size / (float) dst_size;
+   unsigned i;
+
+   c->pos0 = MALLOC(dst_size * sizeof(int));
+   c->pos1 = MALLOC(dst_size * sizeof(int));
+   c->weight = MALLOC(dst_size * sizeof(float));
+   if (!c->pos0 || !c->pos1 || !c->weight)
+      return FALSE;
+
+   c->min = src_limit - 1;
+   c->max = 0;
+
+   for (i = 0; i < dst_size; i++) {
+      float s = src_start + (i + 0.5f) * scale;
+
+      if (linear) {
+         float f;
+
+         s -= 0.5f;
+         f = floorf(s);
+         c->pos0[i] = CLAMP((int) f, 0, (int) src_limit - 1);
+         c->pos1[i] = CLAMP((int) f + 1, 0, (int) src_limit - 1);
+         c->weight[i] = s - f;
+      }
+      else {
+         c->pos0[i] = CLAMP((int) floorf(s), 0, (int) src_limit - 1);
+         c->pos1[i] = c->pos0[i];
+         c->weight[i] = 0.0f;
+      }
+
+      c->min = MIN3(c->min, c->pos0[i], c->pos1[i]);
+      c->max = MAX3(c->max, c->pos0[i], c->pos1[i]);
+   }
+
+   return TRUE;
+}
+
+
+static void
+sp_blit_coords_fini(struct sp_blit_coords *c)
+{
+   FREE(c->pos0);
+   FREE(c->pos1);
+   FREE(c->weight);
+}
+
+
+/*
+ * Row kernels.  Plain loops over one destination row, simple enough for
+ * the compiler to unroll/vectorize.
+ */
+
+#define COPY_PIXELS(NAME, SIZE)                                         \
+static void                                                             \
+NAME(uint8_t *dst, const uint8_t *src, const int *sx, unsigned width)   \
+{                                                                       \
+   unsigned i;                                                          \
+   for (i = 0; i < width; i++)                                          \
+      memcpy(dst + i * SIZE, src + sx[i] * SIZE, SIZE);                 \
+}
+
+COPY_PIXELS(copy_pixels_1, 1)
+COPY_PIXELS(copy_pixels_2, 2)
+COPY_PIXELS(copy_pixels_4, 4)
+COPY_PIXELS(copy_pixels_8, 8)
+COPY_PIXELS(copy_pixels_12, 12)
+COPY_PIXELS(copy_pixels_16, 16)
+
+
+static void
+copy_pixels(uint8_t *dst, const uint8_t *src, const int *sx,
+            unsigned width, unsigned bpp)
+{
+   unsigned i;
+
+   switch (bpp) {
+   case 1:
+      copy_pixels_1(dst, src, sx, width);
+      break;
+   case 2:
+      copy_pixels_2(dst, src, sx, width);
+      break;
+   case 4:
+      copy_pixels_4(dst, src, sx, width);
+      break;
+   case 8:
+      copy_pixels_8(dst, src, sx, width);
+      break;
+   case 12:
+      copy_pixels_12(dst, src, sx, width);
+      break;
+   case 16:
+      copy_pixels_16(dst, src, sx, width);
+      break;
+   default:
+      for (i = 0; i < width; i++)
+         memcpy(dst + i * bpp, src + sx[i] * bpp, bpp);
+      break;
+   }
+}
+
+
+/**
+ * 8-bit, 4 channel shuffle.  sel[c] picks the source byte for destination
+ * byte c; 4 means 0x00 and 5 means 0xff.
+ */
+static void
+swizzle_pixels(uint8_t *dst, const uint8_t *src, const int *sx,
+               unsigned width, const uint8_t sel[4])
+{
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      uint8_t px[6];
+
+      memcpy(px, src + sx[i] * 4, 4);
+      px[4] = 0x00;
+      px[5] = 0xff;
+
+      dst[i * 4 + 0] = px[sel[0]];
+      dst[i * 4 + 1] = px[sel[1]];
+      dst[i * 4 + 2] = px[sel[2]];
+      dst[i * 4 + 3] = px[sel[3]];
+   }
+}
+
+
+static void
+gather_pixels_float(float *dst, const float *src, const int *sx,
+                    unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      const float *s = src + sx[i] * 4;
+      dst[i * 4 + 0] = s[0];
+      dst[i * 4 + 1] = s[1];
+      dst[i * 4 + 2] = s[2];
+      dst[i * 4 + 3] = s[3];
+   }
+}
+
+
+static void
+lerp_pixels_float(float *dst, const float *src0, const float *src1,
+                  float wy, const int *sx0, const int *sx1,
+                  const float *wx, unsigned width)
+{
+   unsigned i, c;
+
+   for (i = 0; i < width; i++) {
+      const float *a = src0 + sx0[i] * 4;
+      const float *b = src0 + sx1[i] * 4;
+      const float *d = src1 + sx0[i] * 4;
+      const float *e = src1 + sx1[i] * 4;
+
+      for (c = 0; c < 4; c++) {
+         const float top = a[c] + (b[c] - a[c]) * wx[i];
+         const float bot = d[c] + (e[c] - d[c]) * wx[i];
+         dst[i * 4 + c] = top + (bot - top) * wy;
+      }
+   }
+}
+
+
+/**
+ * Set up the byte shuffle from src_format to dst_format, if both are
+ * 8-bit unorm, 4 byte array formats (RGBA8, BGRX8, ...) with the same
+ * colorspace.
+ */
+static boolean
+get_swizzle(enum pipe_format src_format, enum pipe_format dst_format,
+            uint8_t sel[4])
+{
+   const struct util_format_description *src =
+      util_format_description(src_format);
+   const struct util_format_description *dst =
+      util_format_description(dst_format);
+   unsigned i, c;
+
+   if (!src->is_array || !dst->is_array ||
+       src->block.bits != 32 || dst->block.bits != 32 ||
+       src->colorspace != dst->colorspace)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      if (src->channel[i].size != 8 || dst->channel[i].size != 8)
+         return FALSE;
+      if (src->channel[i].type != UTIL_FORMAT_TYPE_VOID &&
+          (src->channel[i].type != UTIL_FORMAT_TYPE_UNSIGNED ||
+           !src->channel[i].normalized))
+         return FALSE;
+      if (dst->channel[i].type != UTIL_FORMAT_TYPE_VOID &&
+          (dst->channel[i].type != UTIL_FORMAT_TYPE_UNSIGNED ||
+           !dst->channel[i].normalized))
+         return FALSE;
+   }
+
+   for (i = 0; i < 4; i++) {
+      /* padding bytes are written as zero, like the u_format packers do */
+      sel[i] = 4;
+
+      if (dst->channel[i].type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+
+      for (c = 0; c < 4; c++) {
+         if (dst->swizzle[c] != i)
+            continue;
+
+         if (src->swizzle[c] <= PIPE_SWIZZLE_W)
+            sel[i] = src->swizzle[c];
+         else if (src->swizzle[c] == PIPE_SWIZZLE_1)
+            sel[i] = 5;
+         break;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static boolean
+is_plain_1x1(const struct util_format_description *desc)
+{
+   return desc->block.width == 1 && desc->block.height == 1 &&
+          desc->layout == UTIL_FORMAT_LAYOUT_PLAIN;
+}
+
+
+/**
+ * Pick the kernel for a blit, or return FALSE if it has to be done with
+ * util_blitter.
+ */
+static boolean
+sp_blit_choose(const struct pipe_blit_info *info, enum sp_blit_mode *mode,
+               uint8_t sel[4])
+{
+   const struct util_format_description *src =
+      util_format_description(info->src.format);
+   const struct util_format_description *dst =
+      util_format_description(info->dst.format);
+   const boolean nearest = info->filter == PIPE_TEX_FILTER_NEAREST;
+
+   if (!is_plain_1x1(src) || !is_plain_1x1(dst))
+      return FALSE;
+
+   if (util_format_is_depth_or_stencil(info->src.format) ||
+       util_format_is_depth_or_stencil(info->dst.format)) {
+      unsigned zs_mask = 0;
+
+      if (util_format_has_depth(dst))
+         zs_mask |= PIPE_MASK_Z;
+      if (util_format_has_stencil(dst))
+         zs_mask |= PIPE_MASK_S;
+
+      /* only whole-pixel copies; partial Z/S updates and format
+       * conversions go through the blitter.  The mask is derived from the
+       * view, so views that hide a channel of the resource (e.g. Z24X8 of
+       * Z24S8) must not overwrite it either.
+       */
+      if (info->src.format != info->dst.format ||
+          info->src.format != info->src.resource->format ||
+          info->dst.format != info->dst.resource->format ||
+          (info->mask & (PIPE_MASK_Z | PIPE_MASK_S)) != zs_mask ||
+          !nearest)
+         return FALSE;
+
+      *mode = SP_BLIT_COPY;
+      return TRUE;
+   }
+
+   if ((info->mask & PIPE_MASK_RGBA) != PIPE_MASK_RGBA)
+      return FALSE;
+
+   if (info->src.format == info->dst.format && nearest) {
+      *mode = SP_BLIT_COPY;
+      return TRUE;
+   }
+
+   if (util_format_is_pure_integer(info->src.format) ||
+       util_format_is_pure_integer(info->dst.format))
+      return FALSE;
+
+   if (nearest && get_swizzle(info->src.format, info->dst.format, sel)) {
+      *mode = SP_BLIT_SWIZZLE;
+      return TRUE;
+   }
+
+   if (!src->unpack_rgba_float || !dst->pack_rgba_float)
+      return FALSE;
+
+   *mode = SP_BLIT_FLOAT;
+   return TRUE;
+}
+
+
+boolean
+sp_blit_native(struct softpipe_context *sp, const struct pipe_blit_info *info)
+{
+   struct pipe_context *pipe = &sp->pipe;
+   struct pipe_resource *src_tex = info->src.resource;
+   struct pipe_resource *dst_tex = info->dst.resource;
+   const boolean linear = info->filter == PIPE_TEX_FILTER_LINEAR;
+   const unsigned src_width = u_minify(src_tex->width0, info->src.level);
+   const unsigned src_height = u_minify(src_tex->height0, info->src.level);
+   const unsigned bpp = util_format_get_blocksize(info->dst.format);
+   const unsigned src_bpp = util_format_get_blocksize(info->src.format);
+   const struct util_format_description *src_desc =
+      util_format_description(info->src.format);
+   const struct util_format_description *dst_desc =
+      util_format_description(info->dst.format);
+   struct pipe_transfer *src_trans, *dst_trans;
+   struct pipe_box src_box, dst_box;
+   struct sp_blit_coords cx, cy;
+   enum sp_blit_mode mode;
+   uint8_t sel[4];
+   const uint8_t *src_map;
+   uint8_t *dst_map;
+   float *rows[2] = { NULL, NULL }, *tmp = NULL;
+   int row_y[2];
+   unsigned span = 0;
+   int x0, x1, y0, y1;
+   int i, z;
+   boolean ret = FALSE;
+
+   if (sp->no_native_blit)
+      return FALSE;
+
+   if (src_tex->target == PIPE_BUFFER || dst_tex->target == PIPE_BUFFER ||
+       src_tex->target == PIPE_TEXTURE_1D_ARRAY ||
+       dst_tex->target == PIPE_TEXTURE_1D_ARRAY ||
+       info->alpha_blend ||
+       info->num_window_rectangles ||
+       (src_tex == dst_tex && info->src.level == info->dst.level))
+      return FALSE;
+
+   if (info->dst.box.width <= 0 || info->dst.box.height <= 0 ||
+       info->dst.box.depth <= 0 || info->src.box.width == 0 ||
+       info->src.box.height == 0 ||
+       info->src.box.depth != info->dst.box.depth)
+      return FALSE;
+
+   if (info->dst.box.x + info->dst.box.width >
+       (int) u_minify(dst_tex->width0, info->dst.level) ||
+       info->dst.box.y + info->dst.box.height >
+       (int) u_minify(dst_tex->height0, info->dst.level) ||
+       info->dst.box.x < 0 || info->dst.box.y < 0 ||
+       info->dst.box.z < 0 ||
+       info->dst.box.z + info->dst.box.depth >
+       (int) util_max_layer(dst_tex, info->dst.level) + 1 ||
+       info->src.box.z < 0 ||
+       info->src.box.z + info->src.box.depth >
+       (int) util_max_layer(src_tex, info->src.level) + 1)
+      return FALSE;
+
+   if (util_format_get_blocksize(info->src.format) !=
+       util_format_get_blocksize(src_tex->format) ||
+       bpp != util_format_get_blocksize(dst_tex->format))
+      return FALSE;
+
+   if (!sp_blit_choose(info, &mode, sel))
+      return FALSE;
+
+   /* destination rectangle after scissoring, relative to dst.box */
+   x0 = 0;
+   x1 = info->dst.box.width;
+   y0 = 0;
+   y1 = info->dst.box.height;
+   if (info->scissor_enable) {
+      x0 = MAX2(x0, (int) info->scissor.minx - info->dst.box.x);
+      x1 = MIN2(x1, (int) info->scissor.maxx - info->dst.box.x);
+      y0 = MAX2(y0, (int) info->scissor.miny - info->dst.box.y);
+      y1 = MIN2(y1, (int) info->scissor.maxy - info->dst.box.y);
+      if (x0 >= x1 || y0 >= y1)
+         return TRUE;
+   }
+
+   memset(&cx, 0, sizeof(cx));
+   memset(&cy, 0, sizeof(cy));
+   if (!sp_blit_coords_init(&cx, info->src.box.x, info->src.box.width,
+                            info->dst.box.width, src_width, linear) ||
+       !sp_blit_coords_init(&cy, info->src.box.y, info->src.box.height,
+                            info->dst.box.height, src_height, linear))
+      goto out;
+
+   if (mode == SP_BLIT_FLOAT) {
+      span = cx.max - cx.min + 1;
+
+      rows[0] = MALLOC(span * 4 * sizeof(float));
+      rows[1] = MALLOC(span * 4 * sizeof(float));
+      tmp = MALLOC(info->dst.box.width * 4 * sizeof(float));
+      if (!rows[0] || !rows[1] || !tmp)
+         goto out;
+
+      /* make the column positions relative to the unpacked span */
+      for (i = 0; i < info->dst.box.width; i++) {
+         cx.pos0[i] -= cx.min;
+         cx.pos1[i] -= cx.min;
+      }
+   }
+
+   /* The transfers flush any bound tile caches and expire the texture
+    * caches for the destination, exactly as a CPU upload would.
+    */
+   u_box_3d(0, 0, info->src.box.z, src_width, src_height,
+            info->src.box.depth, &src_box);
+   src_map = pipe->transfer_map(pipe, src_tex, info->src.level,
+                                PIPE_TRANSFER_READ, &src_box, &src_trans);
+   if (!src_map)
+      goto out;
+
+   dst_box = info->dst.box;
+   dst_map = pipe->transfer_map(pipe, dst_tex, info->dst.level,
+                                PIPE_TRANSFER_WRITE, &dst_box, &dst_trans);
+   if (!dst_map) {
+      pipe->transfer_unmap(pipe, src_trans);
+      goto out;
+   }
+
+   for (z = 0; z < info->dst.box.depth; z++) {
+      const uint8_t *src_layer = src_map + z * src_trans->layer_stride;
+      uint8_t *dst_layer = dst_map + z * dst_trans->layer_stride;
+      int y;
+
+      row_y[0] = row_y[1] = -1;
+
+      for (y = y0; y < y1; y++) {
+         uint8_t *dst_row = dst_layer + y * dst_trans->stride + x0 * bpp;
+         const uint8_t *src_row;
+
+         switch (mode) {
+         case SP_BLIT_COPY:
+            src_row = src_layer + cy.pos0[y] * src_trans->stride;
+            copy_pixels(dst_row, src_row, cx.pos0 + x0, x1 - x0, bpp);
+            break;
+
+         case SP_BLIT_SWIZZLE:
+            src_row = src_layer + cy.pos0[y] * src_trans->stride;
+            swizzle_pixels(dst_row, src_row, cx.pos0 + x0, x1 - x0, sel);
+            break;
+
+         case SP_BLIT_FLOAT:
+            /* unpack the (at most two) source rows, reusing the previous
+             * ones where possible
+             */
+            if (linear && row_y[0] != cy.pos0[y] && row_y[1] == cy.pos0[y]) {
+               float *t = rows[0];
+               rows[0] = rows[1];
+               rows[1] = t;
+               row_y[1] = row_y[0];
+               row_y[0] = cy.pos0[y];
+            }
+            if (row_y[0] != cy.pos0[y]) {
+               src_desc->unpack_rgba_float(rows[0], 0,
+                                           src_layer +
+                                           cy.pos0[y] * src_trans->stride +
+                                           cx.min * src_bpp,
+                                           0, span, 1);
+               row_y[0] = cy.pos0[y];
+            }
+            if (linear && row_y[1] != cy.pos1[y]) {
+               src_desc->unpack_rgba_float(rows[1], 0,
+                                           src_layer +
+                                           cy.pos1[y] * src_trans->stride +
+                                           cx.min * src_bpp,
+                                           0, span, 1);
+               row_y[1] = cy.pos1[y];
+            }
+
+            if (linear)
+               lerp_pixels_float(tmp, rows[0], rows[1], cy.weight[y],
+                                 cx.pos0 + x0, cx.pos1 + x0, cx.weight + x0,
+                                 x1 - x0);
+            else
+               gather_pixels_float(tmp, rows[0], cx.pos0 + x0, x1 - x0);
+
+            dst_desc->pack_rgba_float(dst_row, 0, tmp, 0, x1 - x0, 1);
+            break;
+         }
+      }
+   }
+
+   pipe->transfer_unmap(pipe, dst_trans);
+   pipe->transfer_unmap(pipe, src_trans);
+   ret = TRUE;
+
+out:
+   FREE(rows[0]);
+   FREE(rows[1]);
+   FREE(tmp);
+   sp_blit_coords_fini(&cx);
+   sp_blit_coords_fini(&cy);
+   return ret;
+}
@@ -42,6 +42,7 @@
 #include "sp_clear.h"
 #include "sp_context.h"
 #include "sp_flush.h"
+#include "sp_gen_mipmap.h"
 #include "sp_prim_vbuf.h"
 #include "sp_state.h"
 #include "sp_surface.h"
@@ -67,6 +68,8 @@ softpipe_destroy( struct pipe_context *pipe )
    pipe_sampler_view_reference(&softpipe->pstipple.sampler_view, NULL);
 #endif
 
+   sp_destroy_gen_mipmap(softpipe);
+
    if (softpipe->blitter) {
       util_blitter_destroy(softpipe->blitter);
    }
@@ -86,6 +89,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->quad.pstipple)
       softpipe->quad.pstipple->destroy( softpipe->quad.pstipple );
 
+   if (softpipe->quad.fused)
+      softpipe->quad.fused->destroy( softpipe->quad.fused );
+
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
       sp_destroy_tile_cache(softpipe->cbuf_cache[i]);
       pipe_surface_reference(&softpipe->framebuffer.cbufs[i], NULL);
@@ -266,6 +272,7 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
    softpipe->quad.blend = sp_quad_blend_stage(softpipe);
    softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+   softpipe->quad.fused = sp_quad_fused_stage(softpipe);
 
 
    /*
@@ -311,6 +318,15 @@ softpipe_create_context(struct pipe_screen *screen,
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", FALSE ))
       softpipe->no_rast = TRUE;
 
+   if (debug_get_bool_option( "SOFTPIPE_NO_FUSED_QUADS", FALSE ))
+      softpipe->no_fused_quads = TRUE;
+
+   if (debug_get_bool_option( "SOFTPIPE_NO_NATIVE_BLIT", FALSE ))
+      softpipe->no_native_blit = TRUE;
+
+   if (debug_get_bool_option( "SOFTPIPE_NO_NATIVE_MIPMAP", FALSE ))
+      softpipe->no_native_mipmap = TRUE;
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
@@ -342,6 +358,7 @@ softpipe_create_context(struct pipe_screen *screen,
    draw_wide_point_sprites(softpipe->draw, TRUE);
 
    sp_init_surface_functions(softpipe);
+   sp_init_gen_mipmap_functions(softpipe);
 
 #if DO_PSTIPPLE_IN_HELPER_MODULE
    /* create the polgon stipple sampler */
@@ -113,6 +113,9 @@ struct softpipe_context {
    uint64_t occlusion_count;
    unsigned active_query_count;
 
+   /** Bytes moved between tile caches and surfaces, for SP_QUERY_BYTES_COPIED */
+   uint64_t bytes_copied;
+
    /** Mapped vertex buffers */
    ubyte *mapped_vbuffer[PIPE_MAX_ATTRIBS];
 
@@ -169,6 +172,7 @@ struct softpipe_context {
       struct quad_stage *depth_test;
       struct quad_stage *blend;
       struct quad_stage *pstipple;
+      struct quad_stage *fused;
       struct quad_stage *first; /**< points to one of the above stages */
    } quad;
 
@@ -208,10 +212,16 @@ struct softpipe_context {
     */
    struct softpipe_tex_tile_cache *tex_cache[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
+   /** Worker threads for generate_mipmap, started on first use */
+   struct sp_mipmap_threads *mipmap_threads;
+
    unsigned dump_fs : 1;
    unsigned dump_gs : 1;
    unsigned dump_cs : 1;
    unsigned no_rast : 1;
+   unsigned no_fused_quads : 1;
+   unsigned no_native_blit : 1;
+   unsigned no_native_mipmap : 1;
 };
 
 
@@ -0,0 +1,599 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \brief  CPU mipmap generation
+ *
+ * pipe_context::generate_mipmap implemented as a box filter over the
+ * mapped texture levels, instead of a blit per level through the blitter.
+ * Each destination texel is the average of the 2x2 (2x2x2 for 3D
+ * textures) source texels it covers, edges clamped for 1-wide dimensions.
+ *
+ * Rows are filtered with one of four kernels:
+ *  - a per-byte integer average for formats made only of 8-bit UNORM
+ *    channels (RGBA8, BGRA8, BGRX8, RG8, R8, L8A8, ...),
+ *  - the same with the color channels of sRGB formats averaged in linear
+ *    space,
+ *  - a per-channel average for 32-bit float formats,
+ *  - an unpack to float / average / pack path for everything else
+ *    (half float, 5-6-5, 10-10-10-2, ...).
+ *
+ * Levels depend on each other, so they are done in order, but the rows of
+ * a level (across all its layers or slices) are split between the calling
+ * thread and a small pool of worker threads, created on first use.  The
+ * number of workers comes from SOFTPIPE_MIPMAP_THREADS, by default one less
+ * than the number of CPUs.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/format_srgb.h"
+#include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "sp_context.h"
+#include "sp_gen_mipmap.h"
+
+
+#define SP_MAX_MIPMAP_THREADS 8
+
+/** Don't hand out fewer destination texels than this to a thread */
+#define SP_MIPMAP_MIN_CHUNK (64 * 64)
+
+
+enum sp_mipmap_kernel {
+   SP_MIPMAP_UNORM8,
+   SP_MIPMAP_SRGB8,
+   SP_MIPMAP_FLOAT32,
+   SP_MIPMAP_GENERIC
+};
+
+
+/**
+ * One source -> destination level step.  For array and cube textures each
+ * destination layer comes from the same source layer; for 3D textures
+ * each destination slice comes from two source slices.
+ */
+struct sp_mipmap_level {
+   enum sp_mipmap_kernel kernel;
+   const struct util_format_description *desc;
+   unsigned bpp;
+   unsigned srgb_mask;   /**< bytes holding sRGB encoded channels */
+   boolean is_3d;
+
+   const uint8_t *src;
+   unsigned src_stride, src_layer_stride;
+   unsigned src_width, src_height, src_depth;
+
+   uint8_t *dst;
+   unsigned dst_stride, dst_layer_stride;
+   unsigned dst_width, dst_height, dst_depth;
+
+   /** per chunk scratch space for the generic kernel, in floats */
+   float *scratch;
+   unsigned scratch_size;
+};
+
+
+struct sp_mipmap_job {
+   const struct sp_mipmap_level *level;
+   unsigned first_row;
+   unsigned num_rows;
+   float *scratch;
+
+   struct util_queue_fence fence;
+};
+
+
+struct sp_mipmap_threads {
+   unsigned num_threads;
+   struct util_queue queue;
+   struct sp_mipmap_job job[SP_MAX_MIPMAP_THREADS];
+};
+
+
+/*
+ * Row kernels.  src[] holds the two (or four, for 3D) source rows, each
+ * destination texel averages columns 2x and 2x+1 of all of them.  dx is
+ * the byte offset of the second column, 0 when the source is 1 wide.
+ * The byte count and row count are compile time constants at the call
+ * sites so the inner loops can be unrolled/vectorized.
+ */
+
+static inline void
+filter_row_unorm8(uint8_t *dst, const uint8_t * const *src,
+                  const unsigned nr, const unsigned bpp,
+                  unsigned width, unsigned dx)
+{
+   const unsigned shift = nr == 4 ? 3 : 2;
+   const unsigned round = 1 << (shift - 1);
+   unsigned x, b;
+
+   for (x = 0; x < width; x++) {
+      const unsigned s = 2 * x * bpp;
+
+      for (b = 0; b < bpp; b++) {
+         unsigned sum = src[0][s + b] + src[0][s + dx + b] +
+                        src[1][s + b] + src[1][s + dx + b];
+         if (nr == 4)
+            sum += src[2][s + b] + src[2][s + dx + b] +
+                   src[3][s + b] + src[3][s + dx + b];
+         dst[x * bpp + b] = (sum + round) >> shift;
+      }
+   }
+}
+
+
+static void
+filter_row_srgb8(uint8_t *dst, const uint8_t * const *src,
+                 unsigned nr, unsigned bpp, unsigned srgb_mask,
+                 unsigned width, unsigned dx)
+{
+   const float *to_linear = util_format_srgb_8unorm_to_linear_float_table;
+   const float scale = 1.0f / (float) (2 * nr);
+   const unsigned shift = nr == 4 ? 3 : 2;
+   const unsigned round = 1 << (shift - 1);
+   unsigned x, b, r;
+
+   for (x = 0; x < width; x++) {
+      const unsigned s = 2 * x * bpp;
+
+      for (b = 0; b < bpp; b++) {
+         if (srgb_mask & (1 << b)) {
+            float sum = 0.0f;
+            for (r = 0; r < nr; r++)
+               sum += to_linear[src[r][s + b]] + to_linear[src[r][s + dx + b]];
+            dst[x * bpp + b] = util_format_linear_float_to_srgb_8unorm(sum * scale);
+         }
+         else {
+            unsigned sum = 0;
+            for (r = 0; r < nr; r++)
+               sum += src[r][s + b] + src[r][s + dx + b];
+            dst[x * bpp + b] = (sum + round) >> shift;
+         }
+      }
+   }
+}
+
+
+static inline void
+filter_row_float32(float *dst, const float * const *src,
+                   const unsigned nr, unsigned comps,
+                   unsigned width, unsigned dx)
+{
+   const float scale = 1.0f / (float) (2 * nr);
+   unsigned x, c;
+
+   for (x = 0; x < width; x++) {
+      const unsigned s = 2 * x * comps;
+
+      for (c = 0; c < comps; c++) {
+         float sum = src[0][s + c] + src[0][s + dx + c] +
+                     src[1][s + c] + src[1][s + dx + c];
+         if (nr == 4)
+            sum += src[2][s + c] + src[2][s + dx + c] +
+                   src[3][s + c] + src[3][s + dx + c];
+         dst[x * comps + c] = sum * scale;
+      }
+   }
+}
+
+
+/**
+ * Filter destination rows [first_row, first_row + num_rows) of a level,
+ * counted across all its layers/slices.
+ */
+static void
+sp_mipmap_filter_rows(const struct sp_mipmap_level *lvl,
+                      unsigned first_row, unsigned num_rows, float *scratch)
+{
+   const unsigned nr = lvl->is_3d ? 4 : 2;
+   const unsigned src_span = MIN2(2 * lvl->dst_width, lvl->src_width);
+   const unsigned dx = lvl->src_width > 1 ? 1 : 0;
+   unsigned row;
+
+   for (row = first_row; row < first_row + num_rows; row++) {
+      const unsigned z = row / lvl->dst_height;
+      const unsigned y = row % lvl->dst_height;
+      const unsigned y0 = 2 * y;
+      const unsigned y1 = MIN2(y0 + 1, lvl->src_height - 1);
+      const uint8_t *src[4];
+      uint8_t *dst;
+      unsigned z0, z1, i;
+
+      if (lvl->is_3d) {
+         z0 = 2 * z;
+         z1 = MIN2(z0 + 1, lvl->src_depth - 1);
+      }
+      else {
+         z0 = z1 = z;
+      }
+
+      src[0] = lvl->src + z0 * lvl->src_layer_stride + y0 * lvl->src_stride;
+      src[1] = lvl->src + z0 * lvl->src_layer_stride + y1 * lvl->src_stride;
+      src[2] = lvl->src + z1 * lvl->src_layer_stride + y0 * lvl->src_stride;
+      src[3] = lvl->src + z1 * lvl->src_layer_stride + y1 * lvl->src_stride;
+      dst = lvl->dst + z * lvl->dst_layer_stride + y * lvl->dst_stride;
+
+      switch (lvl->kernel) {
+      case SP_MIPMAP_UNORM8:
+         switch (lvl->bpp) {
+         case 1:
+            if (nr == 4)
+               filter_row_unorm8(dst, src, 4, 1, lvl->dst_width, dx);
+            else
+               filter_row_unorm8(dst, src, 2, 1, lvl->dst_width, dx);
+            break;
+         case 2:
+            if (nr == 4)
+               filter_row_unorm8(dst, src, 4, 2, lvl->dst_width, dx * 2);
+            else
+               filter_row_unorm8(dst, src, 2, 2, lvl->dst_width, dx * 2);
+            break;
+         case 4:
+            if (nr == 4)
+               filter_row_unorm8(dst, src, 4, 4, lvl->dst_width, dx * 4);
+            else
+               filter_row_unorm8(dst, src, 2, 4, lvl->dst_width, dx * 4);
+            break;
+         default:
+            filter_row_unorm8(dst, src, nr, lvl->bpp, lvl->dst_width,
+                              dx * lvl->bpp);
+            break;
+         }
+         break;
+
+      case SP_MIPMAP_SRGB8:
+         filter_row_srgb8(dst, src, nr, lvl->bpp, lvl->srgb_mask,
+                          lvl->dst_width, dx * lvl->bpp);
+         break;
+
+      case SP_MIPMAP_FLOAT32:
+         {
+            const unsigned comps = lvl->bpp / 4;
+            const float *fsrc[4];
+
+            for (i = 0; i < 4; i++)
+               fsrc[i] = (const float *) src[i];
+
+            if (nr == 4)
+               filter_row_float32((float *) dst, fsrc, 4, comps,
+                                  lvl->dst_width, dx * comps);
+            else
+               filter_row_float32((float *) dst, fsrc, 2, comps,
+                                  lvl->dst_width, dx * comps);
+         }
+         break;
+
+      case SP_MIPMAP_GENERIC:
+         {
+            const float *fsrc[4];
+            float *tmp = scratch + 4 * src_span * 4;
+
+            /* rows 2 and 3 are the same as 0 and 1 unless 3D */
+            for (i = 0; i < nr; i++) {
+               float *unpacked = scratch + i * src_span * 4;
+               lvl->desc->unpack_rgba_float(unpacked, 0, src[i], 0,
+                                            src_span, 1);
+               fsrc[i] = unpacked;
+            }
+
+            if (nr == 4)
+               filter_row_float32(tmp, fsrc, 4, 4, lvl->dst_width, dx * 4);
+            else
+               filter_row_float32(tmp, fsrc, 2, 4, lvl->dst_width, dx * 4);
+
+            lvl->desc->pack_rgba_float(dst, 0, tmp, 0, lvl->dst_width, 1);
+         }
+         break;
+      }
+   }
+}
+
+
+static void
+sp_mipmap_job_execute(void *data, int thread_index)
+{
+   struct sp_mipmap_job *job = (struct sp_mipmap_job *) data;
+
+   sp_mipmap_filter_rows(job->level, job->first_row, job->num_rows,
+                         job->scratch);
+}
+
+
+/**
+ * Start the worker threads the first time they may be useful.  If that
+ * fails the mipmaps are just generated on the calling thread.
+ */
+static struct sp_mipmap_threads *
+sp_mipmap_threads_get(struct softpipe_context *sp)
+{
+   struct sp_mipmap_threads *threads;
+   unsigned num_threads, i;
+
+   if (sp->mipmap_threads)
+      return sp->mipmap_threads;
+
+   threads = CALLOC_STRUCT(sp_mipmap_threads);
+   if (!threads)
+      return NULL;
+
+   for (i = 0; i < SP_MAX_MIPMAP_THREADS; i++)
+      util_queue_fence_init(&threads->job[i].fence);
+
+   util_cpu_detect();
+   num_threads = debug_get_num_option("SOFTPIPE_MIPMAP_THREADS",
+                                      util_cpu_caps.nr_cpus - 1);
+   num_threads = MIN2(num_threads, SP_MAX_MIPMAP_THREADS);
+
+   if (num_threads) {
+      if (util_queue_init(&threads->queue, "spmipmap", num_threads,
+                          num_threads)) {
+         /* the queue may have started fewer threads than asked for */
+         threads->num_threads = threads->queue.num_threads;
+      }
+      else {
+         debug_printf("softpipe: failed to start %u mipmap threads\n",
+                      num_threads);
+      }
+   }
+
+   sp->mipmap_threads = threads;
+   return threads;
+}
+
+
+/**
+ * Filter a whole level, splitting its rows between the calling thread and
+ * the workers.
+ */
+static void
+sp_mipmap_run(const struct sp_mipmap_level *lvl,
+              struct sp_mipmap_threads *threads)
+{
+   const unsigned num_rows = lvl->dst_height * lvl->dst_depth;
+   const unsigned max_chunks =
+      MAX2(num_rows * lvl->dst_width / SP_MIPMAP_MIN_CHUNK, 1);
+   unsigned num_chunks, chunk, start, i, nr_jobs = 0;
+
+   num_chunks = threads ? threads->num_threads + 1 : 1;
+   num_chunks = MIN3(num_chunks, max_chunks, num_rows);
+   chunk = DIV_ROUND_UP(num_rows, num_chunks);
+
+   for (start = chunk; start < num_rows; start += chunk) {
+      struct sp_mipmap_job *job = &threads->job[nr_jobs++];
+
+      assert(nr_jobs <= threads->num_threads);
+
+      job->level = lvl;
+      job->first_row = start;
+      job->num_rows = MIN2(chunk, num_rows - start);
+      job->scratch = lvl->scratch + nr_jobs * lvl->scratch_size;
+
+      util_queue_add_job(&threads->queue, job, &job->fence,
+                         sp_mipmap_job_execute, NULL);
+   }
+
+   sp_mipmap_filter_rows(lvl, 0, MIN2(chunk, num_rows), lvl->scratch);
+
+   for (i = 0; i < nr_jobs; i++)
+      util_queue_job_wait(&threads->job[i].fence);
+}
+
+
+/**
+ * Pick the row kernel for a format, or return FALSE if it can't be
+ * filtered here at all.
+ */
+static boolean
+sp_mipmap_choose_kernel(const struct util_format_description *desc,
+                        enum sp_mipmap_kernel *kernel, unsigned *srgb_mask)
+{
+   boolean all_unorm8 = desc->is_array, all_float32 = desc->is_array;
+   unsigned c;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
+       util_format_is_pure_integer(desc->format))
+      return FALSE;
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      const struct util_format_channel_description *chan = &desc->channel[c];
+
+      if (chan->size != 8 ||
+          (chan->type != UTIL_FORMAT_TYPE_VOID &&
+           (chan->type != UTIL_FORMAT_TYPE_UNSIGNED || !chan->normalized)))
+         all_unorm8 = FALSE;
+
+      if (chan->size != 32 ||
+          (chan->type != UTIL_FORMAT_TYPE_VOID &&
+           chan->type != UTIL_FORMAT_TYPE_FLOAT))
+         all_float32 = FALSE;
+   }
+
+   *srgb_mask = 0;
+
+   if (all_unorm8 && desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB) {
+      /* R, G and B are sRGB encoded, alpha (and padding) is linear */
+      for (c = 0; c < 3; c++) {
+         if (desc->swizzle[c] <= PIPE_SWIZZLE_W)
+            *srgb_mask |= 1 << desc->swizzle[c];
+      }
+      *kernel = SP_MIPMAP_SRGB8;
+   }
+   else if (all_unorm8)
+      *kernel = SP_MIPMAP_UNORM8;
+   else if (all_float32)
+      *kernel = SP_MIPMAP_FLOAT32;
+   else if (desc->unpack_rgba_float && desc->pack_rgba_float)
+      *kernel = SP_MIPMAP_GENERIC;
+   else
+      return FALSE;
+
+   return TRUE;
+}
+
+
+static boolean
+softpipe_generate_mipmap(struct pipe_context *pipe,
+                         struct pipe_resource *pt,
+                         enum pipe_format format,
+                         unsigned base_level,
+                         unsigned last_level,
+                         unsigned first_layer,
+                         unsigned last_layer)
+{
+   struct softpipe_context *sp = softpipe_context(pipe);
+   const struct util_format_description *desc =
+      util_format_description(format);
+   struct sp_mipmap_threads *threads = NULL;
+   struct sp_mipmap_level lvl;
+   unsigned num_slots, level;
+   boolean ret = FALSE;
+
+   if (sp->no_native_mipmap ||
+       pt->target == PIPE_BUFFER ||
+       pt->nr_samples > 1 ||
+       util_format_get_blocksize(format) !=
+       util_format_get_blocksize(pt->format))
+      return FALSE;
+
+   memset(&lvl, 0, sizeof(lvl));
+   if (!sp_mipmap_choose_kernel(desc, &lvl.kernel, &lvl.srgb_mask))
+      return FALSE;
+
+   lvl.desc = desc;
+   lvl.bpp = util_format_get_blocksize(format);
+   lvl.is_3d = pt->target == PIPE_TEXTURE_3D;
+
+   /* only bother with the threads if the first level is big enough */
+   if (u_minify(pt->width0, base_level + 1) *
+       u_minify(pt->height0, base_level + 1) *
+       (lvl.is_3d ? u_minify(pt->depth0, base_level + 1) :
+        last_layer - first_layer + 1) >= 2 * SP_MIPMAP_MIN_CHUNK)
+      threads = sp_mipmap_threads_get(sp);
+   num_slots = threads ? threads->num_threads + 1 : 1;
+
+   if (lvl.kernel == SP_MIPMAP_GENERIC) {
+      /* four unpacked source rows and one destination row per chunk */
+      lvl.scratch_size = (4 * u_minify(pt->width0, base_level) +
+                          u_minify(pt->width0, base_level + 1)) * 4;
+      lvl.scratch = MALLOC(num_slots * lvl.scratch_size * sizeof(float));
+      if (!lvl.scratch)
+         return FALSE;
+   }
+
+   for (level = base_level + 1; level <= last_level; level++) {
+      struct pipe_transfer *src_trans, *dst_trans;
+      struct pipe_box src_box, dst_box;
+      unsigned first, src_layers, dst_layers;
+
+      lvl.src_width = u_minify(pt->width0, level - 1);
+      lvl.src_height = u_minify(pt->height0, level - 1);
+      lvl.dst_width = u_minify(pt->width0, level);
+      lvl.dst_height = u_minify(pt->height0, level);
+
+      if (lvl.is_3d) {
+         first = 0;
+         src_layers = u_minify(pt->depth0, level - 1);
+         dst_layers = u_minify(pt->depth0, level);
+      }
+      else {
+         first = first_layer;
+         src_layers = dst_layers = last_layer - first_layer + 1;
+      }
+      lvl.src_depth = src_layers;
+      lvl.dst_depth = dst_layers;
+
+      /* The transfers flush any tile caches holding these levels and
+       * expire the sampler caches of the written one.
+       */
+      u_box_3d(0, 0, first, lvl.src_width, lvl.src_height, src_layers,
+               &src_box);
+      lvl.src = pipe->transfer_map(pipe, pt, level - 1, PIPE_TRANSFER_READ,
+                                   &src_box, &src_trans);
+      if (!lvl.src)
+         goto out;
+
+      u_box_3d(0, 0, first, lvl.dst_width, lvl.dst_height, dst_layers,
+               &dst_box);
+      lvl.dst = pipe->transfer_map(pipe, pt, level, PIPE_TRANSFER_WRITE,
+                                   &dst_box, &dst_trans);
+      if (!lvl.dst) {
+         pipe->transfer_unmap(pipe, src_trans);
+         goto out;
+      }
+
+      lvl.src_stride = src_trans->stride;
+      lvl.src_layer_stride = src_trans->layer_stride;
+      lvl.dst_stride = dst_trans->stride;
+      lvl.dst_layer_stride = dst_trans->layer_stride;
+
+      sp_mipmap_run(&lvl, threads);
+
+      pipe->transfer_unmap(pipe, dst_trans);
+      pipe->transfer_unmap(pipe, src_trans);
+   }
+
+   ret = TRUE;
+
+out:
+   FREE(lvl.scratch);
+   return ret;
+}
+
+
+void
+sp_init_gen_mipmap_functions(struct softpipe_context *sp)
+{
+   sp->pipe.generate_mipmap = softpipe_generate_mipmap;
+}
+
+
+void
+sp_destroy_gen_mipmap(struct softpipe_context *sp)
+{
+   struct sp_mipmap_threads *threads = sp->mipmap_threads;
+   unsigned i;
+
+   if (!threads)
+      return;
+
+   if (util_queue_is_initialized(&threads->queue))
+      util_queue_destroy(&threads->queue);
+
+   for (i = 0; i < SP_MAX_MIPMAP_THREADS; i++)
+      util_queue_fence_destroy(&threads->job[i].fence);
+
+   FREE(threads);
+   sp->mipmap_threads = NULL;
+}
@@ -42,12 +42,16 @@
 #include "sp_prim_vbuf.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
 
 #define SP_MAX_VBUF_INDEXES 1024
 #define SP_MAX_VBUF_SIZE    4096
 
+/** Number of triangles culled together before setup */
+#define SP_TRI_BATCH 64
+
 typedef const float (*cptrf4)[4];
 
 /**
@@ -64,6 +68,13 @@ struct softpipe_vbuf_render
    uint nr_vertices;
    uint vertex_buffer_size;
    void *vertex_buffer;
+
+   /** Faces to cull, PIPE_FACE_x, derived in set_primitive */
+   unsigned cull_face;
+
+   /** Triangles waiting for sp_flush_tris() */
+   cptrf4 tris[SP_TRI_BATCH][3];
+   uint nr_tris;
 };
 
 
@@ -141,6 +152,18 @@ sp_vbuf_set_primitive(struct vbuf_render *vbr, unsigned prim)
 
    cvbr->softpipe->reduced_prim = u_reduced_prim(prim);
    cvbr->prim = prim;
+
+   /* Same rule as sp_setup_prepare(): unfilled triangles get culled
+    * by the draw module before they are turned into lines or points.
+    */
+   if (cvbr->softpipe->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
+       cvbr->softpipe->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
+       cvbr->softpipe->rasterizer->fill_back == PIPE_POLYGON_MODE_FILL) {
+      cvbr->cull_face = cvbr->softpipe->rasterizer->cull_face;
+   }
+   else {
+      cvbr->cull_face = PIPE_FACE_NONE;
+   }
 }
 
 
@@ -152,6 +175,133 @@ static inline cptrf4 get_vert( const void *vertex_buffer,
 }
 
 
+/**
+ * Find the triangles of the batch that can't produce any fragment:
+ * zero area (or NaN), culled face, entirely outside the cliprect, or
+ * so thin that their bounding box doesn't contain a pixel center.
+ *
+ * The positions are gathered into separate arrays first so that the
+ * test loop has no branches and can be vectorized by the compiler.
+ * The tests are conservative with respect to the span rasterizer in
+ * sp_setup.c, which samples rows at y + pixel_offset in
+ * [ceil(ymin), ceil(ymax)) and columns at the truncated edge x + offset.
+ */
+static void
+sp_cull_tris(const struct softpipe_vbuf_render *cvbr,
+             unsigned nr,
+             ubyte keep[SP_TRI_BATCH])
+{
+   const struct softpipe_context *softpipe = cvbr->softpipe;
+   const int viewport_index_slot = softpipe->viewport_index_slot;
+   const float offset = softpipe->rasterizer->half_pixel_center ? 0.5f : 0.0f;
+   const unsigned front_ccw = softpipe->rasterizer->front_ccw;
+   const unsigned cull_face = cvbr->cull_face;
+   /* slack for the rounding of the edge walk in x, in pixels */
+   const float pad = 1.0f / 64.0f;
+   float x0[SP_TRI_BATCH], y0[SP_TRI_BATCH];
+   float x1[SP_TRI_BATCH], y1[SP_TRI_BATCH];
+   float x2[SP_TRI_BATCH], y2[SP_TRI_BATCH];
+   float minx[SP_TRI_BATCH], miny[SP_TRI_BATCH];
+   float maxx[SP_TRI_BATCH], maxy[SP_TRI_BATCH];
+   unsigned i;
+
+   for (i = 0; i < nr; i++) {
+      const struct pipe_scissor_state *cliprect = &softpipe->cliprect[0];
+
+      if (viewport_index_slot > 0) {
+         unsigned *udata = (unsigned *)cvbr->tris[i][0][viewport_index_slot];
+         cliprect = &softpipe->cliprect[sp_clamp_viewport_idx(*udata)];
+      }
+
+      x0[i] = cvbr->tris[i][0][0][0];
+      y0[i] = cvbr->tris[i][0][0][1];
+      x1[i] = cvbr->tris[i][1][0][0];
+      y1[i] = cvbr->tris[i][1][0][1];
+      x2[i] = cvbr->tris[i][2][0][0];
+      y2[i] = cvbr->tris[i][2][0][1];
+      minx[i] = (float) cliprect->minx;
+      miny[i] = (float) cliprect->miny;
+      maxx[i] = (float) cliprect->maxx;
+      maxy[i] = (float) cliprect->maxy;
+   }
+
+   for (i = 0; i < nr; i++) {
+      /* same determinant as calc_det() in sp_setup.c */
+      const float ex = x0[i] - x2[i];
+      const float ey = y0[i] - y2[i];
+      const float fx = x1[i] - x2[i];
+      const float fy = y1[i] - y2[i];
+      const float det = ex * fy - ey * fx;
+      const unsigned facing = (det < 0.0f) ^ front_ccw;
+      const float xl = truncf(MIN3(x0[i], x1[i], x2[i]) + offset - pad);
+      const float xr = truncf(MAX3(x0[i], x1[i], x2[i]) + offset + pad);
+      const float yt = ceilf(MIN3(y0[i], y1[i], y2[i]) - offset);
+      const float yb = ceilf(MAX3(y0[i], y1[i], y2[i]) - offset);
+      unsigned cull;
+
+      cull = det == 0.0f || util_is_inf_or_nan(det);
+      cull |= ((PIPE_FACE_FRONT << facing) & cull_face) != 0;
+      cull |= xr <= minx[i];
+      cull |= xl >= maxx[i];
+      cull |= yb <= miny[i];
+      cull |= yt >= maxy[i];
+      cull |= xl >= xr;
+      cull |= yt >= yb;
+
+      keep[i] = !cull;
+   }
+}
+
+
+/**
+ * Cull the queued triangles and send the survivors to setup.
+ */
+static void
+sp_flush_tris(struct softpipe_vbuf_render *cvbr)
+{
+   const unsigned nr = cvbr->nr_tris;
+   ubyte keep[SP_TRI_BATCH];
+   unsigned i;
+
+   if (!nr)
+      return;
+
+   cvbr->nr_tris = 0;
+
+   if (cvbr->softpipe->no_rast ||
+       cvbr->softpipe->rasterizer->rasterizer_discard)
+      return;
+
+   sp_cull_tris(cvbr, nr, keep);
+
+   for (i = 0; i < nr; i++) {
+      if (keep[i]) {
+         ogpu_raster_tri(cvbr->setup,
+                         cvbr->tris[i][0],
+                         cvbr->tris[i][1],
+                         cvbr->tris[i][2]);
+      }
+   }
+}
+
+
+static inline void
+sp_queue_tri(struct softpipe_vbuf_render *cvbr,
+             cptrf4 v0,
+             cptrf4 v1,
+             cptrf4 v2)
+{
+   cptrf4 *tri = cvbr->tris[cvbr->nr_tris];
+
+   tri[0] = v0;
+   tri[1] = v1;
+   tri[2] = v2;
+
+   if (++cvbr->nr_tris == SP_TRI_BATCH)
+      sp_flush_tris(cvbr);
+}
+
+
 /**
  * draw elements / indexed primitives
  */
@@ -205,7 +355,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
 
    case PIPE_PRIM_TRIANGLES:
        for (i = 2; i < nr; i += 3) {
-         ogpu_raster_tri( setup,
+         sp_queue_tri( cvbr,
                        get_vert(vertex_buffer, indices[i-2], stride),
                        get_vert(vertex_buffer, indices[i-1], stride),
                        get_vert(vertex_buffer, indices[i-0], stride) );
@@ -216,7 +366,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first triangle vertex as first triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i+(i&1)-1], stride),
                           get_vert(vertex_buffer, indices[i-(i&1)], stride) );
@@ -226,7 +376,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last triangle vertex as last triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i+(i&1)-2], stride),
                           get_vert(vertex_buffer, indices[i-(i&1)-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
@@ -238,7 +388,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[0], stride) );
@@ -247,7 +397,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last non-spoke vertex as last vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[0], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
@@ -260,12 +410,12 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[i-3], stride),
                           get_vert(vertex_buffer, indices[i-2], stride) );
 
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-1], stride) );
@@ -274,12 +424,12 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-3], stride),
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
 
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
@@ -292,11 +442,11 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[i-3], stride),
                           get_vert(vertex_buffer, indices[i-2], stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-3], stride) );
@@ -305,11 +455,11 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-3], stride),
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-3], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
@@ -324,7 +474,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       if (flatshade_first) {
          /* emit first polygon  vertex as first triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[0], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride) );
@@ -333,7 +483,7 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       else {
          /* emit first polygon  vertex as last triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, indices[i-1], stride),
                           get_vert(vertex_buffer, indices[i-0], stride),
                           get_vert(vertex_buffer, indices[0], stride) );
@@ -344,6 +494,8 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   sp_flush_tris(cvbr);
 }
 
 
@@ -418,7 +570,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
 
    case PIPE_PRIM_TRIANGLES:
        for (i = 2; i < nr; i += 3) {
-         ogpu_raster_tri( setup,
+         sp_queue_tri( cvbr,
                        get_vert(vertex_buffer, i-2, stride),
                        get_vert(vertex_buffer, i-1, stride),
                        get_vert(vertex_buffer, i-0, stride) );
@@ -427,7 +579,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
 
    case PIPE_PRIM_TRIANGLES_ADJACENCY:
       for (i = 5; i < nr; i += 6) {
-         ogpu_raster_tri( setup,
+         sp_queue_tri( cvbr,
                        get_vert(vertex_buffer, i-5, stride),
                        get_vert(vertex_buffer, i-3, stride),
                        get_vert(vertex_buffer, i-1, stride) );
@@ -438,7 +590,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i++) {
             /* emit first triangle vertex as first triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i+(i&1)-1, stride),
                           get_vert(vertex_buffer, i-(i&1), stride) );
@@ -447,7 +599,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          for (i = 2; i < nr; i++) {
             /* emit last triangle vertex as last triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i+(i&1)-2, stride),
                           get_vert(vertex_buffer, i-(i&1)-1, stride),
                           get_vert(vertex_buffer, i-0, stride) );
@@ -459,7 +611,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 5; i < nr; i += 2) {
             /* emit first triangle vertex as first triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-5, stride),
                           get_vert(vertex_buffer, i+(i&1)*2-3, stride),
                           get_vert(vertex_buffer, i-(i&1)*2-1, stride) );
@@ -468,7 +620,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          for (i = 5; i < nr; i += 2) {
             /* emit last triangle vertex as last triangle vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i+(i&1)*2-5, stride),
                           get_vert(vertex_buffer, i-(i&1)*2-3, stride),
                           get_vert(vertex_buffer, i-1, stride) );
@@ -480,7 +632,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          for (i = 2; i < nr; i += 1) {
             /* emit first non-spoke vertex as first vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, 0, stride)  );
@@ -489,7 +641,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          for (i = 2; i < nr; i += 1) {
             /* emit last non-spoke vertex as last vertex */
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, 0, stride),
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-0, stride) );
@@ -502,11 +654,11 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 4) {
-                ogpu_raster_tri( setup,
+                sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, i-3, stride),
                           get_vert(vertex_buffer, i-2, stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-1, stride) );
@@ -515,11 +667,11 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 4) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-3, stride),
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-0, stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-0, stride) );
@@ -532,11 +684,11 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          /* emit last quad vertex as first triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, i-3, stride),
                           get_vert(vertex_buffer, i-2, stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-3, stride) );
@@ -545,11 +697,11 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          /* emit last quad vertex as last triangle vertex */
          for (i = 3; i < nr; i += 2) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-3, stride),
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-0, stride) );
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-3, stride),
                           get_vert(vertex_buffer, i-0, stride) );
@@ -564,7 +716,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       if (flatshade_first) {
          /* emit first polygon  vertex as first triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, 0, stride),
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-0, stride) );
@@ -573,7 +725,7 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       else {
          /* emit first polygon  vertex as last triangle vertex */
          for (i = 2; i < nr; i += 1) {
-            ogpu_raster_tri( setup,
+            sp_queue_tri( cvbr,
                           get_vert(vertex_buffer, i-1, stride),
                           get_vert(vertex_buffer, i-0, stride),
                           get_vert(vertex_buffer, 0, stride) );
@@ -584,6 +736,8 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   sp_flush_tris(cvbr);
 }
 
 /*
@@ -0,0 +1,268 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \brief  Fused early depth test / shade / blend quad stage
+ *
+ * For the most common early-Z state combinations the depth test, fragment
+ * shader and color write are done in a single loop over the quads, with
+ * the depth and color tiles looked up once per batch.  Any other state is
+ * handed to the generic stages which follow this one in the pipeline.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_quad_pipe.h"
+#include "sp_state.h"
+#include "sp_tile_cache.h"
+
+
+/** Subclass of quad_stage */
+struct fused_quad_stage
+{
+   struct quad_stage base;
+   unsigned zshift;     /**< position of the 24 Z bits in the Z/S word */
+   uint32_t zkeep;      /**< bits of the Z/S word kept on Z writes */
+   boolean has_alpha;   /**< color buffer has alpha, else A = 1 */
+};
+
+
+/** cast wrapper */
+static inline const struct fused_quad_stage *
+fused_quad_stage(const struct quad_stage *stage)
+{
+   return (const struct fused_quad_stage *) stage;
+}
+
+
+static inline void
+fused_clamp_colors(float (*quadColor)[4])
+{
+   unsigned i, j;
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         quadColor[i][j] = CLAMP(quadColor[i][j], 0.0F, 1.0F);
+      }
+   }
+}
+
+
+#define NAME fused_z24_less_opaque
+#define OPERATOR <
+#define DEPTH_WRITE 0
+#define BLEND_SRC_ALPHA 0
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_write_opaque
+#define OPERATOR <
+#define DEPTH_WRITE 1
+#define BLEND_SRC_ALPHA 0
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_opaque
+#define OPERATOR <=
+#define DEPTH_WRITE 0
+#define BLEND_SRC_ALPHA 0
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_write_opaque
+#define OPERATOR <=
+#define DEPTH_WRITE 1
+#define BLEND_SRC_ALPHA 0
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_src_alpha
+#define OPERATOR <
+#define DEPTH_WRITE 0
+#define BLEND_SRC_ALPHA 1
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_less_write_src_alpha
+#define OPERATOR <
+#define DEPTH_WRITE 1
+#define BLEND_SRC_ALPHA 1
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_src_alpha
+#define OPERATOR <=
+#define DEPTH_WRITE 0
+#define BLEND_SRC_ALPHA 1
+#include "sp_quad_fused_tmp.h"
+
+#define NAME fused_z24_lequal_write_src_alpha
+#define OPERATOR <=
+#define DEPTH_WRITE 1
+#define BLEND_SRC_ALPHA 1
+#include "sp_quad_fused_tmp.h"
+
+
+/** Indexed by [depth func is LEQUAL][depth write][src alpha blend] */
+static void
+(*const fused_funcs[2][2][2])(struct quad_stage *qs,
+                              struct quad_header *quads[],
+                              unsigned nr) = {
+   {
+      { fused_z24_less_opaque, fused_z24_less_src_alpha },
+      { fused_z24_less_write_opaque, fused_z24_less_write_src_alpha }
+   },
+   {
+      { fused_z24_lequal_opaque, fused_z24_lequal_src_alpha },
+      { fused_z24_lequal_write_opaque, fused_z24_lequal_write_src_alpha }
+   }
+};
+
+
+/**
+ * State not covered by a fused function: use the generic stages.
+ */
+static void
+fused_fallback(struct quad_stage *qs,
+               struct quad_header *quads[],
+               unsigned nr)
+{
+   qs->next->run(qs->next, quads, nr);
+}
+
+
+static void
+choose_fused_quads(struct quad_stage *qs,
+                   struct quad_header *quads[],
+                   unsigned nr)
+{
+   struct fused_quad_stage *fqs = (struct fused_quad_stage *) qs;
+   struct softpipe_context *softpipe = qs->softpipe;
+   const struct pipe_depth_stencil_alpha_state *dsa = softpipe->depth_stencil;
+   const struct pipe_blend_state *blend = softpipe->blend;
+   const struct pipe_surface *zsbuf = softpipe->framebuffer.zsbuf;
+   const struct pipe_surface *cbuf = softpipe->framebuffer.cbufs[0];
+   const struct util_format_description *desc;
+   boolean src_alpha;
+
+   qs->run = fused_fallback;
+
+   if (!softpipe->early_depth ||
+       !zsbuf ||
+       !dsa->depth.enabled ||
+       (dsa->depth.func != PIPE_FUNC_LESS &&
+        dsa->depth.func != PIPE_FUNC_LEQUAL) ||
+       dsa->stencil[0].enabled ||
+       dsa->alpha.enabled ||
+       !softpipe->rasterizer->depth_clip ||
+       softpipe->framebuffer.nr_cbufs != 1 ||
+       !cbuf ||
+       blend->logicop_enable ||
+       blend->rt[0].colormask != 0xf)
+      goto done;
+
+   switch (zsbuf->format) {
+   case PIPE_FORMAT_Z24X8_UNORM:
+      fqs->zshift = 0;
+      fqs->zkeep = 0;
+      break;
+   case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+      fqs->zshift = 0;
+      fqs->zkeep = 0xff000000;
+      break;
+   case PIPE_FORMAT_X8Z24_UNORM:
+      fqs->zshift = 8;
+      fqs->zkeep = 0;
+      break;
+   case PIPE_FORMAT_S8_UINT_Z24_UNORM:
+      fqs->zshift = 8;
+      fqs->zkeep = 0xff;
+      break;
+   default:
+      goto done;
+   }
+
+   desc = util_format_description(cbuf->format);
+   if (!desc->channel[0].normalized ||
+       util_format_is_intensity(cbuf->format) ||
+       util_format_is_luminance(cbuf->format) ||
+       util_format_is_luminance_alpha(cbuf->format))
+      goto done;
+
+   fqs->has_alpha = util_format_has_alpha(cbuf->format);
+
+   if (blend->rt[0].blend_enable) {
+      if (blend->rt[0].rgb_func != PIPE_BLEND_ADD ||
+          blend->rt[0].alpha_func != PIPE_BLEND_ADD ||
+          blend->rt[0].rgb_src_factor != PIPE_BLENDFACTOR_SRC_ALPHA ||
+          blend->rt[0].alpha_src_factor != PIPE_BLENDFACTOR_SRC_ALPHA ||
+          blend->rt[0].rgb_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA ||
+          blend->rt[0].alpha_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA)
+         goto done;
+      src_alpha = TRUE;
+   }
+   else {
+      src_alpha = FALSE;
+   }
+
+   qs->run = fused_funcs[dsa->depth.func == PIPE_FUNC_LEQUAL]
+                        [dsa->depth.writemask != 0]
+                        [src_alpha];
+
+done:
+   qs->run(qs, quads, nr);
+}
+
+
+static void
+fused_begin(struct quad_stage *qs)
+{
+   qs->run = choose_fused_quads;
+   qs->next->begin(qs->next);
+}
+
+
+static void
+fused_destroy(struct quad_stage *qs)
+{
+   FREE( qs );
+}
+
+
+struct quad_stage *
+sp_quad_fused_stage( struct softpipe_context *softpipe )
+{
+   struct fused_quad_stage *stage = CALLOC_STRUCT(fused_quad_stage);
+
+   if (!stage)
+      return NULL;
+
+   stage->base.softpipe = softpipe;
+   stage->base.begin = fused_begin;
+   stage->base.run = choose_fused_quads;
+   stage->base.destroy = fused_destroy;
+
+   return &stage->base;
+}
@@ -0,0 +1,198 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Template for generating fused early-Z / shade / blend functions.
+ * Only packed 24-bit Z formats and a single normalized color buffer
+ * are supported.
+ *
+ * NAME       - function name
+ * OPERATOR   - depth compare operator
+ * DEPTH_WRITE - 1 to write passing Z values back
+ * BLEND_SRC_ALPHA - 1 for SRC_ALPHA / INV_SRC_ALPHA add, 0 for no blending
+ */
+
+
+#ifndef NAME
+#error "NAME is not defined!"
+#endif
+
+#ifndef OPERATOR
+#error "OPERATOR is not defined!"
+#endif
+
+
+/*
+ * Each step mirrors what the generic stages do for the same state
+ * (depth_test_quads_fallback, shade_quads, single_output_color and
+ * blend_single_add_src_alpha_inv_src_alpha) so that the results are
+ * bit-identical; only the tile lookups and the per-stage loops are
+ * shared.
+ */
+static void
+NAME(struct quad_stage *qs,
+     struct quad_header *quads[],
+     unsigned nr)
+{
+   const struct fused_quad_stage *fqs = fused_quad_stage(qs);
+   struct softpipe_context *softpipe = qs->softpipe;
+   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   const float scale = (float) ((1 << 24) - 1);
+   const unsigned zshift = fqs->zshift;
+#if DEPTH_WRITE
+   const uint32_t zkeep = fqs->zkeep;
+#endif
+   struct softpipe_cached_tile *ztile, *ctile;
+   unsigned i, j, c;
+
+   if (!nr)
+      return;
+
+   ztile = sp_get_cached_tile(softpipe->zsbuf_cache,
+                              quads[0]->input.x0,
+                              quads[0]->input.y0, quads[0]->input.layer);
+   ctile = sp_get_cached_tile(softpipe->cbuf_cache[0],
+                              quads[0]->input.x0,
+                              quads[0]->input.y0, quads[0]->input.layer);
+
+   tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
+                         softpipe->mapped_constants[PIPE_SHADER_FRAGMENT],
+                         softpipe->const_buffer_size[PIPE_SHADER_FRAGMENT]);
+
+   machine->InterpCoefs = quads[0]->coef;
+   machine->flatshade_color = softpipe->rasterizer->flatshade ? TRUE : FALSE;
+
+   for (i = 0; i < nr; i++) {
+      struct quad_header *quad = quads[i];
+      float (*quadColor)[4] = quad->output.color[0];
+      const int itx = quad->input.x0 & (TILE_SIZE-1);
+      const int ity = quad->input.y0 & (TILE_SIZE-1);
+      const float fx = (float) quad->input.x0;
+      const float fy = (float) quad->input.y0;
+      const float dzdx = quad->posCoef->dadx[2];
+      const float dzdy = quad->posCoef->dady[2];
+      const float z0 = quad->posCoef->a0[2] + dzdx * fx + dzdy * fy;
+      unsigned qzzzz[TGSI_QUAD_SIZE], bzzzz[TGSI_QUAD_SIZE];
+      unsigned zmask = 0;
+
+      /* depth test */
+      quad->output.depth[0] = z0;
+      quad->output.depth[1] = z0 + dzdx;
+      quad->output.depth[2] = z0 + dzdy;
+      quad->output.depth[3] = z0 + dzdx + dzdy;
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         const uint32_t zs = ztile->data.depth32[ity + (j >> 1)][itx + (j & 1)];
+         qzzzz[j] = (unsigned) (quad->output.depth[j] * scale);
+         bzzzz[j] = (zs >> zshift) & 0xffffff;
+         if (qzzzz[j] OPERATOR bzzzz[j])
+            zmask |= 1 << j;
+      }
+
+      quad->inout.mask &= zmask;
+      if (quad->inout.mask == 0)
+         continue;
+
+#if DEPTH_WRITE
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         uint32_t *zs = &ztile->data.depth32[ity + (j >> 1)][itx + (j & 1)];
+         const unsigned z = (quad->inout.mask & (1 << j)) ? qzzzz[j] : bzzzz[j];
+         *zs = (*zs & zkeep) | (z << zshift);
+      }
+#endif
+
+      if (softpipe->active_query_count)
+         softpipe->occlusion_count += util_bitcount(quad->inout.mask);
+
+      /* shade */
+      if (softpipe->active_statistics_queries) {
+         softpipe->pipeline_statistics.ps_invocations +=
+            util_bitcount(quad->inout.mask);
+      }
+
+      if (!softpipe->fs_variant->run(softpipe->fs_variant, machine, quad, TRUE))
+         continue;
+
+      /* blend */
+#if BLEND_SRC_ALPHA
+      {
+         const float *alpha = quadColor[3];
+         float one_minus_alpha[TGSI_QUAD_SIZE];
+         float dest[4][TGSI_QUAD_SIZE];
+         float source[4][TGSI_QUAD_SIZE];
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+            const float *d = ctile->data.color[ity + (j >> 1)][itx + (j & 1)];
+            for (c = 0; c < 4; c++)
+               dest[c][j] = d[c];
+         }
+
+         /* the color buffer is normalized, so clamp incoming colors */
+         fused_clamp_colors(quadColor);
+
+         for (c = 0; c < 4; c++)
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               source[c][j] = quadColor[c][j] * alpha[j];
+
+         for (j = 0; j < TGSI_QUAD_SIZE; j++)
+            one_minus_alpha[j] = 1.0f - alpha[j];
+
+         for (c = 0; c < 4; c++)
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               dest[c][j] = dest[c][j] * one_minus_alpha[j];
+
+         for (c = 0; c < 4; c++)
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               quadColor[c][j] = source[c][j] + dest[c][j];
+
+         fused_clamp_colors(quadColor);
+      }
+#else
+      if (softpipe->rasterizer->clamp_fragment_color)
+         fused_clamp_colors(quadColor);
+#endif
+
+      if (!fqs->has_alpha) {
+         for (j = 0; j < TGSI_QUAD_SIZE; j++)
+            quadColor[3][j] = 1.0F;
+      }
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (quad->inout.mask & (1 << j)) {
+            float *d = ctile->data.color[ity + (j >> 1)][itx + (j & 1)];
+            for (c = 0; c < 4; c++)
+               d[c] = quadColor[c][j];
+         }
+      }
+   }
+}
+
+
+#undef NAME
+#undef OPERATOR
+#undef DEPTH_WRITE
+#undef BLEND_SRC_ALPHA
@@ -57,6 +57,11 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
    if (early_depth_test) {
       insert_stage_at_head( sp, sp->quad.shade );
       insert_stage_at_head( sp, sp->quad.depth_test );
+      /* the fused stage handles common states itself and otherwise
+       * passes the quads on to the generic stages above
+       */
+      if (!sp->no_fused_quads)
+         insert_stage_at_head( sp, sp->quad.fused );
    }
    else {
       insert_stage_at_head( sp, sp->quad.depth_test );
@@ -35,6 +35,7 @@
 #include "util/u_memory.h"
 #include "sp_context.h"
 #include "sp_query.h"
+#include "sp_screen.h"
 #include "sp_state.h"
 
 struct softpipe_query {
@@ -68,7 +69,9 @@ softpipe_create_query(struct pipe_context *pipe,
           type == PIPE_QUERY_PIPELINE_STATISTICS ||
           type == PIPE_QUERY_GPU_FINISHED ||
           type == PIPE_QUERY_TIMESTAMP ||
-          type == PIPE_QUERY_TIMESTAMP_DISJOINT);
+          type == PIPE_QUERY_TIMESTAMP_DISJOINT ||
+          type == SP_QUERY_BYTES_COPIED ||
+          type == SP_QUERY_BYTES_PRESENTED);
    sq = CALLOC_STRUCT( softpipe_query );
    sq->type = type;
 
@@ -89,6 +92,16 @@ softpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    struct softpipe_context *softpipe = softpipe_context( pipe );
    struct softpipe_query *sq = softpipe_query(q);
 
+   /* driver statistics don't affect rendering */
+   switch (sq->type) {
+   case SP_QUERY_BYTES_COPIED:
+      sq->start = softpipe->bytes_copied;
+      return true;
+   case SP_QUERY_BYTES_PRESENTED:
+      sq->start = softpipe_screen(pipe->screen)->bytes_presented;
+      return true;
+   }
+
    switch (sq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
@@ -140,6 +153,15 @@ softpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct softpipe_context *softpipe = softpipe_context( pipe );
    struct softpipe_query *sq = softpipe_query(q);
 
+   switch (sq->type) {
+   case SP_QUERY_BYTES_COPIED:
+      sq->end = softpipe->bytes_copied;
+      return true;
+   case SP_QUERY_BYTES_PRESENTED:
+      sq->end = softpipe_screen(pipe->screen)->bytes_presented;
+      return true;
+   }
+
    softpipe->active_query_count--;
    switch (sq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
@@ -290,6 +312,33 @@ softpipe_set_active_query_state(struct pipe_context *pipe, boolean enable)
 }
 
 
+/**
+ * Per-frame memory traffic of the driver, e.g. GALLIUM_HUD=bytes-copied.
+ */
+int
+softpipe_get_driver_query_info(struct pipe_screen *screen, unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info queries[] = {
+      {"bytes-copied", SP_QUERY_BYTES_COPIED, {0},
+       PIPE_DRIVER_QUERY_TYPE_BYTES, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+       0, 0x0},
+      {"bytes-presented", SP_QUERY_BYTES_PRESENTED, {0},
+       PIPE_DRIVER_QUERY_TYPE_BYTES, PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE,
+       0, 0x0},
+   };
+
+   if (!info)
+      return ARRAY_SIZE(queries);
+
+   if (index >= ARRAY_SIZE(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
+
 void softpipe_init_query_funcs(struct softpipe_context *softpipe )
 {
    softpipe->pipe.create_query = softpipe_create_query;
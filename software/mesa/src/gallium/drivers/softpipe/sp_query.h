@@ -32,6 +32,10 @@
 #ifndef SP_QUERY_H
 #define SP_QUERY_H
 
+/* Driver specific queries, for the HUD */
+#define SP_QUERY_BYTES_COPIED       (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define SP_QUERY_BYTES_PRESENTED    (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+
 extern boolean
 softpipe_check_render_cond(struct softpipe_context *sp);
 
@@ -39,5 +43,11 @@ softpipe_check_render_cond(struct softpipe_context *sp);
 struct softpipe_context;
 extern void softpipe_init_query_funcs(struct softpipe_context * );
 
+struct pipe_screen;
+struct pipe_driver_query_info;
+extern int
+softpipe_get_driver_query_info(struct pipe_screen *screen, unsigned index,
+                               struct pipe_driver_query_info *info);
+
 
 #endif /* SP_QUERY_H */
@@ -29,6 +29,7 @@
 #include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_box.h"
 #include "util/u_video.h"
 #include "os/os_misc.h"
 #include "os/os_time.h"
@@ -44,8 +45,10 @@
 #include "sp_context.h"
 #include "sp_fence.h"
 #include "sp_public.h"
+#include "sp_query.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(use_llvm, "SOFTPIPE_USE_LLVM", FALSE)
+DEBUG_GET_ONCE_BOOL_OPTION(no_damage, "SOFTPIPE_NO_DAMAGE", FALSE)
 
 static const char *
 softpipe_get_vendor(struct pipe_screen *screen)
@@ -249,6 +252,8 @@ softpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 0;
    case PIPE_CAP_COPY_BETWEEN_COMPRESSED_AND_PLAIN_FORMATS:
       return 1;
+   case PIPE_CAP_GENERATE_MIPMAP:
+      return 1;
    case PIPE_CAP_MULTISAMPLE_Z_RESOLVE:
    case PIPE_CAP_RESOURCE_FROM_USER_MEMORY:
    case PIPE_CAP_DEVICE_RESET_STATUS_QUERY:
@@ -265,7 +270,6 @@ softpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL:
    case PIPE_CAP_TGSI_FS_FACE_IS_INTEGER_SYSVAL:
    case PIPE_CAP_INVALIDATE_BUFFER:
-   case PIPE_CAP_GENERATE_MIPMAP:
    case PIPE_CAP_STRING_MARKER:
    case PIPE_CAP_SURFACE_REINTERPRET_BLOCKS:
    case PIPE_CAP_QUERY_BUFFER_OBJECT:
@@ -463,10 +467,81 @@ softpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct softpipe_screen *screen = softpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct softpipe_resource *texture = softpipe_resource(resource);
+   const unsigned cpp = util_format_get_blocksize(resource->format);
+   boolean full = TRUE;
+   unsigned i;
 
    assert(texture->dt);
-   if (texture->dt)
-      winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
+   if (!texture->dt)
+      return;
+
+   /* Only the damage needs to go out if the window shows this resource's
+    * previous frame.  Otherwise (first present to the window, or another
+    * resource went to it in between, e.g. swapped front/back) it all does.
+    */
+   if (!screen->no_damage) {
+      for (i = 0; i < SP_MAX_PRESENT_TARGETS; i++) {
+         if (screen->last_present[i].context_private == context_private) {
+            full = screen->last_present[i].present_id != texture->present_id;
+            break;
+         }
+      }
+      if (i == SP_MAX_PRESENT_TARGETS) {
+         i = screen->next_present++ % SP_MAX_PRESENT_TARGETS;
+         screen->last_present[i].context_private = context_private;
+      }
+      screen->last_present[i].present_id = texture->present_id;
+   }
+
+   if (full) {
+      winsys->displaytarget_display(winsys, texture->dt, context_private,
+                                    sub_box);
+      screen->bytes_presented += cpp * (sub_box ?
+         sub_box->width * sub_box->height :
+         resource->width0 * resource->height0);
+   }
+   else {
+      struct pipe_box boxes[SP_MAX_DAMAGE_RECTS];
+      struct u_rect bounds = { INT_MAX, 0, INT_MAX, 0 };
+      unsigned num_boxes = 0, area = 0;
+
+      for (i = 0; i < texture->num_damage; i++) {
+         struct u_rect r = texture->damage[i];
+
+         if (sub_box) {
+            r.x0 = MAX2(r.x0, sub_box->x);
+            r.y0 = MAX2(r.y0, sub_box->y);
+            r.x1 = MIN2(r.x1, sub_box->x + sub_box->width);
+            r.y1 = MIN2(r.y1, sub_box->y + sub_box->height);
+            if (r.x0 >= r.x1 || r.y0 >= r.y1)
+               continue;
+         }
+
+         u_box_2d(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, &boxes[num_boxes++]);
+         u_rect_union(&bounds, &bounds, &r);
+         area += u_rect_area(&r);
+      }
+
+      if (num_boxes && winsys->displaytarget_display_rects) {
+         winsys->displaytarget_display_rects(winsys, texture->dt,
+                                             context_private,
+                                             boxes, num_boxes);
+         screen->bytes_presented += cpp * area;
+      }
+      else if (num_boxes) {
+         /* one present of everything that changed */
+         struct pipe_box box;
+         u_box_2d(bounds.x0, bounds.y0, bounds.x1 - bounds.x0,
+                  bounds.y1 - bounds.y0, &box);
+         winsys->displaytarget_display(winsys, texture->dt, context_private,
+                                       &box);
+         screen->bytes_presented += cpp * u_rect_area(&bounds);
+      }
+   }
+
+   /* a partial present leaves the rest of the damage for later */
+   if (!sub_box)
+      texture->num_damage = 0;
 }
 
 static uint64_t
@@ -554,7 +629,9 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.context_create = softpipe_create_context;
    screen->base.flush_frontbuffer = softpipe_flush_frontbuffer;
    screen->base.get_compute_param = softpipe_get_compute_param;
+   screen->base.get_driver_query_info = softpipe_get_driver_query_info;
    screen->use_llvm = debug_get_option_use_llvm();
+   screen->no_damage = debug_get_option_no_damage();
 
    util_format_s3tc_init();
 
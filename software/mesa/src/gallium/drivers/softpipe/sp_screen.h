@@ -37,6 +37,10 @@
 
 struct sw_winsys;
 
+/** Number of windows remembered for damage-limited presents */
+#define SP_MAX_PRESENT_TARGETS 4
+
+
 struct softpipe_screen {
    struct pipe_screen base;
 
@@ -47,6 +51,23 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+
+   /**
+    * Display target (by present_id) last presented to each recently used
+    * window (context_private of flush_frontbuffer), to know whether the
+    * window still shows that resource's previous frame and damage alone
+    * can be presented.
+    */
+   struct {
+      void *context_private;
+      unsigned present_id;
+   } last_present[SP_MAX_PRESENT_TARGETS];
+   unsigned next_present;
+   unsigned next_present_id;
+   boolean no_damage;
+
+   /** Bytes handed to the winsys for presents, for SP_QUERY_BYTES_PRESENTED */
+   uint64_t bytes_presented;
 };
 
 static inline struct softpipe_screen *
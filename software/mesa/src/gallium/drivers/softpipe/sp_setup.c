@@ -161,9 +161,34 @@ struct setup_context {
 
    unsigned cull_face;		/* which faces cull */
    unsigned nr_vertex_attrs;
+
+   /** Triangle's coef[] and posCoef not computed yet */
+   boolean coef_pending;
+
+   /** The OpenGPU board can be reached, see ogpu_probe() */
+   boolean ogpu;
 };
 
 
+static void
+setup_tri_coefficients(struct setup_context *setup);
+
+
+/**
+ * Triangle coefficients are computed when the first quad of the triangle
+ * is about to be emitted, so triangles which don't cover any pixel center
+ * inside the cliprect never pay for them.
+ */
+static inline void
+setup_tri_coefficients_once(struct setup_context *setup)
+{
+   if (setup->coef_pending) {
+      setup_tri_coefficients(setup);
+      setup->coef_pending = FALSE;
+   }
+}
+
+
 
 
 
@@ -296,6 +321,7 @@ flush_spans(struct setup_context *setup)
             lx += 2;
          } while (mask0 | mask1);
 
+         setup_tri_coefficients_once(setup);
          pipe->run( pipe, setup->quad_ptrs, q );
       }
    }
@@ -523,80 +549,92 @@ const_coeff(struct setup_context *setup,
 
 
 /**
- * Compute a0, dadx and dady for a linearly interpolated coefficient,
- * for a triangle.
- * v[0], v[1] and v[2] are vmin, vmid and vmax, respectively.
+ * Compute a0, dadx and dady for the four channels of a linearly
+ * interpolated attribute, for a triangle.
+ * v0, v1 and v2 hold the channel values at vmin, vmid and vmax.
+ *
+ * Everything is loaded into locals first and the channels are done in
+ * one loop without calls or branches, so the compiler can process them
+ * as a single 4-wide vector.
  */
-static void
-tri_linear_coeff(struct setup_context *setup,
-                 struct tgsi_interp_coef *coef,
-                 uint i,
-                 const float v[3])
+static inline void
+tri_linear_coeff4(const struct setup_context *setup,
+                  struct tgsi_interp_coef *coef,
+                  const float v0[4],
+                  const float v1[4],
+                  const float v2[4])
 {
-   float botda = v[1] - v[0];
-   float majda = v[2] - v[0];
-   float a = setup->ebot.dy * majda - botda * setup->emaj.dy;
-   float b = setup->emaj.dx * botda - majda * setup->ebot.dx;
-   float dadx = a * setup->oneoverarea;
-   float dady = b * setup->oneoverarea;
-
-   assert(i <= 3);
-
-   coef->dadx[i] = dadx;
-   coef->dady[i] = dady;
+   const float ebot_dx = setup->ebot.dx;
+   const float ebot_dy = setup->ebot.dy;
+   const float emaj_dx = setup->emaj.dx;
+   const float emaj_dy = setup->emaj.dy;
+   const float oneoverarea = setup->oneoverarea;
+   const float x0 = setup->vmin[0][0] - setup->pixel_offset;
+   const float y0 = setup->vmin[0][1] - setup->pixel_offset;
+   float a0[4], dadx[4], dady[4];
+   uint j;
+
+   for (j = 0; j < 4; j++) {
+      const float botda = v1[j] - v0[j];
+      const float majda = v2[j] - v0[j];
+      const float a = ebot_dy * majda - botda * emaj_dy;
+      const float b = emaj_dx * botda - majda * ebot_dx;
+
+      dadx[j] = a * oneoverarea;
+      dady[j] = b * oneoverarea;
+
+      /* calculate a0 as the value which would be sampled for the
+       * fragment at (0,0), taking into account that we want to sample at
+       * pixel centers, in other words (pixel_offset, pixel_offset).
+       *
+       * this is neat but unfortunately not a good way to do things for
+       * triangles with very large values of dadx or dady as it will
+       * result in the subtraction and re-addition from a0 of a very
+       * large number, which means we'll end up loosing a lot of the
+       * fractional bits and precision from a0.  the way to fix this is
+       * to define a0 as the sample at a pixel center somewhere near vmin
+       * instead - i'll switch to this later.
+       */
+      a0[j] = v0[j] - (dadx[j] * x0 + dady[j] * y0);
+   }
 
-   /* calculate a0 as the value which would be sampled for the
-    * fragment at (0,0), taking into account that we want to sample at
-    * pixel centers, in other words (pixel_offset, pixel_offset).
-    *
-    * this is neat but unfortunately not a good way to do things for
-    * triangles with very large values of dadx or dady as it will
-    * result in the subtraction and re-addition from a0 of a very
-    * large number, which means we'll end up loosing a lot of the
-    * fractional bits and precision from a0.  the way to fix this is
-    * to define a0 as the sample at a pixel center somewhere near vmin
-    * instead - i'll switch to this later.
-    */
-   coef->a0[i] = (v[0] -
-                  (dadx * (setup->vmin[0][0] - setup->pixel_offset) +
-                   dady * (setup->vmin[0][1] - setup->pixel_offset)));
+   memcpy(coef->a0, a0, sizeof(a0));
+   memcpy(coef->dadx, dadx, sizeof(dadx));
+   memcpy(coef->dady, dady, sizeof(dady));
 }
 
 
 /**
- * Compute a0, dadx and dady for a perspective-corrected interpolant,
- * for a triangle.
+ * Compute a0, dadx and dady for the four channels of a perspective-corrected
+ * interpolant, for a triangle.
  * We basically multiply the vertex value by 1/w before computing
  * the plane coefficients (a0, dadx, dady).
  * Later, when we compute the value at a particular fragment position we'll
  * divide the interpolated value by the interpolated W at that fragment.
- * v[0], v[1] and v[2] are vmin, vmid and vmax, respectively.
+ * v0, v1 and v2 hold the channel values at vmin, vmid and vmax.
  */
-static void
-tri_persp_coeff(struct setup_context *setup,
-                struct tgsi_interp_coef *coef,
-                uint i,
-                const float v[3])
+static inline void
+tri_persp_coeff4(const struct setup_context *setup,
+                 struct tgsi_interp_coef *coef,
+                 const float v0[4],
+                 const float v1[4],
+                 const float v2[4])
 {
    /* premultiply by 1/w  (v[0][3] is always W):
     */
-   float mina = v[0] * setup->vmin[0][3];
-   float mida = v[1] * setup->vmid[0][3];
-   float maxa = v[2] * setup->vmax[0][3];
-   float botda = mida - mina;
-   float majda = maxa - mina;
-   float a = setup->ebot.dy * majda - botda * setup->emaj.dy;
-   float b = setup->emaj.dx * botda - majda * setup->ebot.dx;
-   float dadx = a * setup->oneoverarea;
-   float dady = b * setup->oneoverarea;
-
-   assert(i <= 3);
+   const float minw = setup->vmin[0][3];
+   const float midw = setup->vmid[0][3];
+   const float maxw = setup->vmax[0][3];
+   float mina[4], mida[4], maxa[4];
+   uint j;
+
+   for (j = 0; j < 4; j++) {
+      mina[j] = v0[j] * minw;
+      mida[j] = v1[j] * midw;
+      maxa[j] = v2[j] * maxw;
+   }
 
-   coef->dadx[i] = dadx;
-   coef->dady[i] = dady;
-   coef->a0[i] = (mina -
-                  (dadx * (setup->vmin[0][0] - setup->pixel_offset) +
-                   dady * (setup->vmin[0][1] - setup->pixel_offset)));
+   tri_linear_coeff4(setup, coef, mina, mida, maxa);
 }
 
 
@@ -648,28 +686,43 @@ setup_tri_coefficients(struct setup_context *setup)
    const struct tgsi_shader_info *fsInfo = &setup->softpipe->fs_variant->info;
    const struct sp_setup_info *sinfo = &softpipe->setup_info;
    uint fragSlot;
-   float v[3];
 
    assert(sinfo->valid);
 
-   /* z and w are done by linear interpolation:
+   /* z and w are done by linear interpolation, x and y come along for
+    * free as the position is handled as one vector:
     */
-   v[0] = setup->vmin[0][2];
-   v[1] = setup->vmid[0][2];
-   v[2] = setup->vmax[0][2];
-   tri_linear_coeff(setup, &setup->posCoef, 2, v);
-
-   v[0] = setup->vmin[0][3];
-   v[1] = setup->vmid[0][3];
-   v[2] = setup->vmax[0][3];
-   tri_linear_coeff(setup, &setup->posCoef, 3, v);
+   tri_linear_coeff4(setup, &setup->posCoef,
+                     setup->vmin[0], setup->vmid[0], setup->vmax[0]);
 
    /* setup interpolation for all the remaining attributes:
     */
    for (fragSlot = 0; fragSlot < fsInfo->num_inputs; fragSlot++) {
       const uint vertSlot = sinfo->attrib[fragSlot].src_index;
+      const uint cylindrical_wrap = fsInfo->input_cylindrical_wrap[fragSlot];
+      const float *v0 = setup->vmin[vertSlot];
+      const float *v1 = setup->vmid[vertSlot];
+      const float *v2 = setup->vmax[vertSlot];
+      float w0[4], w1[4], w2[4];
       uint j;
 
+      if (cylindrical_wrap &&
+          (sinfo->attrib[fragSlot].interp == SP_INTERP_LINEAR ||
+           sinfo->attrib[fragSlot].interp == SP_INTERP_PERSPECTIVE)) {
+         for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
+            float v[3];
+            tri_apply_cylindrical_wrap(v0[j], v1[j], v2[j],
+                                       cylindrical_wrap & (1 << j),
+                                       v);
+            w0[j] = v[0];
+            w1[j] = v[1];
+            w2[j] = v[2];
+         }
+         v0 = w0;
+         v1 = w1;
+         v2 = w2;
+      }
+
       switch (sinfo->attrib[fragSlot].interp) {
       case SP_INTERP_CONSTANT:
          for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
@@ -677,24 +730,10 @@ setup_tri_coefficients(struct setup_context *setup)
          }
          break;
       case SP_INTERP_LINEAR:
-         for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
-            tri_apply_cylindrical_wrap(setup->vmin[vertSlot][j],
-                                       setup->vmid[vertSlot][j],
-                                       setup->vmax[vertSlot][j],
-                                       fsInfo->input_cylindrical_wrap[fragSlot] & (1 << j),
-                                       v);
-            tri_linear_coeff(setup, &setup->coef[fragSlot], j, v);
-         }
+         tri_linear_coeff4(setup, &setup->coef[fragSlot], v0, v1, v2);
          break;
       case SP_INTERP_PERSPECTIVE:
-         for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
-            tri_apply_cylindrical_wrap(setup->vmin[vertSlot][j],
-                                       setup->vmid[vertSlot][j],
-                                       setup->vmax[vertSlot][j],
-                                       fsInfo->input_cylindrical_wrap[fragSlot] & (1 << j),
-                                       v);
-            tri_persp_coeff(setup, &setup->coef[fragSlot], j, v);
-         }
+         tri_persp_coeff4(setup, &setup->coef[fragSlot], v0, v1, v2);
          break;
       case SP_INTERP_POS:
          setup_fragcoord_coeff(setup, fragSlot);
@@ -883,7 +922,7 @@ sp_setup_tri(struct setup_context *setup,
    if (!setup_sort_vertices( setup, det, v0, v1, v2 ))
       return;
 
-   setup_tri_coefficients( setup );
+   setup->coef_pending = TRUE;
    setup_tri_edges( setup );
 
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_TRIANGLES);
@@ -920,6 +959,7 @@ sp_setup_tri(struct setup_context *setup,
    }
 
    flush_spans( setup );
+   setup->coef_pending = FALSE;
 
    if (setup->softpipe->active_statistics_queries) {
       setup->softpipe->pipeline_statistics.c_primitives++;
@@ -1548,6 +1588,33 @@ sp_setup_destroy_context(struct setup_context *setup)
 }
 
 
+/**
+ * Whether the OpenGPU board's registers can be mapped through /dev/mem.
+ * The board sits behind the ARM HPS of a DE1-SoC, so other architectures
+ * never touch /dev/mem.
+ */
+static boolean
+ogpu_probe(void)
+{
+#if defined(PIPE_ARCH_ARM)
+   int fd = open("/dev/mem", O_RDWR | O_SYNC);
+
+   if (fd >= 0) {
+      void *regs = mmap(NULL, HW_REGS_SPAN, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, HW_REGS_BASE);
+      close(fd);
+      if (regs != MAP_FAILED) {
+         munmap(regs, HW_REGS_SPAN);
+         return TRUE;
+      }
+   }
+#endif
+
+   debug_printf("softpipe: no OpenGPU board, rasterizing in software\n");
+   return FALSE;
+}
+
+
 /**
  * Create a new primitive setup/render stage.
  */
@@ -1558,6 +1625,7 @@ sp_setup_create_context(struct softpipe_context *softpipe)
    unsigned i;
 
    setup->softpipe = softpipe;
+   setup->ogpu = ogpu_probe();
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
@@ -2401,6 +2469,11 @@ ogpu_raster_tri(struct setup_context *setup,
 
 	float det;
 
+	if (!setup->ogpu) {
+		sp_setup_tri(setup, v0, v1, v2);
+		return;
+	}
+
 	uint layer = 0;
 	unsigned viewport_index = 0;
 
@@ -2412,8 +2485,6 @@ ogpu_raster_tri(struct setup_context *setup,
 	if (!setup_sort_vertices( setup, det, v0, v1, v2 ))
 	  return;
 
-	setup_tri_coefficients( setup );
-
 	if (setup->softpipe->layer_slot > 0) {
 	  layer = *(unsigned *)setup->vprovoke[setup->softpipe->layer_slot];
 	  layer = MIN2(layer, setup->max_layer);
@@ -2508,6 +2579,10 @@ ogpu_raster_tri(struct setup_context *setup,
 	r1_quad_buffer_addr_low=( unsigned long  )h2f_virtual_base + ( ( unsigned long  )( OGPU_RASTER_UNIT_QUAD_BUFFER_ADDR_LOW_BASE ));
 	r1_status=( unsigned long  )h2f_virtual_base + ( ( unsigned long  )( OGPU_RASTER_UNIT_STATUS_BASE ));
 
+	/* Only now is the triangle going to be rasterized; the error returns
+	 * above must not leave coefficients pending for the next flush.
+	 */
+	setup->coef_pending = TRUE;
 
 
 	int sw = alt_read_hword(h2p_lw_sw_addr) & 0x3FF;
@@ -2717,7 +2792,10 @@ ogpu_raster_tri(struct setup_context *setup,
 
 					setup->quad_ptrs[q]=&setup->quad[q];
 				}
-				if(s) pipe->run( pipe, setup->quad_ptrs, s );
+				if(s) {
+					setup_tri_coefficients_once(setup);
+					pipe->run( pipe, setup->quad_ptrs, s );
+				}
 				m-=s;
 			}while(m);
 		tile.x0+=64;
@@ -2734,6 +2812,9 @@ ogpu_raster_tri(struct setup_context *setup,
 		alt_write_word(r1_tile0,tile0); alt_write_word(r1_tile1,tile1);
 
 		}while(tile.y0<=setup->softpipe->cliprect[viewport_index].maxy);
+
+		if (setup->softpipe->active_statistics_queries)
+			setup->softpipe->pipeline_statistics.c_primitives++;
 	}
 	else // if sw0 is zero, do software approach
 	{
@@ -2880,7 +2961,10 @@ ogpu_raster_tri(struct setup_context *setup,
 
 			                setup->quad_ptrs[q]=&setup->quad[q];
 			            }
-			            if(s) pipe->run( pipe, setup->quad_ptrs, s );
+			            if(s) {
+			                setup_tri_coefficients_once(setup);
+			                pipe->run( pipe, setup->quad_ptrs, s );
+			            }
 			            m-=s;
 			        }while(m);
 			    tile.x0+=64;
@@ -2894,10 +2978,15 @@ ogpu_raster_tri(struct setup_context *setup,
 			    }
 			    }while(tile.y0<setup->softpipe->cliprect[viewport_index].maxy);
 
+			    if (setup->softpipe->active_statistics_queries)
+			        setup->softpipe->pipeline_statistics.c_primitives++;
+
 			    //ogpu_quad_buffer_free(&quad_buffer);
 		}
 		else sp_setup_tri(setup,v0,v1,v2); // if sw9 is zero, use softpipe original function
 	}
+	setup->coef_pending = FALSE;
+
 	if( munmap( virtual_base, HW_REGS_SPAN ) != 0 ) {
 			if( munmap( h2f_virtual_base, HW_FPGA_AXI_SPAN ) != 0 ) {
 					printf( "ERROR: h2f munmap() failed...\n" );
@@ -27,6 +27,7 @@
 
 #include "util/u_format.h"
 #include "util/u_surface.h"
+#include "sp_blit.h"
 #include "sp_context.h"
 #include "sp_surface.h"
 #include "sp_query.h"
@@ -39,6 +40,14 @@ static void sp_blit(struct pipe_context *pipe,
    if (info->render_condition_enable && !softpipe_check_render_cond(sp))
       return;
 
+   if (util_try_blit_via_copy_region(pipe, info)) {
+      return; /* done */
+   }
+
+   if (sp_blit_native(sp, info)) {
+      return; /* done */
+   }
+
    if (info->src.resource->nr_samples > 1 &&
        info->dst.resource->nr_samples <= 1 &&
        !util_format_is_depth_or_stencil(info->src.resource->format) &&
@@ -47,10 +56,6 @@ static void sp_blit(struct pipe_context *pipe,
       return;
    }
 
-   if (util_try_blit_via_copy_region(pipe, info)) {
-      return; /* done */
-   }
-
    if (!util_blitter_is_blit_supported(sp->blitter, info)) {
       debug_printf("softpipe: blit unsupported %s -> %s\n",
                    util_format_short_name(info->src.resource->format),
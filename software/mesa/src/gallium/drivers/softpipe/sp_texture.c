@@ -31,6 +31,7 @@
   */
 
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 
 #include "util/u_format.h"
@@ -142,6 +143,11 @@ softpipe_displaytarget_layout(struct pipe_screen *screen,
                                           64,
                                           map_front_private,
                                           &spr->stride[0] );
+   spr->present_id =
+      p_atomic_inc_return(&softpipe_screen(screen)->next_present_id);
+
+   /* nothing has been presented yet */
+   softpipe_resource_damage(spr, 0, 0, spr->base.width0, spr->base.height0);
 
    return spr->dt != NULL;
 }
@@ -241,6 +247,10 @@ softpipe_resource_from_handle(struct pipe_screen *screen,
    if (!spr->dt)
       goto fail;
 
+   spr->present_id =
+      p_atomic_inc_return(&softpipe_screen(screen)->next_present_id);
+   softpipe_resource_damage(spr, 0, 0, spr->base.width0, spr->base.height0);
+
    return &spr->base;
 
  fail:
@@ -283,6 +293,77 @@ softpipe_get_tex_image_offset(const struct softpipe_resource *spr,
 }
 
 
+/**
+ * Note that a region of a display target was written, so that the next
+ * present can be limited to what changed.  Rectangles which overlap or
+ * touch without wasting area are merged; when the list is full the new
+ * one is merged into whichever rectangle grows the least.
+ */
+void
+softpipe_resource_damage(struct softpipe_resource *spr,
+                         int x, int y, int width, int height)
+{
+   struct u_rect rect, u;
+   unsigned i, j, best = 0;
+   int best_growth = 0;
+
+   if (!spr->dt)
+      return;
+
+   rect.x0 = MAX2(x, 0);
+   rect.y0 = MAX2(y, 0);
+   rect.x1 = MIN2(x + width, (int) spr->base.width0);
+   rect.y1 = MIN2(y + height, (int) spr->base.height0);
+   if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1)
+      return;
+
+   for (i = 0; i < spr->num_damage; i++) {
+      struct u_rect *d = &spr->damage[i];
+
+      u_rect_union(&u, d, &rect);
+      if (u_rect_area(&u) <= u_rect_area(d) + u_rect_area(&rect))
+         break;
+   }
+
+   if (i == spr->num_damage) {
+      if (spr->num_damage < SP_MAX_DAMAGE_RECTS) {
+         spr->damage[spr->num_damage++] = rect;
+         return;
+      }
+
+      for (i = 0; i < spr->num_damage; i++) {
+         int growth;
+         u_rect_union(&u, &spr->damage[i], &rect);
+         growth = u_rect_area(&u) - u_rect_area(&spr->damage[i]);
+         if (i == 0 || growth < best_growth) {
+            best_growth = growth;
+            best = i;
+         }
+      }
+      i = best;
+   }
+
+   /* merge, then fold in any other rectangles the result now covers */
+   u_rect_union(&spr->damage[i], &spr->damage[i], &rect);
+
+   for (j = 0; j < spr->num_damage; j++) {
+      struct u_rect *d = &spr->damage[i];
+
+      if (j == i)
+         continue;
+
+      u_rect_union(&u, d, &spr->damage[j]);
+      if (u_rect_area(&u) <= u_rect_area(d) + u_rect_area(&spr->damage[j])) {
+         *d = u;
+         spr->damage[j] = spr->damage[--spr->num_damage];
+         if (i == spr->num_damage)
+            i = j;
+         j = (unsigned) -1; /* start over */
+      }
+   }
+}
+
+
 /**
  * Get a pipe_surface "view" into a texture resource.
  */
@@ -470,6 +551,10 @@ softpipe_transfer_unmap(struct pipe_context *pipe,
    if (transfer->usage & PIPE_TRANSFER_WRITE) {
       /* Mark the texture as dirty to expire the tile caches. */
       spr->timestamp++;
+
+      if (spr->dt && !softpipe_transfer(transfer)->tile_cache)
+         softpipe_resource_damage(spr, transfer->box.x, transfer->box.y,
+                                  transfer->box.width, transfer->box.height);
    }
 
    pipe_resource_reference(&transfer->resource, NULL);
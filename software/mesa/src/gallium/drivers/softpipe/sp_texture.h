@@ -30,9 +30,14 @@
 
 
 #include "pipe/p_state.h"
+#include "util/u_rect.h"
 #include "sp_limits.h"
 
 
+/** Max number of damage rectangles tracked per display target */
+#define SP_MAX_DAMAGE_RECTS 8
+
+
 struct pipe_context;
 struct pipe_screen;
 struct softpipe_context;
@@ -66,6 +71,19 @@ struct softpipe_resource
    boolean userBuffer;
 
    unsigned timestamp;
+
+   /**
+    * Parts of a display target written since it was last presented, with
+    * exclusive x1/y1.  Only kept for resources with a dt.
+    */
+   struct u_rect damage[SP_MAX_DAMAGE_RECTS];
+   unsigned num_damage;
+
+   /**
+    * Unique id of a display target, for softpipe_screen::last_present.
+    * Unlike the pointer it is never reused by a later resource.
+    */
+   unsigned present_id;
 };
 
 
@@ -77,6 +95,9 @@ struct softpipe_transfer
    struct pipe_transfer base;
 
    unsigned long offset;
+
+   /** Mapped by a tile cache, which reports damage per tile itself */
+   boolean tile_cache;
 };
 
 
@@ -119,4 +140,8 @@ softpipe_init_texture_funcs(struct pipe_context *pipe);
 unsigned
 softpipe_get_tex_image_offset(const struct softpipe_resource *spr,
                               unsigned level, unsigned layer);
+
+void
+softpipe_resource_damage(struct softpipe_resource *spr,
+                         int x, int y, int width, int height);
 #endif /* SP_TEXTURE */
@@ -36,6 +36,8 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_tile.h"
+#include "sp_context.h"
+#include "sp_texture.h"
 #include "sp_tile_cache.h"
 
 static struct softpipe_cached_tile *
@@ -164,6 +166,111 @@ sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
 }
 
 
+/**
+ * Report a tile written back to the surface as display target damage.
+ */
+static inline void
+sp_tile_cache_damage(struct softpipe_tile_cache *tc, unsigned x, unsigned y)
+{
+   if (tc->damage_target)
+      softpipe_resource_damage(tc->damage_target, x, y,
+                               TILE_SIZE, TILE_SIZE);
+}
+
+
+/**
+ * Write a cached tile back to the mapped surface.  Color tiles are packed
+ * straight into the surface memory, without a staging copy in between,
+ * so a display target's storage is written exactly once per tile.
+ */
+static void
+sp_tile_cache_put_tile(struct softpipe_tile_cache *tc, int layer,
+                       unsigned x, unsigned y, enum pipe_format format,
+                       const struct softpipe_cached_tile *tile)
+{
+   struct pipe_transfer *pt = tc->transfer[layer];
+   unsigned w = TILE_SIZE, h = TILE_SIZE;
+
+   if (u_clip_tile(x, y, &w, &h, &pt->box))
+      return;
+
+   if (tc->depth_stencil) {
+      pipe_put_tile_raw(pt, tc->transfer_map[layer], x, y, w, h,
+                        tile->data.any,
+                        util_format_get_stride(pt->resource->format,
+                                               TILE_SIZE));
+   }
+   else if (util_format_is_pure_uint(format)) {
+      util_format_write_4ui(format, (const unsigned *) tile->data.colorui128,
+                            sizeof(tile->data.colorui128[0]),
+                            tc->transfer_map[layer], pt->stride,
+                            x, y, w, h);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      util_format_write_4i(format, (const int *) tile->data.colori128,
+                           sizeof(tile->data.colori128[0]),
+                           tc->transfer_map[layer], pt->stride,
+                           x, y, w, h);
+   }
+   else {
+      util_format_write_4f(format, (const float *) tile->data.color,
+                           sizeof(tile->data.color[0]),
+                           tc->transfer_map[layer], pt->stride,
+                           x, y, w, h);
+   }
+
+   softpipe_context(tc->pipe)->bytes_copied +=
+      w * h * util_format_get_blocksize(pt->resource->format);
+   sp_tile_cache_damage(tc, x, y);
+}
+
+
+/**
+ * Read a tile from the mapped surface into the cache, unpacking color
+ * tiles in place.
+ */
+static void
+sp_tile_cache_get_tile(struct softpipe_tile_cache *tc, int layer,
+                       unsigned x, unsigned y,
+                       struct softpipe_cached_tile *tile)
+{
+   struct pipe_transfer *pt = tc->transfer[layer];
+   enum pipe_format format = tc->surface->format;
+   unsigned w = TILE_SIZE, h = TILE_SIZE;
+
+   if (u_clip_tile(x, y, &w, &h, &pt->box))
+      return;
+
+   if (tc->depth_stencil) {
+      pipe_get_tile_raw(pt, tc->transfer_map[layer], x, y, w, h,
+                        tile->data.any,
+                        util_format_get_stride(pt->resource->format,
+                                               TILE_SIZE));
+   }
+   else if (util_format_is_pure_uint(format)) {
+      util_format_read_4ui(format, (unsigned *) tile->data.colorui128,
+                           sizeof(tile->data.colorui128[0]),
+                           tc->transfer_map[layer], pt->stride,
+                           x, y, w, h);
+   }
+   else if (util_format_is_pure_sint(format)) {
+      util_format_read_4i(format, (int *) tile->data.colori128,
+                          sizeof(tile->data.colori128[0]),
+                          tc->transfer_map[layer], pt->stride,
+                          x, y, w, h);
+   }
+   else {
+      util_format_read_4f(format, (float *) tile->data.color,
+                          sizeof(tile->data.color[0]),
+                          tc->transfer_map[layer], pt->stride,
+                          x, y, w, h);
+   }
+
+   softpipe_context(tc->pipe)->bytes_copied +=
+      w * h * util_format_get_blocksize(pt->resource->format);
+}
+
+
 /**
  * Specify the surface to cache.
  */
@@ -192,6 +299,7 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
    }
 
    tc->surface = ps;
+   tc->damage_target = NULL;
 
    if (ps) {
       tc->num_maps = ps->u.tex.last_layer - ps->u.tex.first_layer + 1;
@@ -209,6 +317,8 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
                                                     PIPE_TRANSFER_UNSYNCHRONIZED,
                                                     0, 0, ps->width, ps->height,
                                                     &tc->transfer[i]);
+            if (tc->transfer[i])
+               softpipe_transfer(tc->transfer[i])->tile_cache = TRUE;
          }
       }
       else {
@@ -217,6 +327,10 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
       }
 
       tc->depth_stencil = util_format_is_depth_or_stencil(ps->format);
+
+      /* display targets are single level, single layer 2D textures */
+      if (softpipe_resource(ps->texture)->dt && !tc->depth_stencil)
+         tc->damage_target = softpipe_resource(ps->texture);
    }
 }
 
@@ -364,28 +478,8 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
 
          if (is_clear_flag_set(tc->clear_flags, addr, tc->clear_flags_size)) {
             /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
-               pipe_put_tile_raw(pt, tc->transfer_map[layer],
-                                 x, y, TILE_SIZE, TILE_SIZE,
-                                 tc->tile->data.any, 0/*STRIDE*/);
-            }
-            else {
-               if (util_format_is_pure_uint(tc->surface->format)) {
-                  pipe_put_tile_ui_format(pt, tc->transfer_map[layer],
-                                          x, y, TILE_SIZE, TILE_SIZE,
-                                          pt->resource->format,
-                                          (unsigned *) tc->tile->data.colorui128);
-               } else if (util_format_is_pure_sint(tc->surface->format)) {
-                  pipe_put_tile_i_format(pt, tc->transfer_map[layer],
-                                         x, y, TILE_SIZE, TILE_SIZE,
-                                         pt->resource->format,
-                                         (int *) tc->tile->data.colori128);
-               } else {
-                  pipe_put_tile_rgba(pt, tc->transfer_map[layer],
-                                     x, y, TILE_SIZE, TILE_SIZE,
-                                     (float *) tc->tile->data.color);
-               }
-            }
+            sp_tile_cache_put_tile(tc, layer, x, y, pt->resource->format,
+                                   tc->tile);
             numCleared++;
          }
       }
@@ -402,37 +496,10 @@ sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    int layer = tc->tile_addrs[pos].bits.layer;
    if (!tc->tile_addrs[pos].bits.invalid) {
-      if (tc->depth_stencil) {
-         pipe_put_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
-                           tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                           tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                           TILE_SIZE, TILE_SIZE,
-                           tc->entries[pos]->data.depth32, 0/*STRIDE*/);
-      }
-      else {
-         if (util_format_is_pure_uint(tc->surface->format)) {
-            pipe_put_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
-                                    tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                    tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                    TILE_SIZE, TILE_SIZE,
-                                    tc->surface->format,
-                                    (unsigned *) tc->entries[pos]->data.colorui128);
-         } else if (util_format_is_pure_sint(tc->surface->format)) {
-            pipe_put_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
-                                   tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                   tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                   TILE_SIZE, TILE_SIZE,
-                                   tc->surface->format,
-                                   (int *) tc->entries[pos]->data.colori128);
-         } else {
-            pipe_put_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (float *) tc->entries[pos]->data.color);
-         }
-      }
+      sp_tile_cache_put_tile(tc, layer,
+                             tc->tile_addrs[pos].bits.x * TILE_SIZE,
+                             tc->tile_addrs[pos].bits.y * TILE_SIZE,
+                             tc->surface->format, tc->entries[pos]);
       tc->tile_addrs[pos].bits.invalid = 1;  /* mark as empty */
    }
 }
@@ -532,37 +599,10 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       layer = tc->tile_addrs[pos].bits.layer;
       if (tc->tile_addrs[pos].bits.invalid == 0) {
          /* put dirty tile back in framebuffer */
-         if (tc->depth_stencil) {
-            pipe_put_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_put_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_put_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
-                                      tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                      tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                      TILE_SIZE, TILE_SIZE,
-                                      tc->surface->format,
-                                      (int *) tile->data.colori128);
-            } else {
-               pipe_put_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         sp_tile_cache_put_tile(tc, layer,
+                                tc->tile_addrs[pos].bits.x * TILE_SIZE,
+                                tc->tile_addrs[pos].bits.y * TILE_SIZE,
+                                tc->surface->format, tile);
       }
 
       tc->tile_addrs[pos] = addr;
@@ -583,37 +623,10 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       }
       else {
          /* get new tile data from transfer */
-         if (tc->depth_stencil) {
-            pipe_get_tile_raw(tc->transfer[layer], tc->transfer_map[layer],
-                              tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                              tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                              TILE_SIZE, TILE_SIZE,
-                              tile->data.depth32, 0/*STRIDE*/);
-         }
-         else {
-            if (util_format_is_pure_uint(tc->surface->format)) {
-               pipe_get_tile_ui_format(tc->transfer[layer], tc->transfer_map[layer],
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (unsigned *) tile->data.colorui128);
-            } else if (util_format_is_pure_sint(tc->surface->format)) {
-               pipe_get_tile_i_format(tc->transfer[layer], tc->transfer_map[layer],
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (int *) tile->data.colori128);
-            } else {
-               pipe_get_tile_rgba_format(tc->transfer[layer], tc->transfer_map[layer],
-                                         tc->tile_addrs[pos].bits.x * TILE_SIZE,
-                                         tc->tile_addrs[pos].bits.y * TILE_SIZE,
-                                         TILE_SIZE, TILE_SIZE,
-                                         tc->surface->format,
-                                         (float *) tile->data.color);
-            }
-         }
+         sp_tile_cache_get_tile(tc, layer,
+                                tc->tile_addrs[pos].bits.x * TILE_SIZE,
+                                tc->tile_addrs[pos].bits.y * TILE_SIZE,
+                                tile);
       }
    }
 
@@ -99,6 +99,9 @@ struct softpipe_tile_cache
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   /** display target that written back tiles are reported as damage to */
+   struct softpipe_resource *damage_target;
 };
 
 
@@ -0,0 +1,339 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/****************************************************************************
+* @file trace.cpp
+*
+* @brief Per-thread trace buffers and the trace file writer.
+*
+******************************************************************************/
+#include "common/os.h"
+#include "archrast/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ArchRast
+{
+    std::atomic<bool> gTraceEnabled(false);
+
+    // Records per thread.  The writer drains the buffers every
+    // TRACE_FLUSH_MS, records arriving faster than that are dropped.
+    static const uint32_t TRACE_BUFFER_SIZE = 64 * 1024;
+    static const uint32_t TRACE_FLUSH_MS = 2;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// TraceBuffer - ring written only by its thread and read only by the
+    /// writer thread, so head and tail need no lock.
+    //////////////////////////////////////////////////////////////////////////
+    struct TraceBuffer
+    {
+        // Producer side
+        OSALIGN(std::atomic<uint64_t>, 64) head{ 0 };
+        uint64_t                cachedTail = 0;
+        std::atomic<uint32_t>   dropped{ 0 };
+
+        // Consumer side
+        OSALIGN(std::atomic<uint64_t>, 64) tail{ 0 };
+        uint32_t                threadIndex = 0;
+        bool                    nameWritten = false;
+        std::string             name;
+
+        TraceRecord             records[TRACE_BUFFER_SIZE];
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// TraceWriter - owns the trace file, the thread buffers and the thread
+    /// that copies the buffers to the file.
+    //////////////////////////////////////////////////////////////////////////
+    class TraceWriter
+    {
+    public:
+        TraceWriter(FILE* pFile) : mpFile(pFile)
+        {
+            mThread = std::thread(&TraceWriter::Run, this);
+        }
+
+        ~TraceWriter()
+        {
+            {
+                std::lock_guard<std::mutex> l(mMutex);
+                mStop = true;
+            }
+            mCond.notify_one();
+            mThread.join();
+
+            Drain();
+
+            for (TraceBuffer* pBuffer : mBuffers)
+            {
+                pBuffer->~TraceBuffer();
+                AlignedFree(pBuffer);
+            }
+            fclose(mpFile);
+        }
+
+        TraceBuffer* AddBuffer(const std::string& name)
+        {
+            TraceBuffer* pBuffer = new (AlignedMalloc(sizeof(TraceBuffer), 64)) TraceBuffer();
+            pBuffer->name = name;
+
+            std::lock_guard<std::mutex> l(mMutex);
+            pBuffer->threadIndex = (uint32_t)mBuffers.size();
+            mBuffers.push_back(pBuffer);
+            return pBuffer;
+        }
+
+    private:
+        void Run()
+        {
+            std::unique_lock<std::mutex> l(mMutex);
+            while (!mStop)
+            {
+                mCond.wait_for(l, std::chrono::milliseconds(TRACE_FLUSH_MS));
+                DrainLocked();
+            }
+        }
+
+        void Drain()
+        {
+            std::lock_guard<std::mutex> l(mMutex);
+            DrainLocked();
+        }
+
+        void WriteChunk(TraceChunkType type, const TraceBuffer* pBuffer, const void* pData, uint32_t size, uint32_t elementSize)
+        {
+            TraceChunkHeader header;
+            header.type = type;
+            header.threadIndex = pBuffer->threadIndex;
+            header.size = size;
+            header.dropped = pBuffer->dropped.load(std::memory_order_relaxed);
+
+            fwrite(&header, sizeof(header), 1, mpFile);
+            fwrite(pData, elementSize, size, mpFile);
+        }
+
+        void DrainLocked()
+        {
+            for (TraceBuffer* pBuffer : mBuffers)
+            {
+                if (!pBuffer->nameWritten)
+                {
+                    WriteChunk(TRACE_CHUNK_THREAD, pBuffer, pBuffer->name.c_str(), (uint32_t)pBuffer->name.size(), 1);
+                    pBuffer->nameWritten = true;
+                }
+
+                uint64_t tail = pBuffer->tail.load(std::memory_order_relaxed);
+                uint64_t head = pBuffer->head.load(std::memory_order_acquire);
+
+                while (tail != head)
+                {
+                    uint32_t start = uint32_t(tail % TRACE_BUFFER_SIZE);
+                    uint32_t count = (uint32_t)std::min<uint64_t>(head - tail, TRACE_BUFFER_SIZE - start);
+
+                    WriteChunk(TRACE_CHUNK_RECORDS, pBuffer, &pBuffer->records[start], count, sizeof(TraceRecord));
+                    tail += count;
+                }
+
+                pBuffer->tail.store(tail, std::memory_order_release);
+            }
+            fflush(mpFile);
+        }
+
+        FILE*                       mpFile;
+        std::thread                 mThread;
+        std::mutex                  mMutex;
+        std::condition_variable     mCond;
+        bool                        mStop = false;
+        std::vector<TraceBuffer*>   mBuffers;
+    };
+
+    // Open trace state, protected by sTraceMutex.
+    static std::mutex               sTraceMutex;
+    static TraceWriter*             spTraceWriter = nullptr;
+    static uint32_t                 sTraceRefs = 0;
+    static uint32_t                 sTraceFiles = 0;
+
+    // Incremented whenever a trace file is opened; threads compare it to
+    // the session of their buffer to find out that it is gone.
+    static std::atomic<uint32_t>    sTraceSession(0);
+
+    static THREAD TraceBuffer*      t_pTraceBuffer = nullptr;
+    static THREAD uint32_t          t_traceSession = 0;
+    static THREAD uint32_t          t_traceDrawId = 0;
+    static THREAD int32_t           t_traceWorkerId = -1;
+
+    static uint64_t MeasureTscFrequency()
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startTsc = __rdtsc();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        uint64_t endTsc = __rdtsc();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        return uint64_t((endTsc - startTsc) / elapsed.count());
+    }
+
+    static TraceBuffer* RegisterThread()
+    {
+        std::lock_guard<std::mutex> l(sTraceMutex);
+
+        if (spTraceWriter == nullptr)
+        {
+            return nullptr;
+        }
+
+        std::string name = (t_traceWorkerId < 0) ? "API" : "Worker " + std::to_string(t_traceWorkerId);
+
+        t_pTraceBuffer = spTraceWriter->AddBuffer(name);
+        t_traceSession = sTraceSession.load(std::memory_order_relaxed);
+        return t_pTraceBuffer;
+    }
+
+    void TraceOpen(const char* pFilename, const char* const* ppIdNames, uint32_t numIds)
+    {
+        std::lock_guard<std::mutex> l(sTraceMutex);
+
+        if (sTraceRefs++)
+        {
+            return;
+        }
+
+        // Don't overwrite the trace of an earlier set of contexts.
+        std::string filename = pFilename;
+        if (sTraceFiles)
+        {
+            filename += "." + std::to_string(sTraceFiles);
+        }
+        sTraceFiles++;
+
+        FILE* pFile = fopen(filename.c_str(), "wb");
+        if (pFile == nullptr)
+        {
+            fprintf(stderr, "SWR: could not open trace file %s\n", filename.c_str());
+            return;
+        }
+
+        TraceFileHeader header = {};
+        std::copy(TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC), header.magic);
+        header.version = TRACE_VERSION;
+        header.recordSize = sizeof(TraceRecord);
+        header.tscFrequency = MeasureTscFrequency();
+        header.numIds = numIds;
+        fwrite(&header, sizeof(header), 1, pFile);
+
+        for (uint32_t i = 0; i < numIds; ++i)
+        {
+            uint16_t length = (uint16_t)strlen(ppIdNames[i]);
+            fwrite(&length, sizeof(length), 1, pFile);
+            fwrite(ppIdNames[i], 1, length, pFile);
+        }
+
+        spTraceWriter = new TraceWriter(pFile);
+        sTraceSession.fetch_add(1, std::memory_order_relaxed);
+        gTraceEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    void TraceClose()
+    {
+        std::lock_guard<std::mutex> l(sTraceMutex);
+
+        SWR_ASSERT(sTraceRefs > 0);
+        if (--sTraceRefs)
+        {
+            return;
+        }
+
+        gTraceEnabled.store(false, std::memory_order_relaxed);
+
+        delete spTraceWriter;
+        spTraceWriter = nullptr;
+    }
+
+    void TraceRecordSlow(TraceRecordKind kind, uint32_t id, uint32_t count)
+    {
+        TraceBuffer* pBuffer = t_pTraceBuffer;
+        if (t_traceSession != sTraceSession.load(std::memory_order_relaxed))
+        {
+            pBuffer = RegisterThread();
+            if (pBuffer == nullptr)
+            {
+                return;
+            }
+        }
+
+        uint64_t head = pBuffer->head.load(std::memory_order_relaxed);
+        if (head - pBuffer->cachedTail >= TRACE_BUFFER_SIZE)
+        {
+            pBuffer->cachedTail = pBuffer->tail.load(std::memory_order_acquire);
+            if (head - pBuffer->cachedTail >= TRACE_BUFFER_SIZE)
+            {
+                pBuffer->dropped.store(pBuffer->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        static const uint32_t maxCount = (1 << TRACE_COUNT_BITS) - 1;
+        static const uint32_t maxId = (1 << TRACE_ID_BITS) - 1;
+
+        TraceRecord& record = pBuffer->records[head % TRACE_BUFFER_SIZE];
+        record.tsc = __rdtsc();
+        if (kind == TRACE_FRAME)
+        {
+            record.drawId = count;
+            count = 0;
+        }
+        else
+        {
+            record.drawId = t_traceDrawId;
+        }
+        record.data = (uint32_t(kind) << (TRACE_ID_BITS + TRACE_COUNT_BITS)) |
+                      (std::min(id, maxId) << TRACE_COUNT_BITS) |
+                      std::min(count, maxCount);
+
+        pBuffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    void TraceSetWorkerId(uint32_t workerId)
+    {
+        t_traceWorkerId = (int32_t)workerId;
+    }
+
+    void TraceSetDrawId(uint32_t drawId)
+    {
+        t_traceDrawId = drawId;
+    }
+}
@@ -0,0 +1,132 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/****************************************************************************
+* @file trace.h
+*
+* @brief Binary event trace for ArchRast.
+*
+*        When KNOB_AR_TRACE_FILE is set, every RDTSC bucket start/stop and
+*        event is recorded with a timestamp and the draw the thread works
+*        on into a per-thread ring buffer.  A writer thread drains the
+*        buffers to the trace file, see the format below.  Use
+*        scripts/ar_trace_analyze.py to turn the file into per-draw,
+*        per-stage and per-thread reports or a Chrome trace.
+*
+*        When tracing is off each trace point costs one load and a branch.
+*
+******************************************************************************/
+#pragma once
+
+#include "common/os.h"
+
+#include <atomic>
+
+namespace ArchRast
+{
+    //////////////////////////////////////////////////////////////////////////
+    /// Trace file layout, all integers little-endian:
+    ///   TraceFileHeader
+    ///   numIds x { uint16_t length; char name[length]; }
+    ///   chunks, each a TraceChunkHeader followed by
+    ///     TRACE_CHUNK_THREAD:  char name[size]
+    ///     TRACE_CHUNK_RECORDS: TraceRecord records[size]
+    //////////////////////////////////////////////////////////////////////////
+    static const char     TRACE_MAGIC[8] = { 'S', 'W', 'R', 'T', 'R', 'A', 'C', 'E' };
+    static const uint32_t TRACE_VERSION  = 1;
+
+    struct TraceFileHeader
+    {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    recordSize;
+        uint64_t    tscFrequency;   // timestamp ticks per second
+        uint32_t    numIds;         // names of the ids used in records
+        uint32_t    reserved;
+    };
+
+    enum TraceChunkType
+    {
+        TRACE_CHUNK_THREAD,
+        TRACE_CHUNK_RECORDS,
+    };
+
+    struct TraceChunkHeader
+    {
+        uint32_t    type;
+        uint32_t    threadIndex;
+        uint32_t    size;
+        uint32_t    dropped;        // records lost on this thread so far
+    };
+
+    enum TraceRecordKind
+    {
+        TRACE_BEGIN,
+        TRACE_END,
+        TRACE_EVENT,
+        TRACE_FRAME,                // drawId holds the frame number
+    };
+
+    static const uint32_t TRACE_COUNT_BITS = 22;
+    static const uint32_t TRACE_ID_BITS    = 8;
+
+    struct TraceRecord
+    {
+        uint64_t    tsc;
+        uint32_t    drawId;
+        uint32_t    data;           // kind:2 | id:8 | count:22 (saturated)
+    };
+    static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay packed");
+
+    extern std::atomic<bool> gTraceEnabled;
+
+    INLINE bool TraceEnabled()
+    {
+        return gTraceEnabled.load(std::memory_order_relaxed);
+    }
+
+    // Opens the trace file, or adds a reference to the open one.
+    // ppIdNames names the ids passed to the trace points.
+    void TraceOpen(const char* pFilename, const char* const* ppIdNames, uint32_t numIds);
+    // Drops a reference, flushing and closing the file on the last one.
+    void TraceClose();
+
+    void TraceRecordSlow(TraceRecordKind kind, uint32_t id, uint32_t count);
+    void TraceSetWorkerId(uint32_t workerId);
+    void TraceSetDrawId(uint32_t drawId);
+};
+
+#define AR_TRACE(kind, id, count) \
+    do { if (ArchRast::TraceEnabled()) ArchRast::TraceRecordSlow(ArchRast::kind, id, count); } while (0)
+
+#define AR_TRACE_BEGIN(id)              AR_TRACE(TRACE_BEGIN, id, 0)
+#define AR_TRACE_END(id, count)         AR_TRACE(TRACE_END, id, count)
+#define AR_TRACE_EVENT(id, count)       AR_TRACE(TRACE_EVENT, id, count)
+#define AR_TRACE_FRAME(frame)           AR_TRACE(TRACE_FRAME, 0, frame)
+
+#define AR_TRACE_DRAW(drawId) \
+    do { if (ArchRast::TraceEnabled()) ArchRast::TraceSetDrawId(drawId); } while (0)
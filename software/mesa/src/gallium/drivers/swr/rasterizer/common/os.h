@@ -145,8 +145,8 @@ uint64_t __rdtsc()
 }
 #endif
 
-#if !defined( __clang__) && !defined(__INTEL_COMPILER)
-// Intrinsic not defined in gcc
+#if !defined( __clang__) && !defined(__INTEL_COMPILER) && (GCC_VERSION < 100000)
+// Intrinsic not defined in gcc before 10
 static INLINE
 void _mm256_storeu2_m128i(__m128i *hi, __m128i *lo, __m256i a)
 {
@@ -240,6 +240,7 @@ typedef MEGABYTE    GIGABYTE[1024];
 
 #define OSALIGNLINE(RWORD) OSALIGN(RWORD, 64)
 #define OSALIGNSIMD(RWORD) OSALIGN(RWORD, KNOB_SIMD_BYTES)
+#define OSALIGNSIMD16(RWORD) OSALIGN(RWORD, KNOB_SIMD16_BYTES)
 
 #include "common/swr_assert.h"
 
@@ -119,6 +119,9 @@ void BucketManager::PrintBucket(FILE* f, UINT level, uint64_t threadCycles, uint
     // compute average cycle count per invocation
     uint64_t CPE = bucket.elapsed / bucket.count;
 
+    // compute average cycle count per element, for buckets that report them
+    uint64_t CPE2 = bucket.elements ? bucket.elapsed / bucket.elements : 0;
+
     BUCKET_DESC &desc = mBuckets[bucket.id];
 
     // construct hierarchy visualization
@@ -127,14 +130,14 @@ void BucketManager::PrintBucket(FILE* f, UINT level, uint64_t threadCycles, uint
     strcat(hier, desc.name.c_str());
 
     // print out
-    fprintf(f, "%6.2f %6.2f %-10" PRIu64 " %-10" PRIu64 " %-10u %-10lu %-10u %s\n", 
+    fprintf(f, "%6.2f %6.2f %-10" PRIu64 " %-10" PRIu64 " %-10u %-10" PRIu64 " %-10" PRIu64 " %s\n", 
         percentTotal, 
         percentParent, 
         bucket.elapsed, 
         CPE, 
         bucket.count, 
-        (unsigned long)0, 
-        (uint32_t)0, 
+        CPE2, 
+        bucket.elements, 
         hier
     );
 
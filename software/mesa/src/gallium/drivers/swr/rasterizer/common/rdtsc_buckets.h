@@ -164,7 +164,8 @@ public:
     }
 
     // stop the currently executing bucket
-    INLINE void StopBucket(UINT id)
+    // count is the number of elements (verts, prims, ...) the bucket processed
+    INLINE void StopBucket(UINT id, uint32_t count = 0)
     {
         SWR_ASSERT(tlsThreadId < mThreads.size());
         BUCKET_THREAD &bt = mThreads[tlsThreadId];
@@ -192,6 +193,7 @@ public:
 
             bt.pCurrent->elapsed += (tsc - bt.pCurrent->start);
             bt.pCurrent->count++;
+            bt.pCurrent->elements += count;
 
             // pop to parent
             bt.pCurrent = bt.pCurrent->pParent;
@@ -38,6 +38,7 @@ struct BUCKET
     uint64_t start{ 0 };
     uint64_t elapsed{ 0 };
     uint32_t count{ 0 };
+    uint64_t elements{ 0 };
 
     BUCKET* pParent{ nullptr };
     std::vector<BUCKET> children;
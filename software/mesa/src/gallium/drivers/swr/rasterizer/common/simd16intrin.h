@@ -55,6 +55,10 @@ typedef __m512 simd16scalar;
 typedef __m512d simd16scalard;
 typedef __m512i simd16scalari;
 typedef __mmask16 simd16mask;
+
+#define _simd16_masklo(mask) ((mask) & 0xFF)
+#define _simd16_maskhi(mask) (((mask) >> 8))
+#define _simd16_setmask(hi, lo) (((hi) << 8) | (lo))
 #endif//ENABLE_AVX512_EMULATION
 #else
 #error Unsupported vector width
@@ -321,12 +325,8 @@ INLINE simd16mask _simd16_movemask_ps(simd16scalar a)
 
 INLINE simd16mask _simd16_movemask_pd(simd16scalard a)
 {
-    simd16mask mask;
-
-    reinterpret_cast<uint8_t *>(&mask)[0] = _mm256_movemask_pd(a.lo);
-    reinterpret_cast<uint8_t *>(&mask)[1] = _mm256_movemask_pd(a.hi);
-
-    return mask;
+    // 4 doubles per half, so the upper half lands in bits 4..7
+    return _mm256_movemask_pd(a.lo) | (_mm256_movemask_pd(a.hi) << 4);
 }
 
 INLINE simd16mask _simd16_movemask_epi8(simd16scalari a)
@@ -575,6 +575,56 @@ INLINE simd16scalari _simd16_permute_128_temp(simd16scalari a, simd16scalari b)
 
 #define _simd16_permute_128(a, b, imm8) _simd16_permute_128_temp<imm8>(a, b)
 
+template <int imm8>
+INLINE __m256 _simd16_extract_ps_temp(simd16scalar a)
+{
+    return imm8 ? a.hi : a.lo;
+}
+
+#define _simd16_extract_ps(a, imm8) _simd16_extract_ps_temp<imm8>(a)
+
+template <int imm8>
+INLINE __m256i _simd16_extract_si_temp(simd16scalari a)
+{
+    return imm8 ? a.hi : a.lo;
+}
+
+#define _simd16_extract_si(a, imm8) _simd16_extract_si_temp<imm8>(a)
+
+template <int imm8>
+INLINE simd16scalar _simd16_insert_ps_temp(simd16scalar a, __m256 b)
+{
+    if (imm8)
+    {
+        a.hi = b;
+    }
+    else
+    {
+        a.lo = b;
+    }
+
+    return a;
+}
+
+#define _simd16_insert_ps(a, b, imm8) _simd16_insert_ps_temp<imm8>(a, b)
+
+template <int imm8>
+INLINE simd16scalari _simd16_insert_si_temp(simd16scalari a, __m256i b)
+{
+    if (imm8)
+    {
+        a.hi = b;
+    }
+    else
+    {
+        a.lo = b;
+    }
+
+    return a;
+}
+
+#define _simd16_insert_si(a, b, imm8) _simd16_insert_si_temp<imm8>(a, b)
+
 // convert bitmask to vector mask
 INLINE simd16scalar vMask16(int32_t mask)
 {
@@ -591,23 +641,18 @@ INLINE simd16scalar vMask16(int32_t mask)
 
 INLINE simd16mask _simd16_scalari2mask(simd16scalari mask)
 {
-    __m512i flag = _mm512_set1_epi32(0x80000000);
-
-    __m512i temp = _mm512_and_epi32(mask, flag);
-
-    return _mm512_cmpeq_epu32_mask(temp, flag);
+    return _mm512_cmplt_epi32_mask(mask, _mm512_setzero_si512());
 }
 
-#if 0
 INLINE simd16mask _simd16_scalard2mask(simd16scalard mask)
 {
-    __m512i flag = _mm512_set1_epi64(0x8000000000000000);
-
-    __m512 tempi = _mm512_and_epi64(_mm512_castpd_si512(mask), flag);
+    return _mm512_cmplt_epi64_mask(_mm512_castpd_si512(mask), _mm512_setzero_si512());
+}
 
-    return _mm512_cmpeq_epu64_mask(temp, flag);
+INLINE simd16scalari _simd16_mask2scalari(simd16mask mask)
+{
+    return _mm512_maskz_set1_epi32(mask, 0xFFFFFFFF);
 }
-#endif
 
 #define _simd16_setzero_ps      _mm512_setzero_ps
 #define _simd16_setzero_si      _mm512_setzero_si512
@@ -615,106 +660,91 @@ INLINE simd16mask _simd16_scalard2mask(simd16scalard mask)
 #define _simd16_set1_epi8       _mm512_set1_epi8
 #define _simd16_set1_epi32      _mm512_set1_epi32
 
+INLINE simd16scalari _simd16_set_epi32(int e15, int e14, int e13, int e12, int e11, int e10, int e9, int e8, int e7, int e6, int e5, int e4, int e3, int e2, int e1, int e0)
+{
+    return _mm512_set_epi32(e15, e14, e13, e12, e11, e10, e9, e8, e7, e6, e5, e4, e3, e2, e1, e0);
+}
+
 INLINE simd16scalari _simd16_set_epi32(int e7, int e6, int e5, int e4, int e3, int e2, int e1, int e0)
 {
-    simd16scalari result;
+    return _mm512_set_epi32(e7, e6, e5, e4, e3, e2, e1, e0, e7, e6, e5, e4, e3, e2, e1, e0);
+}
 
-    result = _mm512_set_epi32(e7, e6, e5, e4, e3, e2, e1, e0, e7, e6, e5, e4, e3, e2, e1, e0);
+#define _simd16_load_ps         _mm512_load_ps
+#define _simd16_loadu_ps        _mm512_loadu_ps
+#define _simd16_load_si         _mm512_load_si512
+#define _simd16_loadu_si        _mm512_loadu_si512
 
-    return result;
+INLINE simd16scalar _simd16_broadcast_ss(float const *m)
+{
+    return _mm512_set1_ps(*m);
 }
 
-INLINE simd16scalari _simd16_set_epi32(int e15, int e14, int e13, int e12, int e11, int e10, int e9, int e8, int e7, int e6, int e5, int e4, int e3, int e2, int e1, int e0)
+INLINE simd16scalar _simd16_broadcast_ps(__m128 const *m)
 {
-    simd16scalari result;
-
-    result = _mm512_set_epi32(e15, e14, e13, e12, e11, e10, e9, e8, e7, e6, e5, e4, e3, e2, e1, e0);
-
-    return result;
+    return _mm512_broadcast_f32x4(*m);
 }
 
-#define _simd16_load_ps         _mm512_load_ps
-#define _simd16_loadu_ps        _mm512_loadu_ps
-#if 1
 #define _simd16_load1_ps        _simd16_broadcast_ss
-#endif
-#define _simd16_load_si         _mm256_load_si256
-#define _simd16_loadu_si        _mm256_loadu_si256
-#define _simd16_broadcast_ss(m) _mm512_extload_ps(m, _MM_UPCONV_PS_NONE, _MM_BROADCAST_1X16, 0)
-#define _simd16_broadcast_ps(m) _mm512_extload_ps(m, _MM_UPCONV_PS_NONE, _MM_BROADCAST_4X16, 0)
 #define _simd16_store_ps        _mm512_store_ps
 #define _simd16_store_si        _mm512_store_si512
 
 INLINE void _simd16_maskstore_ps(float *m, simd16scalari mask, simd16scalar a)
 {
-    simd16mask k = _simd16_scalari2mask(mask);
-
-    _mm512_mask_store_ps(m, k, a);
+    _mm512_mask_store_ps(m, _simd16_scalari2mask(mask), a);
 }
 
 #define _simd16_blend_ps(a, b, mask)    _mm512_mask_blend_ps(mask, a, b)
 
 INLINE simd16scalar _simd16_blendv_ps(simd16scalar a, simd16scalar b, const simd16scalar mask)
 {
-    simd16mask k = _simd16_scalari2mask(_mm512_castps_si512(mask));
-
-    _mm512_mask_blend_ps(k, a, b);
+    return _mm512_mask_blend_ps(_simd16_scalari2mask(_mm512_castps_si512(mask)), a, b);
 }
 
 INLINE simd16scalari _simd16_blendv_epi32(simd16scalari a, simd16scalari b, const simd16scalar mask)
 {
-    simd16mask k = _simd16_scalari2mask(_mm512_castps_si512(mask));
-
-    _mm512_mask_blend_epi32(k, a, b);
+    return _mm512_mask_blend_epi32(_simd16_scalari2mask(_mm512_castps_si512(mask)), a, b);
 }
 
 INLINE simd16scalari _simd16_blendv_epi32(simd16scalari a, simd16scalari b, const simd16scalari mask)
 {
-    simd16mask k = _simd16_scalari2mask(mask);
-
-    _mm512_mask_blend_epi32(k, a, b);
+    return _mm512_mask_blend_epi32(_simd16_scalari2mask(mask), a, b);
 }
 
 #define _simd16_mul_ps          _mm512_mul_ps
 #define _simd16_add_ps          _mm512_add_ps
 #define _simd16_sub_ps          _mm512_sub_ps
-#define _simd16_rsqrt_ps        _mm512_rsqrt23_ps
+#define _simd16_rsqrt_ps        _mm512_rsqrt14_ps
 #define _simd16_min_ps          _mm512_min_ps
 #define _simd16_max_ps          _mm512_max_ps
 
 INLINE simd16mask _simd16_movemask_ps(simd16scalar a)
 {
-    return  _simd16_scalari2mask(_mm512_castps_si512(a));
+    return _simd16_scalari2mask(_mm512_castps_si512(a));
 }
 
-#if 0
 INLINE simd16mask _simd16_movemask_pd(simd16scalard a)
 {
-    return  _simd16_scalard2mask(_mm512i_castpd_si512(a));
+    return _simd16_scalard2mask(a);
 }
-#endif
 
-#if 0
-INLINE int _simd16_movemask_epi8(simd16scalari a)
+INLINE uint64_t _simd16_movemask_epi8(simd16scalari a)
 {
-    return  _simd16_scalar2mask(a);
+    return _mm512_movepi8_mask(a);
 }
-#endif
 
 #define _simd16_cvtps_epi32     _mm512_cvtps_epi32
 #define _simd16_cvttps_epi32    _mm512_cvttps_epi32
 #define _simd16_cvtepi32_ps     _mm512_cvtepi32_ps
 
 template <int comp>
-INLINE simd16scalar _simd16_cmp_ps_temp(simd16scalar a, simd16scalar b)
+INLINE simd16scalar _simd16_cmp_ps(simd16scalar a, simd16scalar b)
 {
-    simd16mask k = _mm512_cmpeq_ps_mask(a, b);
+    simd16mask k = _mm512_cmp_ps_mask(a, b, comp);
 
-    return _mm512_castsi256_ps(_mm512_mask_blend_epi32(k, _mm512_setzero_epi32(), _mm512_set1_epi32(0xFFFFFFFF)));
+    return _mm512_castsi512_ps(_simd16_mask2scalari(k));
 }
 
-#define _simd16_cmp_ps(a, b, comp)  _simd16_cmp_ps_temp<comp>(a, b)
-
 #define _simd16_cmplt_ps(a, b)      _simd16_cmp_ps<_CMP_LT_OQ>(a, b)
 #define _simd16_cmpgt_ps(a, b)      _simd16_cmp_ps<_CMP_GT_OQ>(a, b)
 #define _simd16_cmpneq_ps(a, b)     _simd16_cmp_ps<_CMP_NEQ_OQ>(a, b)
@@ -729,7 +759,24 @@ INLINE simd16scalar _simd16_cmp_ps_temp(simd16scalar a, simd16scalar b)
 #define _simd16_castpd_ps           _mm512_castpd_ps
 #define _simd16_castps_pd           _mm512_castps_pd
 
-#define _simd16_andnot_ps           _mm512_andnot_ps
+// AVX512F has no floating point logic ops, go through the integer domain
+INLINE simd16scalar _simd16_and_ps(simd16scalar a, simd16scalar b)
+{
+    return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+INLINE simd16scalar _simd16_or_ps(simd16scalar a, simd16scalar b)
+{
+    return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+INLINE simd16scalar _simd16_andnot_ps(simd16scalar a, simd16scalar b)
+{
+    return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+#define _simd16_rcp_ps          _mm512_rcp14_ps
+#define _simd16_div_ps          _mm512_div_ps
 
 template <int mode>
 INLINE simd16scalar _simd16_round_ps_temp(simd16scalar a)
@@ -755,36 +802,24 @@ INLINE simd16scalar _simd16_round_ps_temp(simd16scalar a)
 
 INLINE simd16scalari _simd16_cmpeq_epi32(simd16scalari a, simd16scalari b)
 {
-    simd16mask k = _mm512_cmpeq_epi32_mask(a, b);
-
-    return _mm512_mask_blend_epi32(k, _mm512_setzero_epi32(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _simd16_mask2scalari(_mm512_cmpeq_epi32_mask(a, b));
 }
 
 INLINE simd16scalari _simd16_cmpgt_epi32(simd16scalari a, simd16scalari b)
 {
-    simd16mask k = _mm512_cmpgt_epi32_mask(a, b);
-
-    return _mm512_mask_blend_epi32(k, _mm512_setzero_epi32(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _simd16_mask2scalari(_mm512_cmpgt_epi32_mask(a, b));
 }
 
 INLINE simd16scalari _simd16_cmplt_epi32(simd16scalari a, simd16scalari b)
 {
-    simd16mask k = _mm512_cmplt_epi32_mask(a, b);
-
-    return _mm512_mask_blend_epi32(k, _mm512_setzero_epi32(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _simd16_mask2scalari(_mm512_cmplt_epi32_mask(a, b));
 }
 
-#if 0
 INLINE int _simd16_testz_ps(simd16scalar a, simd16scalar b)
 {
-    int lo = _mm256_testz_ps(a.lo, b.lo);
-    int hi = _mm256_testz_ps(a.hi, b.hi);
-
-    return lo & hi;
+    return _mm512_test_epi32_mask(_mm512_castps_si512(a), _mm512_castps_si512(b)) == 0;
 }
 
-#endif
-
 #define _simd16_unpacklo_epi32    _mm512_unpacklo_epi32
 #define _simd16_unpackhi_epi32    _mm512_unpackhi_epi32
 #define _simd16_slli_epi32        _mm512_slli_epi32
@@ -800,88 +835,60 @@ INLINE int _simd16_testz_ps(simd16scalar a, simd16scalar b)
 #define _simd16_i32gather_ps(m, index, scale) _mm512_i32gather_ps(index, m, scale)
 
 #define _simd16_abs_epi32         _mm512_abs_epi32
-#define _simd16_cmpeq_epi64       _mm512_abs_epi32
 
 INLINE simd16scalari _simd16_cmpeq_epi64(simd16scalari a, simd16scalari b)
 {
-    __mmask8 k = _mm512_cmpeq_epi64_mask(a, b);
-
-    return _mm512_mask_blend_epi64(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_maskz_set1_epi64(_mm512_cmpeq_epi64_mask(a, b), -1LL);
 }
 
 INLINE simd16scalari _simd16_cmpgt_epi64(simd16scalari a, simd16scalari b)
 {
-    __mmask8 k = _mm512_cmpgt_epi64_mask(a, b);
-
-    return _mm512_mask_blend_epi64(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_maskz_set1_epi64(_mm512_cmpgt_epi64_mask(a, b), -1LL);
 }
 
 INLINE simd16scalari _simd16_cmpeq_epi16(simd16scalari a, simd16scalari b)
 {
-    __mmask32 k = _mm512_cmpeq_epi16_mask(a, b);
-
-    return _mm512_mask_blend_epi16(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a, b));
 }
 
 INLINE simd16scalari _simd16_cmpgt_epi16(simd16scalari a, simd16scalari b)
 {
-    __mmask32 k = _mm512_cmpgt_epi16_mask(a, b);
-
-    return _mm512_mask_blend_epi16(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(a, b));
 }
 
 INLINE simd16scalari _simd16_cmpeq_epi8(simd16scalari a, simd16scalari b)
 {
-    __mmask64 k = _mm512_cmpeq_epi8_mask(a, b);
-
-    return _mm512_mask_blend_epi8(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b));
 }
 
 INLINE simd16scalari _simd16_cmpgt_epi8(simd16scalari a, simd16scalari b)
 {
-    __mmask64 k = _mm512_cmpgt_epi8_mask(a, b);
-
-    return _mm512_mask_blend_epi8(k, _mm512_setzero_si512(), _mm512_set1_epi32(0xFFFFFFFF));
+    return _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(a, b));
 }
 
-#if 0
+#define _simd16_sllv_epi32        _mm512_sllv_epi32
+#define _simd16_srlv_epi32        _mm512_srlv_epi32
+#define _simd16_shuffle_ps        _mm512_shuffle_ps
+
 INLINE simd16scalar _simd16_permute_ps(simd16scalar a, simd16scalari b)
 {
-    simd16scalar result;
-
-    result.lo = _mm256_permutevar8x32_ps(a.lo, b.lo);
-    result.hi = _mm256_permutevar8x32_ps(a.hi, b.hi);
-
-    return result;
+    return _mm512_permutexvar_ps(b, a);
 }
 
-INLINE (simd16scalari _simd16_permute_epi32(simd16scalari a, simd16scalari b)
+INLINE simd16scalari _simd16_permute_epi32(simd16scalari a, simd16scalari b)
 {
-    simd16scalar result;
-
-    result.lo = _mm256_permutevar8x32_epi32(a.lo, b.lo);
-    result.hi = _mm256_permutevar8x32_epi32(a.hi, b.hi);
-
-    return result;
+    return _mm512_permutexvar_epi32(b, a);
 }
 
-#endif
-
-#define _simd16_sllv_epi32        _mm512_srlv_epi32
-#define _simd16_srlv_epi32        _mm512_sllv_epi32
-#define _simd16_shuffle_ps        _mm512_shuffle_ps
-#define _simd16_permute_128       _mm512_permute4f128_epi32
+#define _simd16_extract_ps(a, imm8)     _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), imm8))
+#define _simd16_extract_si(a, imm8)     _mm512_extracti64x4_epi64(a, imm8)
+#define _simd16_insert_ps(a, b, imm8)   _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(a), _mm256_castps_pd(b), imm8))
+#define _simd16_insert_si(a, b, imm8)   _mm512_inserti64x4(a, b, imm8)
 
 // convert bitmask to vector mask
 INLINE simd16scalar vMask16(int32_t mask)
 {
-    simd16scalari temp = _simd16_set1_epi32(mask);
-
-    simd16scalari bits = _simd16_set_epi32(0x8000, 0x4000, 0x2000, 0x1000, 0x0800, 0x0400, 0x0200, 0x0100, 0x0080, 0x0040, 0x0020, 0x0010, 0x0008, 0x0004, 0x0002, 0x0001);
-
-    simd16scalari result = _simd16_cmplt_epi32(_simd16_setzero_si(), _simd16_and_si(temp, bits));
-
-    return _simd16_castsi_ps(result);
+    return _mm512_castsi512_ps(_simd16_mask2scalari((simd16mask)mask));
 }
 
 #endif//ENABLE_AVX512_EMULATION
@@ -94,6 +94,16 @@ HANDLE SwrCreateContext(
     pContext->threadInfo.MAX_THREADS_PER_CORE      = KNOB_MAX_THREADS_PER_CORE;
     pContext->threadInfo.SINGLE_THREADED           = KNOB_SINGLE_THREADED;
 
+    if (!KNOB_AR_TRACE_FILE.empty())
+    {
+        const char* bucketNames[NumBuckets];
+        for (uint32_t i = 0; i < NumBuckets; ++i)
+        {
+            bucketNames[i] = gCoreBuckets[i].name.c_str();
+        }
+        ArchRast::TraceOpen(KNOB_AR_TRACE_FILE.c_str(), bucketNames, NumBuckets);
+    }
+
     if (pCreateInfo->pThreadInfo)
     {
         pContext->threadInfo = *pCreateInfo->pThreadInfo;
@@ -164,6 +174,11 @@ void SwrDestroyContext(HANDLE hContext)
     SWR_CONTEXT *pContext = GetContext(hContext);
     DestroyThreadPool(pContext, &pContext->threadPool);
 
+    if (!KNOB_AR_TRACE_FILE.empty())
+    {
+        ArchRast::TraceClose();
+    }
+
     // free the fifos
     for (uint32_t i = 0; i < KNOB_MAX_DRAWS_IN_FLIGHT; ++i)
     {
@@ -364,6 +379,7 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
 
         // Assign unique drawId for this DC
         pCurDrawContext->drawId = pContext->dcRing.GetHead();
+        AR_TRACE_DRAW(pCurDrawContext->drawId);
 
         pCurDrawContext->cleanupState = true;
     }
@@ -883,6 +899,25 @@ void SetupPipeline(DRAW_CONTEXT *pDC)
         pState->pfnProcessPrims = nullptr;
     }
 
+#if ENABLE_AVX512_SIMD16
+    // 16-wide clip/bin is only implemented for standard rasterization of triangles,
+    // everything else is handed to pfnProcessPrims 8 prims at a time
+    pState->pfnProcessPrims_simd16 = nullptr;
+    if ((pState->pfnProcessPrims != nullptr) &&
+        (rastState.conservativeRast == 0) &&
+        (pfnBinner != BinPoints) && (pfnBinner != BinLines))
+    {
+        if (pState->state.frontendState.vpTransformDisable)
+        {
+            pState->pfnProcessPrims_simd16 = BinTriangles_simd16;
+        }
+        else
+        {
+            pState->pfnProcessPrims_simd16 = ClipTriangles_simd16;
+        }
+    }
+#endif
+
     // set up the frontend attribute count
     pState->state.feNumAttributes = 0;
     const SWR_BACKEND_STATE& backendState = pState->state.backendState;
@@ -1118,7 +1153,8 @@ void DrawInstanced(
             pState->tsState.tsEnable,
             pState->gsState.gsEnable,
             pState->soState.soEnable,
-            pDC->pState->pfnProcessPrims != nullptr);
+            pDC->pState->pfnProcessPrims != nullptr,
+            pState->topology);
         pDC->FeWork.desc.draw.numVerts = numVertsForDraw;
         pDC->FeWork.desc.draw.startVertex = startVertex;
         pDC->FeWork.desc.draw.numInstances = numInstances;
@@ -1255,7 +1291,8 @@ void DrawIndexedInstance(
             pState->tsState.tsEnable,
             pState->gsState.gsEnable,
             pState->soState.soEnable,
-            pDC->pState->pfnProcessPrims != nullptr);
+            pDC->pState->pfnProcessPrims != nullptr,
+            pState->topology);
         pDC->FeWork.desc.draw.pDC = pDC;
         pDC->FeWork.desc.draw.numIndices = numIndicesForDraw;
         pDC->FeWork.desc.draw.pIB = (int*)pIB;
@@ -1568,5 +1605,16 @@ void SWR_API SwrEndFrame(
 {
     RDTSC_ENDFRAME();
     SWR_CONTEXT *pContext = GetContext(hContext);
+
+    AR_TRACE_FRAME(pContext->frameCount);
+
+#if defined(KNOB_ENABLE_AR)
+    ArenaAllocatorStats arenaStats;
+    pContext->cachingArenaAllocator.GetFrameStats(arenaStats);
+    AR_EVENT(pContext->pArContext[pContext->NumWorkerThreads],
+             FrameArenaStats(pContext->frameCount, arenaStats.bytesAllocated, arenaStats.bytesReused,
+                             arenaStats.peakAllocated, arenaStats.peakArenaSize));
+#endif
+
     pContext->frameCount++;
 }
@@ -67,6 +67,25 @@ public:
             AlignedFree(pMem);
         }
     }
+
+    // Called by TArena on reset with the number of bytes it held.
+    void RecordArenaSize(size_t size) {}
+};
+
+// Per-frame usage statistics of a CachingAllocator.
+struct ArenaAllocatorStats
+{
+    uint64_t bytesAllocated;    // bytes of new blocks requested from the OS
+    uint64_t bytesReused;       // bytes of blocks handed back out of the caches
+    uint64_t peakAllocated;     // peak bytes owned by the allocator
+    uint64_t peakArenaSize;     // largest arena seen at reset
+};
+
+// Thread local binding of a thread to its cache in one allocator.
+struct ArenaThreadCacheSlot
+{
+    uint64_t    ownerId;
+    void*       pCache;
 };
 
 // Caching Allocator for Arena
@@ -80,6 +99,38 @@ struct CachingAllocatorT : DefaultAllocator
 
         uint32_t bucket = GetBucketId(size);
 
+        if (IsUniformBucket(bucket))
+        {
+            // Make all blocks in this bucket the same size
+            size = GetBucketBlockSize(bucket);
+
+            if (align <= ARENA_BLOCK_ALIGN)
+            {
+                // Fast path: serve from this thread's cache, refilling it
+                // from the shared lists a batch at a time.
+                ThreadCache* pCache = GetThreadCache();
+                if (pCache->numBlocks[bucket] == 0)
+                {
+                    RefillThreadCache(pCache, bucket);
+                }
+
+                ArenaBlock* pBlock = pCache->blocks[bucket].pNext;
+                if (pBlock)
+                {
+                    pCache->blocks[bucket].pNext = pBlock->pNext;
+                    pCache->numBlocks[bucket]--;
+                    pBlock->pNext = nullptr;
+
+                    pCache->AddStat(pCache->bytesReused, pBlock->blockSize);
+                    return pBlock;
+                }
+
+                // RefillThreadCache has already accounted for the new block.
+                pCache->AddStat(pCache->bytesAllocated, size);
+                return this->DefaultAllocator::AllocateAligned(size, align);
+            }
+        }
+
         {
             // search cached blocks
             std::lock_guard<std::mutex> l(m_mutex);
@@ -115,10 +166,12 @@ struct CachingAllocatorT : DefaultAllocator
                 pPrevBlock->pNext = pBlock->pNext;
                 pBlock->pNext = nullptr;
 
+                m_bytesReused += pBlock->blockSize;
                 return pBlock;
             }
 
-            m_totalAllocated += size;
+            AddAllocated(size);
+            m_bytesAllocated += size;
 
 #if 0
             {
@@ -130,12 +183,6 @@ struct CachingAllocatorT : DefaultAllocator
 #endif
         }
 
-        if (bucket && bucket < (CACHE_NUM_BUCKETS - 1))
-        {
-            // Make all blocks in this bucket the same size
-            size = size_t(1) << (bucket + 1 + CACHE_START_BUCKET_BIT);
-        }
-
         return this->DefaultAllocator::AllocateAligned(size, align);
     }
 
@@ -143,9 +190,58 @@ struct CachingAllocatorT : DefaultAllocator
     {
         if (pMem)
         {
+            uint32_t bucket = GetBucketId(pMem->blockSize);
+
+            if (IsUniformBucket(bucket))
+            {
+                ThreadCache* pCache = GetThreadCache();
+                pMem->pNext = pCache->blocks[bucket].pNext;
+                pCache->blocks[bucket].pNext = pMem;
+
+                if (++pCache->numBlocks[bucket] > GetThreadCacheMaxBlocks(bucket))
+                {
+                    FlushThreadCache(pCache, bucket, GetThreadCacheBatch(bucket));
+                }
+                return;
+            }
+
             std::unique_lock<std::mutex> l(m_mutex);
-            InsertCachedBlock(GetBucketId(pMem->blockSize), pMem);
+            InsertCachedBlock(bucket, pMem);
+        }
+    }
+
+    void RecordArenaSize(size_t size)
+    {
+        uint64_t peak = m_peakArenaSize.load(std::memory_order_relaxed);
+        while (size > peak &&
+               !m_peakArenaSize.compare_exchange_weak(peak, size, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Returns the statistics gathered since the last call and starts a new
+    // collection period.  Called once per frame.
+    void GetFrameStats(ArenaAllocatorStats& stats)
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+
+        // Counters only ever grow; report the difference to the last call.
+        uint64_t bytesAllocated = m_bytesAllocated;
+        uint64_t bytesReused = m_bytesReused;
+        for (ThreadCache* pCache = m_pThreadCaches; pCache; pCache = pCache->pNextCache)
+        {
+            bytesAllocated += pCache->bytesAllocated.load(std::memory_order_relaxed);
+            bytesReused += pCache->bytesReused.load(std::memory_order_relaxed);
         }
+
+        stats.bytesAllocated = bytesAllocated - m_reportedBytesAllocated;
+        stats.bytesReused = bytesReused - m_reportedBytesReused;
+        stats.peakAllocated = m_peakAllocated;
+        stats.peakArenaSize = m_peakArenaSize.exchange(0, std::memory_order_relaxed);
+
+        m_reportedBytesAllocated = bytesAllocated;
+        m_reportedBytesReused = bytesReused;
+        m_peakAllocated = m_totalAllocated;
     }
 
     void FreeOldBlocks()
@@ -213,6 +309,9 @@ struct CachingAllocatorT : DefaultAllocator
 
     CachingAllocatorT()
     {
+        static std::atomic<uint64_t> s_nextId(1);
+        m_id = s_nextId.fetch_add(1);
+
         for (uint32_t i = 0; i < CACHE_NUM_BUCKETS; ++i)
         {
             m_pLastCachedBlocks[i] = &m_cachedBlocks[i];
@@ -222,6 +321,25 @@ struct CachingAllocatorT : DefaultAllocator
 
     ~CachingAllocatorT()
     {
+        // Free all thread caches and the blocks they still hold
+        ThreadCache* pCache = m_pThreadCaches;
+        while (pCache)
+        {
+            ThreadCache* pNextCache = pCache->pNextCache;
+            for (uint32_t i = 0; i < CACHE_NUM_BUCKETS; ++i)
+            {
+                ArenaBlock* pBlock = pCache->blocks[i].pNext;
+                while (pBlock)
+                {
+                    ArenaBlock* pNext = pBlock->pNext;
+                    this->DefaultAllocator::Free(pBlock);
+                    pBlock = pNext;
+                }
+            }
+            delete pCache;
+            pCache = pNextCache;
+        }
+
         // Free all cached blocks
         for (uint32_t i = 0; i < CACHE_NUM_BUCKETS; ++i)
         {
@@ -243,6 +361,141 @@ struct CachingAllocatorT : DefaultAllocator
     }
 
 private:
+    // Blocks owned by one thread.  Only the middle buckets, whose blocks
+    // all have the same size, are cached per thread.
+    struct ThreadCache
+    {
+        ArenaBlock      blocks[NumBucketsT];
+        uint32_t        numBlocks[NumBucketsT] = {};
+        const void*     pOwner = nullptr;
+        ThreadCache*    pNextCache = nullptr;
+
+        // Only written by the owning thread, read by GetFrameStats.
+        std::atomic<uint64_t> bytesAllocated{ 0 };
+        std::atomic<uint64_t> bytesReused{ 0 };
+
+        static void AddStat(std::atomic<uint64_t>& stat, uint64_t value)
+        {
+            stat.store(stat.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+
+    static bool IsUniformBucket(uint32_t bucketId)
+    {
+        return bucketId && bucketId < (CACHE_NUM_BUCKETS - 1);
+    }
+
+    static size_t GetBucketBlockSize(uint32_t bucketId)
+    {
+        return size_t(1) << (bucketId + 1 + CACHE_START_BUCKET_BIT);
+    }
+
+    // Number of blocks moved between a thread cache and the shared lists
+    // at once.
+    static uint32_t GetThreadCacheBatch(uint32_t bucketId)
+    {
+        return std::max<uint32_t>(1, uint32_t((THREAD_CACHE_MAX_SIZE / 2) / GetBucketBlockSize(bucketId)));
+    }
+
+    static uint32_t GetThreadCacheMaxBlocks(uint32_t bucketId)
+    {
+        return 2 * GetThreadCacheBatch(bucketId);
+    }
+
+    ThreadCache* GetThreadCache()
+    {
+        ArenaThreadCacheSlot& slot = t_threadCacheSlot;
+        if (slot.ownerId != m_id)
+        {
+            slot.pCache = FindThreadCache(&slot);
+            slot.ownerId = m_id;
+        }
+        return static_cast<ThreadCache*>(slot.pCache);
+    }
+
+    // The slot address identifies the calling thread.  A thread that
+    // alternates between contexts finds its old cache again instead of
+    // creating a new one each time.
+    ThreadCache* FindThreadCache(const void* pOwner)
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+
+        for (ThreadCache* pCache = m_pThreadCaches; pCache; pCache = pCache->pNextCache)
+        {
+            if (pCache->pOwner == pOwner)
+            {
+                return pCache;
+            }
+        }
+
+        ThreadCache* pCache = new ThreadCache();
+        pCache->pOwner = pOwner;
+        pCache->pNextCache = m_pThreadCaches;
+        m_pThreadCaches = pCache;
+        return pCache;
+    }
+
+    // Moves up to a batch of blocks from the shared lists to the thread
+    // cache.  If there are none, accounts for a new block of the bucket
+    // size which the caller allocates outside the lock.
+    void RefillThreadCache(ThreadCache* pCache, uint32_t bucketId)
+    {
+        uint32_t batch = GetThreadCacheBatch(bucketId);
+
+        std::lock_guard<std::mutex> l(m_mutex);
+
+        ArenaBlock* pCachedBlocks[] = { &m_cachedBlocks[bucketId], &m_oldCachedBlocks[bucketId] };
+        ArenaBlock** ppLastCachedBlocks[] = { &m_pLastCachedBlocks[bucketId], &m_pOldLastCachedBlocks[bucketId] };
+        size_t* pCachedSizes[] = { &m_cachedSize, &m_oldCachedSize };
+
+        for (uint32_t list = 0; list < 2 && pCache->numBlocks[bucketId] < batch; ++list)
+        {
+            ArenaBlock* pHead = pCachedBlocks[list];
+            while (pHead->pNext && pCache->numBlocks[bucketId] < batch)
+            {
+                ArenaBlock* pBlock = pHead->pNext;
+                pHead->pNext = pBlock->pNext;
+                if (*ppLastCachedBlocks[list] == pBlock)
+                {
+                    *ppLastCachedBlocks[list] = pHead;
+                }
+                *pCachedSizes[list] -= pBlock->blockSize;
+
+                pBlock->pNext = pCache->blocks[bucketId].pNext;
+                pCache->blocks[bucketId].pNext = pBlock;
+                pCache->numBlocks[bucketId]++;
+            }
+        }
+
+        if (pCache->numBlocks[bucketId] == 0)
+        {
+            AddAllocated(GetBucketBlockSize(bucketId));
+        }
+    }
+
+    // Returns numBlocks blocks from the thread cache to the shared lists.
+    void FlushThreadCache(ThreadCache* pCache, uint32_t bucketId, uint32_t numBlocks)
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+
+        while (numBlocks-- && pCache->blocks[bucketId].pNext)
+        {
+            ArenaBlock* pBlock = pCache->blocks[bucketId].pNext;
+            pCache->blocks[bucketId].pNext = pBlock->pNext;
+            pCache->numBlocks[bucketId]--;
+
+            pBlock->pNext = nullptr;
+            InsertCachedBlock(bucketId, pBlock);
+        }
+    }
+
+    // Must be called with m_mutex held.
+    void AddAllocated(size_t size)
+    {
+        m_totalAllocated += size;
+        m_peakAllocated = std::max(m_peakAllocated, m_totalAllocated);
+    }
+
     static uint32_t GetBucketId(size_t blockSize)
     {
         uint32_t bucketId = 0;
@@ -350,6 +603,7 @@ private:
     static const uint32_t   CACHE_NUM_BUCKETS       = NumBucketsT;
     static const uint32_t   CACHE_START_BUCKET_BIT  = StartBucketBitT;
     static const size_t     MAX_UNUSED_SIZE         = sizeof(MEGABYTE);
+    static const size_t     THREAD_CACHE_MAX_SIZE   = sizeof(MEGABYTE);
 
     ArenaBlock              m_cachedBlocks[CACHE_NUM_BUCKETS];
     ArenaBlock*             m_pLastCachedBlocks[CACHE_NUM_BUCKETS];
@@ -361,7 +615,23 @@ private:
 
     size_t                  m_cachedSize = 0;
     size_t                  m_oldCachedSize = 0;
+
+    uint64_t                m_id = 0;
+    ThreadCache*            m_pThreadCaches = nullptr;
+    static THREAD ArenaThreadCacheSlot t_threadCacheSlot;
+
+    // Statistics, protected by m_mutex unless atomic
+    size_t                  m_peakAllocated = 0;
+    uint64_t                m_bytesAllocated = 0;
+    uint64_t                m_bytesReused = 0;
+    uint64_t                m_reportedBytesAllocated = 0;
+    uint64_t                m_reportedBytesReused = 0;
+    std::atomic<uint64_t>   m_peakArenaSize{ 0 };
 };
+
+template<uint32_t NumBucketsT, uint32_t StartBucketBitT>
+THREAD ArenaThreadCacheSlot CachingAllocatorT<NumBucketsT, StartBucketBitT>::t_threadCacheSlot = { 0, nullptr };
+
 typedef CachingAllocatorT<> CachingAllocator;
 
 template<typename T = DefaultAllocator, size_t BlockSizeT = 128 * sizeof(KILOBYTE)>
@@ -412,6 +682,7 @@ public:
         if (pNewBlock != nullptr)
         {
             m_offset = ARENA_BLOCK_ALIGN;
+            m_size += pNewBlock->blockSize;
             pNewBlock->pNext = m_pCurBlock;
 
             m_pCurBlock = pNewBlock;
@@ -453,6 +724,9 @@ public:
 
         if (m_pCurBlock)
         {
+            m_allocator.RecordArenaSize(m_size);
+            m_size = removeAll ? 0 : m_pCurBlock->blockSize;
+
             ArenaBlock *pUsedBlocks = m_pCurBlock->pNext;
             m_pCurBlock->pNext = nullptr;
             while (pUsedBlocks)
@@ -480,6 +754,7 @@ private:
 
     ArenaBlock*         m_pCurBlock = nullptr;
     size_t              m_offset    = ARENA_BLOCK_ALIGN;
+    size_t              m_size      = 0;    // bytes in all blocks
 
     /// @note Mutex is only used by sync allocation functions.
     std::mutex          m_mutex;
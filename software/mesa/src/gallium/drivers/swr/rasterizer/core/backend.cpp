@@ -276,9 +276,7 @@ void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile
     STORE_TILES_DESC *pDesc = (STORE_TILES_DESC*)pData;
     SWR_CONTEXT *pContext = pDC->pContext;
 
-#ifdef KNOB_ENABLE_RDTSC
     uint32_t numTiles = 0;
-#endif
     SWR_FORMAT srcFormat;
     switch (pDesc->attachment)
     {
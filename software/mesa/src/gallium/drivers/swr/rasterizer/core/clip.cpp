@@ -184,21 +184,31 @@ void ClipTriangles(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvecto
     RDTSC_START(FEClipTriangles);
     Clipper<3> clipper(workerId, pDC);
     clipper.ExecuteStage(pa, prims, primMask, primId, viewportIdx);
-    RDTSC_STOP(FEClipTriangles, 1, 0);
+    RDTSC_STOP(FEClipTriangles, _mm_popcnt_u32(primMask), 0);
 }
 
+#if ENABLE_AVX512_SIMD16
+void ClipTriangles_simd16(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simd16vector prims[], uint32_t primMask, simd16scalari primId)
+{
+    RDTSC_START(FEClipTriangles);
+    Clipper<3> clipper(workerId, pDC);
+    clipper.ExecuteStage_simd16(pa, prims, primMask, primId);
+    RDTSC_STOP(FEClipTriangles, _mm_popcnt_u32(primMask), 0);
+}
+#endif
+
 void ClipLines(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], uint32_t primMask, simdscalari primId, simdscalari viewportIdx)
 {
     RDTSC_START(FEClipLines);
     Clipper<2> clipper(workerId, pDC);
     clipper.ExecuteStage(pa, prims, primMask, primId, viewportIdx);
-    RDTSC_STOP(FEClipLines, 1, 0);
+    RDTSC_STOP(FEClipLines, _mm_popcnt_u32(primMask), 0);
 }
 void ClipPoints(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], uint32_t primMask, simdscalari primId, simdscalari viewportIdx)
 {
     RDTSC_START(FEClipPoints);
     Clipper<1> clipper(workerId, pDC);
     clipper.ExecuteStage(pa, prims, primMask, primId, viewportIdx);
-    RDTSC_STOP(FEClipPoints, 1, 0);
+    RDTSC_STOP(FEClipPoints, _mm_popcnt_u32(primMask), 0);
 }
 
@@ -130,6 +130,78 @@ void ComputeClipCodes(DRIVER_TYPE type, const API_STATE& state, const simdvector
     clipCodes = _simd_or_ps(clipCodes, _simd_and_ps(vRes, _simd_castsi_ps(_simd_set1_epi32(GUARDBAND_BOTTOM))));
 }
 
+#if ENABLE_AVX512_SIMD16
+INLINE
+void ComputeClipCodes_simd16(DRIVER_TYPE type, const API_STATE& state, const simd16vector& vertex, simd16scalar& clipCodes)
+{
+    clipCodes = _simd16_setzero_ps();
+
+    // -w
+    simd16scalar vNegW = _simd16_mul_ps(vertex.w, _simd16_set1_ps(-1.0f));
+
+    // FRUSTUM_LEFT
+    simd16scalar vRes = _simd16_cmplt_ps(vertex.x, vNegW);
+    clipCodes = _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_LEFT)));
+
+    // FRUSTUM_TOP
+    vRes = _simd16_cmplt_ps(vertex.y, vNegW);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_TOP))));
+
+    // FRUSTUM_RIGHT
+    vRes = _simd16_cmpgt_ps(vertex.x, vertex.w);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_RIGHT))));
+
+    // FRUSTUM_BOTTOM
+    vRes = _simd16_cmpgt_ps(vertex.y, vertex.w);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_BOTTOM))));
+
+    if (state.rastState.depthClipEnable)
+    {
+        // FRUSTUM_NEAR
+        // DX clips depth [0..w], GL clips [-w..w]
+        if (type == DX)
+        {
+            vRes = _simd16_cmplt_ps(vertex.z, _simd16_setzero_ps());
+        }
+        else
+        {
+            vRes = _simd16_cmplt_ps(vertex.z, vNegW);
+        }
+        clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_NEAR))));
+
+        // FRUSTUM_FAR
+        vRes = _simd16_cmpgt_ps(vertex.z, vertex.w);
+        clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(FRUSTUM_FAR))));
+    }
+
+    // NEGW
+    vRes = _simd16_cmple_ps(vertex.w, _simd16_setzero_ps());
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(NEGW))));
+
+    // guardband of viewport 0, the 16-wide path never sees a viewport array index
+
+    // GUARDBAND_LEFT
+    simd16scalar gbMult = _simd16_mul_ps(vNegW, _simd16_set1_ps(state.gbState.left[0]));
+    vRes = _simd16_cmplt_ps(vertex.x, gbMult);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(GUARDBAND_LEFT))));
+
+    // GUARDBAND_TOP
+    gbMult = _simd16_mul_ps(vNegW, _simd16_set1_ps(state.gbState.top[0]));
+    vRes = _simd16_cmplt_ps(vertex.y, gbMult);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(GUARDBAND_TOP))));
+
+    // GUARDBAND_RIGHT
+    gbMult = _simd16_mul_ps(vertex.w, _simd16_set1_ps(state.gbState.right[0]));
+    vRes = _simd16_cmpgt_ps(vertex.x, gbMult);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(GUARDBAND_RIGHT))));
+
+    // GUARDBAND_BOTTOM
+    gbMult = _simd16_mul_ps(vertex.w, _simd16_set1_ps(state.gbState.bottom[0]));
+    vRes = _simd16_cmpgt_ps(vertex.y, gbMult);
+    clipCodes = _simd16_or_ps(clipCodes, _simd16_and_ps(vRes, _simd16_castsi_ps(_simd16_set1_epi32(GUARDBAND_BOTTOM))));
+}
+#endif
+
 template<uint32_t NumVertsPerPrim>
 class Clipper
 {
@@ -262,45 +334,6 @@ public:
         return _simd_movemask_ps(vClipCullMask);
     }
 
-    // clip a single primitive
-    int ClipScalar(PA_STATE& pa, uint32_t primIndex, float* pOutPos, float* pOutAttribs)
-    {
-        OSALIGNSIMD(float) inVerts[3 * 4];
-        OSALIGNSIMD(float) inAttribs[3 * KNOB_NUM_ATTRIBUTES * 4];
-
-        // transpose primitive position
-        __m128 verts[3];
-        pa.AssembleSingle(VERTEX_POSITION_SLOT, primIndex, verts);
-        _mm_store_ps(&inVerts[0], verts[0]);
-        _mm_store_ps(&inVerts[4], verts[1]);
-        _mm_store_ps(&inVerts[8], verts[2]);
-
-        // transpose attribs
-        uint32_t numScalarAttribs = this->state.linkageCount * 4;
-
-        int idx = 0;
-        DWORD slot = 0;
-        uint32_t mapIdx = 0;
-        uint32_t tmpLinkage = uint32_t(this->state.linkageMask);
-        while (_BitScanForward(&slot, tmpLinkage))
-        {
-            tmpLinkage &= ~(1 << slot);
-            // Compute absolute attrib slot in vertex array
-            uint32_t inputSlot = VERTEX_ATTRIB_START_SLOT + this->state.linkageMap[mapIdx++];
-            __m128 attrib[3];    // triangle attribs (always 4 wide)
-            pa.AssembleSingle(inputSlot, primIndex, attrib);
-            _mm_store_ps(&inAttribs[idx], attrib[0]);
-            _mm_store_ps(&inAttribs[idx + numScalarAttribs], attrib[1]);
-            _mm_store_ps(&inAttribs[idx + numScalarAttribs * 2], attrib[2]);
-            idx += 4;
-        }
-
-        int numVerts;
-        Clip(inVerts, inAttribs, numScalarAttribs, pOutPos, &numVerts, pOutAttribs);
-
-        return numVerts;
-    }
-
     // clip SIMD primitives
     void ClipSimd(const simdscalar& vPrimMask, const simdscalar& vClipMask, PA_STATE& pa, const simdscalari& vPrimId, const simdscalari& vViewportIdx)
     {
@@ -564,6 +597,79 @@ public:
         }
     }
 
+#if ENABLE_AVX512_SIMD16
+    // execute the clipper stage on 16 triangles; falls back to the 8-wide
+    // stage for each half when any prim needs guardband clipping or user culling
+    void ExecuteStage_simd16(PA_STATE& pa, simd16vector prim[], uint32_t primMask, simd16scalari primId)
+    {
+        static_assert(NumVertsPerPrim == 3, "16-wide clipper only handles triangles");
+
+        simd16scalar vClipCodes[NumVertsPerPrim];
+        for (uint32_t i = 0; i < NumVertsPerPrim; ++i)
+        {
+            ComputeClipCodes_simd16(this->driverType, this->state, prim[i], vClipCodes[i]);
+        }
+
+        simd16scalar clipUnion = vClipCodes[0];
+        simd16scalar clipIntersection = vClipCodes[0];
+        simd16scalar vNanMask = _simd16_setzero_ps();
+        for (uint32_t i = 0; i < NumVertsPerPrim; ++i)
+        {
+            if (i > 0)
+            {
+                clipUnion = _simd16_or_ps(clipUnion, vClipCodes[i]);
+                clipIntersection = _simd16_and_ps(clipIntersection, vClipCodes[i]);
+            }
+
+            vNanMask = _simd16_or_ps(vNanMask, _simd16_cmp_ps<_CMP_UNORD_Q>(prim[i].v[0], prim[i].v[1]));
+            vNanMask = _simd16_or_ps(vNanMask, _simd16_cmp_ps<_CMP_UNORD_Q>(prim[i].v[2], prim[i].v[3]));
+        }
+
+        clipUnion = _simd16_and_ps(clipUnion, _simd16_castsi_ps(_simd16_set1_epi32(GUARDBAND_CLIP_MASK)));
+        uint32_t clipMask = primMask & _simd16_movemask_ps(_simd16_cmpneq_ps(clipUnion, _simd16_setzero_ps()));
+
+        if (clipMask || this->state.rastState.cullDistanceMask)
+        {
+            simdvector primLo[NumVertsPerPrim], primHi[NumVertsPerPrim];
+            SplitPrims_simd16(prim, NumVertsPerPrim, primLo, primHi);
+
+            uint32_t maskLo = primMask & 0xFF;
+            uint32_t maskHi = primMask >> KNOB_SIMD_WIDTH;
+
+            if (maskLo)
+            {
+                ExecuteStage(pa, primLo, maskLo, _simd16_extract_si(primId, 0), _simd_setzero_si());
+            }
+
+            if (maskHi)
+            {
+                pa.useAlternateOffset = true;
+                ExecuteStage(pa, primHi, maskHi, _simd16_extract_si(primId, 1), _simd_setzero_si());
+                pa.useAlternateOffset = false;
+            }
+            return;
+        }
+
+        // update clipper invocations pipeline stat
+        UPDATE_STAT_FE(CInvocations, _mm_popcnt_u32(primMask));
+
+        // cull prims with NAN coords
+        primMask &= ~_simd16_movemask_ps(vNanMask);
+
+        // cull prims outside view frustum
+        uint32_t validMask = primMask & _simd16_movemask_ps(_simd16_cmpeq_ps(clipIntersection, _simd16_setzero_ps()));
+
+        if (validMask)
+        {
+            // update CPrimitives pipeline state
+            UPDATE_STAT_FE(CPrimitives, _mm_popcnt_u32(validMask));
+
+            // forward valid prims directly to binner
+            BinTriangles_simd16(this->pDC, pa, this->workerId, prim, validMask, primId);
+        }
+    }
+#endif
+
 private:
     inline simdscalar ComputeInterpFactor(simdscalar boundaryCoord0, simdscalar boundaryCoord1)
     {
@@ -947,5 +1053,8 @@ private:
 
 // pipeline stage functions
 void ClipTriangles(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], uint32_t primMask, simdscalari primId, simdscalari viewportIdx);
+#if ENABLE_AVX512_SIMD16
+void ClipTriangles_simd16(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simd16vector prims[], uint32_t primMask, simd16scalari primId);
+#endif
 void ClipLines(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], uint32_t primMask, simdscalari primId, simdscalari viewportIdx);
 void ClipPoints(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], uint32_t primMask, simdscalari primId, simdscalari viewportIdx);
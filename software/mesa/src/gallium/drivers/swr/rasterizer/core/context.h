@@ -223,6 +223,12 @@ struct PA_STATE;
 typedef void(*PFN_PROCESS_PRIMS)(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[], 
     uint32_t primMask, simdscalari primID, simdscalari viewportIdx);
 
+#if ENABLE_AVX512_SIMD16
+// 16-wide variant, only used for draws that always render to viewport 0
+typedef void(*PFN_PROCESS_PRIMS_SIMD16)(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simd16vector prims[],
+    uint32_t primMask, simd16scalari primID);
+#endif
+
 OSALIGNLINE(struct) API_STATE
 {
     // Vertex Buffers
@@ -362,6 +368,9 @@ struct DRAW_STATE
     // pipeline function pointers, filled in by API thread when setting up the draw
     BACKEND_FUNCS backendFuncs;
     PFN_PROCESS_PRIMS pfnProcessPrims;
+#if ENABLE_AVX512_SIMD16
+    PFN_PROCESS_PRIMS_SIMD16 pfnProcessPrims_simd16;
+#endif
 
     CachingArena* pArena;     // This should only be used by API thread.
 };
@@ -1147,7 +1147,7 @@ static void TessellationStages(
                     bool assemble =
 #endif
                         tessPa.Assemble(VERTEX_POSITION_SLOT, prim);
-                    RDTSC_STOP(FEPAAssemble, 1, 0);
+                    RDTSC_STOP(FEPAAssemble, tessPa.NumPrims(), 0);
                     SWR_ASSERT(assemble);
 
                     SWR_ASSERT(pfnClipFunc);
@@ -1260,9 +1260,7 @@ void ProcessDraw(
         fetchInfo.StartVertex = work.startVertex;
     }
 
-#ifdef KNOB_ENABLE_RDTSC
     uint32_t numPrims = GetNumPrims(state.topology, work.numVerts);
-#endif
 
     void* pGsOut = nullptr;
     void* pCutBuffer = nullptr;
@@ -1336,7 +1334,7 @@ void ProcessDraw(
                 // 1. Execute FS/VS for a single SIMD.
                 RDTSC_START(FEFetchShader);
                 state.pfnFetchFunc(fetchInfo, vin);
-                RDTSC_STOP(FEFetchShader, 0, 0);
+                RDTSC_STOP(FEFetchShader, GetNumInvocations(i, endVertex), 0);
 
                 // forward fetch generated vertex IDs to the vertex shader
                 vsContext.VertexID = fetchInfo.VertexID;
@@ -1358,7 +1356,7 @@ void ProcessDraw(
                 {
                     RDTSC_START(FEVertexShader);
                     state.pfnVertexFunc(GetPrivateState(pDC), &vsContext);
-                    RDTSC_STOP(FEVertexShader, 0, 0);
+                    RDTSC_STOP(FEVertexShader, GetNumInvocations(i, endVertex), 0);
 
                     UPDATE_STAT_FE(VsInvocations, GetNumInvocations(i, endVertex));
                 }
@@ -1371,7 +1369,7 @@ void ProcessDraw(
                 // PaAssemble returns false if there is not enough verts to assemble.
                 RDTSC_START(FEPAAssemble);
                 bool assemble = pa.Assemble(VERTEX_POSITION_SLOT, prim);
-                RDTSC_STOP(FEPAAssemble, 1, 0);
+                RDTSC_STOP(FEPAAssemble, assemble ? pa.NumPrims() : 0, 0);
 
 #if KNOB_ENABLE_TOSS_POINTS
                 if (!KNOB_TOSS_FETCH)
@@ -1431,6 +1429,274 @@ void ProcessDraw(
     RDTSC_STOP(FEProcessDraw, numPrims * work.numInstances, pDC->drawId);
 }
 
+#if ENABLE_AVX512_SIMD16
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if the cut-aware PA can assemble the topology, which
+///        is what the SIMD16 frontend uses for all draws.
+static bool IsSimd16FrontendTopology(PRIMITIVE_TOPOLOGY topology)
+{
+    switch (topology)
+    {
+    case TOP_POINT_LIST:
+    case TOP_LINE_LIST:
+    case TOP_LINE_STRIP:
+    case TOP_TRIANGLE_LIST:
+    case TOP_TRIANGLE_STRIP:
+    case TOP_LINE_LIST_ADJ:
+    case TOP_LISTSTRIP_ADJ:
+    case TOP_TRI_LIST_ADJ:
+    case TOP_TRI_STRIP_ADJ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief FE handler for SwrDraw when KNOB_USE_SIMD16_FRONTEND is set.
+///        Runs fetch and VS on 16 vertices per batch (two 8-wide shader
+///        invocations) and assembles 16 prims at a time with the cut-aware
+///        PA.  Only used for draws without tessellation, GS or streamout.
+/// @tparam IsIndexedT - Is indexed drawing enabled
+/// @tparam IsCutIndexEnabledT - Is cut index enabled
+/// @param pContext - pointer to SWR context.
+/// @param pDC - pointer to draw context.
+/// @param workerId - thread's worker id.
+/// @param pUserData - Pointer to DRAW_WORK
+template <
+    typename IsIndexedT,
+    typename IsCutIndexEnabledT>
+void ProcessDrawSimd16(
+    SWR_CONTEXT *pContext,
+    DRAW_CONTEXT *pDC,
+    uint32_t workerId,
+    void *pUserData)
+{
+
+#if KNOB_ENABLE_TOSS_POINTS
+    if (KNOB_TOSS_QUEUE_FE)
+    {
+        return;
+    }
+#endif
+
+    RDTSC_START(FEProcessDraw);
+
+    DRAW_WORK&          work = *(DRAW_WORK*)pUserData;
+    const API_STATE&    state = GetApiState(pDC);
+    __m256i             vScale = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    SWR_VS_CONTEXT      vsContext;
+    simdvertex          vin;
+
+    int indexSize = 0;
+    uint32_t endVertex = work.numVerts;
+
+    const int32_t* pLastRequestedIndex = nullptr;
+    if (IsIndexedT::value)
+    {
+        switch (work.type)
+        {
+        case R32_UINT:
+            indexSize = sizeof(uint32_t);
+            pLastRequestedIndex = &(work.pIB[endVertex]);
+            break;
+        case R16_UINT:
+            indexSize = sizeof(uint16_t);
+            // nasty address offset to last index
+            pLastRequestedIndex = (int32_t*)(&(((uint16_t*)work.pIB)[endVertex]));
+            break;
+        case R8_UINT:
+            indexSize = sizeof(uint8_t);
+            // nasty address offset to last index
+            pLastRequestedIndex = (int32_t*)(&(((uint8_t*)work.pIB)[endVertex]));
+            break;
+        default:
+            SWR_ASSERT(0);
+        }
+    }
+    else
+    {
+        // No cuts, prune partial primitives.
+        endVertex = GetNumVerts(state.topology, GetNumPrims(state.topology, work.numVerts));
+    }
+
+    SWR_FETCH_CONTEXT fetchInfo = { 0 };
+    fetchInfo.pStreams = &state.vertexBuffers[0];
+    fetchInfo.StartInstance = work.startInstance;
+    fetchInfo.StartVertex = 0;
+
+    vsContext.pVin = &vin;
+
+    if (IsIndexedT::value)
+    {
+        fetchInfo.BaseVertex = work.baseVertex;
+
+        // if the entire index buffer isn't being consumed, set the last index
+        // so that fetches < a SIMD wide will be masked off
+        fetchInfo.pLastIndex = (const int32_t*)(((uint8_t*)state.indexBuffer.pIndices) + state.indexBuffer.size);
+        if (pLastRequestedIndex < fetchInfo.pLastIndex)
+        {
+            fetchInfo.pLastIndex = pLastRequestedIndex;
+        }
+    }
+    else
+    {
+        fetchInfo.StartVertex = work.startVertex;
+    }
+
+    uint32_t numPrims = GetNumPrims(state.topology, work.numVerts);
+
+    // the cut-aware PA handles every topology this path is selected for; with
+    // cuts disabled the index store stays zero
+    simdvertex vertexStore[MAX_NUM_VERTS_PER_PRIM];
+    simdmask indexStore[MAX_NUM_VERTS_PER_PRIM];
+    memset(&indexStore, 0, sizeof(indexStore));
+
+    PA_STATE_CUT pa(pDC, (uint8_t*)&vertexStore[0], MAX_NUM_VERTS_PER_PRIM * KNOB_SIMD_WIDTH,
+        &indexStore[0], work.numVerts, state.feNumAttributes, state.topology, false, KNOB_SIMD16_WIDTH);
+
+    /// @todo: temporarily move instance loop in the FE to ensure SO ordering
+    for (uint32_t instanceNum = 0; instanceNum < work.numInstances; instanceNum++)
+    {
+        simdscalari vIndex;
+        uint32_t  i = 0;
+
+        if (IsIndexedT::value)
+        {
+            fetchInfo.pIndices = work.pIB;
+        }
+        else
+        {
+            vIndex = _simd_add_epi32(_simd_set1_epi32(work.startVertexID), vScale);
+            fetchInfo.pIndices = (const int32_t*)&vIndex;
+        }
+
+        fetchInfo.CurInstance = instanceNum;
+        vsContext.InstanceID = instanceNum;
+
+        while (pa.HasWork())
+        {
+            // 1. Execute FS/VS for 16 verts, as two SIMD8 batches.
+            for (uint32_t batch = 0; batch < KNOB_SIMD16_WIDTH / KNOB_SIMD_WIDTH; ++batch)
+            {
+                // PaGetNextVsOutput currently has the side effect of updating some PA state machine state.
+                // So we need to keep this outside of (i < endVertex) check.
+                simdmask* pvCutIndices = nullptr;
+                if (IsIndexedT::value)
+                {
+                    pvCutIndices = &pa.GetNextVsIndices();
+                }
+
+                simdvertex& vout = pa.GetNextVsOutput();
+                vsContext.pVout = &vout;
+
+                if (i < endVertex)
+                {
+                    RDTSC_START(FEFetchShader);
+                    state.pfnFetchFunc(fetchInfo, vin);
+                    RDTSC_STOP(FEFetchShader, GetNumInvocations(i, endVertex), 0);
+
+                    // forward fetch generated vertex IDs to the vertex shader
+                    vsContext.VertexID = fetchInfo.VertexID;
+
+                    // Setup active mask for vertex shader.
+                    vsContext.mask = GenerateMask(endVertex - i);
+
+                    // forward cut mask to the PA
+                    if (IsIndexedT::value && IsCutIndexEnabledT::value)
+                    {
+                        *pvCutIndices = _simd_movemask_ps(_simd_castsi_ps(fetchInfo.CutMask));
+                    }
+
+                    UPDATE_STAT_FE(IaVertices, GetNumInvocations(i, endVertex));
+
+#if KNOB_ENABLE_TOSS_POINTS
+                    if (!KNOB_TOSS_FETCH)
+#endif
+                    {
+                        RDTSC_START(FEVertexShader);
+                        state.pfnVertexFunc(GetPrivateState(pDC), &vsContext);
+                        RDTSC_STOP(FEVertexShader, GetNumInvocations(i, endVertex), 0);
+
+                        UPDATE_STAT_FE(VsInvocations, GetNumInvocations(i, endVertex));
+                    }
+                }
+
+                i += KNOB_SIMD_WIDTH;
+                if (IsIndexedT::value)
+                {
+                    fetchInfo.pIndices = (int*)((uint8_t*)fetchInfo.pIndices + KNOB_SIMD_WIDTH * indexSize);
+                }
+                else
+                {
+                    vIndex = _simd_add_epi32(vIndex, _simd_set1_epi32(KNOB_SIMD_WIDTH));
+                }
+            }
+
+            // 2. Assemble 16 primitives from the VS output.
+            simd16vector prim[MAX_NUM_VERTS_PER_PRIM];
+            RDTSC_START(FEPAAssemble);
+            bool assemble = pa.Assemble_simd16(VERTEX_POSITION_SLOT, prim);
+            RDTSC_STOP(FEPAAssemble, assemble ? pa.NumPrims_simd16() : 0, 0);
+
+#if KNOB_ENABLE_TOSS_POINTS
+            if (!KNOB_TOSS_FETCH && !KNOB_TOSS_VS)
+#endif
+            {
+                if (assemble)
+                {
+                    UPDATE_STAT_FE(IaPrimitives, pa.NumPrims_simd16());
+
+                    if (pDC->pState->pfnProcessPrims_simd16)
+                    {
+                        pDC->pState->pfnProcessPrims_simd16(pDC, pa, workerId, prim,
+                            GenMask(pa.NumPrims_simd16()), pa.GetPrimID_simd16(work.startPrimID));
+                    }
+                    else
+                    {
+                        // no 16-wide path for this topology, hand each half to the 8-wide clipper/binner
+                        SWR_ASSERT(pDC->pState->pfnProcessPrims);
+
+                        simdvector primLo[MAX_NUM_VERTS_PER_PRIM], primHi[MAX_NUM_VERTS_PER_PRIM];
+                        SplitPrims_simd16(prim, pa.vertsPerPrim, primLo, primHi);
+
+                        if (pa.NumPrims())
+                        {
+                            pDC->pState->pfnProcessPrims(pDC, pa, workerId, primLo,
+                                GenMask(pa.NumPrims()), pa.GetPrimID(work.startPrimID), _simd_set1_epi32(0));
+                        }
+
+                        pa.useAlternateOffset = true;
+                        if (pa.NumPrims())
+                        {
+                            pDC->pState->pfnProcessPrims(pDC, pa, workerId, primHi,
+                                GenMask(pa.NumPrims()), pa.GetPrimID(work.startPrimID), _simd_set1_epi32(0));
+                        }
+                        pa.useAlternateOffset = false;
+                    }
+                }
+            }
+
+            pa.NextPrim();
+        }
+        pa.Reset();
+    }
+
+    RDTSC_STOP(FEProcessDraw, numPrims * work.numInstances, pDC->drawId);
+}
+
+struct FEDrawSimd16Chooser
+{
+    typedef PFN_FE_WORK_FUNC FuncType;
+
+    template <typename... ArgsB>
+    static FuncType GetFunc()
+    {
+        return ProcessDrawSimd16<ArgsB...>;
+    }
+};
+#endif
+
 struct FEDrawChooser
 {
     typedef PFN_FE_WORK_FUNC FuncType;
@@ -1450,8 +1716,18 @@ PFN_FE_WORK_FUNC GetProcessDrawFunc(
     bool HasTessellation,
     bool HasGeometryShader,
     bool HasStreamOut,
-    bool HasRasterization)
+    bool HasRasterization,
+    PRIMITIVE_TOPOLOGY topology)
 {
+#if ENABLE_AVX512_SIMD16
+    if (KNOB_USE_SIMD16_FRONTEND &&
+        !HasTessellation && !HasGeometryShader && !HasStreamOut && HasRasterization &&
+        IsSimd16FrontendTopology(topology))
+    {
+        return TemplateArgUnroller<FEDrawSimd16Chooser>::GetFunc(IsIndexed, IsCutIndexEnabled);
+    }
+#endif
+
     return TemplateArgUnroller<FEDrawChooser>::GetFunc(IsIndexed, IsCutIndexEnabled, HasTessellation, HasGeometryShader, HasStreamOut, HasRasterization);
 }
 
@@ -1789,6 +2065,8 @@ void BinTriangles(
 {
     RDTSC_START(FEBinTriangles);
 
+    uint32_t numTris = _mm_popcnt_u32(triMask);
+
     const API_STATE& state = GetApiState(pDC);
     const SWR_RASTSTATE& rastState = state.rastState;
     const SWR_FRONTEND_STATE& feState = state.frontendState;
@@ -2168,7 +2446,7 @@ void BinTriangles(
     }
 
 endBinTriangles:
-    RDTSC_STOP(FEBinTriangles, 1, 0);
+    RDTSC_STOP(FEBinTriangles, numTris, 0);
 }
 
 struct FEBinTrianglesChooser
@@ -2188,6 +2466,314 @@ PFN_PROCESS_PRIMS GetBinTrianglesFunc(bool IsConservative)
     return TemplateArgUnroller<FEBinTrianglesChooser>::GetFunc(IsConservative);
 }
 
+#if ENABLE_AVX512_SIMD16
+//////////////////////////////////////////////////////////////////////////
+/// @brief Bin 16 triangles to the backend.  Standard rasterization of
+///        viewport 0 only, the API only selects this for those draws.
+/// @param pDC - pointer to draw context.
+/// @param pa - The primitive assembly object.
+/// @param workerId - thread's worker id. Even thread has a unique id.
+/// @param tri - Contains triangle position data for 16 triangles.
+/// @param triMask - Specifies which triangles are valid.
+/// @param primID - Primitive ID for each triangle.
+void BinTriangles_simd16(
+    DRAW_CONTEXT *pDC,
+    PA_STATE& pa,
+    uint32_t workerId,
+    simd16vector tri[3],
+    uint32_t triMask,
+    simd16scalari primID)
+{
+    RDTSC_START(FEBinTriangles);
+
+    uint32_t numTris = _mm_popcnt_u32(triMask);
+
+    const API_STATE& state = GetApiState(pDC);
+    const SWR_RASTSTATE& rastState = state.rastState;
+    const SWR_FRONTEND_STATE& feState = state.frontendState;
+    MacroTileMgr *pTileMgr = pDC->pTileMgr;
+
+    simd16scalar vRecipW[3];
+
+    if (feState.vpTransformDisable)
+    {
+        // RHW is passed in directly when VP transform is disabled
+        for (uint32_t v = 0; v < 3; ++v)
+        {
+            vRecipW[v] = tri[v].v[3];
+        }
+    }
+    else
+    {
+        const simd16scalar m00 = _simd16_set1_ps(state.vpMatrices.m00[0]);
+        const simd16scalar m30 = _simd16_set1_ps(state.vpMatrices.m30[0]);
+        const simd16scalar m11 = _simd16_set1_ps(state.vpMatrices.m11[0]);
+        const simd16scalar m31 = _simd16_set1_ps(state.vpMatrices.m31[0]);
+        const simd16scalar m22 = _simd16_set1_ps(state.vpMatrices.m22[0]);
+        const simd16scalar m32 = _simd16_set1_ps(state.vpMatrices.m32[0]);
+
+        for (uint32_t v = 0; v < 3; ++v)
+        {
+            // Perspective divide
+            vRecipW[v] = _simd16_div_ps(_simd16_set1_ps(1.0f), tri[v].w);
+
+            tri[v].x = _simd16_mul_ps(tri[v].x, vRecipW[v]);
+            tri[v].y = _simd16_mul_ps(tri[v].y, vRecipW[v]);
+            tri[v].z = _simd16_mul_ps(tri[v].z, vRecipW[v]);
+
+            // Viewport transform to screen space coords
+            tri[v].x = _simd16_fmadd_ps(tri[v].x, m00, m30);
+            tri[v].y = _simd16_fmadd_ps(tri[v].y, m11, m31);
+            tri[v].z = _simd16_fmadd_ps(tri[v].z, m22, m32);
+        }
+    }
+
+    // Adjust for pixel center location and convert to fixed point
+    const simd16scalar offset = _simd16_set1_ps((rastState.pixelLocation == SWR_PIXEL_LOCATION_UL) ? 0.5f : 0.0f);
+    const simd16scalar fixedScale = _simd16_set1_ps(FixedPointTraits<Fixed_16_8>::ScaleT::value);
+
+    simd16scalari vXi[3], vYi[3];
+    for (uint32_t v = 0; v < 3; ++v)
+    {
+        tri[v].x = _simd16_add_ps(tri[v].x, offset);
+        tri[v].y = _simd16_add_ps(tri[v].y, offset);
+
+        vXi[v] = _simd16_cvtps_epi32(_simd16_mul_ps(tri[v].x, fixedScale));
+        vYi[v] = _simd16_cvtps_epi32(_simd16_mul_ps(tri[v].y, fixedScale));
+    }
+
+    // triangle setup, see triangleSetupABIntVertical and calcDeterminantIntVertical
+    simd16scalari vA1 = _simd16_sub_epi32(vYi[1], vYi[2]);
+    simd16scalari vA2 = _simd16_sub_epi32(vYi[2], vYi[0]);
+    simd16scalari vB1 = _simd16_sub_epi32(vXi[2], vXi[1]);
+    simd16scalari vB2 = _simd16_sub_epi32(vXi[0], vXi[2]);
+
+    // the 64-bit products of the low unpack hold lanes 0 1 4 5 8 9 12 13,
+    // the high unpack holds lanes 2 3 6 7 10 11 14 15
+    simd16scalari vA1B2Lo = _simd16_mul_epi32(_simd16_unpacklo_epi32(vA1, vA1), _simd16_unpacklo_epi32(vB2, vB2));
+    simd16scalari vA1B2Hi = _simd16_mul_epi32(_simd16_unpackhi_epi32(vA1, vA1), _simd16_unpackhi_epi32(vB2, vB2));
+    simd16scalari vA2B1Lo = _simd16_mul_epi32(_simd16_unpacklo_epi32(vA2, vA2), _simd16_unpacklo_epi32(vB1, vB1));
+    simd16scalari vA2B1Hi = _simd16_mul_epi32(_simd16_unpackhi_epi32(vA2, vA2), _simd16_unpackhi_epi32(vB1, vB1));
+
+    simd16scalari vDetLo = _simd16_sub_epi64(vA1B2Lo, vA2B1Lo);
+    simd16scalari vDetHi = _simd16_sub_epi64(vA1B2Hi, vA2B1Hi);
+
+    const uint32_t laneMaskLo = 0x3333;
+    const uint32_t laneMaskHi = 0xCCCC;
+
+    // cull zero area
+    uint32_t maskLo = _simd16_movemask_pd(_simd16_castsi_pd(_simd16_cmpeq_epi64(vDetLo, _simd16_setzero_si())));
+    uint32_t maskHi = _simd16_movemask_pd(_simd16_castsi_pd(_simd16_cmpeq_epi64(vDetHi, _simd16_setzero_si())));
+    uint32_t cullZeroAreaMask = pdep_u32(maskLo, laneMaskLo) | pdep_u32(maskHi, laneMaskHi);
+
+    uint32_t origTriMask = triMask;
+    triMask &= ~cullZeroAreaMask;
+
+    // determine front winding tris
+    // CW  +det
+    // CCW det <= 0
+    maskLo = _simd16_movemask_pd(_simd16_castsi_pd(_simd16_cmpgt_epi64(vDetLo, _simd16_setzero_si())));
+    maskHi = _simd16_movemask_pd(_simd16_castsi_pd(_simd16_cmpgt_epi64(vDetHi, _simd16_setzero_si())));
+    uint32_t cwTriMask = pdep_u32(maskLo, laneMaskLo) | pdep_u32(maskHi, laneMaskHi);
+
+    uint32_t frontWindingTris;
+    if (rastState.frontWinding == SWR_FRONTWINDING_CW)
+    {
+        frontWindingTris = cwTriMask;
+    }
+    else
+    {
+        frontWindingTris = ~cwTriMask;
+    }
+
+    // cull
+    uint32_t cullTris;
+    switch ((SWR_CULLMODE)rastState.cullMode)
+    {
+    case SWR_CULLMODE_BOTH:  cullTris = 0xffffffff; break;
+    case SWR_CULLMODE_NONE:  cullTris = 0x0; break;
+    case SWR_CULLMODE_FRONT: cullTris = frontWindingTris; break;
+    case SWR_CULLMODE_BACK:  cullTris = ~frontWindingTris; break;
+    default: SWR_ASSERT(false, "Invalid cull mode: %d", rastState.cullMode); cullTris = 0x0; break;
+    }
+
+    triMask &= ~cullTris;
+
+    if (origTriMask ^ triMask)
+    {
+        RDTSC_EVENT(FECullZeroAreaAndBackface, _mm_popcnt_u32(origTriMask ^ triMask), 0);
+    }
+
+    /// Note: these variable initializations must stay above any 'goto endBinTriangles_simd16'
+    uint32_t frontFaceMask = frontWindingTris;
+    OSALIGNSIMD16(uint32_t) aPrimID[KNOB_SIMD16_WIDTH];
+    DWORD triIndex = 0;
+    // for center sample pattern, all samples are at pixel center; calculate coverage
+    // once at center and broadcast the results in the backend
+    const SWR_MULTISAMPLE_COUNT sampleCount = (rastState.samplePattern == SWR_MSAA_STANDARD_PATTERN) ? rastState.sampleCount : SWR_MULTISAMPLE_1X;
+    // degenerate triangles won't be sent to rasterizer; just enable all edges
+    PFN_WORK_FUNC pfnWork = GetRasterizerFunc(sampleCount, false,
+        (SWR_INPUT_COVERAGE)pDC->pState->state.psState.inputCoverage, ALL_EDGES_VALID,
+        (state.scissorsTileAligned == false));
+    // Select attribute processor
+    PFN_PROCESS_ATTRIBUTES pfnProcessAttribs = GetProcessAttributesFunc(3,
+        state.backendState.swizzleEnable, state.backendState.constantInterpolationMask);
+
+    simd16scalari bboxXmin, bboxXmax, bboxYmin, bboxYmax;
+    OSALIGNSIMD16(uint32_t) aMTLeft[KNOB_SIMD16_WIDTH], aMTRight[KNOB_SIMD16_WIDTH], aMTTop[KNOB_SIMD16_WIDTH], aMTBottom[KNOB_SIMD16_WIDTH];
+    __m128 vHorizX[2][KNOB_SIMD_WIDTH], vHorizY[2][KNOB_SIMD_WIDTH], vHorizZ[2][KNOB_SIMD_WIDTH], vHorizW[2][KNOB_SIMD_WIDTH];
+
+    if (!triMask)
+    {
+        goto endBinTriangles_simd16;
+    }
+
+    // Calc bounding box of triangles
+    bboxXmin = _simd16_min_epi32(_simd16_min_epi32(vXi[0], vXi[1]), vXi[2]);
+    bboxXmax = _simd16_max_epi32(_simd16_max_epi32(vXi[0], vXi[1]), vXi[2]);
+    bboxYmin = _simd16_min_epi32(_simd16_min_epi32(vYi[0], vYi[1]), vYi[2]);
+    bboxYmax = _simd16_max_epi32(_simd16_max_epi32(vYi[0], vYi[1]), vYi[2]);
+
+    // determine if triangle falls between pixel centers and discard
+    // only discard for non-MSAA case
+    // (xmin + 127) & ~255
+    // (xmax + 128) & ~255
+    if (rastState.sampleCount == SWR_MULTISAMPLE_1X)
+    {
+        origTriMask = triMask;
+
+        simd16scalari xmin = _simd16_and_si(_simd16_add_epi32(bboxXmin, _simd16_set1_epi32(127)), _simd16_set1_epi32(~255));
+        simd16scalari xmax = _simd16_and_si(_simd16_add_epi32(bboxXmax, _simd16_set1_epi32(128)), _simd16_set1_epi32(~255));
+        simd16scalari ymin = _simd16_and_si(_simd16_add_epi32(bboxYmin, _simd16_set1_epi32(127)), _simd16_set1_epi32(~255));
+        simd16scalari ymax = _simd16_and_si(_simd16_add_epi32(bboxYmax, _simd16_set1_epi32(128)), _simd16_set1_epi32(~255));
+
+        simd16scalari vMaskHV = _simd16_or_si(_simd16_cmpeq_epi32(xmin, xmax), _simd16_cmpeq_epi32(ymin, ymax));
+        triMask &= ~_simd16_movemask_ps(_simd16_castsi_ps(vMaskHV));
+
+        if (origTriMask ^ triMask)
+        {
+            RDTSC_EVENT(FECullBetweenCenters, _mm_popcnt_u32(origTriMask ^ triMask), 0);
+        }
+    }
+
+    // Intersect with scissor/viewport. Subtract 1 ULP in x.8 fixed point since xmax/ymax edge is exclusive.
+    bboxXmin = _simd16_max_epi32(bboxXmin, _simd16_set1_epi32(state.scissorsInFixedPoint[0].xmin));
+    bboxYmin = _simd16_max_epi32(bboxYmin, _simd16_set1_epi32(state.scissorsInFixedPoint[0].ymin));
+    bboxXmax = _simd16_min_epi32(_simd16_sub_epi32(bboxXmax, _simd16_set1_epi32(1)), _simd16_set1_epi32(state.scissorsInFixedPoint[0].xmax));
+    bboxYmax = _simd16_min_epi32(_simd16_sub_epi32(bboxYmax, _simd16_set1_epi32(1)), _simd16_set1_epi32(state.scissorsInFixedPoint[0].ymax));
+
+    // Cull tris completely outside scissor
+    {
+        simd16scalari maskOutsideScissorXY = _simd16_or_si(_simd16_cmpgt_epi32(bboxXmin, bboxXmax), _simd16_cmpgt_epi32(bboxYmin, bboxYmax));
+        triMask &= ~_simd16_movemask_ps(_simd16_castsi_ps(maskOutsideScissorXY));
+    }
+
+    if (!triMask)
+    {
+        goto endBinTriangles_simd16;
+    }
+
+    // Convert triangle bbox to macrotile units.
+    _simd16_store_si((simd16scalari*)aMTLeft, _simd16_srai_epi32(bboxXmin, KNOB_MACROTILE_X_DIM_FIXED_SHIFT));
+    _simd16_store_si((simd16scalari*)aMTRight, _simd16_srai_epi32(bboxXmax, KNOB_MACROTILE_X_DIM_FIXED_SHIFT));
+    _simd16_store_si((simd16scalari*)aMTTop, _simd16_srai_epi32(bboxYmin, KNOB_MACROTILE_Y_DIM_FIXED_SHIFT));
+    _simd16_store_si((simd16scalari*)aMTBottom, _simd16_srai_epi32(bboxYmax, KNOB_MACROTILE_Y_DIM_FIXED_SHIFT));
+
+    _simd16_store_si((simd16scalari*)aPrimID, primID);
+
+    // transpose verts needed for backend, one 8-wide half at a time
+    /// @todo modify BE to take non-transformed verts
+    {
+        simdscalar vX[3], vY[3], vZ[3], vW[3];
+        for (uint32_t v = 0; v < 3; ++v)
+        {
+            vX[v] = _simd16_extract_ps(tri[v].x, 0);
+            vY[v] = _simd16_extract_ps(tri[v].y, 0);
+            vZ[v] = _simd16_extract_ps(tri[v].z, 0);
+            vW[v] = _simd16_extract_ps(vRecipW[v], 0);
+        }
+        vTranspose3x8(vHorizX[0], vX[0], vX[1], vX[2]);
+        vTranspose3x8(vHorizY[0], vY[0], vY[1], vY[2]);
+        vTranspose3x8(vHorizZ[0], vZ[0], vZ[1], vZ[2]);
+        vTranspose3x8(vHorizW[0], vW[0], vW[1], vW[2]);
+
+        for (uint32_t v = 0; v < 3; ++v)
+        {
+            vX[v] = _simd16_extract_ps(tri[v].x, 1);
+            vY[v] = _simd16_extract_ps(tri[v].y, 1);
+            vZ[v] = _simd16_extract_ps(tri[v].z, 1);
+            vW[v] = _simd16_extract_ps(vRecipW[v], 1);
+        }
+        vTranspose3x8(vHorizX[1], vX[0], vX[1], vX[2]);
+        vTranspose3x8(vHorizY[1], vY[0], vY[1], vY[2]);
+        vTranspose3x8(vHorizZ[1], vZ[0], vZ[1], vZ[2]);
+        vTranspose3x8(vHorizW[1], vW[0], vW[1], vW[2]);
+    }
+
+    // scan remaining valid triangles and bin each separately
+    while (_BitScanForward(&triIndex, triMask))
+    {
+        uint32_t linkageCount = state.backendState.numAttributes;
+        uint32_t numScalarAttribs = linkageCount * 4;
+
+        BE_WORK work;
+        work.type = DRAW;
+        work.pfnWork = pfnWork;
+
+        TRIANGLE_WORK_DESC &desc = work.desc.tri;
+
+        desc.triFlags.frontFacing = state.forceFront ? 1 : ((frontFaceMask >> triIndex) & 1);
+        desc.triFlags.primID = aPrimID[triIndex];
+        desc.triFlags.renderTargetArrayIndex = 0;
+        desc.triFlags.viewportIndex = 0;
+
+        auto pArena = pDC->pArena;
+        SWR_ASSERT(pArena != nullptr);
+
+        // store active attribs
+        float *pAttribs = (float*)pArena->AllocAligned(numScalarAttribs * 3 * sizeof(float), 16);
+        desc.pAttribs = pAttribs;
+        desc.numAttribs = linkageCount;
+        pfnProcessAttribs(pDC, pa, triIndex, aPrimID[triIndex], desc.pAttribs);
+
+        // store triangle vertex data
+        desc.pTriBuffer = (float*)pArena->AllocAligned(4 * 4 * sizeof(float), 16);
+
+        const uint32_t half = triIndex / KNOB_SIMD_WIDTH;
+        const uint32_t lane = triIndex % KNOB_SIMD_WIDTH;
+        _mm_store_ps(&desc.pTriBuffer[0], vHorizX[half][lane]);
+        _mm_store_ps(&desc.pTriBuffer[4], vHorizY[half][lane]);
+        _mm_store_ps(&desc.pTriBuffer[8], vHorizZ[half][lane]);
+        _mm_store_ps(&desc.pTriBuffer[12], vHorizW[half][lane]);
+
+        // store user clip distances
+        if (rastState.clipDistanceMask)
+        {
+            uint32_t numClipDist = _mm_popcnt_u32(rastState.clipDistanceMask);
+            desc.pUserClipBuffer = (float*)pArena->Alloc(numClipDist * 3 * sizeof(float));
+            ProcessUserClipDist<3>(pa, triIndex, rastState.clipDistanceMask, desc.pUserClipBuffer);
+        }
+
+        for (uint32_t y = aMTTop[triIndex]; y <= aMTBottom[triIndex]; ++y)
+        {
+            for (uint32_t x = aMTLeft[triIndex]; x <= aMTRight[triIndex]; ++x)
+            {
+#if KNOB_ENABLE_TOSS_POINTS
+                if (!KNOB_TOSS_SETUP_TRIS)
+#endif
+                {
+                    pTileMgr->enqueue(x, y, &work);
+                }
+            }
+        }
+        triMask &= ~(1 << triIndex);
+    }
+
+endBinTriangles_simd16:
+    RDTSC_STOP(FEBinTriangles, numTris, 0);
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Bin SIMD points to the backend.  Only supports point size of 1
 /// @param pDC - pointer to draw context.
@@ -298,7 +298,8 @@ PFN_FE_WORK_FUNC GetProcessDrawFunc(
     bool HasTessellation,
     bool HasGeometryShader,
     bool HasStreamOut,
-    bool HasRasterization);
+    bool HasRasterization,
+    PRIMITIVE_TOPOLOGY topology);
 
 void ProcessClear(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC, uint32_t workerId, void *pUserData);
 void ProcessStoreTiles(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC, uint32_t workerId, void *pUserData);
@@ -311,3 +312,21 @@ struct PA_STATE_BASE;  // forward decl
 void BinPoints(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[3], uint32_t primMask, simdscalari primID, simdscalari viewportIdx);
 void BinLines(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simdvector prims[3], uint32_t primMask, simdscalari primID, simdscalari viewportIdx);
 
+#if ENABLE_AVX512_SIMD16
+void BinTriangles_simd16(DRAW_CONTEXT *pDC, PA_STATE& pa, uint32_t workerId, simd16vector tri[3], uint32_t triMask, simd16scalari primID);
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Splits 16-wide assembled prims into their lower and upper 8 lanes
+INLINE void SplitPrims_simd16(const simd16vector prims[], uint32_t numVerts, simdvector primsLo[], simdvector primsHi[])
+{
+    for (uint32_t v = 0; v < numVerts; ++v)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            primsLo[v].v[c] = _simd16_extract_ps(prims[v].v[c], 0);
+            primsHi[v].v[c] = _simd16_extract_ps(prims[v].v[c], 1);
+        }
+    }
+}
+#endif
+
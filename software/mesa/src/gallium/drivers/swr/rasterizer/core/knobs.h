@@ -34,12 +34,6 @@
 #define KNOB_ARCH_AVX2   1
 #define KNOB_ARCH_AVX512 2
 
-///////////////////////////////////////////////////////////////////////////////
-// AVX512 Support
-///////////////////////////////////////////////////////////////////////////////
-
-#define ENABLE_AVX512_SIMD16    0
-
 ///////////////////////////////////////////////////////////////////////////////
 // Architecture validation
 ///////////////////////////////////////////////////////////////////////////////
@@ -74,6 +68,19 @@
 #error "Unknown architecture"
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// AVX512 Support
+///////////////////////////////////////////////////////////////////////////////
+
+// 16-wide types and intrinsics for the SIMD16 frontend. Native on AVX512,
+// emulated with pairs of AVX2 registers otherwise. The emulation needs
+// AVX2 integer ops, so plain AVX builds stay 8-wide only.
+#if (KNOB_ARCH == KNOB_ARCH_AVX)
+#define ENABLE_AVX512_SIMD16    0
+#else
+#define ENABLE_AVX512_SIMD16    1
+#endif
+
 #if ENABLE_AVX512_SIMD16
 
 #define KNOB_SIMD16_WIDTH 16
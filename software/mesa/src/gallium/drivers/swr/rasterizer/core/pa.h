@@ -41,6 +41,10 @@ struct PA_STATE
     // The topology the binner will use. In some cases the FE changes the topology from the api state.
     PRIMITIVE_TOPOLOGY binTopology{ TOP_UNKNOWN };
 
+    // When the PA assembles 16 prims at a time, the 8-wide interface works on the
+    // upper 8 prims while this is set.
+    bool useAlternateOffset{ false };
+
     PA_STATE() {}
     PA_STATE(DRAW_CONTEXT *in_pDC, uint8_t* in_pStreamBase, uint32_t in_streamSizeInVerts) :
         pDC(in_pDC), pStreamBase(in_pStreamBase), streamSizeInVerts(in_streamSizeInVerts) {}
@@ -330,6 +334,14 @@ INLINE __m128 swizzleLaneN(const simdvector &a, int lane)
     }
 }
 
+#if ENABLE_AVX512_SIMD16
+#define PA_MAX_SIMD_WIDTH KNOB_SIMD16_WIDTH
+#define OSALIGNPA OSALIGNSIMD16
+#else
+#define PA_MAX_SIMD_WIDTH KNOB_SIMD_WIDTH
+#define OSALIGNPA OSALIGNSIMD
+#endif
+
 // Cut-aware primitive assembler.
 struct PA_STATE_CUT : public PA_STATE
 {
@@ -338,8 +350,9 @@ struct PA_STATE_CUT : public PA_STATE
     uint32_t numAttribs{ 0 };            // number of attributes
     int32_t numRemainingVerts{ 0 };      // number of verts remaining to be assembled
     uint32_t numVertsToAssemble{ 0 };    // total number of verts to assemble for the draw
-    OSALIGNSIMD(uint32_t) indices[MAX_NUM_VERTS_PER_PRIM][KNOB_SIMD_WIDTH];    // current index buffer for gather
-    simdscalari vOffsets[MAX_NUM_VERTS_PER_PRIM];           // byte offsets for currently assembling simd
+    OSALIGNPA(uint32_t) indices[MAX_NUM_VERTS_PER_PRIM][PA_MAX_SIMD_WIDTH];    // current index buffer for gather
+    OSALIGNPA(uint32_t) vOffsets[MAX_NUM_VERTS_PER_PRIM][PA_MAX_SIMD_WIDTH];   // byte offsets for currently assembling simd
+    uint32_t simdWidth{ KNOB_SIMD_WIDTH };  // number of prims assembled per batch, KNOB_SIMD_WIDTH or KNOB_SIMD16_WIDTH
     uint32_t numPrimsAssembled{ 0 };     // number of primitives that are fully assembled
     uint32_t headVertex{ 0 };            // current unused vertex slot in vertex buffer store
     uint32_t tailVertex{ 0 };            // beginning vertex currently assembling
@@ -363,9 +376,11 @@ struct PA_STATE_CUT : public PA_STATE
 
     PA_STATE_CUT() {}
     PA_STATE_CUT(DRAW_CONTEXT* pDC, uint8_t* in_pStream, uint32_t in_streamSizeInVerts, simdmask* in_pIndices, uint32_t in_numVerts, 
-        uint32_t in_numAttribs, PRIMITIVE_TOPOLOGY topo, bool in_processCutVerts)
+        uint32_t in_numAttribs, PRIMITIVE_TOPOLOGY topo, bool in_processCutVerts, uint32_t in_simdWidth = KNOB_SIMD_WIDTH)
         : PA_STATE(pDC, in_pStream, in_streamSizeInVerts)
     {
+        SWR_ASSERT(in_simdWidth == KNOB_SIMD_WIDTH || in_simdWidth == PA_MAX_SIMD_WIDTH);
+        simdWidth = in_simdWidth;
         numVerts = in_streamSizeInVerts;
         numAttribs = in_numAttribs;
         binTopology = topo;
@@ -441,9 +456,26 @@ struct PA_STATE_CUT : public PA_STATE
 
     simdscalari GetPrimID(uint32_t startID)
     {
+        if (this->useAlternateOffset)
+        {
+            startID += KNOB_SIMD_WIDTH;
+        }
         return _simd_add_epi32(_simd_set1_epi32(startID), this->vPrimId);
     }
 
+#if ENABLE_AVX512_SIMD16
+    simd16scalari GetPrimID_simd16(uint32_t startID)
+    {
+        simdscalari lo = _simd_add_epi32(_simd_set1_epi32(startID), this->vPrimId);
+        simdscalari hi = _simd_add_epi32(lo, _simd_set1_epi32(KNOB_SIMD_WIDTH));
+
+        simd16scalari result = _simd16_setzero_si();
+        result = _simd16_insert_si(result, lo, 0);
+        result = _simd16_insert_si(result, hi, 1);
+        return result;
+    }
+#endif
+
     void Reset()
     {
         this->numRemainingVerts = this->numVertsToAssemble;
@@ -485,7 +517,7 @@ struct PA_STATE_CUT : public PA_STATE
     // have assembled SIMD prims
     void ProcessVerts()
     {
-        while (this->numPrimsAssembled != KNOB_SIMD_WIDTH &&
+        while (this->numPrimsAssembled != this->simdWidth &&
             this->numRemainingVerts > 0 &&
             this->curVertex != this->headVertex)
         {
@@ -516,7 +548,7 @@ struct PA_STATE_CUT : public PA_STATE
         }
 
         // special case last primitive for tri strip w/ adj
-        if (this->numPrimsAssembled != KNOB_SIMD_WIDTH && this->numRemainingVerts == 0 && this->adjExtraVert != -1)
+        if (this->numPrimsAssembled != this->simdWidth && this->numRemainingVerts == 0 && this->adjExtraVert != -1)
         {
             (this->*pfnPa)(this->curVertex, true);
         }
@@ -528,13 +560,13 @@ struct PA_STATE_CUT : public PA_STATE
         // advance tail to the current unsubmitted vertex
         this->tailVertex = this->curVertex;
         this->numPrimsAssembled = 0;
-        this->vPrimId = _simd_add_epi32(vPrimId, _simd_set1_epi32(KNOB_SIMD_WIDTH));
+        this->vPrimId = _simd_add_epi32(vPrimId, _simd_set1_epi32(this->simdWidth));
     }
 
     bool NextPrim()
     {
         // if we've assembled enough prims, we can advance to the next set of verts
-        if (this->numPrimsAssembled == KNOB_SIMD_WIDTH || this->numRemainingVerts <= 0)
+        if (this->numPrimsAssembled == this->simdWidth || this->numRemainingVerts <= 0)
         {
             Advance();
         }
@@ -545,27 +577,34 @@ struct PA_STATE_CUT : public PA_STATE
     {
         for (uint32_t v = 0; v < this->vertsPerPrim; ++v)
         {
-            simdscalari vIndices = *(simdscalari*)&this->indices[v][0];
+            for (uint32_t lane = 0; lane < this->simdWidth; lane += KNOB_SIMD_WIDTH)
+            {
+                simdscalari vIndices = *(simdscalari*)&this->indices[v][lane];
+
+                // step to simdvertex batch
+                const uint32_t simdShift = 3; // @todo make knob
+                simdscalari vVertexBatch = _simd_srai_epi32(vIndices, simdShift);
+                simdscalari vOffset = _simd_mullo_epi32(vVertexBatch, _simd_set1_epi32(sizeof(simdvertex)));
 
-            // step to simdvertex batch
-            const uint32_t simdShift = 3; // @todo make knob
-            simdscalari vVertexBatch = _simd_srai_epi32(vIndices, simdShift);
-            this->vOffsets[v] = _simd_mullo_epi32(vVertexBatch, _simd_set1_epi32(sizeof(simdvertex)));
+                // step to index
+                const uint32_t simdMask = 0x7; // @todo make knob
+                simdscalari vVertexIndex = _simd_and_si(vIndices, _simd_set1_epi32(simdMask));
+                vOffset = _simd_add_epi32(vOffset, _simd_mullo_epi32(vVertexIndex, _simd_set1_epi32(sizeof(float))));
 
-            // step to index
-            const uint32_t simdMask = 0x7; // @todo make knob
-            simdscalari vVertexIndex = _simd_and_si(vIndices, _simd_set1_epi32(simdMask));
-            this->vOffsets[v] = _simd_add_epi32(this->vOffsets[v], _simd_mullo_epi32(vVertexIndex, _simd_set1_epi32(sizeof(float))));
+                *(simdscalari*)&this->vOffsets[v][lane] = vOffset;
+            }
         }
     }
 
-    bool Assemble(uint32_t slot, simdvector result[])
+    // assembles verts into prims and computes gather offsets, returns false if
+    // a full batch of prims isn't available yet
+    bool PrepareAssemble()
     {
         // process any outstanding verts
         ProcessVerts();
 
         // return false if we don't have enough prims assembled
-        if (this->numPrimsAssembled != KNOB_SIMD_WIDTH && this->numRemainingVerts > 0)
+        if (this->numPrimsAssembled != this->simdWidth && this->numRemainingVerts > 0)
         {
             return false;
         }
@@ -577,9 +616,21 @@ struct PA_STATE_CUT : public PA_STATE
             this->needOffsets = false;
         }
 
+        return true;
+    }
+
+    bool Assemble(uint32_t slot, simdvector result[])
+    {
+        if (!PrepareAssemble())
+        {
+            return false;
+        }
+
+        const uint32_t lane = this->useAlternateOffset ? KNOB_SIMD_WIDTH : 0;
+
         for (uint32_t v = 0; v < this->vertsPerPrim; ++v)
         {
-            simdscalari offsets = this->vOffsets[v];
+            simdscalari offsets = *(simdscalari*)&this->vOffsets[v][lane];
 
             // step to attribute
             offsets = _simd_add_epi32(offsets, _simd_set1_epi32(slot * sizeof(simdvector)));
@@ -597,13 +648,46 @@ struct PA_STATE_CUT : public PA_STATE
         return true;
     }
 
+#if ENABLE_AVX512_SIMD16
+    bool Assemble_simd16(uint32_t slot, simd16vector result[])
+    {
+        if (!PrepareAssemble())
+        {
+            return false;
+        }
+
+        for (uint32_t v = 0; v < this->vertsPerPrim; ++v)
+        {
+            simd16scalari offsets = _simd16_load_si((const simd16scalari*)&this->vOffsets[v][0]);
+
+            // step to attribute
+            offsets = _simd16_add_epi32(offsets, _simd16_set1_epi32(slot * sizeof(simdvector)));
+
+            float* pBase = (float*)this->pStreamBase;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                result[v].v[c] = _simd16_i32gather_ps(pBase, offsets, 1);
+
+                // move base to next component
+                pBase += KNOB_SIMD_WIDTH;
+            }
+        }
+
+        return true;
+    }
+#endif
+
     void AssembleSingle(uint32_t slot, uint32_t triIndex, __m128 tri[3])
     {
+        if (this->useAlternateOffset)
+        {
+            triIndex += KNOB_SIMD_WIDTH;
+        }
+
         // move to slot
         for (uint32_t v = 0; v < this->vertsPerPrim; ++v)
         {
-            uint32_t* pOffset = (uint32_t*)&this->vOffsets[v];
-            uint32_t offset = pOffset[triIndex];
+            uint32_t offset = this->vOffsets[v][triIndex];
             offset += sizeof(simdvector) * slot;
             float* pVert = (float*)&tri[v];
             for (uint32_t c = 0; c < 4; ++c)
@@ -616,6 +700,16 @@ struct PA_STATE_CUT : public PA_STATE
     }
 
     uint32_t NumPrims()
+    {
+        // 8-wide view of the batch, either the lower or the upper half
+        if (this->useAlternateOffset)
+        {
+            return this->numPrimsAssembled > KNOB_SIMD_WIDTH ? this->numPrimsAssembled - KNOB_SIMD_WIDTH : 0;
+        }
+        return std::min<uint32_t>(this->numPrimsAssembled, KNOB_SIMD_WIDTH);
+    }
+
+    uint32_t NumPrims_simd16()
     {
         return this->numPrimsAssembled;
     }
@@ -26,6 +26,7 @@
 
 #include "common/os.h"
 #include "common/rdtsc_buckets.h"
+#include "archrast/trace.h"
 
 #include <vector>
 
@@ -102,19 +103,21 @@ void rdtscStop(uint32_t bucketId, uint32_t count, uint64_t drawId);
 void rdtscEvent(uint32_t bucketId, uint32_t count1, uint32_t count2);
 void rdtscEndFrame();
 
+// Bucket starts, stops and events also go to the ArchRast trace when it
+// is enabled at runtime, see archrast/trace.h.
 #ifdef KNOB_ENABLE_RDTSC
 #define RDTSC_RESET() rdtscReset()
 #define RDTSC_INIT(threadId) rdtscInit(threadId)
-#define RDTSC_START(bucket) rdtscStart(bucket)
-#define RDTSC_STOP(bucket, count, draw) rdtscStop(bucket, count, draw)
-#define RDTSC_EVENT(bucket, count1, count2) rdtscEvent(bucket, count1, count2)
+#define RDTSC_START(bucket) do { AR_TRACE_BEGIN(bucket); rdtscStart(bucket); } while (0)
+#define RDTSC_STOP(bucket, count, draw) do { rdtscStop(bucket, count, draw); AR_TRACE_END(bucket, count); } while (0)
+#define RDTSC_EVENT(bucket, count1, count2) do { AR_TRACE_EVENT(bucket, count1); rdtscEvent(bucket, count1, count2); } while (0)
 #define RDTSC_ENDFRAME() rdtscEndFrame()
 #else
 #define RDTSC_RESET()
 #define RDTSC_INIT(threadId)
-#define RDTSC_START(bucket)
-#define RDTSC_STOP(bucket, count, draw)
-#define RDTSC_EVENT(bucket, count1, count2)
+#define RDTSC_START(bucket) AR_TRACE_BEGIN(bucket)
+#define RDTSC_STOP(bucket, count, draw) AR_TRACE_END(bucket, count)
+#define RDTSC_EVENT(bucket, count1, count2) AR_TRACE_EVENT(bucket, count1)
 #define RDTSC_ENDFRAME()
 #endif
 
@@ -156,7 +159,7 @@ INLINE void rdtscStart(uint32_t bucketId)
 INLINE void rdtscStop(uint32_t bucketId, uint32_t count, uint64_t drawId)
 {
     uint32_t id = gBucketMap[bucketId];
-    gBucketMgr.StopBucket(id);
+    gBucketMgr.StopBucket(id, count);
 }
 
 INLINE void rdtscEvent(uint32_t bucketId, uint32_t count1, uint32_t count2)
@@ -501,6 +501,7 @@ void WorkOnFifoBE(
             {
                 BE_WORK *pWork;
 
+                AR_TRACE_DRAW(pDC->drawId);
                 RDTSC_START(WorkerFoundWork);
 
                 uint32_t numWorkItems = tile->getNumQueued();
@@ -606,6 +607,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, uint32_t &curDrawFE)
             if (initial == 0)
             {
                 // successfully grabbed the DC, now run the FE
+                AR_TRACE_DRAW(pDC->drawId);
                 pDC->FeWork.pfnWork(pContext, pDC, workerId, &pDC->FeWork.desc);
 
                 CompleteDrawFE(pContext, pDC);
@@ -654,6 +656,7 @@ void WorkOnCompute(
         {
             void* pSpillFillBuffer = nullptr;
             uint32_t threadGroupId = 0;
+            AR_TRACE_DRAW(pDC->drawId);
             while (queue.getWork(threadGroupId))
             {
                 ProcessComputeBE(pDC, workerId, threadGroupId, pSpillFillBuffer);
@@ -675,6 +678,7 @@ DWORD workerThreadMain(LPVOID pData)
     bindThread(pContext, threadId, pThreadData->procGroupId, pThreadData->forceBindProcGroup); 
 
     RDTSC_INIT(threadId);
+    ArchRast::TraceSetWorkerId(workerId);
 
     uint32_t numaNode = pThreadData->numaId;
     uint32_t numaMask = pContext->threadPool.numaMask;
@@ -145,6 +145,41 @@ struct LoadMacroTile
     }
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// LoadMacroTileSwrz - Loads a macro tile from an SWR_TILE_SWRZ surface
+///                     stored in the hot tile format.
+//////////////////////////////////////////////////////////////////////////
+template<SWR_FORMAT Format>
+struct LoadMacroTileSwrz
+{
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Load a macrotile to the destination hot tile.  Raster tiles
+    ///        in the surface are already in hot tile order, so each row of
+    ///        raster tiles is a single contiguous copy.
+    /// @param pSrcSurface - Src surface state
+    /// @param pDstHotTile - Destination hot tile pointer
+    /// @param x, y - Coordinates to macro tile
+    static void Load(
+        const SWR_SURFACE_STATE* pSrcSurface,
+        uint8_t *pDstHotTile,
+        uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex)
+    {
+        static const uint32_t rowBytes = KNOB_MACROTILE_X_DIM * KNOB_TILE_Y_DIM * (FormatTraits<Format>::bpp / 8);
+
+        SWR_ASSERT(pSrcSurface->numSamples == 1);
+
+        for (uint32_t row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
+        {
+            const uint8_t* pSrc = (const uint8_t*)ComputeSurfaceAddress<false>(x, y + row,
+                pSrcSurface->arrayIndex + renderTargetArrayIndex, pSrcSurface->arrayIndex + renderTargetArrayIndex,
+                0, pSrcSurface->lod, pSrcSurface);
+
+            memcpy(pDstHotTile, pSrc, rowBytes);
+            pDstHotTile += rowBytes;
+        }
+    }
+};
+
 
 static void BUCKETS_START(UINT id)
 {
@@ -216,7 +251,7 @@ void LoadHotTile(
     }
     else if (renderTargetIndex == SWR_ATTACHMENT_DEPTH)
     {
-        // Currently depth can map to linear and tile-y.
+        // Currently depth can map to linear, tile-y and swrz.
         switch (pSrcSurface->tileMode)
         {
         case SWR_TILE_NONE:
@@ -225,6 +260,10 @@ void LoadHotTile(
         case SWR_TILE_MODE_YMAJOR:
             pfnLoadTiles = sLoadTilesDepthTable_SWR_TILE_MODE_YMAJOR[pSrcSurface->format];
             break;
+        case SWR_TILE_SWRZ:
+            SWR_ASSERT(pSrcSurface->format == KNOB_DEPTH_HOT_TILE_FORMAT);
+            pfnLoadTiles = LoadMacroTileSwrz<KNOB_DEPTH_HOT_TILE_FORMAT>::Load;
+            break;
         default:
             SWR_ASSERT(0, "Unsupported tiling mode");
             break;
@@ -242,6 +281,9 @@ void LoadHotTile(
         case SWR_TILE_MODE_WMAJOR:
             pfnLoadTiles = LoadMacroTile<TilingTraits<SWR_TILE_MODE_WMAJOR, 8>, R8_UINT, R8_UINT>::Load;
             break;
+        case SWR_TILE_SWRZ:
+            pfnLoadTiles = LoadMacroTileSwrz<KNOB_STENCIL_HOT_TILE_FORMAT>::Load;
+            break;
         default:
             SWR_ASSERT(0, "Unsupported tiling mode");
             break;
@@ -1478,6 +1478,41 @@ struct StoreMacroTile
     }
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// StoreMacroTileSwrz - Stores a macro tile to an SWR_TILE_SWRZ surface
+///                      stored in the hot tile format.
+//////////////////////////////////////////////////////////////////////////
+template<SWR_FORMAT Format>
+struct StoreMacroTileSwrz
+{
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Stores a macrotile to the destination surface.  Raster tiles
+    ///        in the surface are already in hot tile order, so each row of
+    ///        raster tiles is a single contiguous copy.
+    /// @param pSrc - Pointer to macro tile.
+    /// @param pDstSurface - Destination surface state
+    /// @param x, y - Coordinates to macro tile
+    static void Store(
+        uint8_t *pSrcHotTile,
+        SWR_SURFACE_STATE* pDstSurface,
+        uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex)
+    {
+        static const uint32_t rowBytes = KNOB_MACROTILE_X_DIM * KNOB_TILE_Y_DIM * (FormatTraits<Format>::bpp / 8);
+
+        SWR_ASSERT(pDstSurface->numSamples == 1);
+
+        for (uint32_t row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
+        {
+            uint8_t* pDst = (uint8_t*)ComputeSurfaceAddress<false>(x, y + row,
+                pDstSurface->arrayIndex + renderTargetArrayIndex, pDstSurface->arrayIndex + renderTargetArrayIndex,
+                0, pDstSurface->lod, pDstSurface);
+
+            memcpy(pDst, pSrcHotTile, rowBytes);
+            pSrcHotTile += rowBytes;
+        }
+    }
+};
+
 static void BUCKETS_START(UINT id)
 {
 #ifdef KNOB_ENABLE_RDTSC
@@ -1714,6 +1749,10 @@ void InitSimStoreTilesTable()
     InitStoreTilesTableDepth<SWR_TILE_MODE_YMAJOR>(sStoreTilesTableDepth);
     InitStoreTilesTableStencil<SWR_TILE_MODE_WMAJOR>(sStoreTilesTableStencil);
 
+    // swrz surfaces in the hot tile format store with straight copies
+    sStoreTilesTableDepth[SWR_TILE_SWRZ][KNOB_DEPTH_HOT_TILE_FORMAT] = StoreMacroTileSwrz<KNOB_DEPTH_HOT_TILE_FORMAT>::Store;
+    sStoreTilesTableStencil[SWR_TILE_SWRZ][KNOB_STENCIL_HOT_TILE_FORMAT] = StoreMacroTileSwrz<KNOB_STENCIL_HOT_TILE_FORMAT>::Store;
+
     // special color hot tile -> 8-bit WMAJOR
     sStoreTilesTableColor[SWR_TILE_MODE_WMAJOR][R8_UINT] = StoreMacroTile<TilingTraits<SWR_TILE_MODE_WMAJOR, 8>, R32G32B32A32_FLOAT, R8_UINT>::Store;
 }
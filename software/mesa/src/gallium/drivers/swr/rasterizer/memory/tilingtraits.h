@@ -63,9 +63,9 @@ template<> struct TilingTraits <SWR_TILE_SWRZ, 8>
     static UINT GetCr() { return 0; }
     static UINT GetTileIDShift() { return KNOB_TILE_X_DIM_SHIFT + KNOB_TILE_Y_DIM_SHIFT; }
 
-    /// @todo correct pdep shifts for all rastertile dims.  Unused for now
-    static UINT GetPdepX() { SWR_ASSERT(0); return 0x00; }
-    static UINT GetPdepY() { SWR_ASSERT(0); return 0x00; }
+    // matches the 4x2 SimdTile<R8_UINT> layout of the stencil hot tile
+    static UINT GetPdepX() { return 0x0D; }
+    static UINT GetPdepY() { return 0x32; }
 };
 
 template<> struct TilingTraits <SWR_TILE_SWRZ, 32>
@@ -0,0 +1,322 @@
+# Copyright 2017 Fabricio Ribeiro Toloczko
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+# Python source
+#
+# Reads a trace written with KNOB_AR_TRACE_FILE (see archrast/trace.h)
+# and prints per-stage, per-thread and per-draw summaries.  --chrome
+# writes the whole timeline in the Chrome trace event format, for
+# chrome://tracing or ui.perfetto.dev.
+
+from __future__ import print_function
+import argparse
+import collections
+import json
+import struct
+import sys
+
+TRACE_MAGIC = b'SWRTRACE'
+TRACE_VERSION = 1
+
+TRACE_CHUNK_THREAD = 0
+TRACE_CHUNK_RECORDS = 1
+
+TRACE_BEGIN = 0
+TRACE_END = 1
+TRACE_EVENT = 2
+TRACE_FRAME = 3
+
+TRACE_COUNT_BITS = 22
+TRACE_ID_BITS = 8
+
+FILE_HEADER = struct.Struct('<8sIIQII')
+CHUNK_HEADER = struct.Struct('<IIII')
+RECORD = struct.Struct('<QII')
+
+
+class Thread(object):
+    def __init__(self, index):
+        self.index = index
+        self.name = 'Thread %d' % index
+        self.records = []
+        self.dropped = 0
+
+
+class Trace(object):
+    def __init__(self, filename):
+        with open(filename, 'rb') as f:
+            data = f.read()
+
+        magic, version, record_size, self.tsc_frequency, num_ids, _ = \
+            FILE_HEADER.unpack_from(data, 0)
+        if magic != TRACE_MAGIC:
+            raise ValueError('%s is not an SWR trace' % filename)
+        if version != TRACE_VERSION or record_size != RECORD.size:
+            raise ValueError('unsupported trace version %d' % version)
+
+        offset = FILE_HEADER.size
+        self.ids = []
+        for _ in range(num_ids):
+            length, = struct.unpack_from('<H', data, offset)
+            offset += 2
+            self.ids.append(data[offset:offset + length].decode())
+            offset += length
+
+        self.threads = {}
+        while offset + CHUNK_HEADER.size <= len(data):
+            type, index, size, dropped = CHUNK_HEADER.unpack_from(data, offset)
+            offset += CHUNK_HEADER.size
+
+            thread = self.threads.setdefault(index, Thread(index))
+            thread.dropped = max(thread.dropped, dropped)
+
+            if type == TRACE_CHUNK_THREAD:
+                thread.name = data[offset:offset + size].decode()
+                offset += size
+            elif type == TRACE_CHUNK_RECORDS:
+                end = offset + size * RECORD.size
+                if end > len(data):
+                    # Truncated, e.g. the process did not exit cleanly.
+                    break
+                for tsc, draw, bits in RECORD.iter_unpack(data[offset:end]):
+                    kind = bits >> (TRACE_ID_BITS + TRACE_COUNT_BITS)
+                    id = (bits >> TRACE_COUNT_BITS) & ((1 << TRACE_ID_BITS) - 1)
+                    count = bits & ((1 << TRACE_COUNT_BITS) - 1)
+                    thread.records.append((tsc, kind, id, draw, count))
+                offset = end
+            else:
+                raise ValueError('bad chunk type %d at offset %d' % (type, offset))
+
+        all_tsc = [r[0] for t in self.threads.values() for r in t.records]
+        self.start_tsc = min(all_tsc) if all_tsc else 0
+
+    def name(self, id):
+        return self.ids[id] if id < len(self.ids) else 'id%d' % id
+
+    def us(self, tsc):
+        return (tsc - self.start_tsc) * 1e6 / self.tsc_frequency
+
+
+class Interval(object):
+    __slots__ = ['thread', 'id', 'draw', 'begin', 'end', 'count', 'child_time']
+
+    def __init__(self, thread, id, draw, begin):
+        self.thread = thread
+        self.id = id
+        self.draw = draw
+        self.begin = begin
+        self.end = begin
+        self.count = 0
+        self.child_time = 0
+
+
+def build_intervals(trace):
+    """Match begin and end records per thread.  Returns the intervals, the
+    instant events and the frame markers."""
+    intervals = []
+    events = []
+    frames = []
+
+    for thread in trace.threads.values():
+        stack = []
+        for tsc, kind, id, draw, count in thread.records:
+            if kind == TRACE_BEGIN:
+                stack.append(Interval(thread.index, id, draw, tsc))
+            elif kind == TRACE_END:
+                # Unwind to the matching begin, dropping unmatched ones.
+                while stack and stack[-1].id != id:
+                    stack.pop()
+                if not stack:
+                    continue
+                interval = stack.pop()
+                interval.end = tsc
+                interval.count = count
+                # The draw is only known once the API thread picked the
+                # draw context, so take it from the end record.
+                interval.draw = draw
+                if stack:
+                    stack[-1].child_time += tsc - interval.begin
+                intervals.append(interval)
+            elif kind == TRACE_EVENT:
+                events.append((thread.index, tsc, id, draw, count))
+            elif kind == TRACE_FRAME:
+                frames.append((tsc, draw))
+
+    intervals.sort(key=lambda i: i.begin)
+    frames.sort()
+    return intervals, events, frames
+
+
+def ms(trace, ticks):
+    return ticks * 1e3 / trace.tsc_frequency
+
+
+def print_stages(trace, intervals, events, out):
+    total = collections.defaultdict(int)
+    exclusive = collections.defaultdict(int)
+    calls = collections.defaultdict(int)
+    counts = collections.defaultdict(int)
+    for i in intervals:
+        total[i.id] += i.end - i.begin
+        exclusive[i.id] += i.end - i.begin - i.child_time
+        calls[i.id] += 1
+        counts[i.id] += i.count
+    for _, _, id, _, count in events:
+        calls[id] += 1
+        counts[id] += count
+
+    print('Per stage (all threads)', file=out)
+    print('%-28s %10s %12s %12s %10s %12s' %
+          ('stage', 'calls', 'total ms', 'self ms', 'avg us', 'count'), file=out)
+    for id in sorted(calls, key=lambda id: -exclusive[id]):
+        avg = ms(trace, total[id]) * 1e3 / calls[id] if total[id] else 0
+        print('%-28s %10d %12.3f %12.3f %10.2f %12d' %
+              (trace.name(id), calls[id], ms(trace, total[id]),
+               ms(trace, exclusive[id]), avg, counts[id]), file=out)
+    print(file=out)
+
+
+def print_threads(trace, intervals, out):
+    busy = collections.defaultdict(int)
+    top = collections.defaultdict(lambda: collections.defaultdict(int))
+    span = {}
+    for i in intervals:
+        busy[i.thread] += i.end - i.begin - i.child_time
+        top[i.thread][i.id] += i.end - i.begin - i.child_time
+        lo, hi = span.get(i.thread, (i.begin, i.end))
+        span[i.thread] = (min(lo, i.begin), max(hi, i.end))
+
+    print('Per thread', file=out)
+    print('%-12s %10s %10s %8s %8s  %s' %
+          ('thread', 'span ms', 'busy ms', 'busy %', 'dropped', 'top stages (self ms)'), file=out)
+    for index in sorted(trace.threads):
+        thread = trace.threads[index]
+        lo, hi = span.get(index, (0, 0))
+        wall = hi - lo
+        stages = sorted(top[index].items(), key=lambda kv: -kv[1])[:3]
+        print('%-12s %10.3f %10.3f %7.1f%% %8d  %s' %
+              (thread.name, ms(trace, wall), ms(trace, busy[index]),
+               100.0 * busy[index] / wall if wall else 0, thread.dropped,
+               ', '.join('%s %.3f' % (trace.name(id), ms(trace, t)) for id, t in stages)),
+              file=out)
+    print(file=out)
+
+
+def print_draws(trace, intervals, num_draws, out):
+    draws = {}
+    for i in intervals:
+        # Waiting for work is not part of any draw.
+        if trace.name(i.id) in ('WorkerWaitForThreadEvent', 'WorkerWorkOnFifoBE'):
+            continue
+        d = draws.setdefault(i.draw, {'begin': i.begin, 'end': i.end,
+                                      'fe': 0, 'be': 0, 'api': 0,
+                                      'threads': set()})
+        d['begin'] = min(d['begin'], i.begin)
+        d['end'] = max(d['end'], i.end)
+        d['threads'].add(i.thread)
+        self_time = i.end - i.begin - i.child_time
+        prefix = trace.name(i.id)[:2]
+        if prefix == 'FE':
+            d['fe'] += self_time
+        elif prefix == 'BE' or trace.name(i.id) == 'WorkerFoundWork':
+            d['be'] += self_time
+        elif prefix == 'AP':
+            d['api'] += self_time
+
+    print('Per draw, %d longest of %d (times in ms, latency from first to last record)' %
+          (min(num_draws, len(draws)), len(draws)), file=out)
+    print('%10s %12s %10s %10s %10s %10s %8s' %
+          ('draw', 'start', 'latency', 'api', 'fe', 'be', 'threads'), file=out)
+    longest = sorted(draws.items(), key=lambda kv: kv[1]['begin'] - kv[1]['end'])[:num_draws]
+    for draw, d in sorted(longest, key=lambda kv: kv[0]):
+        print('%10d %12.3f %10.3f %10.3f %10.3f %10.3f %8d' %
+              (draw, trace.us(d['begin']) / 1e3, ms(trace, d['end'] - d['begin']),
+               ms(trace, d['api']), ms(trace, d['fe']), ms(trace, d['be']),
+               len(d['threads'])), file=out)
+    print(file=out)
+
+
+def print_frames(trace, frames, out):
+    if len(frames) < 2:
+        return
+    times = [ms(trace, b[0] - a[0]) for a, b in zip(frames, frames[1:])]
+    times.sort()
+    print('Frames: %d, frame time ms min %.3f median %.3f max %.3f' %
+          (len(frames), times[0], times[len(times) // 2], times[-1]), file=out)
+    print(file=out)
+
+
+def write_chrome(trace, intervals, events, frames, filename):
+    out = []
+    for index, thread in trace.threads.items():
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': index,
+                    'args': {'name': thread.name}})
+        out.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': 0, 'tid': index,
+                    'args': {'sort_index': index}})
+    for i in intervals:
+        out.append({'name': trace.name(i.id), 'ph': 'X', 'pid': 0, 'tid': i.thread,
+                    'ts': trace.us(i.begin), 'dur': (i.end - i.begin) * 1e6 / trace.tsc_frequency,
+                    'args': {'draw': i.draw, 'count': i.count}})
+    for thread, tsc, id, draw, count in events:
+        out.append({'name': trace.name(id), 'ph': 'i', 's': 't', 'pid': 0, 'tid': thread,
+                    'ts': trace.us(tsc), 'args': {'draw': draw, 'count': count}})
+    for tsc, frame in frames:
+        out.append({'name': 'Frame %d' % frame, 'ph': 'i', 's': 'g', 'pid': 0, 'tid': 0,
+                    'ts': trace.us(tsc)})
+
+    with open(filename, 'w') as f:
+        json.dump({'traceEvents': out, 'displayTimeUnit': 'ms'}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Analyze an SWR ArchRast trace.')
+    parser.add_argument('trace', help='file written with KNOB_AR_TRACE_FILE')
+    parser.add_argument('--chrome', metavar='FILE',
+                        help='write the timeline as Chrome trace JSON')
+    parser.add_argument('--draws', type=int, default=20,
+                        help='number of draws listed, longest first (default 20)')
+    args = parser.parse_args()
+
+    trace = Trace(args.trace)
+    intervals, events, frames = build_intervals(trace)
+
+    out = sys.stdout
+    print('%s: %d threads, %d intervals, %d events, TSC %.3f GHz' %
+          (args.trace, len(trace.threads), len(intervals), len(events),
+           trace.tsc_frequency / 1e9), file=out)
+    dropped = sum(t.dropped for t in trace.threads.values())
+    if dropped:
+        print('WARNING: %d records were dropped, the timeline has gaps' % dropped, file=out)
+    print(file=out)
+
+    print_frames(trace, frames, out)
+    print_stages(trace, intervals, events, out)
+    print_threads(trace, intervals, out)
+    print_draws(trace, intervals, args.draws, out)
+
+    if args.chrome:
+        write_chrome(trace, intervals, events, frames, args.chrome)
+
+
+if __name__ == '__main__':
+    main()
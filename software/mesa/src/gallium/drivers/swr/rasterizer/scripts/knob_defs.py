@@ -53,6 +53,17 @@ KNOBS = [
         'category'  : 'perf',
     }],
 
+    ['USE_SIMD16_FRONTEND', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Run fetch/VS in 16 vertex batches and assemble, clip and bin',
+                       'triangles 16 at a time.  Used for draws without tessellation,',
+                       'GS or streamout on topologies handled by the cut-aware PA.',
+                       'Emulated with AVX2 pairs unless built for AVX512.  Ignored',
+                       'on AVX builds.'],
+        'category'  : 'perf',
+    }],
+
     ['MAX_NUMA_NODES', {
         'type'      : 'uint32_t',
         'default'   : '0',
@@ -146,6 +157,17 @@ KNOBS = [
     }],
 
 
+    ['AR_TRACE_FILE', {
+        'type'      : 'std::string',
+        'default'   : '',
+        'desc'      : ['Record the start, stop and events of all RDTSC buckets into',
+                       'this binary trace file.  Does not require KNOB_ENABLE_RDTSC.',
+                       'Contexts created after all earlier ones were destroyed',
+                       'write to a new file with a numbered suffix.',
+                       'Process the file with scripts/ar_trace_analyze.py.'],
+        'category'  : 'perf',
+    }],
+
     ['BUCKETS_ENABLE_THREADVIZ', {
         'type'      : 'bool',
         'default'   : 'false',
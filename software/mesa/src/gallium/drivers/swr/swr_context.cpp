@@ -40,6 +40,7 @@ extern "C" {
 
 #include "api.h"
 #include "backend.h"
+#include "memory/TilingFunctions.h"
 
 static struct pipe_surface *
 swr_create_surface(struct pipe_context *pipe,
@@ -94,6 +95,47 @@ swr_surface_destroy(struct pipe_context *pipe, struct pipe_surface *surf)
 }
 
 
+/*
+ * Copy between a swizzled (SWR_TILE_SWRZ) surface and a linear image of the
+ * same pitch.  Rendering loads and stores the swizzled layout directly, so
+ * only CPU maps and blit sources pay for this.
+ */
+static void
+swr_swizzle_copy(const SWR_SURFACE_STATE *surf,
+                 uint8_t *linear,
+                 unsigned width,
+                 unsigned height,
+                 boolean to_linear)
+{
+   const unsigned cpp = GetFormatInfo(surf->format).Bpp;
+   unsigned inner[KNOB_TILE_Y_DIM][KNOB_TILE_X_DIM];
+
+   assert(surf->tileMode == SWR_TILE_SWRZ);
+   assert(width % KNOB_TILE_X_DIM == 0 && height % KNOB_TILE_Y_DIM == 0);
+
+   /* Every raster tile shares the same pixel order */
+   for (unsigned ry = 0; ry < KNOB_TILE_Y_DIM; ry++)
+      for (unsigned rx = 0; rx < KNOB_TILE_X_DIM; rx++)
+         inner[ry][rx] = ComputeSurfaceOffset<false>(rx, ry, 0, 0, 0, 0, surf);
+
+   for (unsigned y = 0; y < height; y += KNOB_TILE_Y_DIM) {
+      for (unsigned x = 0; x < width; x += KNOB_TILE_X_DIM) {
+         uint8_t *tile = surf->pBaseAddress
+            + ComputeSurfaceOffset<false>(x, y, 0, 0, 0, 0, surf);
+
+         for (unsigned ry = 0; ry < KNOB_TILE_Y_DIM; ry++) {
+            uint8_t *row = linear + (y + ry) * surf->pitch + x * cpp;
+            for (unsigned rx = 0; rx < KNOB_TILE_X_DIM; rx++) {
+               if (to_linear)
+                  memcpy(row + rx * cpp, tile + inner[ry][rx], cpp);
+               else
+                  memcpy(tile + inner[ry][rx], row + rx * cpp, cpp);
+            }
+         }
+      }
+   }
+}
+
 static void *
 swr_transfer_map(struct pipe_context *pipe,
                  struct pipe_resource *resource,
@@ -134,25 +176,61 @@ swr_transfer_map(struct pipe_context *pipe,
       }
    }
 
-   pt = CALLOC_STRUCT(pipe_transfer);
-   if (!pt)
+   struct swr_transfer *st = CALLOC_STRUCT(swr_transfer);
+   if (!st)
       return NULL;
+   pt = &st->base;
    pipe_resource_reference(&pt->resource, resource);
    pt->level = level;
+   pt->usage = (enum pipe_transfer_usage)usage;
    pt->box = *box;
    pt->stride = spr->row_stride[level];
    pt->layer_stride = spr->img_stride[level];
 
+   /* Swizzled resources are mapped through a detiled copy */
+   uint8_t *base = spr->swr.pBaseAddress;
+   if (spr->swr.tileMode != SWR_TILE_NONE) {
+      st->linear = (uint8_t *)AlignedMalloc(spr->img_stride[0], 64);
+      if (!st->linear) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(st);
+         return NULL;
+      }
+      if (!(usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))
+         swr_swizzle_copy(&spr->swr, st->linear,
+                          spr->alignedWidth, spr->alignedHeight, TRUE);
+      base = st->linear;
+   }
+
    /* if we're mapping the depth/stencil, copy in stencil */
-   if (spr->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+   if ((spr->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+        || spr->base.format == PIPE_FORMAT_Z32_FLOAT_S8X24_UINT)
        && spr->has_stencil) {
-      for (unsigned i = 0; i < spr->alignedWidth * spr->alignedHeight; i++) {
-         spr->swr.pBaseAddress[4 * i + 3] = spr->secondary.pBaseAddress[i];
+      unsigned num_pixels = spr->alignedWidth * spr->alignedHeight;
+      uint8_t *stencil = spr->secondary.pBaseAddress;
+      if (spr->secondary.tileMode != SWR_TILE_NONE) {
+         /* kept until unmap, which has no way to fail */
+         st->stencil = (uint8_t *)AlignedMalloc(num_pixels, 64);
+         if (!st->stencil) {
+            if (st->linear)
+               AlignedFree(st->linear);
+            pipe_resource_reference(&pt->resource, NULL);
+            FREE(st);
+            return NULL;
+         }
+         stencil = st->stencil;
+         swr_swizzle_copy(&spr->secondary, stencil,
+                          spr->alignedWidth, spr->alignedHeight, TRUE);
       }
-   } else if (spr->base.format == PIPE_FORMAT_Z32_FLOAT_S8X24_UINT
-              && spr->has_stencil) {
-      for (unsigned i = 0; i < spr->alignedWidth * spr->alignedHeight; i++) {
-         spr->swr.pBaseAddress[8 * i + 4] = spr->secondary.pBaseAddress[i];
+
+      if (spr->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT) {
+         for (unsigned i = 0; i < num_pixels; i++) {
+            base[4 * i + 3] = stencil[i];
+         }
+      } else {
+         for (unsigned i = 0; i < num_pixels; i++) {
+            base[8 * i + 4] = stencil[i];
+         }
       }
    }
 
@@ -161,7 +239,7 @@ swr_transfer_map(struct pipe_context *pipe,
 
    *transfer = pt;
 
-   return spr->swr.pBaseAddress + offset + spr->mip_offsets[level];
+   return base + offset + spr->mip_offsets[level];
 }
 
 static void
@@ -170,21 +248,44 @@ swr_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
    assert(transfer->resource);
 
    struct swr_resource *res = swr_resource(transfer->resource);
+   struct swr_transfer *st = swr_transfer(transfer);
+   uint8_t *base = st->linear ? st->linear : res->swr.pBaseAddress;
+
    /* if we're mapping the depth/stencil, copy out stencil */
-   if (res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+   if ((res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+        || res->base.format == PIPE_FORMAT_Z32_FLOAT_S8X24_UINT)
        && res->has_stencil) {
-      for (unsigned i = 0; i < res->alignedWidth * res->alignedHeight; i++) {
-         res->secondary.pBaseAddress[i] = res->swr.pBaseAddress[4 * i + 3];
+      unsigned num_pixels = res->alignedWidth * res->alignedHeight;
+      uint8_t *stencil = st->stencil ? st->stencil
+                                     : res->secondary.pBaseAddress;
+
+      if (res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT) {
+         for (unsigned i = 0; i < num_pixels; i++) {
+            stencil[i] = base[4 * i + 3];
+         }
+      } else {
+         for (unsigned i = 0; i < num_pixels; i++) {
+            stencil[i] = base[8 * i + 4];
+         }
       }
-   } else if (res->base.format == PIPE_FORMAT_Z32_FLOAT_S8X24_UINT
-              && res->has_stencil) {
-      for (unsigned i = 0; i < res->alignedWidth * res->alignedHeight; i++) {
-         res->secondary.pBaseAddress[i] = res->swr.pBaseAddress[8 * i + 4];
+
+      if (st->stencil) {
+         swr_swizzle_copy(&res->secondary, st->stencil,
+                          res->alignedWidth, res->alignedHeight, FALSE);
+         AlignedFree(st->stencil);
       }
    }
 
+   /* write back the detiled copy of a swizzled resource */
+   if (st->linear) {
+      if (transfer->usage & PIPE_TRANSFER_WRITE)
+         swr_swizzle_copy(&res->swr, st->linear,
+                          res->alignedWidth, res->alignedHeight, FALSE);
+      AlignedFree(st->linear);
+   }
+
    pipe_resource_reference(&transfer->resource, NULL);
-   FREE(transfer);
+   FREE(st);
 }
 
 
@@ -252,6 +353,26 @@ swr_blit(struct pipe_context *pipe, const struct pipe_blit_info *blit_info)
       return;
    }
 
+   /* util_blitter samples the source, and swizzled resources can't be
+    * sampled, so blit from a linear copy instead */
+   struct pipe_resource *linear_src = NULL;
+   if (swr_resource(info.src.resource)->swr.tileMode != SWR_TILE_NONE) {
+      struct pipe_resource templ = *info.src.resource;
+      struct pipe_box box;
+
+      templ.bind = PIPE_BIND_SAMPLER_VIEW;
+      linear_src = pipe->screen->resource_create(pipe->screen, &templ);
+      if (!linear_src) {
+         debug_printf("swr: cannot allocate linear blit source\n");
+         return;
+      }
+
+      u_box_2d(0, 0, templ.width0, templ.height0, &box);
+      swr_resource_copy(pipe, linear_src, 0, 0, 0, 0,
+                        info.src.resource, 0, &box);
+      info.src.resource = linear_src;
+   }
+
    /* XXX turn off occlusion and streamout queries */
 
    util_blitter_save_vertex_buffer_slot(ctx->blitter, ctx->vertex_buffer);
@@ -286,6 +407,8 @@ swr_blit(struct pipe_context *pipe, const struct pipe_blit_info *blit_info)
                                       ctx->render_cond_mode);
 
    util_blitter_blit(ctx->blitter, &info);
+
+   pipe_resource_reference(&linear_src, NULL);
 }
 
 
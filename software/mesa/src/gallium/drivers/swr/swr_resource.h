@@ -57,12 +57,29 @@ struct swr_resource {
 };
 
 
+struct swr_transfer {
+   struct pipe_transfer base;
+
+   /* detiled copy of a swizzled (SWR_TILE_SWRZ) resource */
+   uint8_t *linear;
+
+   /* detiled copy of its swizzled stencil, written back at unmap */
+   uint8_t *stencil;
+};
+
+
 static INLINE struct swr_resource *
 swr_resource(struct pipe_resource *resource)
 {
    return (struct swr_resource *)resource;
 }
 
+static INLINE struct swr_transfer *
+swr_transfer(struct pipe_transfer *transfer)
+{
+   return (struct swr_transfer *)transfer;
+}
+
 static INLINE boolean
 swr_resource_is_texture(const struct pipe_resource *resource)
 {
@@ -489,6 +489,30 @@ swr_displaytarget_layout(struct swr_screen *screen, struct swr_resource *res)
    return TRUE;
 }
 
+/*
+ * Depth and stencil buffers whose format matches the core's hot tile format
+ * can be stored in the hot tile layout itself (SWR_TILE_SWRZ), which turns
+ * StoreTiles/LoadTiles into plain copies.  Only buffers that are never
+ * sampled or displayed qualify; CPU maps see a detiled copy.
+ */
+static boolean
+swr_can_tile_depth_stencil(struct swr_screen *screen,
+                           const struct pipe_resource *pt)
+{
+   if (!screen->tiled_depth)
+      return FALSE;
+
+   if (!(pt->bind & PIPE_BIND_DEPTH_STENCIL))
+      return FALSE;
+
+   if (pt->bind & (PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_DISPLAY_TARGET
+                   | PIPE_BIND_SCANOUT | PIPE_BIND_SHARED | PIPE_BIND_LINEAR))
+      return FALSE;
+
+   return (pt->target == PIPE_TEXTURE_2D || pt->target == PIPE_TEXTURE_RECT)
+      && pt->last_level == 0 && pt->array_size == 1 && pt->nr_samples == 0;
+}
+
 static boolean
 swr_texture_layout(struct swr_screen *screen,
                    struct swr_resource *res,
@@ -513,6 +537,13 @@ swr_texture_layout(struct swr_screen *screen,
    res->swr.format = mesa_to_swr_format(fmt);
    res->swr.numSamples = (1 << pt->nr_samples);
 
+   boolean tiled = swr_can_tile_depth_stencil(screen, pt);
+   if (tiled) {
+      if (res->has_depth ? res->swr.format == KNOB_DEPTH_HOT_TILE_FORMAT
+                         : res->swr.format == KNOB_STENCIL_HOT_TILE_FORMAT)
+         res->swr.tileMode = SWR_TILE_SWRZ;
+   }
+
    SWR_FORMAT_INFO finfo = GetFormatInfo(res->swr.format);
 
    unsigned total_size = 0;
@@ -569,13 +600,13 @@ swr_texture_layout(struct swr_screen *screen,
       res->swr.pBaseAddress = (uint8_t *)AlignedMalloc(total_size, 64);
 
       if (res->has_depth && res->has_stencil) {
+         res->secondary.format = R8_UINT;
          SWR_FORMAT_INFO finfo = GetFormatInfo(res->secondary.format);
          res->secondary.width = pt->width0;
          res->secondary.height = pt->height0;
          res->secondary.depth = pt->depth0;
          res->secondary.type = SURFACE_2D;
-         res->secondary.tileMode = SWR_TILE_NONE;
-         res->secondary.format = R8_UINT;
+         res->secondary.tileMode = tiled ? SWR_TILE_SWRZ : SWR_TILE_NONE;
          res->secondary.numSamples = (1 << pt->nr_samples);
          res->secondary.pitch = res->alignedWidth * finfo.Bpp;
 
@@ -738,6 +769,8 @@ swr_create_screen(struct sw_winsys *winsys)
    }
 
    screen->winsys = winsys;
+   screen->tiled_depth = debug_get_bool_option("SWR_TILED_DEPTH", FALSE);
+
    screen->base.get_name = swr_get_name;
    screen->base.get_vendor = swr_get_vendor;
    screen->base.is_format_supported = swr_is_format_supported;
@@ -38,6 +38,9 @@ struct swr_screen {
 
    struct sw_winsys *winsys;
 
+   /* store eligible depth/stencil buffers in the swizzled hot tile layout */
+   boolean tiled_depth;
+
    HANDLE hJitMgr;
 };
 
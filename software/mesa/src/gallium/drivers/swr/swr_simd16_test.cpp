@@ -0,0 +1,626 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Renders the same draws with KNOB_USE_SIMD16_FRONTEND off and on and
+ * checks that both frontends produce identical pixels and pipeline
+ * statistics.  Covers every topology the SIMD16 frontend accepts, plain,
+ * indexed and indexed with primitive restart, plus triangles crossing the
+ * guardband or the near plane, which the 16-wide clipper hands to the
+ * 8-wide one.
+ *
+ * Fetch, vertex and pixel shaders are plain C++, so only the rasterizer
+ * core is needed, not the jitter.
+ *
+ * Usage: swr_simd16_test
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "util/macros.h"
+#include "util/u_math.h"
+
+#include "common/os.h"
+#include "common/formats.h"
+#include "core/api.h"
+#include "core/backend.h"
+#include "core/frontend.h"
+#include "core/knobs.h"
+
+void LoadHotTile(const SWR_SURFACE_STATE *pSrcSurface,
+                 SWR_FORMAT dstFormat,
+                 SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                 UINT x, UINT y, uint32_t renderTargetArrayIndex,
+                 uint8_t *pDstHotTile);
+
+void StoreHotTile(SWR_SURFACE_STATE *pDstSurface,
+                  SWR_FORMAT srcFormat,
+                  SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                  UINT x, UINT y, uint32_t renderTargetArrayIndex,
+                  uint8_t *pSrcHotTile);
+
+void StoreHotTileClear(SWR_SURFACE_STATE *pDstSurface,
+                       SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                       UINT x, UINT y,
+                       const float *pClearColor);
+
+void InitSimLoadTilesTable();
+void InitSimStoreTilesTable();
+void InitSimClearTilesTable();
+
+#if ENABLE_AVX512_SIMD16
+
+#define WIDTH 128
+#define HEIGHT 128
+#define NUM_VERTS 101
+#define NUM_INDICES 157
+#define BASE_VERTEX 3
+#define CUT_INDEX 0xffffffff
+
+static const float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+static const struct {
+   const char *name;
+   PRIMITIVE_TOPOLOGY topology;
+} topologies[] = {
+   { "points", TOP_POINT_LIST },
+   { "lines", TOP_LINE_LIST },
+   { "line_strip", TOP_LINE_STRIP },
+   { "triangles", TOP_TRIANGLE_LIST },
+   { "tri_strip", TOP_TRIANGLE_STRIP },
+   { "lines_adj", TOP_LINE_LIST_ADJ },
+   { "line_strip_adj", TOP_LISTSTRIP_ADJ },
+   { "triangles_adj", TOP_TRI_LIST_ADJ },
+   { "tri_strip_adj", TOP_TRI_STRIP_ADJ },
+};
+
+struct test_case {
+   const char *name;
+   PRIMITIVE_TOPOLOGY topology;
+   bool indexed;
+   bool cut;         /* restart the primitive every few indices */
+   bool guardband;   /* push vertices past the guardband and near plane */
+};
+
+struct vertex {
+   float pos[4];
+   float color[4];
+};
+
+/* private context state, one copy per draw */
+struct test_draw_context {
+   SWR_SURFACE_STATE renderTargets[SWR_NUM_ATTACHMENTS];
+};
+
+static test_draw_context draw_context;
+
+static SWR_STATS stats;
+static SWR_STATS_FE stats_fe;
+
+static uint32_t seed;
+
+/* same sequence on every platform, unlike rand() */
+static float
+frand(float lo, float hi)
+{
+   seed = seed * 1664525u + 1013904223u;
+   return lo + (hi - lo) * (float)(seed >> 8) / 16777216.0f;
+}
+
+static void
+load_hot_tile(HANDLE hPrivateContext, SWR_FORMAT dstFormat,
+              SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+              UINT x, UINT y, uint32_t renderTargetArrayIndex,
+              uint8_t *pDstHotTile)
+{
+   test_draw_context *pDC = (test_draw_context *)hPrivateContext;
+
+   LoadHotTile(&pDC->renderTargets[renderTargetIndex], dstFormat,
+               renderTargetIndex, x, y, renderTargetArrayIndex, pDstHotTile);
+}
+
+static void
+store_hot_tile(HANDLE hPrivateContext, SWR_FORMAT srcFormat,
+               SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+               UINT x, UINT y, uint32_t renderTargetArrayIndex,
+               uint8_t *pSrcHotTile)
+{
+   test_draw_context *pDC = (test_draw_context *)hPrivateContext;
+
+   StoreHotTile(&pDC->renderTargets[renderTargetIndex], srcFormat,
+                renderTargetIndex, x, y, renderTargetArrayIndex, pSrcHotTile);
+}
+
+static void
+store_hot_tile_clear(HANDLE hPrivateContext,
+                     SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                     UINT x, UINT y, const float *pClearColor)
+{
+   test_draw_context *pDC = (test_draw_context *)hPrivateContext;
+
+   StoreHotTileClear(&pDC->renderTargets[renderTargetIndex],
+                     renderTargetIndex, x, y, pClearColor);
+}
+
+static void
+update_stats(HANDLE hPrivateContext, const SWR_STATS *pStats)
+{
+   stats.PsInvocations += pStats->PsInvocations;
+}
+
+static void
+update_stats_fe(HANDLE hPrivateContext, const SWR_STATS_FE *pStats)
+{
+   stats_fe.IaVertices += pStats->IaVertices;
+   stats_fe.IaPrimitives += pStats->IaPrimitives;
+   stats_fe.VsInvocations += pStats->VsInvocations;
+   stats_fe.CInvocations += pStats->CInvocations;
+   stats_fe.CPrimitives += pStats->CPrimitives;
+}
+
+/*
+ * Fetch shader for one stream of struct vertex, reading 32-bit indices
+ * the way the jitted fetch does: lanes past pLastIndex read index 0.
+ */
+static void
+fetch(SWR_FETCH_CONTEXT &fetchInfo, simdvertex &out)
+{
+   const SWR_VERTEX_BUFFER_STATE *vb = &fetchInfo.pStreams[0];
+   int32_t *vertex_id = (int32_t *)&fetchInfo.VertexID;
+   int32_t *cut_mask = (int32_t *)&fetchInfo.CutMask;
+
+   for (unsigned lane = 0; lane < KNOB_SIMD_WIDTH; lane++) {
+      const int32_t *pIndex = &fetchInfo.pIndices[lane];
+      uint32_t index = 0;
+
+      if (!fetchInfo.pLastIndex || pIndex < fetchInfo.pLastIndex)
+         index = *pIndex;
+
+      cut_mask[lane] = index == CUT_INDEX ? -1 : 0;
+
+      uint32_t v = index + fetchInfo.BaseVertex + fetchInfo.StartVertex;
+      vertex_id[lane] = v;
+      if (v >= vb->maxVertex)
+         v = 0;
+
+      const vertex *in = (const vertex *)(vb->pData + v * vb->pitch);
+      for (unsigned c = 0; c < 4; c++) {
+         ((float *)&out.attrib[0].v[c])[lane] = in->pos[c];
+         ((float *)&out.attrib[1].v[c])[lane] = in->color[c];
+      }
+   }
+}
+
+static void
+vertex_shader(HANDLE hPrivateData, SWR_VS_CONTEXT *pVsContext)
+{
+   pVsContext->pVout->attrib[VERTEX_POSITION_SLOT] =
+      pVsContext->pVin->attrib[0];
+   pVsContext->pVout->attrib[VERTEX_ATTRIB_START_SLOT] =
+      pVsContext->pVin->attrib[1];
+}
+
+/* perspective correct color, as the gallium fragment shader does */
+static void
+pixel_shader(HANDLE hPrivateData, SWR_PS_CONTEXT *pContext)
+{
+   const float *pAttribs = pContext->pPerspAttribs;
+   simdscalar vi = pContext->vI.center;
+   simdscalar vj = pContext->vJ.center;
+   simdscalar vk = _simd_sub_ps(_simd_sub_ps(_simd_set1_ps(1.0f), vi), vj);
+   simdscalar vw = _simd_div_ps(_simd_set1_ps(1.0f),
+                                pContext->vOneOverW.center);
+
+   for (unsigned c = 0; c < 4; c++) {
+      simdscalar v = _simd_mul_ps(_simd_set1_ps(pAttribs[c]), vi);
+      v = _simd_add_ps(v, _simd_mul_ps(_simd_set1_ps(pAttribs[c + 4]), vj));
+      v = _simd_add_ps(v, _simd_mul_ps(_simd_set1_ps(pAttribs[c + 8]), vk));
+      pContext->shaded[0].v[c] = _simd_mul_ps(v, vw);
+   }
+}
+
+static void
+init_surface(SWR_SURFACE_STATE *surf, SWR_FORMAT format,
+             unsigned width, unsigned height)
+{
+   unsigned aligned_width = align(width, KNOB_MACROTILE_X_DIM);
+   unsigned aligned_height = align(height, KNOB_MACROTILE_Y_DIM);
+
+   memset(surf, 0, sizeof(*surf));
+   surf->type = SURFACE_2D;
+   surf->width = width;
+   surf->height = height;
+   surf->depth = 1;
+   surf->numSamples = 1;
+   surf->format = format;
+   surf->tileMode = SWR_TILE_NONE;
+   surf->halign = aligned_width;
+   surf->valign = aligned_height;
+   surf->pitch = aligned_width * GetFormatInfo(format).Bpp;
+   surf->pBaseAddress =
+      (uint8_t *)AlignedMalloc(surf->pitch * aligned_height, 64);
+}
+
+static void
+init_vertices(const test_case *test, std::vector<vertex> &verts)
+{
+   verts.resize(NUM_VERTS);
+
+   for (unsigned i = 0; i < NUM_VERTS; i++) {
+      vertex *v = &verts[i];
+      float w = frand(0.5f, 2.0f);
+
+      v->pos[0] = frand(-1.1f, 1.1f) * w;
+      v->pos[1] = frand(-1.1f, 1.1f) * w;
+      v->pos[2] = frand(-0.9f, 0.9f) * w;
+      v->pos[3] = w;
+      v->color[0] = frand(0.0f, 1.0f);
+      v->color[1] = frand(0.0f, 1.0f);
+      v->color[2] = frand(0.0f, 1.0f);
+      v->color[3] = 1.0f;
+
+      /* adjacency topologies only draw the even vertices */
+      if (!test->guardband || i % 4 != 2)
+         continue;
+
+      /* a guardband of 32768 pixels is 256 NDC units at 128 pixels */
+      switch ((i / 4) % 4) {
+      case 0:
+         v->pos[0] = 600.0f * w;
+         break;
+      case 1:
+         v->pos[1] = -600.0f * w;
+         break;
+      case 2:
+         v->pos[2] = -1.5f * w;
+         break;
+      case 3:
+         v->pos[3] = -w;
+         break;
+      }
+   }
+}
+
+static void
+init_indices(const test_case *test, std::vector<uint32_t> &indices)
+{
+   unsigned next_cut = 5;
+
+   indices.resize(NUM_INDICES);
+
+   for (unsigned i = 0; i < NUM_INDICES; i++) {
+      if (test->cut && i == next_cut) {
+         indices[i] = CUT_INDEX;
+         next_cut += 2 + (unsigned)frand(0.0f, 13.0f);
+      } else {
+         indices[i] = (uint32_t)frand(0.0f, NUM_VERTS - BASE_VERTEX);
+      }
+   }
+}
+
+static void
+set_state(HANDLE ctx, const test_case *test)
+{
+   SWR_RASTSTATE rast_state;
+   memset(&rast_state, 0, sizeof(rast_state));
+   rast_state.cullMode = SWR_CULLMODE_NONE;
+   rast_state.fillMode = SWR_FILLMODE_SOLID;
+   rast_state.frontWinding = SWR_FRONTWINDING_CCW;
+   rast_state.depthClipEnable = 1;
+   rast_state.pointSize = 2.0f;
+   rast_state.lineWidth = 1.0f;
+   rast_state.sampleCount = SWR_MULTISAMPLE_1X;
+   rast_state.pixelLocation = SWR_PIXEL_LOCATION_CENTER;
+   SwrSetRastState(ctx, &rast_state);
+
+   SWR_RECT scissor = { 0, 0, WIDTH, HEIGHT };
+   SwrSetScissorRects(ctx, 1, &scissor);
+
+   SWR_VIEWPORT vp = { 0.0f, 0.0f, WIDTH, HEIGHT, 0.0f, 1.0f };
+   SWR_VIEWPORT_MATRICES vpm;
+   vpm.m00[0] = WIDTH / 2.0f;
+   vpm.m11[0] = HEIGHT / 2.0f;
+   vpm.m22[0] = 0.5f;
+   vpm.m30[0] = WIDTH / 2.0f;
+   vpm.m31[0] = HEIGHT / 2.0f;
+   vpm.m32[0] = 0.5f;
+   SwrSetViewports(ctx, 1, &vp, &vpm);
+
+   SwrSetFetchFunc(ctx, fetch);
+   SwrSetVertexFunc(ctx, vertex_shader);
+
+   SWR_PS_STATE ps_state;
+   memset(&ps_state, 0, sizeof(ps_state));
+   ps_state.pfnPixelShader = pixel_shader;
+   ps_state.inputCoverage = SWR_INPUT_COVERAGE_NORMAL;
+   ps_state.shadingRate = SWR_SHADING_RATE_PIXEL;
+   ps_state.numRenderTargets = 1;
+   ps_state.posOffset = SWR_PS_POSITION_SAMPLE_NONE;
+   ps_state.barycentricsMask = SWR_BARYCENTRIC_PER_PIXEL_MASK;
+   SwrSetPixelShaderState(ctx, &ps_state);
+
+   SWR_DEPTH_STENCIL_STATE depth_stencil_state;
+   memset(&depth_stencil_state, 0, sizeof(depth_stencil_state));
+   SwrSetDepthStencilState(ctx, &depth_stencil_state);
+
+   SWR_BLEND_STATE blend_state;
+   memset(&blend_state, 0, sizeof(blend_state));
+   blend_state.sampleCount = SWR_MULTISAMPLE_1X;
+   SwrSetBlendState(ctx, &blend_state);
+   SwrSetBlendFunc(ctx, 0, NULL);
+
+   SWR_BACKEND_STATE backend_state;
+   memset(&backend_state, 0, sizeof(backend_state));
+   backend_state.numAttributes = 1;
+   backend_state.numComponents[0] = 4;
+   SwrSetBackendState(ctx, &backend_state);
+
+   SWR_FRONTEND_STATE fe_state;
+   memset(&fe_state, 0, sizeof(fe_state));
+   fe_state.provokingVertex = {2, 1, 2};
+   fe_state.topologyProvokingVertex = 0;
+   fe_state.bEnableCutIndex = test->cut;
+   SwrSetFrontendState(ctx, &fe_state);
+}
+
+/* every draw context gets its own copy of the private state */
+static void
+update_draw_context(HANDLE ctx)
+{
+   memcpy(SwrGetPrivateContextState(ctx), &draw_context,
+          sizeof(draw_context));
+}
+
+/* draw the case once into rt and return a copy of its pixels */
+static void
+render(HANDLE ctx, const test_case *test, const std::vector<vertex> &verts,
+       const std::vector<uint32_t> &indices, SWR_SURFACE_STATE *rt,
+       std::vector<float> &pixels)
+{
+   SWR_RECT rect = { 0, 0, WIDTH, HEIGHT };
+
+   memset(&stats, 0, sizeof(stats));
+   memset(&stats_fe, 0, sizeof(stats_fe));
+
+   set_state(ctx, test);
+
+   SWR_VERTEX_BUFFER_STATE vb;
+   memset(&vb, 0, sizeof(vb));
+   vb.index = 0;
+   vb.pitch = sizeof(vertex);
+   vb.pData = (const uint8_t *)&verts[0];
+   vb.size = verts.size() * sizeof(vertex);
+   vb.maxVertex = verts.size();
+   SwrSetVertexBuffers(ctx, 1, &vb);
+
+   update_draw_context(ctx);
+   SwrClearRenderTarget(ctx, SWR_CLEAR_COLOR, clear_color, 0.0f, 0, rect);
+
+   if (test->indexed) {
+      SWR_INDEX_BUFFER_STATE ib;
+      ib.format = R32_UINT;
+      ib.pIndices = &indices[0];
+      ib.size = indices.size() * sizeof(uint32_t);
+      SwrSetIndexBuffer(ctx, &ib);
+      update_draw_context(ctx);
+      SwrDrawIndexed(ctx, test->topology, indices.size(), 0, BASE_VERTEX);
+   } else {
+      update_draw_context(ctx);
+      SwrDraw(ctx, test->topology, 0, verts.size());
+   }
+
+   update_draw_context(ctx);
+   SwrStoreTiles(ctx, SWR_ATTACHMENT_COLOR0, SWR_TILE_INVALID, rect);
+   SwrWaitForIdle(ctx);
+
+   pixels.resize(WIDTH * HEIGHT * 4);
+   for (unsigned y = 0; y < HEIGHT; y++)
+      memcpy(&pixels[y * WIDTH * 4], rt->pBaseAddress + y * rt->pitch,
+             WIDTH * 4 * sizeof(float));
+}
+
+static bool
+run_case(HANDLE ctx, const test_case *test, SWR_SURFACE_STATE *rt)
+{
+   std::vector<vertex> verts;
+   std::vector<uint32_t> indices;
+   std::vector<float> pixels8, pixels16;
+   SWR_STATS stats8, stats16;
+   SWR_STATS_FE stats_fe8, stats_fe16;
+   char name[64];
+
+   snprintf(name, sizeof(name), "%s%s%s%s", test->name,
+            test->indexed ? " indexed" : "", test->cut ? " restart" : "",
+            test->guardband ? " guardband" : "");
+
+   init_vertices(test, verts);
+   init_indices(test, indices);
+
+   /* the knob only picks the frontend, make sure it is honoured */
+   SET_KNOB(USE_SIMD16_FRONTEND, false);
+   PFN_FE_WORK_FUNC func8 =
+      GetProcessDrawFunc(test->indexed, test->cut, false, false, false,
+                         true, test->topology);
+   render(ctx, test, verts, indices, rt, pixels8);
+   stats8 = stats;
+   stats_fe8 = stats_fe;
+
+   SET_KNOB(USE_SIMD16_FRONTEND, true);
+   PFN_FE_WORK_FUNC func16 =
+      GetProcessDrawFunc(test->indexed, test->cut, false, false, false,
+                         true, test->topology);
+   render(ctx, test, verts, indices, rt, pixels16);
+   stats16 = stats;
+   stats_fe16 = stats_fe;
+
+   SET_KNOB(USE_SIMD16_FRONTEND, false);
+
+   if (func8 == func16) {
+      printf("%-40s FAIL: SIMD16 frontend not selected\n", name);
+      return false;
+   }
+
+   unsigned covered = 0;
+   for (unsigned i = 0; i < WIDTH * HEIGHT; i++) {
+      const float *p8 = &pixels8[i * 4];
+      const float *p16 = &pixels16[i * 4];
+
+      if (memcmp(p8, p16, 4 * sizeof(float)) != 0) {
+         printf("%-40s FAIL: pixel %u,%u is "
+                "(%.9g %.9g %.9g %.9g) 8-wide, (%.9g %.9g %.9g %.9g) 16-wide\n",
+                name, i % WIDTH, i / WIDTH,
+                p8[0], p8[1], p8[2], p8[3],
+                p16[0], p16[1], p16[2], p16[3]);
+         return false;
+      }
+      if (memcmp(p8, clear_color, sizeof(clear_color)) != 0)
+         covered++;
+   }
+
+   if (!covered) {
+      printf("%-40s FAIL: nothing drawn\n", name);
+      return false;
+   }
+
+   if (stats_fe8.IaVertices != stats_fe16.IaVertices ||
+       stats_fe8.IaPrimitives != stats_fe16.IaPrimitives ||
+       stats_fe8.VsInvocations != stats_fe16.VsInvocations ||
+       stats_fe8.CInvocations != stats_fe16.CInvocations ||
+       stats_fe8.CPrimitives != stats_fe16.CPrimitives ||
+       stats8.PsInvocations != stats16.PsInvocations) {
+      printf("%-40s FAIL: stats differ, "
+             "ia verts %" PRIu64 "/%" PRIu64 ", "
+             "ia prims %" PRIu64 "/%" PRIu64 ", "
+             "vs %" PRIu64 "/%" PRIu64 ", "
+             "c invocations %" PRIu64 "/%" PRIu64 ", "
+             "c prims %" PRIu64 "/%" PRIu64 ", "
+             "ps %" PRIu64 "/%" PRIu64 "\n", name,
+             stats_fe8.IaVertices, stats_fe16.IaVertices,
+             stats_fe8.IaPrimitives, stats_fe16.IaPrimitives,
+             stats_fe8.VsInvocations, stats_fe16.VsInvocations,
+             stats_fe8.CInvocations, stats_fe16.CInvocations,
+             stats_fe8.CPrimitives, stats_fe16.CPrimitives,
+             stats8.PsInvocations, stats16.PsInvocations);
+      return false;
+   }
+
+   /* clipping splits or drops some of the prims */
+   if (test->guardband && stats_fe8.CPrimitives == stats_fe8.CInvocations) {
+      printf("%-40s FAIL: nothing clipped\n", name);
+      return false;
+   }
+
+   printf("%-40s ok, %5u pixels, %3" PRIu64 " prims in, %3" PRIu64
+          " out of the clipper\n", name, covered, stats_fe8.CInvocations,
+          stats_fe8.CPrimitives);
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   std::vector<test_case> tests;
+   bool pass = true;
+
+#if defined(__GNUC__)
+   if (!__builtin_cpu_supports("avx2")) {
+      printf("CPU lacks AVX2\n");
+      return 77;
+   }
+#endif
+
+   for (unsigned t = 0; t < ARRAY_SIZE(topologies); t++) {
+      test_case test = { topologies[t].name, topologies[t].topology,
+                         false, false, false };
+
+      tests.push_back(test);
+      test.indexed = true;
+      tests.push_back(test);
+      test.cut = true;
+      tests.push_back(test);
+
+      switch (topologies[t].topology) {
+      case TOP_TRIANGLE_LIST:
+      case TOP_TRIANGLE_STRIP:
+      case TOP_TRI_STRIP_ADJ:
+         test.guardband = true;
+         tests.push_back(test);
+         test.indexed = false;
+         test.cut = false;
+         tests.push_back(test);
+         break;
+      default:
+         break;
+      }
+   }
+
+   InitSimLoadTilesTable();
+   InitSimStoreTilesTable();
+   InitSimClearTilesTable();
+
+   SWR_CREATECONTEXT_INFO create_info;
+   memset(&create_info, 0, sizeof(create_info));
+   create_info.driver = GL;
+   create_info.privateStateSize = sizeof(test_draw_context);
+   create_info.pfnLoadTile = load_hot_tile;
+   create_info.pfnStoreTile = store_hot_tile;
+   create_info.pfnClearTile = store_hot_tile_clear;
+   create_info.pfnUpdateStats = update_stats;
+   create_info.pfnUpdateStatsFE = update_stats_fe;
+   HANDLE ctx = SwrCreateContext(&create_info);
+   InitBackendFuncTables();
+   SwrEnableStats(ctx, true);
+
+   SWR_SURFACE_STATE *rt = &draw_context.renderTargets[SWR_ATTACHMENT_COLOR0];
+   init_surface(rt, R32G32B32A32_FLOAT, WIDTH, HEIGHT);
+
+   seed = 1;
+   for (unsigned i = 0; i < tests.size(); i++)
+      pass = run_case(ctx, &tests[i], rt) && pass;
+
+   SwrDestroyContext(ctx);
+   AlignedFree(rt->pBaseAddress);
+
+   printf("%s\n", pass ? "PASS" : "FAIL");
+   return pass ? 0 : 1;
+}
+
+#else
+
+int
+main(int argc, char **argv)
+{
+   /* AVX builds have no SIMD16 frontend, report the test as skipped */
+   printf("SIMD16 frontend not built for " KNOB_ARCH_STR "\n");
+   return 77;
+}
+
+#endif
@@ -695,6 +695,8 @@ swr_update_texture_state(struct swr_context *ctx,
          struct pipe_resource *res = view->texture;
          struct swr_resource *swr_res = swr_resource(res);
          struct swr_jit_texture *jit_tex = &textures[i];
+         /* the JIT sampler only understands linear layouts */
+         assert(swr_res->swr.tileMode == SWR_TILE_NONE);
          memset(jit_tex, 0, sizeof(*jit_tex));
          jit_tex->width = res->width0;
          jit_tex->height = res->height0;
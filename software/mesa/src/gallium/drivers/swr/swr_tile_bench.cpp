@@ -0,0 +1,217 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Measures the per-frame cost of resolving depth and stencil hot tiles,
+ * i.e. storing every macrotile to its surface and loading it back, for the
+ * linear layout and for the swizzled SWR_TILE_SWRZ layout used when
+ * SWR_TILED_DEPTH is set.  Also checks that both layouts resolve to the
+ * same pixels.
+ *
+ * Usage: swr_tile_bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "util/macros.h"
+#include "util/u_math.h"
+
+#include "common/os.h"
+#include "common/formats.h"
+#include "core/state.h"
+#include "core/knobs.h"
+#include "memory/TilingFunctions.h"
+
+void LoadHotTile(const SWR_SURFACE_STATE *pSrcSurface,
+                 SWR_FORMAT dstFormat,
+                 SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                 UINT x, UINT y, uint32_t renderTargetArrayIndex,
+                 uint8_t *pDstHotTile);
+
+void StoreHotTile(SWR_SURFACE_STATE *pDstSurface,
+                  SWR_FORMAT srcFormat,
+                  SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+                  UINT x, UINT y, uint32_t renderTargetArrayIndex,
+                  uint8_t *pSrcHotTile);
+
+void InitSimLoadTilesTable();
+void InitSimStoreTilesTable();
+
+static const struct {
+   unsigned width, height;
+} resolutions[] = {
+   { 640, 480 },
+   { 1280, 720 },
+   { 1920, 1080 },
+   { 2560, 1440 },
+   { 3840, 2160 },
+};
+
+static const struct {
+   const char *name;
+   SWR_FORMAT format;
+   SWR_RENDERTARGET_ATTACHMENT attachment;
+} buffers[] = {
+   { "depth", KNOB_DEPTH_HOT_TILE_FORMAT, SWR_ATTACHMENT_DEPTH },
+   { "stencil", KNOB_STENCIL_HOT_TILE_FORMAT, SWR_ATTACHMENT_STENCIL },
+};
+
+static void
+init_surface(SWR_SURFACE_STATE *surf, SWR_FORMAT format,
+             SWR_TILE_MODE tile_mode, unsigned width, unsigned height)
+{
+   unsigned aligned_width = align(width, KNOB_MACROTILE_X_DIM);
+   unsigned aligned_height = align(height, KNOB_MACROTILE_Y_DIM);
+
+   memset(surf, 0, sizeof(*surf));
+   surf->type = SURFACE_2D;
+   surf->width = width;
+   surf->height = height;
+   surf->depth = 1;
+   surf->numSamples = 1;
+   surf->format = format;
+   surf->tileMode = tile_mode;
+   surf->halign = aligned_width;
+   surf->valign = aligned_height;
+   surf->pitch = aligned_width * GetFormatInfo(format).Bpp;
+   surf->pBaseAddress =
+      (uint8_t *)AlignedMalloc(surf->pitch * aligned_height, 64);
+   memset(surf->pBaseAddress, 0, surf->pitch * aligned_height);
+}
+
+/* store then reload every macrotile of the surface */
+static void
+resolve_frame(SWR_SURFACE_STATE *surf, SWR_RENDERTARGET_ATTACHMENT attachment,
+              uint8_t *hot_tiles, unsigned hot_tile_size)
+{
+   for (unsigned y = 0; y < surf->height; y += KNOB_MACROTILE_Y_DIM) {
+      for (unsigned x = 0; x < surf->width; x += KNOB_MACROTILE_X_DIM) {
+         StoreHotTile(surf, surf->format, attachment, x, y, 0, hot_tiles);
+         LoadHotTile(surf, surf->format, attachment, x, y, 0, hot_tiles);
+         hot_tiles += hot_tile_size;
+      }
+   }
+}
+
+static double
+time_frames(SWR_SURFACE_STATE *surf, SWR_RENDERTARGET_ATTACHMENT attachment,
+            uint8_t *hot_tiles, unsigned hot_tile_size, unsigned frames)
+{
+   auto start = std::chrono::high_resolution_clock::now();
+   for (unsigned i = 0; i < frames; i++)
+      resolve_frame(surf, attachment, hot_tiles, hot_tile_size);
+   auto end = std::chrono::high_resolution_clock::now();
+
+   return std::chrono::duration<double, std::milli>(end - start).count()
+      / frames;
+}
+
+/* both layouts must hold the same pixel at every location */
+static bool
+compare_surfaces(const SWR_SURFACE_STATE *linear,
+                 const SWR_SURFACE_STATE *swizzled)
+{
+   unsigned cpp = GetFormatInfo(linear->format).Bpp;
+
+   for (unsigned y = 0; y < linear->height; y++) {
+      for (unsigned x = 0; x < linear->width; x++) {
+         const void *a = ComputeSurfaceAddress<false>(x, y, 0, 0, 0, 0, linear);
+         const void *b = ComputeSurfaceAddress<false>(x, y, 0, 0, 0, 0, swizzled);
+         if (memcmp(a, b, cpp) != 0) {
+            printf("mismatch at %u,%u\n", x, y);
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned frames = argc > 1 ? atoi(argv[1]) : 20;
+   bool pass = true;
+
+   InitSimLoadTilesTable();
+   InitSimStoreTilesTable();
+
+   printf("%-8s %-11s %12s %12s %8s\n",
+          "buffer", "resolution", "linear ms", "swrz ms", "speedup");
+
+   for (unsigned b = 0; b < ARRAY_SIZE(buffers); b++) {
+      const unsigned hot_tile_size = KNOB_MACROTILE_X_DIM
+         * KNOB_MACROTILE_Y_DIM * GetFormatInfo(buffers[b].format).Bpp;
+
+      for (unsigned r = 0; r < ARRAY_SIZE(resolutions); r++) {
+         unsigned width = resolutions[r].width;
+         unsigned height = resolutions[r].height;
+         unsigned num_tiles = align(width, KNOB_MACROTILE_X_DIM)
+            / KNOB_MACROTILE_X_DIM * align(height, KNOB_MACROTILE_Y_DIM)
+            / KNOB_MACROTILE_Y_DIM;
+         SWR_SURFACE_STATE linear, swizzled;
+
+         init_surface(&linear, buffers[b].format, SWR_TILE_NONE,
+                      width, height);
+         init_surface(&swizzled, buffers[b].format, SWR_TILE_SWRZ,
+                      width, height);
+
+         uint8_t *hot_tiles =
+            (uint8_t *)AlignedMalloc(num_tiles * hot_tile_size, 64);
+         for (unsigned i = 0; i < num_tiles * hot_tile_size; i++)
+            hot_tiles[i] = (uint8_t)rand();
+
+         /* resolve the same hot tiles through both layouts */
+         resolve_frame(&linear, buffers[b].attachment,
+                       hot_tiles, hot_tile_size);
+         resolve_frame(&swizzled, buffers[b].attachment,
+                       hot_tiles, hot_tile_size);
+         if (!compare_surfaces(&linear, &swizzled)) {
+            printf("%s %ux%u: layouts differ\n",
+                   buffers[b].name, width, height);
+            pass = false;
+         }
+
+         double linear_ms = time_frames(&linear, buffers[b].attachment,
+                                        hot_tiles, hot_tile_size, frames);
+         double swrz_ms = time_frames(&swizzled, buffers[b].attachment,
+                                      hot_tiles, hot_tile_size, frames);
+
+         printf("%-8s %5ux%-5u %12.3f %12.3f %7.1fx\n",
+                buffers[b].name, width, height,
+                linear_ms, swrz_ms, linear_ms / swrz_ms);
+
+         AlignedFree(hot_tiles);
+         AlignedFree(linear.pBaseAddress);
+         AlignedFree(swizzled.pBaseAddress);
+      }
+   }
+
+   return pass ? 0 : 1;
+}
@@ -133,6 +133,18 @@ struct sw_winsys
                              void *context_private,
                              struct pipe_box *box );
 
+   /**
+    * Present only some rectangles of a display target, the rest being
+    * unchanged since it was last presented to the same context_private.
+    * Optional; drivers use displaytarget_display when it's NULL.
+    */
+   void
+   (*displaytarget_display_rects)( struct sw_winsys *ws,
+                                   struct sw_displaytarget *dt,
+                                   void *context_private,
+                                   const struct pipe_box *boxes,
+                                   unsigned num_boxes );
+
    void 
    (*displaytarget_destroy)( struct sw_winsys *ws, 
                              struct sw_displaytarget *dt );
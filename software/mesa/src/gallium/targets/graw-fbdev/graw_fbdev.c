@@ -0,0 +1,193 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+#include "target-helpers/inline_sw_helper.h"
+#include "target-helpers/inline_debug_helper.h"
+#include "state_tracker/graw.h"
+#include "state_tracker/sw_winsys.h"
+#include "sw/fbdev/fbdev_sw_winsys.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+/*
+ * graw on a Linux framebuffer.  GRAW_FBDEV names the device, /dev/fb0 by
+ * default.  It can also be an existing regular file, or "memfd" for an
+ * anonymous one, which then stands in for a double buffered framebuffer of
+ * the window's size and format; the main loop reports the frame rate, so
+ * the present path can be benchmarked without a display.
+ */
+
+static struct {
+   int fd;
+   struct fbdev_drawable drawable;
+   void (*draw)(void);
+   void (*winsys_destroy)(struct sw_winsys *winsys);
+} graw = { -1 };
+
+
+static int
+graw_open_fbdev(void)
+{
+   const char *path = debug_get_option("GRAW_FBDEV", "/dev/fb0");
+
+   if (strcmp(path, "memfd") == 0) {
+#ifdef __NR_memfd_create
+      return syscall(__NR_memfd_create, "graw-fbdev", 0);
+#else
+      return -1;
+#endif
+   }
+
+   return open(path, O_RDWR);
+}
+
+
+static void
+graw_close_fbdev(void)
+{
+   close(graw.fd);
+   graw.fd = -1;
+}
+
+
+/**
+ * The winsys doesn't own the framebuffer fd, so close it along with the
+ * winsys when the screen is destroyed.
+ */
+static void
+graw_winsys_destroy(struct sw_winsys *winsys)
+{
+   graw.winsys_destroy(winsys);
+   graw_close_fbdev();
+}
+
+
+static struct pipe_screen *
+graw_create_screen(unsigned width, unsigned height, enum pipe_format format)
+{
+   struct pipe_screen *screen = NULL;
+   struct sw_winsys *winsys = NULL;
+   struct fbdev_sw_mode mode;
+
+   if (graw.fd < 0) {
+      graw.fd = graw_open_fbdev();
+      if (graw.fd < 0)
+         return NULL;
+   }
+
+   /* What a file stands in for */
+   mode.width = width;
+   mode.height = height;
+   mode.virtual_height = 2 * height;
+   mode.stride = util_format_get_stride(format, width);
+   mode.format = format;
+
+   winsys = fbdev_create_sw_winsys(graw.fd, &mode);
+   if (winsys == NULL) {
+      graw_close_fbdev();
+      return NULL;
+   }
+
+   graw.winsys_destroy = winsys->destroy;
+   winsys->destroy = graw_winsys_destroy;
+
+   if (!winsys->is_displaytarget_format_supported(winsys,
+                                                  PIPE_BIND_DISPLAY_TARGET,
+                                                  format)) {
+      winsys->destroy(winsys);
+      return NULL;
+   }
+
+   screen = sw_screen_create( winsys );
+   if (screen == NULL) {
+      winsys->destroy(winsys);
+      return NULL;
+   }
+
+   /* Inject any wrapping layers we want to here:
+    */
+   return debug_screen_wrap( screen );
+}
+
+
+struct pipe_screen *
+graw_create_window_and_screen( int x,
+                               int y,
+                               unsigned width,
+                               unsigned height,
+                               enum pipe_format format,
+                               void **handle)
+{
+   struct pipe_screen *screen;
+
+   screen = graw_create_screen(width, height, format);
+   if (screen == NULL)
+      return NULL;
+
+   graw.drawable.x = x;
+   graw.drawable.y = y;
+   *handle = &graw.drawable;
+
+   return screen;
+}
+
+
+void 
+graw_set_display_func( void (*draw)( void ) )
+{
+   graw.draw = draw;
+}
+
+
+void
+graw_main_loop( void )
+{
+   unsigned frames = debug_get_num_option("GRAW_FBDEV_FRAMES", 100);
+   int64_t start, end;
+   unsigned i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < frames; i++)
+      graw.draw();
+   end = os_time_get_nano();
+
+   printf("%u frames in %.3f s, %.1f fps\n", frames,
+          (end - start) / 1e9, frames * 1e9 / MAX2(end - start, 1));
+}
@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# Run osmesa_bench on llvmpipe with 1 up to all CPU cores and print the
+# frame rate of every scene per thread count, with the speedup over the
+# first thread count and the scaling efficiency, that is the speedup
+# divided by the increase in threads.  Extra arguments are passed to
+# osmesa_bench, e.g.
+#
+#   ./llvmpipe_scaling.sh --scene fill --scene small_tris --size 1024x1024
+#
+# Set THREADS to a list of thread counts to override the default of 1, 2,
+# 4, ... up to the number of online CPUs.  Build with --enable-debug and
+# set LP_DEBUG=counters to also get the busy and idle time of every
+# rasterizer thread.  LP_THREAD_AFFINITY=1 binds the rasterizer threads
+# to their own cores, which usually helps with many threads.
+#
+# SWEEP names the variable that is set to each thread count, default
+# LP_NUM_THREADS.  METRIC is the result that is printed, fps (default),
+# tris_per_sec or pixels_per_sec.  The triangle setup and binning
+# throughput is measured with
+#
+#   SWEEP=LP_NUM_BIN_THREADS THREADS="0 1 2 4" METRIC=tris_per_sec \
+#      ./llvmpipe_scaling.sh --scene small_tris --scene vertex
+
+BENCH=${BENCH:-$(dirname "$0")/osmesa_bench}
+SWEEP=${SWEEP:-LP_NUM_THREADS}
+METRIC=${METRIC:-fps}
+
+if [ -z "$THREADS" ]; then
+   cpus=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+   n=1
+   while [ $n -lt $cpus ]; do
+      THREADS="$THREADS $n"
+      n=$((n * 2))
+   done
+   THREADS="$THREADS $cpus"
+fi
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+for n in $THREADS; do
+   echo "$SWEEP=$n" >&2
+   env GALLIUM_DRIVER=llvmpipe "$SWEEP=$n" \
+      "$BENCH" -o "$tmp/$n.json" "$@" || exit $?
+done
+
+# osmesa_bench writes one "name" line and one line per metric per scene
+for n in $THREADS; do
+   awk -F'"' -v threads=$n -v metric="$METRIC" '
+      $2 == "name" { name = $4 }
+      $2 == metric { gsub(/[^0-9.]/, "", $3); print name, threads, $3 }
+   ' "$tmp/$n.json"
+done | awk -v threads="$THREADS" '
+   BEGIN {
+      printf "%-14s", "scene"
+      n = split(threads, t, " ")
+      for (i = 1; i <= n; i++)
+         printf " %14s %13s", t[i] " thr", ""
+      printf "\n"
+   }
+   {
+      if (!($1 in base)) {
+         base[$1] = $3
+         base_threads[$1] = $2
+         order[count++] = $1
+      }
+      line[$1] = line[$1] sprintf(" %14.2f", $3)
+      if (base[$1] > 0 && base_threads[$1] > 0 && $2 > 0) {
+         speedup = $3 / base[$1]
+         line[$1] = line[$1] sprintf(" (%4.2fx %4.0f%%)", speedup,
+                                     100 * speedup * base_threads[$1] / $2)
+      }
+      else if (base[$1] > 0)
+         line[$1] = line[$1] sprintf(" (%4.2fx)      ", $3 / base[$1])
+      else
+         line[$1] = line[$1] sprintf(" %13s", "")
+   }
+   END {
+      for (i = 0; i < count; i++)
+         printf "%-14s%s\n", order[i], line[order[i]]
+   }
+'
@@ -0,0 +1,1385 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Headless rendering benchmark on top of OSMesa.
+ *
+ * Every scene draws fixed geometry with fixed seeds and a fixed number of
+ * frames, so two runs on the same build render exactly the same images and
+ * two runs on different builds are directly comparable.  For each scene the
+ * frame rate, triangle and pixel throughput and the time spent submitting,
+ * finishing and reading back are written as JSON, together with a checksum
+ * of the last frame so that a speedup which changes the rendering does not
+ * go unnoticed.
+ *
+ * A previous run can be passed with --compare; the exit status is then
+ * non-zero when any scene got slower than --threshold percent.  With
+ * --results a saved run is compared instead of rendering a new one.
+ *
+ * The driver is whatever OSMesa picks, e.g. GALLIUM_DRIVER=softpipe.  Note
+ * that softpipe rasterizes while the draw calls are made, so for it most of
+ * the work shows up in the submit stage rather than in the finish stage.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "GL/osmesa.h"
+
+
+#define MAX_SCENES 16
+#define MAX_NAME 32
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+struct scene
+{
+   const char *name;
+   const char *description;
+   unsigned frames;
+
+   void (*setup)(void);
+   void (*draw)(unsigned frame);
+   void (*cleanup)(void);
+
+   /** the scene reads the frame back after each frame */
+   GLboolean readback;
+
+   /** triangles drawn per frame, filled in by setup */
+   unsigned tris;
+
+   /** pixels written per frame when they cannot be counted by a query */
+   double pixels;
+};
+
+
+struct result
+{
+   char name[MAX_NAME];
+   unsigned frames;
+   double seconds;
+   double fps;
+   double tris_per_sec;
+   double pixels_per_sec;
+   double submit_ms;
+   double finish_ms;
+   double readback_ms;
+   unsigned checksum;
+};
+
+
+struct run
+{
+   char renderer[128];
+   unsigned width, height;
+   unsigned num_results;
+   struct result results[MAX_SCENES];
+};
+
+
+static unsigned width = 512;
+static unsigned height = 512;
+
+static GLubyte *readback_buffer;
+
+
+/*
+ * Deterministic pseudo random numbers, so scenes don't depend on the libc.
+ */
+
+static unsigned rand_state;
+
+static void
+bench_srand(unsigned seed)
+{
+   rand_state = seed;
+}
+
+static float
+bench_randf(void)
+{
+   rand_state = rand_state * 1103515245u + 12345u;
+   return (float)((rand_state >> 8) & 0xffff) / 65535.0f;
+}
+
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static unsigned
+checksum_frame(const GLubyte *pixels, unsigned size)
+{
+   unsigned hash = 2166136261u;
+   unsigned i;
+
+   /* FNV-1a */
+   for (i = 0; i < size; i++) {
+      hash ^= pixels[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+
+static void
+setup_2d(void)
+{
+   glViewport(0, 0, width, height);
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glOrtho(0, width, 0, height, -1, 1);
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+   glDisable(GL_DEPTH_TEST);
+   glDisable(GL_BLEND);
+   glDisable(GL_LIGHTING);
+   glDisable(GL_TEXTURE_2D);
+}
+
+
+/**
+ * Full screen quad as two triangles, with texture coordinates repeating
+ * the texture \p repeat times.
+ */
+static void
+draw_screen_quad(float repeat)
+{
+   const GLfloat w = (GLfloat)width, h = (GLfloat)height;
+   const GLfloat verts[6][4] = {
+      { 0, 0, 0,      0      },
+      { w, 0, repeat, 0      },
+      { w, h, repeat, repeat },
+      { 0, 0, 0,      0      },
+      { w, h, repeat, repeat },
+      { 0, h, 0,      repeat },
+   };
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+   glVertexPointer(2, GL_FLOAT, sizeof(verts[0]), &verts[0][0]);
+   glTexCoordPointer(2, GL_FLOAT, sizeof(verts[0]), &verts[0][2]);
+   glDrawArrays(GL_TRIANGLES, 0, 6);
+   glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+   glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+
+/*
+ * clear: color and depth clears only.
+ */
+
+#define CLEARS_PER_FRAME 4
+
+static void
+clear_setup(void)
+{
+   setup_2d();
+}
+
+static void
+clear_draw(unsigned frame)
+{
+   unsigned i;
+
+   for (i = 0; i < CLEARS_PER_FRAME; i++) {
+      unsigned c = frame * CLEARS_PER_FRAME + i;
+
+      glClearColor((c & 1) ? 1.0f : 0.25f,
+                   (c & 2) ? 1.0f : 0.5f,
+                   (c & 4) ? 1.0f : 0.75f,
+                   1.0f);
+      glClearDepth((c & 1) ? 1.0 : 0.5);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+   }
+}
+
+
+/*
+ * fill: overlapping opaque full screen quads.
+ */
+
+#define FILL_LAYERS 8
+
+static void
+fill_setup(void)
+{
+   setup_2d();
+}
+
+static void
+fill_draw(unsigned frame)
+{
+   unsigned i;
+
+   for (i = 0; i < FILL_LAYERS; i++) {
+      unsigned c = frame + i;
+
+      glColor4ub(c * 37, c * 91, c * 13, 255);
+      draw_screen_quad(1.0f);
+   }
+}
+
+
+/*
+ * small_tris: the screen covered with 4x4 pixel triangle pairs.
+ */
+
+#define SMALL_TRI_SIZE 4
+
+static GLuint small_tris_vbo;
+static unsigned small_tris_verts;
+
+static void
+small_tris_setup(void)
+{
+   const unsigned cols = width / SMALL_TRI_SIZE;
+   const unsigned rows = height / SMALL_TRI_SIZE;
+   GLfloat *verts, *v;
+   unsigned x, y;
+
+   setup_2d();
+
+   small_tris_verts = cols * rows * 6;
+   verts = malloc(small_tris_verts * 2 * sizeof(GLfloat));
+   if (!verts)
+      abort();
+
+   v = verts;
+   for (y = 0; y < rows; y++) {
+      for (x = 0; x < cols; x++) {
+         const GLfloat x0 = (GLfloat)(x * SMALL_TRI_SIZE);
+         const GLfloat y0 = (GLfloat)(y * SMALL_TRI_SIZE);
+         const GLfloat x1 = x0 + SMALL_TRI_SIZE;
+         const GLfloat y1 = y0 + SMALL_TRI_SIZE;
+
+         *v++ = x0; *v++ = y0;
+         *v++ = x1; *v++ = y0;
+         *v++ = x1; *v++ = y1;
+         *v++ = x0; *v++ = y0;
+         *v++ = x1; *v++ = y1;
+         *v++ = x0; *v++ = y1;
+      }
+   }
+
+   glGenBuffers(1, &small_tris_vbo);
+   glBindBuffer(GL_ARRAY_BUFFER, small_tris_vbo);
+   glBufferData(GL_ARRAY_BUFFER, small_tris_verts * 2 * sizeof(GLfloat),
+                verts, GL_STATIC_DRAW);
+   free(verts);
+}
+
+static void
+small_tris_draw(unsigned frame)
+{
+   glColor4ub(frame * 53, 255 - frame * 29, 128, 255);
+
+   glBindBuffer(GL_ARRAY_BUFFER, small_tris_vbo);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(2, GL_FLOAT, 0, NULL);
+   glDrawArrays(GL_TRIANGLES, 0, small_tris_verts);
+   glDisableClientState(GL_VERTEX_ARRAY);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void
+small_tris_cleanup(void)
+{
+   glDeleteBuffers(1, &small_tris_vbo);
+}
+
+
+/*
+ * blend: translucent full screen quads blended over each other.
+ */
+
+#define BLEND_LAYERS 8
+
+static void
+blend_setup(void)
+{
+   setup_2d();
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+static void
+blend_draw(unsigned frame)
+{
+   unsigned i;
+
+   for (i = 0; i < BLEND_LAYERS; i++) {
+      unsigned c = frame + i;
+
+      glColor4ub(c * 41, c * 67, c * 23, 64);
+      draw_screen_quad(1.0f);
+   }
+}
+
+static void
+blend_cleanup(void)
+{
+   glDisable(GL_BLEND);
+}
+
+
+/*
+ * texture: full screen quads sampling a mipmapped texture with trilinear
+ * filtering at a few different scales.
+ */
+
+#define TEXTURE_SIZE 256
+#define TEXTURE_LAYERS 4
+
+static GLuint texture_obj;
+
+static void
+texture_setup(void)
+{
+   GLubyte *texels;
+   unsigned i;
+
+   setup_2d();
+
+   texels = malloc(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+   if (!texels)
+      abort();
+
+   bench_srand(0x7e57);
+   for (i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; i++) {
+      const unsigned x = i % TEXTURE_SIZE, y = i / TEXTURE_SIZE;
+      const GLubyte check = ((x / 16) ^ (y / 16)) & 1 ? 255 : 64;
+
+      texels[i * 4 + 0] = check;
+      texels[i * 4 + 1] = (GLubyte)(bench_randf() * 255.0f);
+      texels[i * 4 + 2] = (GLubyte)x;
+      texels[i * 4 + 3] = 255;
+   }
+
+   glGenTextures(1, &texture_obj);
+   glBindTexture(GL_TEXTURE_2D, texture_obj);
+   glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                   GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+   glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TEXTURE_SIZE, TEXTURE_SIZE, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, texels);
+   free(texels);
+
+   glEnable(GL_TEXTURE_2D);
+}
+
+static void
+texture_draw(unsigned frame)
+{
+   unsigned i;
+
+   for (i = 0; i < TEXTURE_LAYERS; i++) {
+      glColor4ub(255, 255 - (frame + i) * 8, 255, 255);
+      draw_screen_quad(1.0f + (float)((frame + i) % 7) * 0.75f);
+   }
+}
+
+static void
+texture_cleanup(void)
+{
+   glDisable(GL_TEXTURE_2D);
+   glDeleteTextures(1, &texture_obj);
+}
+
+
+/*
+ * vertex: a finely tessellated, lit sphere so that the vertex pipeline
+ * dominates over rasterization.
+ */
+
+#define SPHERE_SLICES 128
+#define SPHERE_STACKS 128
+
+static GLuint sphere_vbo, sphere_ibo;
+static unsigned sphere_indices;
+
+static void
+vertex_setup(void)
+{
+   static const GLfloat light0_pos[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+   static const GLfloat light1_pos[4] = { -1.0f, 0.5f, 0.5f, 0.0f };
+   static const GLfloat light1_color[4] = { 0.4f, 0.4f, 0.8f, 1.0f };
+   const unsigned num_verts = (SPHERE_SLICES + 1) * (SPHERE_STACKS + 1);
+   GLfloat *verts, *v;
+   GLushort *indices, *idx;
+   unsigned i, j;
+
+   glViewport(0, 0, width, height);
+   glMatrixMode(GL_PROJECTION);
+   glLoadIdentity();
+   glFrustum(-1.0, 1.0, -1.0, 1.0, 2.0, 10.0);
+   glMatrixMode(GL_MODELVIEW);
+   glLoadIdentity();
+
+   glEnable(GL_DEPTH_TEST);
+   glDisable(GL_BLEND);
+   glDisable(GL_TEXTURE_2D);
+   glEnable(GL_LIGHTING);
+   glEnable(GL_LIGHT0);
+   glEnable(GL_LIGHT1);
+   glLightfv(GL_LIGHT0, GL_POSITION, light0_pos);
+   glLightfv(GL_LIGHT1, GL_POSITION, light1_pos);
+   glLightfv(GL_LIGHT1, GL_DIFFUSE, light1_color);
+   glEnable(GL_COLOR_MATERIAL);
+
+   /* interleaved position and normal, which are the same on a unit sphere */
+   verts = malloc(num_verts * 6 * sizeof(GLfloat));
+   sphere_indices = SPHERE_SLICES * SPHERE_STACKS * 6;
+   indices = malloc(sphere_indices * sizeof(GLushort));
+   if (!verts || !indices)
+      abort();
+
+   v = verts;
+   for (j = 0; j <= SPHERE_STACKS; j++) {
+      const double phi = M_PI * j / SPHERE_STACKS;
+
+      for (i = 0; i <= SPHERE_SLICES; i++) {
+         const double theta = 2.0 * M_PI * i / SPHERE_SLICES;
+         const GLfloat x = (GLfloat)(sin(phi) * cos(theta));
+         const GLfloat y = (GLfloat)cos(phi);
+         const GLfloat z = (GLfloat)(sin(phi) * sin(theta));
+
+         *v++ = x; *v++ = y; *v++ = z;
+         *v++ = x; *v++ = y; *v++ = z;
+      }
+   }
+
+   idx = indices;
+   for (j = 0; j < SPHERE_STACKS; j++) {
+      for (i = 0; i < SPHERE_SLICES; i++) {
+         const GLushort a = j * (SPHERE_SLICES + 1) + i;
+         const GLushort b = a + SPHERE_SLICES + 1;
+
+         *idx++ = a; *idx++ = b; *idx++ = a + 1;
+         *idx++ = a + 1; *idx++ = b; *idx++ = b + 1;
+      }
+   }
+
+   glGenBuffers(1, &sphere_vbo);
+   glBindBuffer(GL_ARRAY_BUFFER, sphere_vbo);
+   glBufferData(GL_ARRAY_BUFFER, num_verts * 6 * sizeof(GLfloat),
+                verts, GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glGenBuffers(1, &sphere_ibo);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere_ibo);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere_indices * sizeof(GLushort),
+                indices, GL_STATIC_DRAW);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+   free(verts);
+   free(indices);
+}
+
+static void
+vertex_draw(unsigned frame)
+{
+   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+   glPushMatrix();
+   glTranslatef(0.0f, 0.0f, -4.0f);
+   glRotatef(frame * 3.0f, 0.3f, 1.0f, 0.1f);
+   glScalef(1.5f, 1.5f, 1.5f);
+   glColor4ub(200, 160 + frame % 64, 96, 255);
+
+   glBindBuffer(GL_ARRAY_BUFFER, sphere_vbo);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere_ibo);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 6 * sizeof(GLfloat), NULL);
+   glNormalPointer(GL_FLOAT, 6 * sizeof(GLfloat),
+                   (const GLvoid *)(3 * sizeof(GLfloat)));
+   glDrawElements(GL_TRIANGLES, sphere_indices, GL_UNSIGNED_SHORT, NULL);
+   glDisableClientState(GL_NORMAL_ARRAY);
+   glDisableClientState(GL_VERTEX_ARRAY);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glPopMatrix();
+}
+
+static void
+vertex_cleanup(void)
+{
+   glDeleteBuffers(1, &sphere_ibo);
+   glDeleteBuffers(1, &sphere_vbo);
+   glDisable(GL_COLOR_MATERIAL);
+   glDisable(GL_LIGHT1);
+   glDisable(GL_LIGHT0);
+   glDisable(GL_LIGHTING);
+   glDisable(GL_DEPTH_TEST);
+}
+
+
+/*
+ * many_draws: one small quad per draw call with a state change in between,
+ * to measure per draw overhead.
+ */
+
+#define MANY_DRAWS_GRID 64
+
+static void
+many_draws_setup(void)
+{
+   setup_2d();
+}
+
+static void
+many_draws_draw(unsigned frame)
+{
+   const GLfloat cell_w = (GLfloat)width / MANY_DRAWS_GRID;
+   const GLfloat cell_h = (GLfloat)height / MANY_DRAWS_GRID;
+   const GLfloat verts[6][2] = {
+      { 0,      0      },
+      { cell_w, 0      },
+      { cell_w, cell_h },
+      { 0,      0      },
+      { cell_w, cell_h },
+      { 0,      cell_h },
+   };
+   unsigned x, y;
+
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glVertexPointer(2, GL_FLOAT, 0, verts);
+
+   for (y = 0; y < MANY_DRAWS_GRID; y++) {
+      for (x = 0; x < MANY_DRAWS_GRID; x++) {
+         glColor4ub(x * 4, y * 4, frame * 16, 255);
+         glPushMatrix();
+         glTranslatef(x * cell_w, y * cell_h, 0.0f);
+         glDrawArrays(GL_TRIANGLES, 0, 6);
+         glPopMatrix();
+      }
+   }
+
+   glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/*
+ * display_lists: legacy glBegin/glEnd geometry compiled into a display
+ * list and called several times per frame.  The list holds one triangle
+ * strip per row of a grid followed by many single quad glBegin/glEnd
+ * blocks, so it measures both display list replay and how well
+ * consecutive small primitives get batched.
+ */
+
+#define DL_STRIP_ROWS 32
+#define DL_STRIP_COLS 64
+#define DL_QUAD_GRID 32
+#define DL_CALLS 4
+
+static GLuint dl_list;
+
+static void
+display_lists_setup(void)
+{
+   const GLfloat cell_w = 1.0f / DL_STRIP_COLS;
+   const GLfloat cell_h = 0.5f / DL_STRIP_ROWS;
+   const GLfloat quad_size = 0.5f / DL_QUAD_GRID;
+   unsigned x, y;
+
+   setup_2d();
+
+   /* the list is drawn in a unit square, scaled at call time */
+   dl_list = glGenLists(1);
+   glNewList(dl_list, GL_COMPILE);
+
+   for (y = 0; y < DL_STRIP_ROWS; y++) {
+      glBegin(GL_TRIANGLE_STRIP);
+      for (x = 0; x <= DL_STRIP_COLS; x++) {
+         glColor3ub(x * 4, y * 8, 128);
+         glVertex2f(x * cell_w, y * cell_h);
+         glColor3ub(x * 4, y * 8 + 8, 160);
+         glVertex2f(x * cell_w, (y + 1) * cell_h);
+      }
+      glEnd();
+   }
+
+   for (y = 0; y < DL_QUAD_GRID; y++) {
+      for (x = 0; x < DL_QUAD_GRID; x++) {
+         const GLfloat x0 = x * 2 * quad_size;
+         const GLfloat y0 = 0.5f + y * quad_size;
+
+         glBegin(GL_QUADS);
+         glColor3ub(255 - x * 8, y * 8, x * 4);
+         glVertex2f(x0, y0);
+         glVertex2f(x0 + quad_size, y0);
+         glVertex2f(x0 + quad_size, y0 + quad_size);
+         glVertex2f(x0, y0 + quad_size);
+         glEnd();
+      }
+   }
+
+   glEndList();
+}
+
+static void
+display_lists_draw(unsigned frame)
+{
+   unsigned i;
+
+   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   for (i = 0; i < DL_CALLS; i++) {
+      const GLfloat half_w = width / 2.0f, half_h = height / 2.0f;
+
+      glPushMatrix();
+      glTranslatef((i & 1) * half_w + (frame % 8), (i >> 1) * half_h, 0.0f);
+      glScalef(half_w, half_h, 1.0f);
+      glCallList(dl_list);
+      glPopMatrix();
+   }
+}
+
+static void
+display_lists_cleanup(void)
+{
+   glDeleteLists(dl_list, 1);
+}
+
+
+
+/*
+ * shaders: a load screen that builds many small GLSL programs and then
+ * draws one quad with each of them, so it measures compile and link time.
+ * Every program differs in a constant and all of them also carry a per
+ * run comment, which keeps the on-disk shader cache from hiding the
+ * compiler.  Programs are only queried when they are first used, as an
+ * application that compiles in the background would do.
+ */
+
+#define SHADER_GRID_X 8
+#define SHADER_GRID_Y 6
+#define SHADER_PROGRAMS (SHADER_GRID_X * SHADER_GRID_Y)
+
+static const char *shader_vs_template =
+   "// osmesa_bench run %u\n"
+   "#version 110\n"
+   "varying vec3 normal;\n"
+   "varying vec2 coord;\n"
+   "void main()\n"
+   "{\n"
+   "   vec4 pos = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+   "   normal = normalize(vec3(pos.xy * %u.0, 1.0));\n"
+   "   coord = gl_Vertex.xy;\n"
+   "   gl_Position = pos;\n"
+   "}\n";
+
+static const char *shader_fs_template =
+   "// osmesa_bench run %u\n"
+   "#version 110\n"
+   "varying vec3 normal;\n"
+   "varying vec2 coord;\n"
+   "vec3 shade(vec3 n, vec3 l)\n"
+   "{\n"
+   "   float d = max(dot(n, normalize(l)), 0.0);\n"
+   "   float s = pow(max(reflect(-l, n).z, 0.0), 16.0);\n"
+   "   return vec3(d) + vec3(s) * 0.5;\n"
+   "}\n"
+   "void main()\n"
+   "{\n"
+   "   vec3 c = vec3(0.0);\n"
+   "   for (int i = 0; i < 4; i++)\n"
+   "      c += shade(normal, vec3(float(i) - 1.5, 1.0, 2.0)) * 0.25;\n"
+   "   c *= vec3(%u.0 / %u.0, fract(coord.x * 0.01), 0.5);\n"
+   "   gl_FragColor = vec4(c, 1.0);\n"
+   "}\n";
+
+static unsigned shader_salt;
+
+static GLuint
+shaders_compile(GLenum type, const char *template, unsigned a, unsigned b)
+{
+   char source[1024];
+   const GLchar *sources[1];
+   GLuint shader = glCreateShader(type);
+
+   snprintf(source, sizeof source, template, shader_salt, a, b);
+   sources[0] = source;
+   glShaderSource(shader, 1, sources, NULL);
+   glCompileShader(shader);
+   return shader;
+}
+
+static void
+shaders_setup(void)
+{
+   setup_2d();
+   shader_salt = (unsigned)(get_time() * 1000.0);
+}
+
+static void
+shaders_draw(unsigned frame)
+{
+   const GLfloat cell_w = (GLfloat)width / SHADER_GRID_X;
+   const GLfloat cell_h = (GLfloat)height / SHADER_GRID_Y;
+   GLuint programs[SHADER_PROGRAMS];
+   GLuint shaders[SHADER_PROGRAMS][2];
+   unsigned i;
+
+   /* new sources every frame, or later frames would hit the cache */
+   shader_salt++;
+
+   for (i = 0; i < SHADER_PROGRAMS; i++) {
+      shaders[i][0] = shaders_compile(GL_VERTEX_SHADER, shader_vs_template,
+                                      i + 1, 0);
+      shaders[i][1] = shaders_compile(GL_FRAGMENT_SHADER, shader_fs_template,
+                                      i + 1, SHADER_PROGRAMS);
+      programs[i] = glCreateProgram();
+      glAttachShader(programs[i], shaders[i][0]);
+      glAttachShader(programs[i], shaders[i][1]);
+      glLinkProgram(programs[i]);
+   }
+
+   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   for (i = 0; i < SHADER_PROGRAMS; i++) {
+      const GLfloat x = (i % SHADER_GRID_X) * cell_w;
+      const GLfloat y = (i / SHADER_GRID_X) * cell_h;
+
+      glUseProgram(programs[i]);
+      glRectf(x, y, x + cell_w, y + cell_h);
+   }
+   glUseProgram(0);
+
+   for (i = 0; i < SHADER_PROGRAMS; i++) {
+      glDeleteProgram(programs[i]);
+      glDeleteShader(shaders[i][0]);
+      glDeleteShader(shaders[i][1]);
+   }
+}
+
+
+
+/*
+ * readback: one quad per frame that is read back with glReadPixels.
+ */
+
+static void
+readback_draw(unsigned frame)
+{
+   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+   glColor4ub(frame * 11, 255, frame * 5, 255);
+   draw_screen_quad(1.0f);
+}
+
+
+static struct scene scenes[] = {
+   { "clear", "color and depth clears",
+     200, clear_setup, clear_draw, NULL, GL_FALSE, 0, 0 },
+   { "fill", "opaque full screen quads",
+     50, fill_setup, fill_draw, NULL, GL_FALSE, 0, 0 },
+   { "small_tris", "4x4 pixel triangles covering the screen",
+     20, small_tris_setup, small_tris_draw, small_tris_cleanup, GL_FALSE, 0, 0 },
+   { "blend", "alpha blended full screen quads",
+     30, blend_setup, blend_draw, blend_cleanup, GL_FALSE, 0, 0 },
+   { "texture", "trilinear filtered full screen quads",
+     30, texture_setup, texture_draw, texture_cleanup, GL_FALSE, 0, 0 },
+   { "vertex", "lit, finely tessellated sphere",
+     20, vertex_setup, vertex_draw, vertex_cleanup, GL_FALSE, 0, 0 },
+   { "many_draws", "one small quad per draw call",
+     20, many_draws_setup, many_draws_draw, NULL, GL_FALSE, 0, 0 },
+   { "display_lists", "glBegin/glEnd strips and quads in a display list",
+     20, display_lists_setup, display_lists_draw, display_lists_cleanup,
+     GL_FALSE, 0, 0 },
+   { "shaders", "compile, link and draw with many GLSL programs",
+     5, shaders_setup, shaders_draw, NULL, GL_FALSE, 0, 0 },
+   { "readback", "one quad and glReadPixels per frame",
+     100, fill_setup, readback_draw, NULL, GL_TRUE, 0, 0 },
+};
+
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+
+/**
+ * Triangles per frame of each scene.  Known from the geometry rather than
+ * counted, so that it does not depend on clipping or culling in the driver.
+ */
+static unsigned
+scene_tris(const struct scene *scene)
+{
+   if (scene->draw == fill_draw)
+      return FILL_LAYERS * 2;
+   if (scene->draw == small_tris_draw)
+      return small_tris_verts / 3;
+   if (scene->draw == blend_draw)
+      return BLEND_LAYERS * 2;
+   if (scene->draw == texture_draw)
+      return TEXTURE_LAYERS * 2;
+   if (scene->draw == vertex_draw)
+      return sphere_indices / 3;
+   if (scene->draw == many_draws_draw)
+      return MANY_DRAWS_GRID * MANY_DRAWS_GRID * 2;
+   if (scene->draw == display_lists_draw)
+      return DL_CALLS * (DL_STRIP_ROWS * DL_STRIP_COLS * 2 +
+                         DL_QUAD_GRID * DL_QUAD_GRID * 2);
+   if (scene->draw == shaders_draw)
+      return SHADER_PROGRAMS * 2;
+   if (scene->draw == readback_draw)
+      return 2;
+   return 0;
+}
+
+
+/**
+ * Draw one untimed frame to warm up caches and to count the pixels the
+ * scene writes per frame.  Clears don't generate samples, so they are
+ * accounted for separately.
+ */
+static double
+scene_pixels(const struct scene *scene)
+{
+   GLuint query, samples = 0;
+   double pixels = 0.0;
+
+   if (scene->draw == clear_draw)
+      pixels += (double)width * height * CLEARS_PER_FRAME;
+   else if (scene->draw == vertex_draw || scene->draw == readback_draw)
+      pixels += (double)width * height;
+
+   glGenQueries(1, &query);
+   glBeginQuery(GL_SAMPLES_PASSED, query);
+   scene->draw(0);
+   glEndQuery(GL_SAMPLES_PASSED);
+   glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+   glDeleteQueries(1, &query);
+
+   if (scene->readback)
+      pixels += (double)width * height;
+
+   return pixels + samples;
+}
+
+
+static void
+run_scene(struct scene *scene, unsigned frames, const GLubyte *color_buffer,
+          struct result *result)
+{
+   double submit = 0.0, finish = 0.0, readback = 0.0;
+   double start, end;
+   unsigned frame;
+
+   scene->setup();
+   scene->tris = scene_tris(scene);
+   scene->pixels = scene_pixels(scene);
+   glFinish();
+
+   start = get_time();
+   for (frame = 0; frame < frames; frame++) {
+      double t0, t1, t2;
+
+      t0 = get_time();
+      scene->draw(frame);
+      t1 = get_time();
+      glFinish();
+      t2 = get_time();
+
+      submit += t1 - t0;
+      finish += t2 - t1;
+
+      if (scene->readback) {
+         glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                      readback_buffer);
+         readback += get_time() - t2;
+      }
+   }
+   end = get_time();
+
+   memset(result, 0, sizeof *result);
+   strncpy(result->name, scene->name, MAX_NAME - 1);
+   result->frames = frames;
+   result->seconds = end - start;
+   if (result->seconds > 0.0) {
+      result->fps = frames / result->seconds;
+      result->tris_per_sec = scene->tris * result->fps;
+      result->pixels_per_sec = scene->pixels * result->fps;
+   }
+   result->submit_ms = submit * 1000.0 / frames;
+   result->finish_ms = finish * 1000.0 / frames;
+   result->readback_ms = readback * 1000.0 / frames;
+   result->checksum = checksum_frame(color_buffer, width * height * 4);
+
+   if (scene->cleanup)
+      scene->cleanup();
+}
+
+
+static void
+write_json(FILE *fp, const struct run *run)
+{
+   unsigned i;
+
+   fprintf(fp, "{\n");
+   fprintf(fp, "  \"benchmark\": \"osmesa_bench\",\n");
+   fprintf(fp, "  \"renderer\": \"%s\",\n", run->renderer);
+   fprintf(fp, "  \"width\": %u,\n", run->width);
+   fprintf(fp, "  \"height\": %u,\n", run->height);
+   fprintf(fp, "  \"scenes\": [\n");
+   for (i = 0; i < run->num_results; i++) {
+      const struct result *r = &run->results[i];
+
+      fprintf(fp, "    {\n");
+      fprintf(fp, "      \"name\": \"%s\",\n", r->name);
+      fprintf(fp, "      \"frames\": %u,\n", r->frames);
+      fprintf(fp, "      \"seconds\": %.6f,\n", r->seconds);
+      fprintf(fp, "      \"fps\": %.3f,\n", r->fps);
+      fprintf(fp, "      \"tris_per_sec\": %.1f,\n", r->tris_per_sec);
+      fprintf(fp, "      \"pixels_per_sec\": %.1f,\n", r->pixels_per_sec);
+      fprintf(fp, "      \"stages_ms\": {\n");
+      fprintf(fp, "        \"submit\": %.4f,\n", r->submit_ms);
+      fprintf(fp, "        \"finish\": %.4f,\n", r->finish_ms);
+      fprintf(fp, "        \"readback\": %.4f\n", r->readback_ms);
+      fprintf(fp, "      },\n");
+      fprintf(fp, "      \"checksum\": \"0x%08x\"\n", r->checksum);
+      fprintf(fp, "    }%s\n", i + 1 < run->num_results ? "," : "");
+   }
+   fprintf(fp, "  ]\n");
+   fprintf(fp, "}\n");
+}
+
+
+/*
+ * Reading back results.  This only needs to understand the JSON written by
+ * write_json() above, not JSON in general.
+ */
+
+/**
+ * Find the value of \p key between \p start and \p end.
+ */
+static const char *
+json_find(const char *start, const char *end, const char *key)
+{
+   char pattern[64];
+   const char *p;
+
+   snprintf(pattern, sizeof pattern, "\"%s\"", key);
+   p = strstr(start, pattern);
+   if (!p || (end && p >= end))
+      return NULL;
+
+   p += strlen(pattern);
+   while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == ':')
+      p++;
+   return p;
+}
+
+static void
+json_string(const char *p, char *dst, unsigned size)
+{
+   unsigned n = 0;
+
+   if (*p++ != '"') {
+      dst[0] = 0;
+      return;
+   }
+   while (*p && *p != '"' && n + 1 < size)
+      dst[n++] = *p++;
+   dst[n] = 0;
+}
+
+static double
+json_number(const char *start, const char *end, const char *key)
+{
+   const char *p = json_find(start, end, key);
+
+   return p ? strtod(p, NULL) : 0.0;
+}
+
+static char *
+read_file(const char *filename)
+{
+   FILE *fp = fopen(filename, "rb");
+   char *data;
+   long size;
+
+   if (!fp)
+      return NULL;
+
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   data = malloc(size + 1);
+   if (data) {
+      if (fread(data, 1, size, fp) != (size_t)size) {
+         free(data);
+         data = NULL;
+      }
+      else {
+         data[size] = 0;
+      }
+   }
+
+   fclose(fp);
+   return data;
+}
+
+static GLboolean
+read_json(const char *filename, struct run *run)
+{
+   char *data = read_file(filename);
+   const char *p, *next;
+   char checksum[16];
+
+   if (!data) {
+      fprintf(stderr, "error: cannot read %s\n", filename);
+      return GL_FALSE;
+   }
+
+   memset(run, 0, sizeof *run);
+
+   p = json_find(data, NULL, "renderer");
+   if (p)
+      json_string(p, run->renderer, sizeof run->renderer);
+   run->width = (unsigned)json_number(data, NULL, "width");
+   run->height = (unsigned)json_number(data, NULL, "height");
+
+   p = json_find(data, NULL, "scenes");
+   if (p)
+      p = json_find(p, NULL, "name");
+
+   while (p && run->num_results < MAX_SCENES) {
+      struct result *r = &run->results[run->num_results++];
+      const char *stages;
+
+      next = json_find(p, NULL, "name");
+
+      json_string(p, r->name, sizeof r->name);
+      r->frames = (unsigned)json_number(p, next, "frames");
+      r->seconds = json_number(p, next, "seconds");
+      r->fps = json_number(p, next, "fps");
+      r->tris_per_sec = json_number(p, next, "tris_per_sec");
+      r->pixels_per_sec = json_number(p, next, "pixels_per_sec");
+
+      /* look the stages up in their own object, a scene name may match */
+      stages = json_find(p, next, "stages_ms");
+      if (stages) {
+         r->submit_ms = json_number(stages, next, "submit");
+         r->finish_ms = json_number(stages, next, "finish");
+         r->readback_ms = json_number(stages, next, "readback");
+      }
+
+      checksum[0] = 0;
+      if (json_find(p, next, "checksum"))
+         json_string(json_find(p, next, "checksum"), checksum,
+                     sizeof checksum);
+      r->checksum = (unsigned)strtoul(checksum, NULL, 16);
+
+      p = next;
+   }
+
+   free(data);
+
+   if (!run->num_results) {
+      fprintf(stderr, "error: no scenes in %s\n", filename);
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Print the change of every scene against the baseline.
+ * \return number of scenes that got slower than the threshold
+ */
+static unsigned
+compare_runs(const struct run *base, const struct run *cur, double threshold)
+{
+   unsigned regressions = 0;
+   unsigned i, j;
+
+   if (strcmp(base->renderer, cur->renderer) != 0)
+      fprintf(stderr, "warning: baseline renderer \"%s\" differs from \"%s\"\n",
+              base->renderer, cur->renderer);
+   if (base->width != cur->width || base->height != cur->height)
+      fprintf(stderr, "warning: baseline size %ux%u differs from %ux%u\n",
+              base->width, base->height, cur->width, cur->height);
+
+   fprintf(stderr, "%-12s %12s %12s %9s\n",
+           "scene", "base fps", "fps", "change");
+
+   for (i = 0; i < cur->num_results; i++) {
+      const struct result *r = &cur->results[i];
+      const struct result *b = NULL;
+      double change;
+      const char *status = "";
+
+      for (j = 0; j < base->num_results; j++) {
+         if (strcmp(base->results[j].name, r->name) == 0) {
+            b = &base->results[j];
+            break;
+         }
+      }
+
+      if (!b || b->fps <= 0.0) {
+         fprintf(stderr, "%-12s %12s %12.2f %9s\n", r->name, "-", r->fps, "-");
+         continue;
+      }
+
+      change = (r->fps / b->fps - 1.0) * 100.0;
+      if (change < -threshold) {
+         status = "  REGRESSION";
+         regressions++;
+      }
+      else if (change > threshold) {
+         status = "  faster";
+      }
+
+      fprintf(stderr, "%-12s %12.2f %12.2f %+8.1f%%%s%s\n",
+              r->name, b->fps, r->fps, change, status,
+              b->checksum != r->checksum ? "  (image changed)" : "");
+   }
+
+   return regressions;
+}
+
+
+static void
+usage(const char *name)
+{
+   unsigned i;
+
+   fprintf(stderr,
+           "Usage: %s [options]\n"
+           "\n"
+           "  -o FILE           write the JSON results to FILE, default stdout\n"
+           "  --scene NAME      only run scene NAME, may be repeated\n"
+           "  --frames N        run every scene for N frames\n"
+           "  --size WxH        framebuffer size, default 512x512\n"
+           "  --compare FILE    compare with the results in FILE\n"
+           "  --threshold PCT   slowdown reported as regression, default 5\n"
+           "  --results FILE    compare FILE instead of running the scenes\n"
+           "  --list            list the scenes\n"
+           "\n"
+           "Scenes:\n",
+           name);
+   for (i = 0; i < NUM_SCENES; i++)
+      fprintf(stderr, "  %-12s %s\n", scenes[i].name, scenes[i].description);
+}
+
+
+static GLboolean
+render_run(struct run *run, const GLboolean *selected, unsigned frames)
+{
+   OSMesaContext ctx;
+   GLubyte *color_buffer;
+   unsigned i;
+
+   color_buffer = calloc(width * height, 4);
+   readback_buffer = malloc(width * height * 4);
+   if (!color_buffer || !readback_buffer) {
+      fprintf(stderr, "error: out of memory\n");
+      return GL_FALSE;
+   }
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+   if (!ctx) {
+      fprintf(stderr, "error: OSMesaCreateContextExt failed\n");
+      return GL_FALSE;
+   }
+
+   if (!OSMesaMakeCurrent(ctx, color_buffer, GL_UNSIGNED_BYTE,
+                          width, height)) {
+      fprintf(stderr, "error: OSMesaMakeCurrent failed\n");
+      OSMesaDestroyContext(ctx);
+      return GL_FALSE;
+   }
+
+   memset(run, 0, sizeof *run);
+   strncpy(run->renderer, (const char *)glGetString(GL_RENDERER),
+           sizeof run->renderer - 1);
+   run->width = width;
+   run->height = height;
+
+   fprintf(stderr, "%s, %ux%u\n", run->renderer, width, height);
+
+   for (i = 0; i < NUM_SCENES; i++) {
+      struct result *r;
+
+      if (!selected[i])
+         continue;
+
+      r = &run->results[run->num_results++];
+      run_scene(&scenes[i], frames ? frames : scenes[i].frames,
+                color_buffer, r);
+
+      fprintf(stderr, "%-12s %8.2f fps %12.0f tris/s %14.0f pixels/s\n",
+              r->name, r->fps, r->tris_per_sec, r->pixels_per_sec);
+   }
+
+   OSMesaDestroyContext(ctx);
+   free(readback_buffer);
+   free(color_buffer);
+   return GL_TRUE;
+}
+
+
+int main(int argc, char **argv)
+{
+   const char *output = NULL, *baseline = NULL, *results = NULL;
+   double threshold = 5.0;
+   unsigned frames = 0;
+   GLboolean selected[NUM_SCENES];
+   GLboolean any_selected = GL_FALSE;
+   struct run cur, base;
+   unsigned regressions = 0;
+   int i;
+   unsigned j;
+
+   memset(selected, 0, sizeof selected);
+
+   for (i = 1; i < argc; i++) {
+      const char *arg = argv[i];
+      const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+      if (strcmp(arg, "--list") == 0) {
+         for (j = 0; j < NUM_SCENES; j++)
+            printf("%s\n", scenes[j].name);
+         return 0;
+      }
+      else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+         usage(argv[0]);
+         return 0;
+      }
+      else if (!value) {
+         usage(argv[0]);
+         return 2;
+      }
+      else if (strcmp(arg, "-o") == 0) {
+         output = value;
+      }
+      else if (strcmp(arg, "--scene") == 0) {
+         for (j = 0; j < NUM_SCENES; j++) {
+            if (strcmp(scenes[j].name, value) == 0)
+               break;
+         }
+         if (j == NUM_SCENES) {
+            fprintf(stderr, "error: unknown scene %s\n", value);
+            return 2;
+         }
+         selected[j] = GL_TRUE;
+         any_selected = GL_TRUE;
+      }
+      else if (strcmp(arg, "--frames") == 0) {
+         int n = atoi(value);
+         if (n < 1) {
+            fprintf(stderr, "error: bad frame count %s\n", value);
+            return 2;
+         }
+         frames = n;
+      }
+      else if (strcmp(arg, "--size") == 0) {
+         if (sscanf(value, "%ux%u", &width, &height) != 2 ||
+             width < 64 || height < 64) {
+            fprintf(stderr, "error: bad size %s\n", value);
+            return 2;
+         }
+      }
+      else if (strcmp(arg, "--compare") == 0) {
+         baseline = value;
+      }
+      else if (strcmp(arg, "--threshold") == 0) {
+         threshold = atof(value);
+      }
+      else if (strcmp(arg, "--results") == 0) {
+         results = value;
+      }
+      else {
+         usage(argv[0]);
+         return 2;
+      }
+      i++;
+   }
+
+   if (!any_selected) {
+      for (j = 0; j < NUM_SCENES; j++)
+         selected[j] = GL_TRUE;
+   }
+
+   if (results) {
+      if (!baseline) {
+         fprintf(stderr, "error: --results needs --compare\n");
+         return 2;
+      }
+      if (!read_json(results, &cur))
+         return 2;
+   }
+   else {
+      FILE *fp = stdout;
+
+      if (!render_run(&cur, selected, frames))
+         return 2;
+
+      if (output) {
+         fp = fopen(output, "w");
+         if (!fp) {
+            fprintf(stderr, "error: cannot write %s\n", output);
+            return 2;
+         }
+      }
+      write_json(fp, &cur);
+      if (fp != stdout)
+         fclose(fp);
+   }
+
+   if (baseline) {
+      if (!read_json(baseline, &base))
+         return 2;
+      regressions = compare_runs(&base, &cur, threshold);
+      if (regressions)
+         fprintf(stderr, "%u scene(s) slower than %.1f%%\n",
+                 regressions, threshold);
+   }
+
+   return regressions ? 1 : 0;
+}
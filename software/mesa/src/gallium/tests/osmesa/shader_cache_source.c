@@ -0,0 +1,206 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Shader cache regression test, in the style of a piglit test.
+ *
+ * glCompileShader() of a shader whose source is already in the shader
+ * cache only computes its key and defers the real compile to link time.
+ * The GL spec says that glShaderSource() does not affect a compiled
+ * shader until it is compiled again, so a shader that is compiled with
+ * one source, then given another source and linked without recompiling
+ * has to behave like the first source, even when the link misses the
+ * cache and the deferred compile happens.
+ *
+ * The cache lives in a temporary directory for the duration of the test.
+ * When the driver has no shader cache the sequence runs uncached and must
+ * give the same result.
+ */
+
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GL/osmesa.h"
+
+
+#define WIDTH 16
+#define HEIGHT 16
+
+
+static const char *vs_a =
+   "void main() { gl_Position = gl_Vertex; }\n";
+
+/* differs from vs_a so that the second link misses the cache */
+static const char *vs_b =
+   "void main() { gl_Position = gl_Vertex * vec4(1.0); }\n";
+
+static const char *fs_red =
+   "void main() { gl_FragColor = vec4(1.0, 0.0, 0.0, 1.0); }\n";
+
+static const char *fs_green =
+   "void main() { gl_FragColor = vec4(0.0, 1.0, 0.0, 1.0); }\n";
+
+
+static GLuint
+compile_shader(GLenum type, const char *source)
+{
+   GLuint sh = glCreateShader(type);
+   GLint ok;
+
+   glShaderSource(sh, 1, &source, NULL);
+   glCompileShader(sh);
+   glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+   if (!ok) {
+      fprintf(stderr, "failed to compile:\n%s", source);
+      return 0;
+   }
+   return sh;
+}
+
+
+static GLuint
+link_program(GLuint vs, GLuint fs)
+{
+   GLuint prog = glCreateProgram();
+   GLint ok;
+
+   glAttachShader(prog, vs);
+   glAttachShader(prog, fs);
+   glLinkProgram(prog);
+   glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+   if (!ok) {
+      char log[1024];
+
+      glGetProgramInfoLog(prog, sizeof(log), NULL, log);
+      fprintf(stderr, "failed to link: %s\n", log);
+      return 0;
+   }
+   return prog;
+}
+
+
+static int
+remove_entry(const char *path, const struct stat *st, int flag,
+             struct FTW *ftw)
+{
+   (void) st;
+   (void) flag;
+   (void) ftw;
+   return remove(path);
+}
+
+
+static int
+run(GLubyte *pixels)
+{
+   GLuint vs1, vs2, fs1, fs2, prog1, prog2;
+
+   /* Put a program using fs_red into the cache. */
+   vs1 = compile_shader(GL_VERTEX_SHADER, vs_a);
+   fs1 = compile_shader(GL_FRAGMENT_SHADER, fs_red);
+   if (!vs1 || !fs1)
+      return 0;
+   prog1 = link_program(vs1, fs1);
+   if (!prog1)
+      return 0;
+
+   /* A cache hit for fs_red, then new source without a recompile. */
+   vs2 = compile_shader(GL_VERTEX_SHADER, vs_b);
+   fs2 = compile_shader(GL_FRAGMENT_SHADER, fs_red);
+   if (!vs2 || !fs2)
+      return 0;
+   glShaderSource(fs2, 1, &fs_green, NULL);
+
+   prog2 = link_program(vs2, fs2);
+   if (!prog2)
+      return 0;
+
+   glViewport(0, 0, WIDTH, HEIGHT);
+   glClearColor(0.0, 0.0, 1.0, 1.0);
+   glClear(GL_COLOR_BUFFER_BIT);
+   glUseProgram(prog2);
+   glRectf(-1.0, -1.0, 1.0, 1.0);
+   glFinish();
+
+   if (pixels[0] != 0xff || pixels[1] != 0 || pixels[2] != 0) {
+      fprintf(stderr, "expected red, got %u %u %u\n",
+              pixels[0], pixels[1], pixels[2]);
+      return 0;
+   }
+
+   glUseProgram(0);
+   glDeleteProgram(prog1);
+   glDeleteProgram(prog2);
+   glDeleteShader(vs1);
+   glDeleteShader(vs2);
+   glDeleteShader(fs1);
+   glDeleteShader(fs2);
+   return 1;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   char cache_dir[] = "/tmp/shader-cache-test-XXXXXX";
+   static GLubyte pixels[WIDTH * HEIGHT * 4];
+   OSMesaContext ctx;
+   int pass;
+
+   (void) argc;
+   (void) argv;
+
+   if (!mkdtemp(cache_dir)) {
+      perror("mkdtemp");
+      return 1;
+   }
+   setenv("MESA_GLSL_CACHE_DIR", cache_dir, 1);
+   unsetenv("MESA_GLSL_CACHE_DISABLE");
+
+   ctx = OSMesaCreateContextExt(OSMESA_RGBA, 0, 0, 0, NULL);
+   if (!ctx || !OSMesaMakeCurrent(ctx, pixels, GL_UNSIGNED_BYTE,
+                                  WIDTH, HEIGHT)) {
+      fprintf(stderr, "failed to create an OSMesa context\n");
+      nftw(cache_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+      /* skip */
+      return 77;
+   }
+
+   pass = run(pixels);
+
+   OSMesaDestroyContext(ctx);
+   nftw(cache_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+   printf("%s\n", pass ? "PASS" : "FAIL");
+   return pass ? 0 : 1;
+}
@@ -0,0 +1,607 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Compute shader benchmark, llvmpipe against softpipe.
+ *
+ * Runs three kernels on each driver and checks the results against a C
+ * reference:
+ *  - saxpy, one invocation per element;
+ *  - a sum reduction in shared memory, with a barrier after every step;
+ *  - a 3x3 box filter over a 2D image, in 8x8 work groups.
+ * Pass a scale factor to grow the problem sizes.  LP_NUM_THREADS sets the
+ * number of llvmpipe threads as usual.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+
+#include "softpipe/sp_public.h"
+#ifdef GALLIUM_LLVMPIPE
+#include "llvmpipe/lp_public.h"
+#endif
+#include "sw/null/null_sw_winsys.h"
+
+
+#define ITERATIONS 3
+
+#define SAXPY_BLOCK 64
+#define REDUCE_BLOCK 256
+#define FILTER_BLOCK 8
+
+#define TEXT_SIZE (16 * 1024)
+
+
+struct driver {
+   const char *name;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+};
+
+
+struct result {
+   double seconds;     /**< per launch */
+   boolean pass;
+};
+
+
+static void
+make_saxpy_text(char *text)
+{
+   util_snprintf(text, TEXT_SIZE,
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL BUFFER[0]\n"
+      "DCL BUFFER[1]\n"
+      "DCL BUFFER[2]\n"
+      "DCL CONST[0]\n"
+      "DCL TEMP[0..2]\n"
+      "IMM[0] UINT32 { %u, 4, 0, 0 }\n"
+      "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+      "UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+      "LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+      "LOAD TEMP[2].x, BUFFER[1], TEMP[0].xxxx\n"
+      "MAD TEMP[2].x, TEMP[1].xxxx, CONST[0].xxxx, TEMP[2].xxxx\n"
+      "STORE BUFFER[2].x, TEMP[0].xxxx, TEMP[2].xxxx\n"
+      "END\n",
+      SAXPY_BLOCK, SAXPY_BLOCK);
+}
+
+
+/**
+ * The tree steps of the reduction are unrolled, IMM[1 + step] holds the
+ * distance of a step in elements and in bytes.
+ */
+static void
+make_reduce_text(char *text)
+{
+   char *p = text, *end = text + TEXT_SIZE;
+   unsigned s, step;
+
+   p += util_snprintf(p, end - p,
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL BUFFER[0]\n"
+      "DCL BUFFER[1]\n"
+      "DCL MEMORY[0], SHARED\n"
+      "DCL TEMP[0..4]\n"
+      "IMM[0] UINT32 { %u, 4, 0, 0 }\n",
+      REDUCE_BLOCK, REDUCE_BLOCK);
+
+   for (s = REDUCE_BLOCK / 2, step = 1; s > 0; s /= 2, step++) {
+      p += util_snprintf(p, end - p, "IMM[%u] UINT32 { %u, %u, 0, 0 }\n",
+                         step, s, s * 4);
+   }
+
+   p += util_snprintf(p, end - p,
+      "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+      "UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+      "UMUL TEMP[1].x, SV[0].xxxx, IMM[0].yyyy\n"
+      "LOAD TEMP[2].x, BUFFER[0], TEMP[0].xxxx\n"
+      "STORE MEMORY[0].x, TEMP[1].xxxx, TEMP[2].xxxx\n"
+      "BARRIER\n");
+
+   for (s = REDUCE_BLOCK / 2, step = 1; s > 0; s /= 2, step++) {
+      p += util_snprintf(p, end - p,
+         "USLT TEMP[3].x, SV[0].xxxx, IMM[%u].xxxx\n"
+         "UIF TEMP[3].xxxx\n"
+         "   UADD TEMP[4].x, TEMP[1].xxxx, IMM[%u].yyyy\n"
+         "   LOAD TEMP[2].x, MEMORY[0], TEMP[1].xxxx\n"
+         "   LOAD TEMP[4].x, MEMORY[0], TEMP[4].xxxx\n"
+         "   ADD TEMP[2].x, TEMP[2].xxxx, TEMP[4].xxxx\n"
+         "   STORE MEMORY[0].x, TEMP[1].xxxx, TEMP[2].xxxx\n"
+         "ENDIF\n"
+         "BARRIER\n",
+         step, step);
+   }
+
+   util_snprintf(p, end - p,
+      "USEQ TEMP[3].x, SV[0].xxxx, IMM[0].zzzz\n"
+      "UIF TEMP[3].xxxx\n"
+      "   LOAD TEMP[2].x, MEMORY[0], IMM[0].zzzz\n"
+      "   UMUL TEMP[4].x, SV[1].xxxx, IMM[0].yyyy\n"
+      "   STORE BUFFER[1].x, TEMP[4].xxxx, TEMP[2].xxxx\n"
+      "ENDIF\n"
+      "END\n");
+}
+
+
+/**
+ * 3x3 box filter with clamp to edge.  IMM[3] holds the offsets -1, 0, 1
+ * in x, y and z.
+ */
+static void
+make_filter_text(char *text, unsigned width, unsigned height)
+{
+   static const char offsets[] = "xyz";
+   char *p = text, *end = text + TEXT_SIZE;
+   int dx, dy;
+
+   p += util_snprintf(p, end - p,
+      "COMP\n"
+      "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+      "PROPERTY CS_FIXED_BLOCK_HEIGHT %u\n"
+      "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+      "DCL SV[0], THREAD_ID\n"
+      "DCL SV[1], BLOCK_ID\n"
+      "DCL BUFFER[0]\n"
+      "DCL BUFFER[1]\n"
+      "DCL TEMP[0..4]\n"
+      "IMM[0] INT32 { %u, %u, %u, %u }\n"
+      "IMM[1] INT32 { 0, 4, 0, 0 }\n"
+      "IMM[2] FLT32 { 0.11111111, 0.0, 0.0, 0.0 }\n"
+      "IMM[3] INT32 { -1, 0, 1, 0 }\n"
+      "UMAD TEMP[0].xy, SV[1].xyyy, IMM[0].xxxx, SV[0].xyyy\n"
+      "MOV TEMP[1].x, IMM[2].yyyy\n",
+      FILTER_BLOCK, FILTER_BLOCK,
+      FILTER_BLOCK, width - 1, height - 1, width);
+
+   for (dy = 0; dy < 3; dy++) {
+      for (dx = 0; dx < 3; dx++) {
+         p += util_snprintf(p, end - p,
+            "IADD TEMP[2].xy, TEMP[0].xyyy, IMM[3].%c%c%c%c\n"
+            "IMAX TEMP[2].xy, TEMP[2].xyyy, IMM[1].xxxx\n"
+            "IMIN TEMP[2].xy, TEMP[2].xyyy, IMM[0].yzzz\n"
+            "UMAD TEMP[3].x, TEMP[2].yyyy, IMM[0].wwww, TEMP[2].xxxx\n"
+            "UMUL TEMP[3].x, TEMP[3].xxxx, IMM[1].yyyy\n"
+            "LOAD TEMP[4].x, BUFFER[0], TEMP[3].xxxx\n"
+            "ADD TEMP[1].x, TEMP[1].xxxx, TEMP[4].xxxx\n",
+            offsets[dx], offsets[dy], offsets[dy], offsets[dy]);
+      }
+   }
+
+   util_snprintf(p, end - p,
+      "UMAD TEMP[3].x, TEMP[0].yyyy, IMM[0].wwww, TEMP[0].xxxx\n"
+      "UMUL TEMP[3].x, TEMP[3].xxxx, IMM[1].yyyy\n"
+      "MUL TEMP[1].x, TEMP[1].xxxx, IMM[2].xxxx\n"
+      "STORE BUFFER[1].x, TEMP[3].xxxx, TEMP[1].xxxx\n"
+      "END\n");
+}
+
+
+static void *
+create_cs(struct pipe_context *pipe, const char *text, unsigned local_mem)
+{
+   struct tgsi_token tokens[4096];
+   struct pipe_compute_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate compute shader:\n%s", text);
+      exit(1);
+   }
+
+   memset(&state, 0, sizeof(state));
+   state.ir_type = PIPE_SHADER_IR_TGSI;
+   state.prog = tokens;
+   state.req_local_mem = local_mem;
+
+   return pipe->create_compute_state(pipe, &state);
+}
+
+
+static struct pipe_resource *
+create_buffer(struct driver *d, unsigned bind, unsigned size,
+              const void *data)
+{
+   struct pipe_resource *buf;
+
+   buf = pipe_buffer_create(d->screen, bind, PIPE_USAGE_DEFAULT, size);
+   if (data)
+      pipe_buffer_write(d->pipe, buf, 0, size, data);
+
+   return buf;
+}
+
+
+static void
+set_buffers(struct driver *d, struct pipe_resource **bufs, unsigned count)
+{
+   struct pipe_shader_buffer sb[3];
+   unsigned i;
+
+   memset(sb, 0, sizeof(sb));
+   for (i = 0; i < count; i++) {
+      sb[i].buffer = bufs[i];
+      sb[i].buffer_size = bufs[i]->width0;
+   }
+   d->pipe->set_shader_buffers(d->pipe, PIPE_SHADER_COMPUTE, 0, count, sb);
+}
+
+
+/**
+ * Launch once to warm up (llvmpipe compiles the shader on first use),
+ * then time ITERATIONS launches.
+ */
+static double
+time_launch(struct driver *d, const struct pipe_grid_info *info)
+{
+   int64_t start, end;
+   unsigned i;
+
+   d->pipe->launch_grid(d->pipe, info);
+   d->pipe->flush(d->pipe, NULL, 0);
+
+   start = os_time_get_nano();
+   for (i = 0; i < ITERATIONS; i++) {
+      d->pipe->launch_grid(d->pipe, info);
+   }
+   d->pipe->flush(d->pipe, NULL, 0);
+   end = os_time_get_nano();
+
+   return (double)(end - start) / 1e9 / ITERATIONS;
+}
+
+
+static boolean
+compare(const float *result, const float *expected, unsigned n, float tol)
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++) {
+      if (fabsf(result[i] - expected[i]) > tol * MAX2(1.0f, fabsf(expected[i]))) {
+         fprintf(stderr, "  element %u: got %f, expected %f\n",
+                 i, result[i], expected[i]);
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+fill_random(float *data, unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+      data[i] = (float) rand() / RAND_MAX;
+}
+
+
+static struct result
+run_saxpy(struct driver *d, unsigned n)
+{
+   static const float a[4] = { 2.5f, 0.0f, 0.0f, 0.0f };
+   struct pipe_resource *bufs[3], *consts;
+   struct pipe_constant_buffer cb;
+   struct pipe_grid_info info;
+   struct result res;
+   char *text = MALLOC(TEXT_SIZE);
+   float *x = MALLOC(n * sizeof(float));
+   float *y = MALLOC(n * sizeof(float));
+   float *out = MALLOC(n * sizeof(float));
+   void *cs;
+   unsigned i;
+
+   srand(1);
+   fill_random(x, n);
+   fill_random(y, n);
+
+   make_saxpy_text(text);
+   cs = create_cs(d->pipe, text, 0);
+   d->pipe->bind_compute_state(d->pipe, cs);
+
+   bufs[0] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, x);
+   bufs[1] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, y);
+   bufs[2] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, NULL);
+   set_buffers(d, bufs, 3);
+
+   consts = create_buffer(d, PIPE_BIND_CONSTANT_BUFFER, sizeof(a), a);
+   memset(&cb, 0, sizeof(cb));
+   cb.buffer = consts;
+   cb.buffer_size = sizeof(a);
+   d->pipe->set_constant_buffer(d->pipe, PIPE_SHADER_COMPUTE, 0, &cb);
+
+   memset(&info, 0, sizeof(info));
+   info.work_dim = 1;
+   info.block[0] = SAXPY_BLOCK;
+   info.block[1] = info.block[2] = 1;
+   info.grid[0] = n / SAXPY_BLOCK;
+   info.grid[1] = info.grid[2] = 1;
+
+   res.seconds = time_launch(d, &info);
+
+   pipe_buffer_read(d->pipe, bufs[2], 0, n * 4, out);
+   for (i = 0; i < n; i++)
+      y[i] = a[0] * x[i] + y[i];
+   res.pass = compare(out, y, n, 1e-5f);
+
+   d->pipe->set_constant_buffer(d->pipe, PIPE_SHADER_COMPUTE, 0, NULL);
+   d->pipe->set_shader_buffers(d->pipe, PIPE_SHADER_COMPUTE, 0, 3, NULL);
+   d->pipe->bind_compute_state(d->pipe, NULL);
+   d->pipe->delete_compute_state(d->pipe, cs);
+   for (i = 0; i < 3; i++)
+      pipe_resource_reference(&bufs[i], NULL);
+   pipe_resource_reference(&consts, NULL);
+   FREE(text);
+   FREE(x);
+   FREE(y);
+   FREE(out);
+
+   return res;
+}
+
+
+static struct result
+run_reduce(struct driver *d, unsigned n)
+{
+   const unsigned num_groups = n / REDUCE_BLOCK;
+   struct pipe_resource *bufs[2];
+   struct pipe_grid_info info;
+   struct result res;
+   char *text = MALLOC(TEXT_SIZE);
+   float *x = MALLOC(n * sizeof(float));
+   float *sums = MALLOC(num_groups * sizeof(float));
+   float *out = MALLOC(num_groups * sizeof(float));
+   void *cs;
+   unsigned i, j;
+
+   srand(2);
+   fill_random(x, n);
+
+   make_reduce_text(text);
+   cs = create_cs(d->pipe, text, REDUCE_BLOCK * sizeof(float));
+   d->pipe->bind_compute_state(d->pipe, cs);
+
+   bufs[0] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, x);
+   bufs[1] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, num_groups * 4, NULL);
+   set_buffers(d, bufs, 2);
+
+   memset(&info, 0, sizeof(info));
+   info.work_dim = 1;
+   info.block[0] = REDUCE_BLOCK;
+   info.block[1] = info.block[2] = 1;
+   info.grid[0] = num_groups;
+   info.grid[1] = info.grid[2] = 1;
+
+   res.seconds = time_launch(d, &info);
+
+   pipe_buffer_read(d->pipe, bufs[1], 0, num_groups * 4, out);
+   for (i = 0; i < num_groups; i++) {
+      sums[i] = 0.0f;
+      for (j = 0; j < REDUCE_BLOCK; j++)
+         sums[i] += x[i * REDUCE_BLOCK + j];
+   }
+   res.pass = compare(out, sums, num_groups, 1e-4f);
+
+   d->pipe->set_shader_buffers(d->pipe, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   d->pipe->bind_compute_state(d->pipe, NULL);
+   d->pipe->delete_compute_state(d->pipe, cs);
+   for (i = 0; i < 2; i++)
+      pipe_resource_reference(&bufs[i], NULL);
+   FREE(text);
+   FREE(x);
+   FREE(sums);
+   FREE(out);
+
+   return res;
+}
+
+
+static struct result
+run_filter(struct driver *d, unsigned width, unsigned height)
+{
+   const unsigned n = width * height;
+   struct pipe_resource *bufs[2];
+   struct pipe_grid_info info;
+   struct result res;
+   char *text = MALLOC(TEXT_SIZE);
+   float *img = MALLOC(n * sizeof(float));
+   float *ref = MALLOC(n * sizeof(float));
+   float *out = MALLOC(n * sizeof(float));
+   void *cs;
+   unsigned x, y, i;
+   int dx, dy;
+
+   srand(3);
+   fill_random(img, n);
+
+   make_filter_text(text, width, height);
+   cs = create_cs(d->pipe, text, 0);
+   d->pipe->bind_compute_state(d->pipe, cs);
+
+   bufs[0] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, img);
+   bufs[1] = create_buffer(d, PIPE_BIND_SHADER_BUFFER, n * 4, NULL);
+   set_buffers(d, bufs, 2);
+
+   memset(&info, 0, sizeof(info));
+   info.work_dim = 2;
+   info.block[0] = FILTER_BLOCK;
+   info.block[1] = FILTER_BLOCK;
+   info.block[2] = 1;
+   info.grid[0] = width / FILTER_BLOCK;
+   info.grid[1] = height / FILTER_BLOCK;
+   info.grid[2] = 1;
+
+   res.seconds = time_launch(d, &info);
+
+   pipe_buffer_read(d->pipe, bufs[1], 0, n * 4, out);
+   for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++) {
+         float sum = 0.0f;
+         for (dy = -1; dy <= 1; dy++) {
+            for (dx = -1; dx <= 1; dx++) {
+               int sx = CLAMP((int) x + dx, 0, (int) width - 1);
+               int sy = CLAMP((int) y + dy, 0, (int) height - 1);
+               sum += img[sy * width + sx];
+            }
+         }
+         ref[y * width + x] = sum * 0.11111111f;
+      }
+   }
+   res.pass = compare(out, ref, n, 1e-5f);
+
+   d->pipe->set_shader_buffers(d->pipe, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   d->pipe->bind_compute_state(d->pipe, NULL);
+   d->pipe->delete_compute_state(d->pipe, cs);
+   for (i = 0; i < 2; i++)
+      pipe_resource_reference(&bufs[i], NULL);
+   FREE(text);
+   FREE(img);
+   FREE(ref);
+   FREE(out);
+
+   return res;
+}
+
+
+static void
+print_result(const char *kernel, const struct driver *d,
+             unsigned invocations, struct result res, double base)
+{
+   printf("%-8s %-10s %12.2f %12.2f %8.2f %s\n",
+          kernel, d->name, res.seconds * 1e3,
+          invocations / res.seconds / 1e6,
+          base > 0.0 ? base / res.seconds : 1.0,
+          res.pass ? "pass" : "FAIL");
+}
+
+
+int main(int argc, char **argv)
+{
+   struct driver drivers[2];
+   unsigned num_drivers = 0;
+   unsigned scale = 1;
+   unsigned n, width, height;
+   boolean pass = TRUE;
+   unsigned i;
+
+   if (argc > 1)
+      scale = MAX2(1, atoi(argv[1]));
+
+   n = 64 * 1024 * scale;
+   width = 256 * scale;
+   height = 256;
+
+   drivers[num_drivers].name = "softpipe";
+   drivers[num_drivers].screen = softpipe_create_screen(null_sw_create());
+   num_drivers++;
+#ifdef GALLIUM_LLVMPIPE
+   drivers[num_drivers].name = "llvmpipe";
+   drivers[num_drivers].screen = llvmpipe_create_screen(null_sw_create());
+   num_drivers++;
+#endif
+
+   for (i = 0; i < num_drivers; i++) {
+      struct pipe_screen *screen = drivers[i].screen;
+
+      if (!screen || !screen->get_param(screen, PIPE_CAP_COMPUTE)) {
+         fprintf(stderr, "%s: no compute support\n", drivers[i].name);
+         return 1;
+      }
+      drivers[i].pipe = screen->context_create(screen, NULL, 0);
+   }
+
+   printf("%-8s %-10s %12s %12s %8s %s\n",
+          "kernel", "driver", "ms/launch", "Minv/s", "speedup", "result");
+
+   /* speedups are relative to softpipe */
+   {
+      double base = 0.0;
+      for (i = 0; i < num_drivers; i++) {
+         struct result res = run_saxpy(&drivers[i], n);
+         print_result("saxpy", &drivers[i], n, res, base);
+         if (i == 0)
+            base = res.seconds;
+         pass = pass && res.pass;
+      }
+   }
+
+   {
+      double base = 0.0;
+      for (i = 0; i < num_drivers; i++) {
+         struct result res = run_reduce(&drivers[i], n);
+         print_result("reduce", &drivers[i], n, res, base);
+         if (i == 0)
+            base = res.seconds;
+         pass = pass && res.pass;
+      }
+   }
+
+   {
+      double base = 0.0;
+      for (i = 0; i < num_drivers; i++) {
+         struct result res = run_filter(&drivers[i], width, height);
+         print_result("filter", &drivers[i], width * height, res, base);
+         if (i == 0)
+            base = res.seconds;
+         pass = pass && res.pass;
+      }
+   }
+
+   for (i = 0; i < num_drivers; i++) {
+      drivers[i].pipe->destroy(drivers[i].pipe);
+      drivers[i].screen->destroy(drivers[i].screen);
+   }
+
+   return pass ? 0 : 1;
+}
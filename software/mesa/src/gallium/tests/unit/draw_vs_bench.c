@@ -0,0 +1,362 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Vertex processing scaling benchmark for the draw module's worker threads
+ * (DRAW_VS_THREADS).
+ *
+ * Draws an indexed grid mesh of 100k-1M triangles on softpipe with a small
+ * transform + lighting vertex shader, once per thread count.  Everything is
+ * culled after clipping so the numbers mostly reflect fetch and shading.
+ * Pass -r to rasterize the (tiny) triangles as well.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "util/u_string.h"
+
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define WIDTH 256
+#define HEIGHT 256
+#define ITERATIONS 4
+
+
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL CONST[0..5]\n"
+   "DCL TEMP[0..1]\n"
+   "IMM[0] FLT32 { 0.0, 0.0, 0.0, 0.0 }\n"
+   "  0: MUL TEMP[0], IN[0].xxxx, CONST[0]\n"
+   "  1: MAD TEMP[0], IN[0].yyyy, CONST[1], TEMP[0]\n"
+   "  2: MAD TEMP[0], IN[0].zzzz, CONST[2], TEMP[0]\n"
+   "  3: MAD OUT[0], IN[0].wwww, CONST[3], TEMP[0]\n"
+   "  4: DP3 TEMP[1].x, IN[1], CONST[4]\n"
+   "  5: MAX TEMP[1].x, TEMP[1].xxxx, IMM[0].xxxx\n"
+   "  6: MUL OUT[1], TEMP[1].xxxx, CONST[5]\n"
+   "  7: END\n";
+
+
+struct bench {
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource *target;
+   struct pipe_surface *cbuf;
+   struct pipe_resource *vbuf;
+   struct pipe_resource *ibuf;
+   void *vs, *fs, *blend, *dsa, *rast, *velems;
+   unsigned num_indices;
+};
+
+
+static void
+make_mesh(struct bench *b, unsigned num_tris)
+{
+   unsigned n = 2;
+   unsigned x, y, i = 0;
+   float *verts;
+   uint32_t *indices;
+
+   while (2 * n * n < num_tris)
+      n++;
+
+   verts = MALLOC((n + 1) * (n + 1) * 8 * sizeof(float));
+   indices = MALLOC(n * n * 6 * sizeof(uint32_t));
+
+   for (y = 0; y <= n; y++) {
+      for (x = 0; x <= n; x++) {
+         float *v = verts + (y * (n + 1) + x) * 8;
+         v[0] = 2.0f * x / n - 1.0f;
+         v[1] = 2.0f * y / n - 1.0f;
+         v[2] = 0.5f;
+         v[3] = 1.0f;
+         v[4] = 0.0f;
+         v[5] = 0.0f;
+         v[6] = 1.0f;
+         v[7] = 0.0f;
+      }
+   }
+
+   for (y = 0; y < n; y++) {
+      for (x = 0; x < n; x++) {
+         uint32_t v0 = y * (n + 1) + x;
+         indices[i++] = v0;
+         indices[i++] = v0 + 1;
+         indices[i++] = v0 + n + 1;
+         indices[i++] = v0 + 1;
+         indices[i++] = v0 + n + 2;
+         indices[i++] = v0 + n + 1;
+      }
+   }
+
+   b->num_indices = i;
+   b->vbuf = pipe_buffer_create(b->screen, PIPE_BIND_VERTEX_BUFFER,
+                                PIPE_USAGE_DEFAULT,
+                                (n + 1) * (n + 1) * 8 * sizeof(float));
+   pipe_buffer_write(b->pipe, b->vbuf, 0,
+                     (n + 1) * (n + 1) * 8 * sizeof(float), verts);
+   b->ibuf = pipe_buffer_create(b->screen, PIPE_BIND_INDEX_BUFFER,
+                                PIPE_USAGE_DEFAULT, i * sizeof(uint32_t));
+   pipe_buffer_write(b->pipe, b->ibuf, 0, i * sizeof(uint32_t), indices);
+
+   FREE(verts);
+   FREE(indices);
+}
+
+
+static void
+init_bench(struct bench *b, unsigned num_tris, boolean rasterize)
+{
+   static const float consts[6][4] = {
+      { 1.0f, 0.0f, 0.0f, 0.0f },
+      { 0.0f, 1.0f, 0.0f, 0.0f },
+      { 0.0f, 0.0f, 1.0f, 0.0f },
+      { 0.0f, 0.0f, 0.0f, 1.0f },
+      { 0.0f, 0.0f, 1.0f, 0.0f },
+      { 1.0f, 0.5f, 0.25f, 1.0f }
+   };
+   struct pipe_resource templ;
+   struct pipe_surface surf_tmpl;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state vp;
+   struct pipe_vertex_element velem[2];
+   struct pipe_vertex_buffer vb;
+   struct pipe_index_buffer ib;
+   struct pipe_constant_buffer cb;
+   struct pipe_shader_state state;
+   struct tgsi_token tokens[1024];
+
+   b->screen = softpipe_create_screen(null_sw_create());
+   b->pipe = b->screen->context_create(b->screen, NULL, 0);
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   b->target = b->screen->resource_create(b->screen, &templ);
+
+   memset(&surf_tmpl, 0, sizeof(surf_tmpl));
+   surf_tmpl.format = templ.format;
+   b->cbuf = b->pipe->create_surface(b->pipe, b->target, &surf_tmpl);
+
+   memset(&fb, 0, sizeof(fb));
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = b->cbuf;
+   b->pipe->set_framebuffer_state(b->pipe, &fb);
+
+   memset(&blend, 0, sizeof(blend));
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   b->blend = b->pipe->create_blend_state(b->pipe, &blend);
+   b->pipe->bind_blend_state(b->pipe, b->blend);
+
+   memset(&dsa, 0, sizeof(dsa));
+   b->dsa = b->pipe->create_depth_stencil_alpha_state(b->pipe, &dsa);
+   b->pipe->bind_depth_stencil_alpha_state(b->pipe, b->dsa);
+
+   memset(&rast, 0, sizeof(rast));
+   rast.cull_face = rasterize ? PIPE_FACE_NONE : PIPE_FACE_FRONT_AND_BACK;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip = 1;
+   b->rast = b->pipe->create_rasterizer_state(b->pipe, &rast);
+   b->pipe->bind_rasterizer_state(b->pipe, b->rast);
+
+   memset(&vp, 0, sizeof(vp));
+   vp.scale[0] = WIDTH / 2.0f;
+   vp.scale[1] = HEIGHT / 2.0f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = WIDTH / 2.0f;
+   vp.translate[1] = HEIGHT / 2.0f;
+   vp.translate[2] = 0.5f;
+   b->pipe->set_viewport_states(b->pipe, 0, 1, &vp);
+
+   memset(velem, 0, sizeof(velem));
+   velem[0].src_offset = 0;
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   b->velems = b->pipe->create_vertex_elements_state(b->pipe, 2, velem);
+   b->pipe->bind_vertex_elements_state(b->pipe, b->velems);
+
+   memset(&state, 0, sizeof(state));
+   if (!tgsi_text_translate(vs_text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate vertex shader\n");
+      exit(1);
+   }
+   state.tokens = tokens;
+   b->vs = b->pipe->create_vs_state(b->pipe, &state);
+   b->pipe->bind_vs_state(b->pipe, b->vs);
+
+   b->fs = util_make_fragment_passthrough_shader(b->pipe,
+                                                 TGSI_SEMANTIC_GENERIC,
+                                                 TGSI_INTERPOLATE_PERSPECTIVE,
+                                                 FALSE);
+   b->pipe->bind_fs_state(b->pipe, b->fs);
+
+   memset(&cb, 0, sizeof(cb));
+   cb.user_buffer = consts;
+   cb.buffer_size = sizeof(consts);
+   b->pipe->set_constant_buffer(b->pipe, PIPE_SHADER_VERTEX, 0, &cb);
+
+   make_mesh(b, num_tris);
+
+   memset(&vb, 0, sizeof(vb));
+   vb.stride = 8 * sizeof(float);
+   vb.buffer = b->vbuf;
+   b->pipe->set_vertex_buffers(b->pipe, 0, 1, &vb);
+
+   memset(&ib, 0, sizeof(ib));
+   ib.index_size = 4;
+   ib.buffer = b->ibuf;
+   b->pipe->set_index_buffer(b->pipe, &ib);
+}
+
+
+static void
+destroy_bench(struct bench *b)
+{
+   b->pipe->bind_vs_state(b->pipe, NULL);
+   b->pipe->bind_fs_state(b->pipe, NULL);
+   b->pipe->delete_vs_state(b->pipe, b->vs);
+   b->pipe->delete_fs_state(b->pipe, b->fs);
+   b->pipe->delete_blend_state(b->pipe, b->blend);
+   b->pipe->delete_depth_stencil_alpha_state(b->pipe, b->dsa);
+   b->pipe->delete_rasterizer_state(b->pipe, b->rast);
+   b->pipe->delete_vertex_elements_state(b->pipe, b->velems);
+   pipe_surface_reference(&b->cbuf, NULL);
+   pipe_resource_reference(&b->target, NULL);
+   pipe_resource_reference(&b->vbuf, NULL);
+   pipe_resource_reference(&b->ibuf, NULL);
+   b->pipe->destroy(b->pipe);
+   b->screen->destroy(b->screen);
+}
+
+
+static double
+run_bench(unsigned num_threads, unsigned num_tris, boolean rasterize)
+{
+   struct bench b;
+   struct pipe_draw_info info;
+   char value[16];
+   int64_t start, end;
+   unsigned i;
+
+   /* the draw module picks the thread count at context creation */
+   util_snprintf(value, sizeof(value), "%u", num_threads);
+   setenv("DRAW_VS_THREADS", value, 1);
+
+   memset(&b, 0, sizeof(b));
+   init_bench(&b, num_tris, rasterize);
+
+   util_draw_init_info(&info);
+   info.indexed = TRUE;
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.count = b.num_indices;
+   info.max_index = ~0;
+
+   /* warm up */
+   b.pipe->draw_vbo(b.pipe, &info);
+   b.pipe->flush(b.pipe, NULL, 0);
+
+   start = os_time_get_nano();
+   for (i = 0; i < ITERATIONS; i++) {
+      b.pipe->draw_vbo(b.pipe, &info);
+      b.pipe->flush(b.pipe, NULL, 0);
+   }
+   end = os_time_get_nano();
+
+   destroy_bench(&b);
+
+   return (double)(end - start) / 1e9 / ITERATIONS;
+}
+
+
+int main(int argc, char **argv)
+{
+   static const unsigned sizes[] = { 100000, 250000, 500000, 1000000 };
+   static const unsigned threads[] = { 0, 1, 2, 4, 8, 16 };
+   boolean rasterize = FALSE;
+   unsigned max_threads = 16;
+   unsigned i, j;
+
+   for (i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "-r"))
+         rasterize = TRUE;
+      else
+         max_threads = atoi(argv[i]);
+   }
+
+   printf("%10s %8s %12s %12s %8s\n",
+          "tris", "threads", "ms/draw", "Mtris/s", "speedup");
+
+   for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+      double base = 0.0;
+
+      for (j = 0; j < ARRAY_SIZE(threads) && threads[j] <= max_threads; j++) {
+         double t = run_bench(threads[j], sizes[i], rasterize);
+
+         if (j == 0)
+            base = t;
+
+         printf("%10u %8u %12.2f %12.2f %8.2f\n",
+                sizes[i], threads[j], t * 1e3,
+                sizes[i] / t / 1e6, base / t);
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,314 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test for the fbdev software winsys, with a temporary file standing in
+ * for the framebuffer.
+ *
+ * softpipe clears display targets to random colors and presents them;
+ * the file must then hold the same pixels, converted to the framebuffer's
+ * format by util_format_translate() as the reference.  Screen-sized
+ * display targets of the framebuffer's format are page flipped, others
+ * are copied to the window position; the page scanned out and the other
+ * page are both checked after every present.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "state_tracker/sw_winsys.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "softpipe/sp_public.h"
+#include "sw/fbdev/fbdev_sw_winsys.h"
+
+
+#define FB_WIDTH 160
+#define FB_HEIGHT 96
+
+
+struct test_case {
+   enum pipe_format fb_format;
+   enum pipe_format format;
+   unsigned width, height;
+   int x, y;
+   boolean flip;
+};
+
+static const struct test_case cases[] = {
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM, 160, 96, 0, 0, TRUE },
+   { PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_B5G6R5_UNORM, 160, 96, 0, 0, TRUE },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM, 64, 40, 10, 20, FALSE },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM, 64, 40, 130, -8, FALSE },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM, 160, 96, 0, 0, FALSE },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM, 100, 50, 3, 5, FALSE },
+   { PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM, 160, 96, 0, 0, FALSE },
+   { PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM, 33, 17, 1, 2, FALSE },
+};
+
+
+static struct pipe_resource *
+create_display_target(struct pipe_screen *screen, const struct test_case *tc)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = tc->format;
+   templ.width0 = tc->width;
+   templ.height0 = tc->height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_DISPLAY_TARGET | PIPE_BIND_RENDER_TARGET;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+/**
+ * Check that the framebuffer page holds the display target's pixels at
+ * the window position, and nothing but the background elsewhere.
+ */
+static boolean
+check_page(struct pipe_context *pipe, struct pipe_resource *tex,
+           const struct test_case *tc, const struct fbdev_sw_mode *mode,
+           const uint8_t *page, uint8_t background)
+{
+   unsigned cpp = util_format_get_blocksize(mode->format);
+   boolean padded = util_format_description(mode->format)->channel[3].type ==
+                    UTIL_FORMAT_TYPE_VOID;
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   uint8_t *expected;
+   boolean ok = TRUE;
+   int x0 = MAX2(tc->x, 0), y0 = MAX2(tc->y, 0);
+   int x1 = MIN2(tc->x + (int) tc->width, (int) mode->width);
+   int y1 = MIN2(tc->y + (int) tc->height, (int) mode->height);
+   int y;
+
+   expected = MALLOC(mode->stride * mode->height);
+   memset(expected, background, mode->stride * mode->height);
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, tc->width, tc->height, &transfer);
+   util_format_translate(mode->format, expected, mode->stride, x0, y0,
+                         tc->format, map, transfer->stride,
+                         x0 - tc->x, y0 - tc->y, x1 - x0, y1 - y0);
+   pipe->transfer_unmap(pipe, transfer);
+
+   for (y = 0; y < (int) mode->height && ok; y++) {
+      const uint8_t *p = page + y * mode->stride;
+      const uint8_t *e = expected + y * mode->stride;
+      int x, i;
+
+      for (x = 0; x < (int) mode->width; x++) {
+         for (i = 0; i < (int) cpp; i++) {
+            /* the contents of X channels are undefined */
+            if (x >= x0 && x < x1 && y >= y0 && y < y1 && i == 3 &&
+                padded)
+               continue;
+            if (p[x * cpp + i] != e[x * cpp + i])
+               ok = FALSE;
+         }
+      }
+   }
+
+   FREE(expected);
+   return ok;
+}
+
+
+/**
+ * Check that the framebuffer page holds nothing but the background.
+ */
+static boolean
+check_background(const struct fbdev_sw_mode *mode, const uint8_t *page,
+                 uint8_t background)
+{
+   unsigned i;
+
+   for (i = 0; i < mode->stride * mode->height; i++) {
+      if (page[i] != background)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Clear the display target to random colors and present it.
+ */
+static void
+present_frame(struct pipe_screen *screen, struct pipe_context *pipe,
+              struct pipe_resource *tex, const struct test_case *tc,
+              struct fbdev_drawable *drawable)
+{
+   struct pipe_surface templ, *surf;
+   union pipe_color_union color;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.format = tc->format;
+   surf = pipe->create_surface(pipe, tex, &templ);
+
+   color.f[0] = (float) rand() / RAND_MAX;
+   color.f[1] = (float) rand() / RAND_MAX;
+   color.f[2] = (float) rand() / RAND_MAX;
+   color.f[3] = 1.0f;
+   pipe->clear_render_target(pipe, surf, &color, 0, 0,
+                             tc->width, tc->height, FALSE);
+   color.f[0] = 1.0f - color.f[0];
+   pipe->clear_render_target(pipe, surf, &color, 5, 7, 9, 3, FALSE);
+
+   pipe_surface_reference(&surf, NULL);
+   pipe->flush(pipe, NULL, 0);
+   screen->flush_frontbuffer(screen, tex, 0, 0, drawable, NULL);
+}
+
+
+static boolean
+test_case(const struct test_case *tc)
+{
+   struct fbdev_sw_mode mode;
+   struct fbdev_drawable drawable;
+   struct sw_winsys *winsys;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource *tex, *tex2 = NULL;
+   uint8_t *fb, *page0, *page1;
+   FILE *file;
+   boolean ok = TRUE;
+   unsigned frame;
+
+   mode.width = FB_WIDTH;
+   mode.height = FB_HEIGHT;
+   mode.virtual_height = 2 * FB_HEIGHT;
+   mode.stride = util_format_get_stride(tc->fb_format, FB_WIDTH);
+   mode.format = tc->fb_format;
+
+   fb = MALLOC(mode.stride * mode.virtual_height);
+   page0 = fb;
+   page1 = fb + mode.height * mode.stride;
+   memset(fb, 0x5a, mode.stride * mode.virtual_height);
+   file = tmpfile();
+   fwrite(fb, 1, mode.stride * mode.virtual_height, file);
+   fflush(file);
+
+   winsys = fbdev_create_sw_winsys(fileno(file), &mode);
+   screen = softpipe_create_screen(winsys);
+   pipe = screen->context_create(screen, NULL, 0);
+
+   drawable.x = tc->x;
+   drawable.y = tc->y;
+
+   /* Page 0 is being scanned out, so a flipped display target gets page 1
+    * and presenting it pans there.  A copied one is written to page 0 and
+    * nothing pans.
+    */
+   tex = create_display_target(screen, tc);
+   for (frame = 0; frame < 2 && ok; frame++) {
+      present_frame(screen, pipe, tex, tc, &drawable);
+      pread(fileno(file), fb, mode.stride * mode.virtual_height, 0);
+
+      if (tc->flip) {
+         ok = fbdev_sw_get_yoffset(winsys) == FB_HEIGHT &&
+              check_page(pipe, tex, tc, &mode, page1, 0x5a) &&
+              check_background(&mode, page0, 0x5a);
+      }
+      else {
+         ok = fbdev_sw_get_yoffset(winsys) == 0 &&
+              check_page(pipe, tex, tc, &mode, page0, 0x5a) &&
+              check_background(&mode, page1, 0x5a);
+      }
+   }
+
+   /* A second flipped display target gets page 0, now free, and the two
+    * then take turns on screen.
+    */
+   if (tc->flip && ok) {
+      tex2 = create_display_target(screen, tc);
+
+      present_frame(screen, pipe, tex2, tc, &drawable);
+      pread(fileno(file), fb, mode.stride * mode.virtual_height, 0);
+      ok = fbdev_sw_get_yoffset(winsys) == 0 &&
+           check_page(pipe, tex2, tc, &mode, page0, 0x5a) &&
+           check_page(pipe, tex, tc, &mode, page1, 0x5a);
+
+      if (ok) {
+         present_frame(screen, pipe, tex, tc, &drawable);
+         pread(fileno(file), fb, mode.stride * mode.virtual_height, 0);
+         ok = fbdev_sw_get_yoffset(winsys) == FB_HEIGHT &&
+              check_page(pipe, tex, tc, &mode, page1, 0x5a) &&
+              check_page(pipe, tex2, tc, &mode, page0, 0x5a);
+      }
+   }
+
+   printf("%s %-28s %-28s %3ux%-3u at %4d,%-4d %s\n",
+          ok ? "PASS" : "FAIL",
+          util_format_name(tc->format), util_format_name(tc->fb_format),
+          tc->width, tc->height, tc->x, tc->y,
+          tc->flip ? "(flip)" : "(copy)");
+
+   pipe_resource_reference(&tex2, NULL);
+   pipe_resource_reference(&tex, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+   fclose(file);
+   FREE(fb);
+
+   return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned i, num_failed = 0;
+
+   /* the test cases expect flipping where possible */
+   unsetenv("FBDEV_NO_PAGE_FLIP");
+
+   for (i = 0; i < ARRAY_SIZE(cases); i++) {
+      if (!test_case(&cases[i]))
+         num_failed++;
+   }
+
+   printf("%u/%u passed\n", (unsigned) ARRAY_SIZE(cases) - num_failed,
+          (unsigned) ARRAY_SIZE(cases));
+
+   return num_failed ? 1 : 0;
+}
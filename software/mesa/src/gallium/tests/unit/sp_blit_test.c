@@ -0,0 +1,416 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Conformance test for softpipe's CPU blit path.
+ *
+ * Every blit is done on two softpipe contexts, one of them created with
+ * SOFTPIPE_NO_NATIVE_BLIT so that it goes through util_blitter, over a
+ * range of format pairs, source/destination rectangles (scaling, flips,
+ * partial boxes), filters and scissors.  The destinations must match
+ * within the rounding differences of the two paths, and the pixels outside
+ * the blitted rectangle must be left alone.
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define SRC_WIDTH 37
+#define SRC_HEIGHT 29
+#define DST_WIDTH 64
+#define DST_HEIGHT 48
+#define LAYERS 2
+
+
+struct format_pair {
+   enum pipe_format src;
+   enum pipe_format dst;
+};
+
+static const struct format_pair format_pairs[] = {
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_B8G8R8X8_UNORM },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_B5G6R5_UNORM },
+   { PIPE_FORMAT_B8G8R8A8_SRGB, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_Z32_FLOAT, PIPE_FORMAT_Z32_FLOAT },
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, PIPE_FORMAT_Z24_UNORM_S8_UINT },
+};
+
+
+struct blit_rect {
+   const char *name;
+   int sx, sy, sw, sh;
+   int dx, dy, dw, dh;
+};
+
+/* The scale factors are chosen so that no destination pixel center maps
+ * exactly onto a source texel edge, where nearest filtering may go either
+ * way depending on rounding.
+ */
+static const struct blit_rect rects[] = {
+   { "copy",      0, 0, SRC_WIDTH, SRC_HEIGHT,  3, 5, SRC_WIDTH, SRC_HEIGHT },
+   { "sub",       4, 7, 20, 11,                 30, 1, 20, 11 },
+   { "flip_y",    0, SRC_HEIGHT, SRC_WIDTH, -SRC_HEIGHT,
+                                                0, 0, SRC_WIDTH, SRC_HEIGHT },
+   { "flip_x",    SRC_WIDTH, 0, -SRC_WIDTH, SRC_HEIGHT,
+                                                2, 2, SRC_WIDTH, SRC_HEIGHT },
+   { "upscale",   0, 0, SRC_WIDTH, SRC_HEIGHT,  0, 0, DST_WIDTH, DST_HEIGHT },
+   { "downscale", 0, 0, SRC_WIDTH, SRC_HEIGHT,  8, 8, 17, 13 },
+   { "stretch",   5, 3, 10, 20,                 1, 9, 60, 8 },
+};
+
+
+struct test_config {
+   const struct format_pair *formats;
+   const struct blit_rect *rect;
+   unsigned filter;
+   boolean scissor;
+};
+
+
+static unsigned rand_state = 1;
+
+static unsigned
+rand_uint(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, enum pipe_format format,
+               unsigned width, unsigned height)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D_ARRAY;
+   templ.format = format;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = LAYERS;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW |
+      (util_format_is_depth_or_stencil(format) ?
+       PIPE_BIND_DEPTH_STENCIL : PIPE_BIND_RENDER_TARGET);
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+/**
+ * Fill all layers of a texture with random values.  Float formats get
+ * values in [0, 1] so that both paths clamp identically.
+ */
+static void
+fill_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+             boolean random)
+{
+   const struct util_format_description *desc =
+      util_format_description(tex->format);
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   uint8_t *map;
+   unsigned x, y, z;
+
+   u_box_3d(0, 0, 0, tex->width0, tex->height0, LAYERS, &box);
+   map = pipe->transfer_map(pipe, tex, 0, PIPE_TRANSFER_WRITE, &box,
+                            &transfer);
+
+   for (z = 0; z < LAYERS; z++) {
+      for (y = 0; y < tex->height0; y++) {
+         uint8_t *row = map + z * transfer->layer_stride +
+            y * transfer->stride;
+
+         if (desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) {
+            for (x = 0; x < tex->width0; x++) {
+               float depth = random ? (rand_uint() & 0xffff) / 65535.0f : 0.5f;
+               uint8_t stencil = random ? rand_uint() : 0x5a;
+               if (util_format_has_depth(desc))
+                  desc->pack_z_float(row + x * (desc->block.bits / 8), 0,
+                                     &depth, 0, 1, 1);
+               if (util_format_has_stencil(desc))
+                  desc->pack_s_8uint(row + x * (desc->block.bits / 8), 0,
+                                     &stencil, 0, 1, 1);
+            }
+         }
+         else {
+            float rgba[4];
+            for (x = 0; x < tex->width0; x++) {
+               unsigned c;
+               for (c = 0; c < 4; c++)
+                  rgba[c] = random ? (rand_uint() & 0xff) / 255.0f : 0.25f;
+               desc->pack_rgba_float(row + x * (desc->block.bits / 8), 0,
+                                     rgba, 0, 1, 1);
+            }
+         }
+      }
+   }
+
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+
+/**
+ * Read back all layers of a texture as floats: rgba for color formats,
+ * depth and stencil in the first two channels for depth/stencil ones.
+ */
+static void
+read_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+             float *dst)
+{
+   const struct util_format_description *desc =
+      util_format_description(tex->format);
+   const unsigned n = tex->width0 * tex->height0;
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   uint8_t *map;
+   unsigned z, y, x;
+
+   u_box_3d(0, 0, 0, tex->width0, tex->height0, LAYERS, &box);
+   map = pipe->transfer_map(pipe, tex, 0, PIPE_TRANSFER_READ, &box,
+                            &transfer);
+
+   for (z = 0; z < LAYERS; z++) {
+      for (y = 0; y < tex->height0; y++) {
+         const uint8_t *row = map + z * transfer->layer_stride +
+            y * transfer->stride;
+         float *out = dst + (z * n + y * tex->width0) * 4;
+
+         if (desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) {
+            memset(out, 0, tex->width0 * 4 * sizeof(float));
+            for (x = 0; x < tex->width0; x++) {
+               const uint8_t *src = row + x * (desc->block.bits / 8);
+               uint8_t stencil = 0;
+               if (util_format_has_depth(desc))
+                  desc->unpack_z_float(&out[x * 4], 0, src, 0, 1, 1);
+               if (util_format_has_stencil(desc))
+                  desc->unpack_s_8uint(&stencil, 0, src, 0, 1, 1);
+               out[x * 4 + 1] = stencil;
+            }
+         }
+         else {
+            desc->unpack_rgba_float(out, 0, row, 0, tex->width0, 1);
+         }
+      }
+   }
+
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+
+static void
+do_blit(struct pipe_context *pipe, struct pipe_resource *src,
+        struct pipe_resource *dst, const struct test_config *cfg)
+{
+   const struct blit_rect *r = cfg->rect;
+   struct pipe_blit_info info;
+
+   memset(&info, 0, sizeof(info));
+   info.src.resource = src;
+   info.src.format = src->format;
+   info.src.level = 0;
+   u_box_3d(r->sx, r->sy, 0, r->sw, r->sh, LAYERS, &info.src.box);
+   info.dst.resource = dst;
+   info.dst.format = dst->format;
+   info.dst.level = 0;
+   u_box_3d(r->dx, r->dy, 0, r->dw, r->dh, LAYERS, &info.dst.box);
+   info.mask = util_format_get_mask(dst->format);
+   info.filter = cfg->filter;
+   if (cfg->scissor) {
+      info.scissor_enable = TRUE;
+      info.scissor.minx = 7;
+      info.scissor.miny = 4;
+      info.scissor.maxx = 41;
+      info.scissor.maxy = 23;
+   }
+
+   pipe->blit(pipe, &info);
+}
+
+
+/**
+ * Largest difference allowed between the two paths: one step of the
+ * destination (or source, if coarser) precision, plus filtering rounding.
+ */
+static float
+get_tolerance(const struct test_config *cfg)
+{
+   const struct util_format_description *src_desc =
+      util_format_description(cfg->formats->src);
+   const struct util_format_description *dst_desc =
+      util_format_description(cfg->formats->dst);
+   unsigned bits = 23;
+   unsigned c;
+
+   if (dst_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS)
+      return cfg->filter == PIPE_TEX_FILTER_LINEAR ? 1e-3f : 0.0f;
+
+   for (c = 0; c < 4; c++) {
+      if (src_desc->channel[c].normalized && src_desc->channel[c].size)
+         bits = MIN2(bits, src_desc->channel[c].size);
+      if (dst_desc->channel[c].normalized && dst_desc->channel[c].size)
+         bits = MIN2(bits, dst_desc->channel[c].size);
+   }
+   if (src_desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT &&
+       src_desc->channel[0].size == 16)
+      bits = MIN2(bits, 10);
+
+   return 1.01f / (float) ((1 << bits) - 1);
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe[2];
+   float *result[2];
+   struct test_config cfg;
+   unsigned p, r, f, s, i;
+   unsigned num_tests = 0, num_failed = 0;
+   boolean blitted = FALSE;
+
+   screen = softpipe_create_screen(null_sw_create());
+
+   /* softpipe reads the option at context creation */
+   unsetenv("SOFTPIPE_NO_NATIVE_BLIT");
+   pipe[0] = screen->context_create(screen, NULL, 0);
+   setenv("SOFTPIPE_NO_NATIVE_BLIT", "1", 1);
+   pipe[1] = screen->context_create(screen, NULL, 0);
+
+   result[0] = MALLOC(DST_WIDTH * DST_HEIGHT * LAYERS * 4 * sizeof(float));
+   result[1] = MALLOC(DST_WIDTH * DST_HEIGHT * LAYERS * 4 * sizeof(float));
+
+   for (p = 0; p < ARRAY_SIZE(format_pairs); p++) {
+   for (r = 0; r < ARRAY_SIZE(rects); r++) {
+   for (f = 0; f < 2; f++) {
+   for (s = 0; s < 2; s++) {
+      struct pipe_resource *src, *dst[2];
+      float tolerance, max_diff = 0.0f;
+      unsigned num_changed = 0;
+
+      cfg.formats = &format_pairs[p];
+      cfg.rect = &rects[r];
+      cfg.filter = f ? PIPE_TEX_FILTER_LINEAR : PIPE_TEX_FILTER_NEAREST;
+      cfg.scissor = s;
+
+      if (!screen->is_format_supported(screen, cfg.formats->src,
+                                       PIPE_TEXTURE_2D_ARRAY, 0,
+                                       PIPE_BIND_SAMPLER_VIEW) ||
+          !screen->is_format_supported(screen, cfg.formats->dst,
+                                       PIPE_TEXTURE_2D_ARRAY, 0,
+                                       util_format_is_depth_or_stencil(
+                                          cfg.formats->dst) ?
+                                       PIPE_BIND_DEPTH_STENCIL :
+                                       PIPE_BIND_RENDER_TARGET))
+         continue;
+
+      src = create_texture(screen, cfg.formats->src, SRC_WIDTH, SRC_HEIGHT);
+      fill_texture(pipe[0], src, TRUE);
+
+      for (i = 0; i < 2; i++) {
+         dst[i] = create_texture(screen, cfg.formats->dst,
+                                 DST_WIDTH, DST_HEIGHT);
+         fill_texture(pipe[i], dst[i], FALSE);
+         do_blit(pipe[i], src, dst[i], &cfg);
+         pipe[i]->flush(pipe[i], NULL, 0);
+         read_texture(pipe[i], dst[i], result[i]);
+      }
+
+      for (i = 0; i < DST_WIDTH * DST_HEIGHT * LAYERS * 4; i++) {
+         max_diff = MAX2(max_diff, fabsf(result[0][i] - result[1][i]));
+      }
+
+      /* did the blitter path write anything at all? */
+      fill_texture(pipe[1], dst[1], FALSE);
+      read_texture(pipe[1], dst[1], result[0]);
+      for (i = 0; i < DST_WIDTH * DST_HEIGHT * LAYERS * 4; i++) {
+         if (result[0][i] != result[1][i])
+            num_changed++;
+      }
+      if (num_changed)
+         blitted = TRUE;
+
+      tolerance = get_tolerance(&cfg);
+      if (num_changed && max_diff > tolerance) {
+         printf("FAILED: %s -> %s %s %s%s: max difference %f\n",
+                util_format_name(cfg.formats->src),
+                util_format_name(cfg.formats->dst),
+                cfg.rect->name, f ? "linear" : "nearest",
+                s ? " scissor" : "", max_diff);
+         num_failed++;
+      }
+
+      num_tests++;
+
+      pipe_resource_reference(&src, NULL);
+      pipe_resource_reference(&dst[0], NULL);
+      pipe_resource_reference(&dst[1], NULL);
+   }
+   }
+   }
+   }
+
+   FREE(result[0]);
+   FREE(result[1]);
+   pipe[0]->destroy(pipe[0]);
+   pipe[1]->destroy(pipe[1]);
+   screen->destroy(screen);
+
+   if (!blitted) {
+      printf("SKIP: nothing was rasterized\n");
+      return 0;
+   }
+
+   printf("%u/%u blits match\n", num_tests - num_failed, num_tests);
+
+   return num_failed ? 1 : 0;
+}
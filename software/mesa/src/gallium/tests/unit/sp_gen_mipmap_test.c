@@ -0,0 +1,378 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test for softpipe's CPU mipmap generation.
+ *
+ * The base level of textures of various formats and targets is filled with
+ * random data and pipe_context::generate_mipmap is called on it.  Every
+ * generated level is checked against a box filter of the previous level
+ * computed here in double precision, and layers outside the requested
+ * range must be left alone.  Some textures are big enough to be split
+ * between worker threads.
+ */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define PATTERN 0x5a
+
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_R8G8B8A8_UNORM,
+   PIPE_FORMAT_B8G8R8X8_UNORM,
+   PIPE_FORMAT_R8_UNORM,
+   PIPE_FORMAT_R8G8_UNORM,
+   PIPE_FORMAT_B8G8R8A8_SRGB,
+   PIPE_FORMAT_R8G8B8A8_SRGB,
+   PIPE_FORMAT_B5G6R5_UNORM,
+   PIPE_FORMAT_R10G10B10A2_UNORM,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R32_FLOAT,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+};
+
+
+struct texture_config {
+   const char *name;
+   enum pipe_texture_target target;
+   unsigned width, height, depth, array_size;
+   unsigned first_layer, last_layer;
+};
+
+static const struct texture_config textures[] = {
+   { "1d",        PIPE_TEXTURE_1D,       67,  1,  1, 1, 0, 0 },
+   { "2d_npot",   PIPE_TEXTURE_2D,       37,  29, 1, 1, 0, 0 },
+   { "2d_large",  PIPE_TEXTURE_2D,       256, 256, 1, 1, 0, 0 },
+   { "2d_array",  PIPE_TEXTURE_2D_ARRAY, 19,  33, 1, 4, 1, 2 },
+   { "2d_array_large", PIPE_TEXTURE_2D_ARRAY, 160, 96, 1, 3, 0, 2 },
+   { "cube",      PIPE_TEXTURE_CUBE,     16,  16, 1, 6, 3, 3 },
+   { "3d",        PIPE_TEXTURE_3D,       16,  8,  5, 1, 0, 0 },
+   { "3d_flat",   PIPE_TEXTURE_3D,       8,   8,  1, 1, 0, 0 },
+};
+
+
+static unsigned rand_state = 1;
+
+static unsigned
+rand_uint(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+
+static unsigned
+num_layers(const struct pipe_resource *tex, unsigned level)
+{
+   if (tex->target == PIPE_TEXTURE_3D)
+      return u_minify(tex->depth0, level);
+   return tex->array_size;
+}
+
+
+/**
+ * Copy a whole level in or out of a texture, layers tightly packed.
+ */
+static void
+access_level(struct pipe_context *pipe, struct pipe_resource *tex,
+             unsigned level, uint8_t *data, boolean write)
+{
+   const unsigned width = u_minify(tex->width0, level);
+   const unsigned height = u_minify(tex->height0, level);
+   const unsigned layers = num_layers(tex, level);
+   const unsigned stride = util_format_get_stride(tex->format, width);
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   uint8_t *map;
+   unsigned z, y;
+
+   u_box_3d(0, 0, 0, width, height, layers, &box);
+   map = pipe->transfer_map(pipe, tex, level,
+                            write ? PIPE_TRANSFER_WRITE : PIPE_TRANSFER_READ,
+                            &box, &transfer);
+
+   for (z = 0; z < layers; z++) {
+      for (y = 0; y < height; y++) {
+         uint8_t *row = map + z * transfer->layer_stride + y * transfer->stride;
+         uint8_t *buf = data + (z * height + y) * stride;
+         if (write)
+            memcpy(row, buf, stride);
+         else
+            memcpy(buf, row, stride);
+      }
+   }
+
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+
+static float
+get_tolerance(enum pipe_format format)
+{
+   const struct util_format_description *desc =
+      util_format_description(format);
+   unsigned bits = 23;
+   unsigned c;
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      if (desc->channel[c].type == UTIL_FORMAT_TYPE_FLOAT)
+         bits = MIN2(bits, desc->channel[c].size == 16 ? 10 : 20);
+      else if (desc->channel[c].normalized)
+         bits = MIN2(bits, desc->channel[c].size);
+   }
+
+   return 1.01f / (float) ((1 << bits) - 1);
+}
+
+
+/**
+ * Check one generated level against a box filter of the previous one.
+ * Returns the largest difference found, compared in the format's encoded
+ * (non-sRGB) space.
+ */
+static float
+check_level(const struct pipe_resource *tex, unsigned level,
+            const uint8_t *src, const uint8_t *dst,
+            unsigned first_layer, unsigned last_layer)
+{
+   const struct util_format_description *desc =
+      util_format_description(tex->format);
+   const struct util_format_description *linear_desc =
+      util_format_description(util_format_linear(tex->format));
+   const unsigned bpp = util_format_get_blocksize(tex->format);
+   const unsigned sw = u_minify(tex->width0, level - 1);
+   const unsigned sh = u_minify(tex->height0, level - 1);
+   const unsigned sd = num_layers(tex, level - 1);
+   const unsigned dw = u_minify(tex->width0, level);
+   const unsigned dh = u_minify(tex->height0, level);
+   const boolean is_3d = tex->target == PIPE_TEXTURE_3D;
+   unsigned z, y, x, c, i;
+   float max_diff = 0.0f;
+
+   if (is_3d) {
+      first_layer = 0;
+      last_layer = num_layers(tex, level) - 1;
+   }
+
+   for (z = first_layer; z <= last_layer; z++) {
+      for (y = 0; y < dh; y++) {
+         for (x = 0; x < dw; x++) {
+            const unsigned xs[2] = { 2 * x, MIN2(2 * x + 1, sw - 1) };
+            const unsigned ys[2] = { 2 * y, MIN2(2 * y + 1, sh - 1) };
+            const unsigned zs[2] = {
+               is_3d ? 2 * z : z,
+               is_3d ? MIN2(2 * z + 1, sd - 1) : z
+            };
+            double sum[4] = { 0, 0, 0, 0 };
+            float expected[4], texel[4], got[4];
+            uint8_t packed[16];
+
+            for (i = 0; i < 8; i++) {
+               const uint8_t *s = src +
+                  ((zs[i >> 2] * sh + ys[(i >> 1) & 1]) * sw +
+                   xs[i & 1]) * bpp;
+               desc->unpack_rgba_float(texel, 0, s, 0, 1, 1);
+               for (c = 0; c < 4; c++)
+                  sum[c] += texel[c];
+            }
+            for (c = 0; c < 4; c++)
+               expected[c] = (float) (sum[c] / 8.0);
+
+            /* quantize the expected value, then compare encoded values */
+            memset(packed, 0, sizeof(packed));
+            desc->pack_rgba_float(packed, 0, expected, 0, 1, 1);
+            linear_desc->unpack_rgba_float(expected, 0, packed, 0, 1, 1);
+            linear_desc->unpack_rgba_float(got, 0,
+                                           dst + ((z * dh + y) * dw + x) * bpp,
+                                           0, 1, 1);
+            for (c = 0; c < 4; c++)
+               max_diff = MAX2(max_diff, fabsf(expected[c] - got[c]));
+         }
+      }
+   }
+
+   return max_diff;
+}
+
+
+/**
+ * Are the layers outside [first_layer, last_layer] of a level still
+ * filled with the pattern?
+ */
+static boolean
+check_untouched(const struct pipe_resource *tex, unsigned level,
+                const uint8_t *data, unsigned first_layer, unsigned last_layer)
+{
+   const unsigned layer_size =
+      util_format_get_stride(tex->format, u_minify(tex->width0, level)) *
+      u_minify(tex->height0, level);
+   unsigned z, i;
+
+   if (tex->target == PIPE_TEXTURE_3D)
+      return TRUE;
+
+   for (z = 0; z < num_layers(tex, level); z++) {
+      if (z >= first_layer && z <= last_layer)
+         continue;
+      for (i = 0; i < layer_size; i++) {
+         if (data[z * layer_size + i] != PATTERN)
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   unsigned f, t;
+   unsigned num_tests = 0, num_failed = 0;
+
+   /* make sure the bigger textures are split between threads */
+   setenv("SOFTPIPE_MIPMAP_THREADS", "3", 0);
+
+   screen = softpipe_create_screen(null_sw_create());
+   pipe = screen->context_create(screen, NULL, 0);
+
+   for (f = 0; f < ARRAY_SIZE(formats); f++) {
+   for (t = 0; t < ARRAY_SIZE(textures); t++) {
+      const struct texture_config *cfg = &textures[t];
+      const float tolerance = get_tolerance(formats[f]);
+      struct pipe_resource templ, *tex;
+      uint8_t *data[2];
+      unsigned level, i, size;
+      boolean ok = TRUE;
+
+      if (!screen->is_format_supported(screen, formats[f], cfg->target, 0,
+                                       PIPE_BIND_SAMPLER_VIEW))
+         continue;
+
+      memset(&templ, 0, sizeof(templ));
+      templ.target = cfg->target;
+      templ.format = formats[f];
+      templ.width0 = cfg->width;
+      templ.height0 = cfg->height;
+      templ.depth0 = cfg->depth;
+      templ.array_size = cfg->array_size;
+      templ.last_level = util_logbase2(MAX3(cfg->width, cfg->height,
+                                            cfg->depth));
+      templ.bind = PIPE_BIND_SAMPLER_VIEW;
+      tex = screen->resource_create(screen, &templ);
+
+      size = util_format_get_stride(formats[f], cfg->width) * cfg->height *
+         MAX2(cfg->depth, cfg->array_size);
+      data[0] = MALLOC(size);
+      data[1] = MALLOC(size);
+
+      /* random base level, keeping float channels in [0, 1] */
+      for (i = 0; i < size / 4; i++) {
+         const struct util_format_description *desc =
+            util_format_description(formats[f]);
+         if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT &&
+             desc->channel[0].size == 32)
+            ((float *) data[0])[i] = (rand_uint() & 0xffff) / 65535.0f;
+         else if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT)
+            ((uint32_t *) data[0])[i] = rand_uint() & 0x3bff3bff;
+         else
+            ((uint32_t *) data[0])[i] = rand_uint() ^ (rand_uint() << 16);
+      }
+      access_level(pipe, tex, 0, data[0], TRUE);
+
+      for (level = 1; level <= templ.last_level; level++) {
+         memset(data[1], PATTERN, size);
+         access_level(pipe, tex, level, data[1], TRUE);
+      }
+
+      if (!pipe->generate_mipmap(pipe, tex, formats[f], 0, templ.last_level,
+                                 cfg->first_layer, cfg->last_layer)) {
+         printf("FAILED: %s %s: not supported\n",
+                util_format_name(formats[f]), cfg->name);
+         ok = FALSE;
+      }
+
+      for (level = 1; ok && level <= templ.last_level; level++) {
+         float diff;
+
+         access_level(pipe, tex, level - 1, data[0], FALSE);
+         access_level(pipe, tex, level, data[1], FALSE);
+
+         diff = check_level(tex, level, data[0], data[1],
+                            cfg->first_layer, cfg->last_layer);
+         if (diff > tolerance) {
+            printf("FAILED: %s %s level %u: max difference %f\n",
+                   util_format_name(formats[f]), cfg->name, level, diff);
+            ok = FALSE;
+         }
+
+         if (!check_untouched(tex, level, data[1],
+                              cfg->first_layer, cfg->last_layer)) {
+            printf("FAILED: %s %s level %u: layers outside the range "
+                   "were modified\n",
+                   util_format_name(formats[f]), cfg->name, level);
+            ok = FALSE;
+         }
+      }
+
+      if (!ok)
+         num_failed++;
+      num_tests++;
+
+      FREE(data[0]);
+      FREE(data[1]);
+      pipe_resource_reference(&tex, NULL);
+   }
+   }
+
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   printf("%u/%u textures match\n", num_tests - num_failed, num_tests);
+
+   return num_failed ? 1 : 0;
+}
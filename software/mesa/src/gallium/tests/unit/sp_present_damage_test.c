@@ -0,0 +1,422 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test for softpipe's damage-limited presents.
+ *
+ * softpipe runs on a small in-memory winsys whose "window" is a plain
+ * buffer that presents copy into.  After every frame the window must show
+ * exactly what was rendered into the display target, while frames that
+ * change little must copy little.  Frames are made of full clears, partial
+ * clears, copies and blits (through util_blitter as well, which renders
+ * through the tile cache), and two display targets are presented to the
+ * same window in turn the way swapped front/back buffers are.  The
+ * driver's bytes-presented query must agree with what the winsys copied.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "state_tracker/sw_winsys.h"
+#include "util/u_box.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "softpipe/sp_public.h"
+
+
+#define WIDTH 256
+#define HEIGHT 192
+#define FORMAT PIPE_FORMAT_B8G8R8A8_UNORM
+#define FULL_FRAME (WIDTH * HEIGHT * 4)
+
+
+struct test_displaytarget {
+   unsigned stride;
+   uint8_t *data;
+};
+
+
+struct test_winsys {
+   struct sw_winsys base;
+   uint8_t window[FULL_FRAME];
+   unsigned bytes_presented;
+};
+
+
+static boolean
+test_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                       unsigned tex_usage,
+                                       enum pipe_format format)
+{
+   return format == FORMAT;
+}
+
+
+static struct sw_displaytarget *
+test_displaytarget_create(struct sw_winsys *ws, unsigned tex_usage,
+                          enum pipe_format format,
+                          unsigned width, unsigned height,
+                          unsigned alignment, const void *front_private,
+                          unsigned *stride)
+{
+   struct test_displaytarget *dt = CALLOC_STRUCT(test_displaytarget);
+
+   dt->stride = align(util_format_get_stride(format, width), alignment);
+   dt->data = align_malloc(dt->stride * height, alignment);
+   *stride = dt->stride;
+   return (struct sw_displaytarget *) dt;
+}
+
+
+static void *
+test_displaytarget_map(struct sw_winsys *ws, struct sw_displaytarget *dt,
+                       unsigned flags)
+{
+   return ((struct test_displaytarget *) dt)->data;
+}
+
+
+static void
+test_displaytarget_unmap(struct sw_winsys *ws, struct sw_displaytarget *dt)
+{
+}
+
+
+static void
+test_displaytarget_destroy(struct sw_winsys *ws, struct sw_displaytarget *dt)
+{
+   align_free(((struct test_displaytarget *) dt)->data);
+   FREE(dt);
+}
+
+
+static void
+present_box(struct test_winsys *tws, struct test_displaytarget *dt,
+            const struct pipe_box *box)
+{
+   int y;
+
+   for (y = box->y; y < box->y + box->height; y++) {
+      memcpy(tws->window + (y * WIDTH + box->x) * 4,
+             dt->data + y * dt->stride + box->x * 4, box->width * 4);
+   }
+   tws->bytes_presented += box->width * box->height * 4;
+}
+
+
+static void
+test_displaytarget_display(struct sw_winsys *ws, struct sw_displaytarget *dt,
+                           void *context_private, struct pipe_box *box)
+{
+   struct pipe_box full;
+
+   if (!box) {
+      u_box_2d(0, 0, WIDTH, HEIGHT, &full);
+      box = &full;
+   }
+   present_box((struct test_winsys *) ws, (struct test_displaytarget *) dt,
+               box);
+}
+
+
+static void
+test_displaytarget_display_rects(struct sw_winsys *ws,
+                                 struct sw_displaytarget *dt,
+                                 void *context_private,
+                                 const struct pipe_box *boxes,
+                                 unsigned num_boxes)
+{
+   unsigned i;
+
+   for (i = 0; i < num_boxes; i++)
+      present_box((struct test_winsys *) ws,
+                  (struct test_displaytarget *) dt, &boxes[i]);
+}
+
+
+static void
+test_winsys_destroy(struct sw_winsys *ws)
+{
+   FREE(ws);
+}
+
+
+static struct test_winsys *
+test_winsys_create(void)
+{
+   struct test_winsys *tws = CALLOC_STRUCT(test_winsys);
+
+   tws->base.destroy = test_winsys_destroy;
+   tws->base.is_displaytarget_format_supported =
+      test_is_displaytarget_format_supported;
+   tws->base.displaytarget_create = test_displaytarget_create;
+   tws->base.displaytarget_map = test_displaytarget_map;
+   tws->base.displaytarget_unmap = test_displaytarget_unmap;
+   tws->base.displaytarget_display = test_displaytarget_display;
+   tws->base.displaytarget_display_rects = test_displaytarget_display_rects;
+   tws->base.displaytarget_destroy = test_displaytarget_destroy;
+   return tws;
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = FORMAT;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = bind;
+
+   return screen->resource_create(screen, &templ);
+}
+
+
+static void
+bind_framebuffer(struct pipe_context *pipe, struct pipe_resource *tex,
+                 struct pipe_surface **surf)
+{
+   struct pipe_framebuffer_state fb;
+   struct pipe_surface templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.format = FORMAT;
+   pipe_surface_reference(surf, NULL);
+   *surf = pipe->create_surface(pipe, tex, &templ);
+
+   memset(&fb, 0, sizeof(fb));
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = *surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+}
+
+
+static void
+blit(struct pipe_context *pipe, struct pipe_resource *src,
+     struct pipe_resource *dst, int sx, int sy, int dx, int dy,
+     int width, int height)
+{
+   struct pipe_blit_info info;
+
+   memset(&info, 0, sizeof(info));
+   info.src.resource = src;
+   info.src.format = FORMAT;
+   u_box_2d(sx, sy, width, height, &info.src.box);
+   info.dst.resource = dst;
+   info.dst.format = FORMAT;
+   u_box_2d(dx, dy, 2 * width, height / 2, &info.dst.box);
+   info.mask = PIPE_MASK_RGBA;
+   info.filter = PIPE_TEX_FILTER_LINEAR;
+   pipe->blit(pipe, &info);
+}
+
+
+static unsigned
+find_driver_query(struct pipe_screen *screen, const char *name)
+{
+   struct pipe_driver_query_info info;
+   unsigned i;
+
+   for (i = 0; screen->get_driver_query_info(screen, i, &info); i++) {
+      if (strcmp(info.name, name) == 0)
+         return info.query_type;
+   }
+   return 0;
+}
+
+
+/**
+ * Present a display target and check the window against its contents.
+ * Returns FALSE on a mismatch or if more than max_bytes were copied.
+ */
+static boolean
+present(struct pipe_context *pipe, struct test_winsys *tws,
+        struct pipe_resource *tex, const char *name, unsigned max_bytes)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_transfer *transfer;
+   struct pipe_query *query;
+   union pipe_query_result result;
+   const uint8_t *map;
+   boolean ok = TRUE;
+   unsigned y;
+
+   pipe->flush(pipe, NULL, 0);
+
+   query = pipe->create_query(pipe, find_driver_query(screen,
+                                                      "bytes-presented"), 0);
+   pipe->begin_query(pipe, query);
+   tws->bytes_presented = 0;
+   screen->flush_frontbuffer(screen, tex, 0, 0, tws, NULL);
+   pipe->end_query(pipe, query);
+   pipe->get_query_result(pipe, query, TRUE, &result);
+   pipe->destroy_query(pipe, query);
+
+   if (result.u64 != tws->bytes_presented) {
+      printf("FAILED: %s: bytes-presented query is %u, winsys copied %u\n",
+             name, (unsigned) result.u64, tws->bytes_presented);
+      ok = FALSE;
+   }
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, WIDTH, HEIGHT, &transfer);
+   for (y = 0; y < HEIGHT; y++) {
+      if (memcmp(tws->window + y * WIDTH * 4, map + y * transfer->stride,
+                 WIDTH * 4)) {
+         printf("FAILED: %s: window differs from the display target "
+                "at row %u\n", name, y);
+         ok = FALSE;
+         break;
+      }
+   }
+   pipe->transfer_unmap(pipe, transfer);
+
+   if (tws->bytes_presented > max_bytes) {
+      printf("FAILED: %s: presented %u bytes, expected at most %u\n",
+             name, tws->bytes_presented, max_bytes);
+      ok = FALSE;
+   }
+
+   printf("%-24s %7u bytes\n", name, tws->bytes_presented);
+   return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct test_winsys *tws = test_winsys_create();
+   struct pipe_screen *screen;
+   struct pipe_context *pipe, *blitter_pipe;
+   struct pipe_resource *dt[2], *src;
+   struct pipe_surface *surf = NULL;
+   union pipe_color_union color;
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+   unsigned i, num_failed = 0;
+
+   screen = softpipe_create_screen(&tws->base);
+
+   /* softpipe reads the option at context creation */
+   unsetenv("SOFTPIPE_NO_NATIVE_BLIT");
+   pipe = screen->context_create(screen, NULL, 0);
+   setenv("SOFTPIPE_NO_NATIVE_BLIT", "1", 1);
+   blitter_pipe = screen->context_create(screen, NULL, 0);
+
+   dt[0] = create_texture(screen, PIPE_BIND_DISPLAY_TARGET |
+                          PIPE_BIND_RENDER_TARGET);
+   dt[1] = create_texture(screen, PIPE_BIND_DISPLAY_TARGET |
+                          PIPE_BIND_RENDER_TARGET);
+   src = create_texture(screen, PIPE_BIND_SAMPLER_VIEW);
+
+   map = pipe_transfer_map(pipe, src, 0, 0, PIPE_TRANSFER_WRITE,
+                           0, 0, WIDTH, HEIGHT, &transfer);
+   for (i = 0; i < HEIGHT * transfer->stride; i++)
+      map[i] = rand();
+   pipe->transfer_unmap(pipe, transfer);
+
+   /* full clear: everything */
+   bind_framebuffer(pipe, dt[0], &surf);
+   color.f[0] = 0.25f; color.f[1] = 0.5f; color.f[2] = 0.75f; color.f[3] = 1.0f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, &color, 0.0, 0);
+   if (!present(pipe, tws, dt[0], "full clear", FULL_FRAME))
+      num_failed++;
+
+   /* nothing changed: nothing */
+   if (!present(pipe, tws, dt[0], "no change", 0))
+      num_failed++;
+
+   /* two small clears */
+   color.f[0] = 1.0f;
+   pipe->clear_render_target(pipe, surf, &color, 10, 12, 20, 16, FALSE);
+   pipe->clear_render_target(pipe, surf, &color, 200, 150, 8, 8, FALSE);
+   if (!present(pipe, tws, dt[0], "partial clears", (20 * 16 + 8 * 8) * 4))
+      num_failed++;
+
+   /* copy and CPU blit */
+   {
+      struct pipe_box box;
+      u_box_2d(5, 5, 40, 30, &box);
+      pipe->resource_copy_region(pipe, dt[0], 0, 100, 60, 0, src, 0, &box);
+   }
+   blit(pipe, src, dt[0], 0, 0, 60, 100, 10, 40);
+   if (!present(pipe, tws, dt[0], "copy + blit", (40 * 30 + 120 * 20) * 4))
+      num_failed++;
+
+   /* a blit drawn by util_blitter: tile granularity */
+   blit(blitter_pipe, src, dt[0], 3, 7, 70, 70, 16, 32);
+   blitter_pipe->flush(blitter_pipe, NULL, 0);
+   if (!present(blitter_pipe, tws, dt[0], "drawn blit", FULL_FRAME / 4))
+      num_failed++;
+
+   /* the other buffer is presented in between */
+   bind_framebuffer(pipe, dt[1], &surf);
+   color.f[0] = 0.0f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, &color, 0.0, 0);
+   if (!present(pipe, tws, dt[1], "other buffer", FULL_FRAME))
+      num_failed++;
+
+   color.f[1] = 1.0f;
+   pipe->clear_render_target(pipe, surf, &color, 0, 0, 4, 4, FALSE);
+   if (!present(pipe, tws, dt[0], "back to first buffer", FULL_FRAME))
+      num_failed++;
+   if (tws->bytes_presented != FULL_FRAME) {
+      printf("FAILED: a different buffer was shown, but the present "
+             "was partial\n");
+      num_failed++;
+   }
+
+   if (!present(pipe, tws, dt[1], "second buffer again", FULL_FRAME))
+      num_failed++;
+
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&dt[0], NULL);
+   pipe_resource_reference(&dt[1], NULL);
+   pipe_resource_reference(&src, NULL);
+   pipe->destroy(pipe);
+   blitter_pipe->destroy(blitter_pipe);
+   screen->destroy(screen);
+
+   printf("%s\n", num_failed ? "FAILED" : "PASSED");
+
+   return num_failed ? 1 : 0;
+}
@@ -0,0 +1,513 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * State coverage test for softpipe's fused early-Z / shade / blend quad
+ * stage.
+ *
+ * The same scene of overlapping, partly coplanar triangles is drawn on two
+ * softpipe contexts, one of them created with SOFTPIPE_NO_FUSED_QUADS, for
+ * every combination of depth/stencil format, depth function and write mask,
+ * blend mode, color mask, color format and alpha/stencil test.  The color
+ * and depth/stencil buffers of both must match bit for bit, and so must the
+ * occlusion query results.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define WIDTH 96
+#define HEIGHT 80
+#define NUM_TRIS 96
+
+
+static const enum pipe_format zs_formats[] = {
+   PIPE_FORMAT_Z16_UNORM,
+   PIPE_FORMAT_Z32_FLOAT,
+   PIPE_FORMAT_Z24X8_UNORM,
+   PIPE_FORMAT_Z24_UNORM_S8_UINT,
+   PIPE_FORMAT_X8Z24_UNORM,
+   PIPE_FORMAT_S8_UINT_Z24_UNORM
+};
+
+static const enum pipe_format cbuf_formats[] = {
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_B8G8R8X8_UNORM,
+   PIPE_FORMAT_R8G8B8A8_UNORM,
+   PIPE_FORMAT_R32G32B32A32_FLOAT
+};
+
+static const unsigned depth_funcs[] = {
+   PIPE_FUNC_LESS,
+   PIPE_FUNC_LEQUAL,
+   PIPE_FUNC_GREATER,
+   PIPE_FUNC_ALWAYS
+};
+
+enum blend_mode {
+   BLEND_NONE,
+   BLEND_SRC_ALPHA,
+   BLEND_ONE_ONE,
+   NUM_BLEND_MODES
+};
+
+enum extra_state {
+   EXTRA_NONE,
+   EXTRA_COLORMASK,
+   EXTRA_ALPHA_TEST,
+   EXTRA_STENCIL,
+   EXTRA_NO_DEPTH_CLIP,
+   NUM_EXTRA_STATES
+};
+
+static const char *blend_names[] = { "none", "src_alpha", "one_one" };
+static const char *extra_names[] = {
+   "", "colormask", "alpha_test", "stencil", "no_depth_clip"
+};
+
+
+struct test_context {
+   struct pipe_context *pipe;
+   void *vs, *fs, *velems;
+};
+
+
+struct test_config {
+   enum pipe_format zs_format;
+   enum pipe_format cbuf_format;
+   unsigned depth_func;
+   unsigned depth_write;
+   enum blend_mode blend;
+   enum extra_state extra;
+};
+
+
+static unsigned rand_state = 1;
+
+static float
+rand_float(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return (float) ((rand_state >> 8) & 0xffff) / 65535.0f;
+}
+
+
+/**
+ * Position (xyzw) and color (rgba) of every vertex.  Every fourth
+ * triangle repeats the previous one with another color, so that LESS and
+ * LEQUAL give different results, and a few triangles poke out of the
+ * near and far planes.
+ */
+static void
+make_scene(float *verts)
+{
+   unsigned i, j;
+
+   for (i = 0; i < NUM_TRIS; i++) {
+      float *tri = verts + i * 3 * 8;
+
+      if (i % 4 == 3) {
+         memcpy(tri, tri - 3 * 8, 3 * 8 * sizeof(float));
+      }
+      else {
+         const float cx = rand_float() * 2.4f - 1.2f;
+         const float cy = rand_float() * 2.4f - 1.2f;
+         const float size = (i % 3) ? 0.6f : 1.5f;
+
+         for (j = 0; j < 3; j++) {
+            float *v = tri + j * 8;
+            v[0] = cx + (rand_float() - 0.5f) * size;
+            v[1] = cy + (rand_float() - 0.5f) * size;
+            v[2] = rand_float() * 2.4f - 1.2f;
+            v[3] = 1.0f;
+         }
+      }
+
+      for (j = 0; j < 3; j++) {
+         float *v = tri + j * 8;
+         v[4] = rand_float();
+         v[5] = rand_float();
+         v[6] = rand_float();
+         v[7] = rand_float();
+      }
+   }
+}
+
+
+static void
+init_context(struct test_context *tc, struct pipe_screen *screen,
+             boolean fused)
+{
+   static const uint semantic_names[] = {
+      TGSI_SEMANTIC_POSITION,
+      TGSI_SEMANTIC_GENERIC
+   };
+   static const uint semantic_indexes[] = { 0, 0 };
+   struct pipe_vertex_element velem[2];
+
+   /* softpipe reads the option at context creation */
+   if (fused)
+      unsetenv("SOFTPIPE_NO_FUSED_QUADS");
+   else
+      setenv("SOFTPIPE_NO_FUSED_QUADS", "1", 1);
+
+   tc->pipe = screen->context_create(screen, NULL, 0);
+
+   memset(velem, 0, sizeof(velem));
+   velem[0].src_offset = 0;
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   tc->velems = tc->pipe->create_vertex_elements_state(tc->pipe, 2, velem);
+   tc->pipe->bind_vertex_elements_state(tc->pipe, tc->velems);
+
+   tc->vs = util_make_vertex_passthrough_shader(tc->pipe, 2, semantic_names,
+                                                semantic_indexes, FALSE);
+   tc->pipe->bind_vs_state(tc->pipe, tc->vs);
+
+   tc->fs = util_make_fragment_passthrough_shader(tc->pipe,
+                                                  TGSI_SEMANTIC_GENERIC,
+                                                  TGSI_INTERPOLATE_PERSPECTIVE,
+                                                  FALSE);
+   tc->pipe->bind_fs_state(tc->pipe, tc->fs);
+}
+
+
+static void
+destroy_context(struct test_context *tc)
+{
+   tc->pipe->bind_vs_state(tc->pipe, NULL);
+   tc->pipe->bind_fs_state(tc->pipe, NULL);
+   tc->pipe->delete_vs_state(tc->pipe, tc->vs);
+   tc->pipe->delete_fs_state(tc->pipe, tc->fs);
+   tc->pipe->delete_vertex_elements_state(tc->pipe, tc->velems);
+   tc->pipe->destroy(tc->pipe);
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, enum pipe_format format,
+               unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = bind;
+   return screen->resource_create(screen, &templ);
+}
+
+
+static void
+read_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+             uint8_t *data)
+{
+   const unsigned stride = util_format_get_stride(tex->format, WIDTH);
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, WIDTH, HEIGHT, &transfer);
+   for (y = 0; y < HEIGHT; y++)
+      memcpy(data + y * stride, map + y * transfer->stride, stride);
+   pipe_transfer_unmap(pipe, transfer);
+}
+
+
+/**
+ * Draw the scene with the given state and read back both buffers.
+ * Returns the number of samples which passed the depth test.
+ */
+static uint64_t
+render(struct test_context *tc, struct pipe_screen *screen,
+       struct pipe_resource *vbuf, const struct test_config *cfg,
+       uint8_t *color, uint8_t *zs)
+{
+   struct pipe_context *pipe = tc->pipe;
+   struct pipe_resource *ctex, *ztex;
+   struct pipe_surface surf_tmpl, *cbuf, *zsbuf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state vp;
+   struct pipe_stencil_ref ref;
+   struct pipe_vertex_buffer vb;
+   struct pipe_draw_info info;
+   union pipe_color_union clear_color;
+   union pipe_query_result result;
+   struct pipe_query *query;
+   void *blend_cso, *dsa_cso, *rast_cso;
+
+   ctex = create_texture(screen, cfg->cbuf_format, PIPE_BIND_RENDER_TARGET);
+   ztex = create_texture(screen, cfg->zs_format, PIPE_BIND_DEPTH_STENCIL);
+
+   memset(&surf_tmpl, 0, sizeof(surf_tmpl));
+   surf_tmpl.format = cfg->cbuf_format;
+   cbuf = pipe->create_surface(pipe, ctex, &surf_tmpl);
+   surf_tmpl.format = cfg->zs_format;
+   zsbuf = pipe->create_surface(pipe, ztex, &surf_tmpl);
+
+   memset(&fb, 0, sizeof(fb));
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = cbuf;
+   fb.zsbuf = zsbuf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   memset(&blend, 0, sizeof(blend));
+   blend.rt[0].colormask = cfg->extra == EXTRA_COLORMASK ?
+      PIPE_MASK_R | PIPE_MASK_G | PIPE_MASK_B : PIPE_MASK_RGBA;
+   if (cfg->blend != BLEND_NONE) {
+      blend.rt[0].blend_enable = 1;
+      blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+      blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+      if (cfg->blend == BLEND_SRC_ALPHA) {
+         blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+         blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+         blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+         blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      }
+      else {
+         blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+         blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+         blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
+         blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
+      }
+   }
+   blend_cso = pipe->create_blend_state(pipe, &blend);
+   pipe->bind_blend_state(pipe, blend_cso);
+
+   memset(&dsa, 0, sizeof(dsa));
+   dsa.depth.enabled = 1;
+   dsa.depth.writemask = cfg->depth_write;
+   dsa.depth.func = cfg->depth_func;
+   if (cfg->extra == EXTRA_ALPHA_TEST) {
+      dsa.alpha.enabled = 1;
+      dsa.alpha.func = PIPE_FUNC_GREATER;
+      dsa.alpha.ref_value = 0.5f;
+   }
+   if (cfg->extra == EXTRA_STENCIL) {
+      dsa.stencil[0].enabled = 1;
+      dsa.stencil[0].func = PIPE_FUNC_ALWAYS;
+      dsa.stencil[0].fail_op = PIPE_STENCIL_OP_KEEP;
+      dsa.stencil[0].zfail_op = PIPE_STENCIL_OP_DECR;
+      dsa.stencil[0].zpass_op = PIPE_STENCIL_OP_INCR;
+      dsa.stencil[0].valuemask = 0xff;
+      dsa.stencil[0].writemask = 0xff;
+   }
+   dsa_cso = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, dsa_cso);
+
+   memset(&ref, 0, sizeof(ref));
+   pipe->set_stencil_ref(pipe, &ref);
+
+   memset(&rast, 0, sizeof(rast));
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip = cfg->extra != EXTRA_NO_DEPTH_CLIP;
+   rast_cso = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, rast_cso);
+
+   memset(&vp, 0, sizeof(vp));
+   vp.scale[0] = WIDTH / 2.0f;
+   vp.scale[1] = HEIGHT / 2.0f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = WIDTH / 2.0f;
+   vp.translate[1] = HEIGHT / 2.0f;
+   vp.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   memset(&vb, 0, sizeof(vb));
+   vb.stride = 8 * sizeof(float);
+   vb.buffer = vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vb);
+
+   clear_color.f[0] = 0.25f;
+   clear_color.f[1] = 0.5f;
+   clear_color.f[2] = 0.75f;
+   clear_color.f[3] = 0.5f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR0 | PIPE_CLEAR_DEPTHSTENCIL,
+               &clear_color, 0.75, 0x5a);
+
+   query = pipe->create_query(pipe, PIPE_QUERY_OCCLUSION_COUNTER, 0);
+   pipe->begin_query(pipe, query);
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.count = NUM_TRIS * 3;
+   pipe->draw_vbo(pipe, &info);
+
+   pipe->end_query(pipe, query);
+   pipe->get_query_result(pipe, query, TRUE, &result);
+   pipe->destroy_query(pipe, query);
+   pipe->flush(pipe, NULL, 0);
+
+   read_texture(pipe, ctex, color);
+   read_texture(pipe, ztex, zs);
+
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+   pipe->bind_rasterizer_state(pipe, NULL);
+   pipe->delete_blend_state(pipe, blend_cso);
+   pipe->delete_depth_stencil_alpha_state(pipe, dsa_cso);
+   pipe->delete_rasterizer_state(pipe, rast_cso);
+
+   memset(&fb, 0, sizeof(fb));
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&cbuf, NULL);
+   pipe_surface_reference(&zsbuf, NULL);
+   pipe_resource_reference(&ctex, NULL);
+   pipe_resource_reference(&ztex, NULL);
+
+   return result.u64;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen *screen;
+   struct test_context fused, generic;
+   struct pipe_resource *vbuf;
+   float *verts;
+   uint8_t *color[2], *zs[2];
+   uint64_t samples[2];
+   struct test_config cfg;
+   unsigned z, c, f, w, b, e;
+   unsigned num_tests = 0, num_failed = 0;
+   boolean rendered = FALSE;
+
+   screen = softpipe_create_screen(null_sw_create());
+   init_context(&fused, screen, TRUE);
+   init_context(&generic, screen, FALSE);
+
+   verts = MALLOC(NUM_TRIS * 3 * 8 * sizeof(float));
+   make_scene(verts);
+   vbuf = pipe_buffer_create(screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT,
+                             NUM_TRIS * 3 * 8 * sizeof(float));
+   pipe_buffer_write(fused.pipe, vbuf, 0,
+                     NUM_TRIS * 3 * 8 * sizeof(float), verts);
+   FREE(verts);
+
+   color[0] = MALLOC(WIDTH * HEIGHT * 16);
+   color[1] = MALLOC(WIDTH * HEIGHT * 16);
+   zs[0] = MALLOC(WIDTH * HEIGHT * 8);
+   zs[1] = MALLOC(WIDTH * HEIGHT * 8);
+
+   for (z = 0; z < ARRAY_SIZE(zs_formats); z++) {
+   for (c = 0; c < ARRAY_SIZE(cbuf_formats); c++) {
+   for (f = 0; f < ARRAY_SIZE(depth_funcs); f++) {
+   for (w = 0; w < 2; w++) {
+   for (b = 0; b < NUM_BLEND_MODES; b++) {
+   for (e = 0; e < NUM_EXTRA_STATES; e++) {
+      const unsigned color_size =
+         util_format_get_stride(cbuf_formats[c], WIDTH) * HEIGHT;
+      const unsigned zs_size =
+         util_format_get_stride(zs_formats[z], WIDTH) * HEIGHT;
+
+      if (e == EXTRA_STENCIL &&
+          !util_format_has_stencil(util_format_description(zs_formats[z])))
+         continue;
+
+      cfg.zs_format = zs_formats[z];
+      cfg.cbuf_format = cbuf_formats[c];
+      cfg.depth_func = depth_funcs[f];
+      cfg.depth_write = w;
+      cfg.blend = b;
+      cfg.extra = e;
+
+      samples[0] = render(&generic, screen, vbuf, &cfg, color[0], zs[0]);
+      samples[1] = render(&fused, screen, vbuf, &cfg, color[1], zs[1]);
+
+      if (samples[0])
+         rendered = TRUE;
+
+      if (samples[0] != samples[1] ||
+          memcmp(color[0], color[1], color_size) ||
+          memcmp(zs[0], zs[1], zs_size)) {
+         printf("FAILED: %s %s depth func %u write %u blend %s %s\n",
+                util_format_name(cfg.zs_format),
+                util_format_name(cfg.cbuf_format),
+                cfg.depth_func, cfg.depth_write,
+                blend_names[cfg.blend], extra_names[cfg.extra]);
+         num_failed++;
+      }
+
+      num_tests++;
+   }
+   }
+   }
+   }
+   }
+   }
+
+   FREE(color[0]);
+   FREE(color[1]);
+   FREE(zs[0]);
+   FREE(zs[1]);
+   pipe_resource_reference(&vbuf, NULL);
+   destroy_context(&fused);
+   destroy_context(&generic);
+   screen->destroy(screen);
+
+   if (!rendered) {
+      printf("SKIP: nothing was rasterized\n");
+      return 0;
+   }
+
+   printf("%u/%u state combinations match\n", num_tests - num_failed,
+          num_tests);
+
+   return num_failed ? 1 : 0;
+}
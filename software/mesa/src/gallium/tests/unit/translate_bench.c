@@ -0,0 +1,186 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Vertex fetch throughput of translate_simd against translate_generic.
+ *
+ * A few typical vertex layouts are fetched into the float4 layout the draw
+ * module uses, both linearly and through an index list.  The outputs of
+ * the two backends are also compared byte for byte.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os/os_time.h"
+#include "translate/translate.h"
+#include "util/u_format.h"
+#include "util/u_memory.h"
+
+
+#define NUM_VERTS (256 * 1024)
+#define ITERATIONS 8
+
+
+struct layout {
+   const char *name;
+   unsigned nr;
+   enum pipe_format formats[4];
+};
+
+static const struct layout layouts[] = {
+   { "pos3f", 1,
+     { PIPE_FORMAT_R32G32B32_FLOAT } },
+   { "pos3f+color4ub", 2,
+     { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R8G8B8A8_UNORM } },
+   { "pos3f+norm3f+tex2f", 3,
+     { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT,
+       PIPE_FORMAT_R32G32_FLOAT } },
+   { "pos4f+bgra4ub+tex2f+norm4b", 4,
+     { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_B8G8R8A8_UNORM,
+       PIPE_FORMAT_R32G32_FLOAT, PIPE_FORMAT_R8G8B8A8_SNORM } },
+};
+
+
+static double
+run_bench(struct translate *translate, const unsigned *elts, void *output)
+{
+   int64_t start, end;
+   unsigned i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < ITERATIONS; i++) {
+      if (elts)
+         translate->run_elts(translate, elts, NUM_VERTS, 0, 0, output);
+      else
+         translate->run(translate, 0, NUM_VERTS, 0, 0, output);
+   }
+   end = os_time_get_nano();
+
+   return (double)(end - start) / 1e9 / ITERATIONS;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned *elts;
+   unsigned l, i, pass;
+   int ret = 0;
+
+   elts = MALLOC(NUM_VERTS * sizeof(unsigned));
+   srand(1234);
+   for (i = 0; i < NUM_VERTS; i++)
+      elts[i] = (i + (rand() & 255)) % NUM_VERTS;
+
+   printf("%-28s %8s %12s %12s %8s\n",
+          "layout", "indexed", "generic Mv/s", "simd Mv/s", "speedup");
+
+   for (l = 0; l < ARRAY_SIZE(layouts); l++) {
+      const struct layout *layout = &layouts[l];
+      struct translate_key key;
+      struct translate *generic, *simd;
+      unsigned input_stride = 0;
+      uint8_t *input;
+      void *output[2];
+
+      memset(&key, 0, sizeof(key));
+      key.nr_elements = layout->nr;
+      key.output_stride = layout->nr * 4 * sizeof(float);
+      for (i = 0; i < layout->nr; i++) {
+         key.element[i].type = TRANSLATE_ELEMENT_NORMAL;
+         key.element[i].input_format = layout->formats[i];
+         key.element[i].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+         key.element[i].input_buffer = 0;
+         key.element[i].input_offset = input_stride;
+         key.element[i].output_offset = i * 4 * sizeof(float);
+         input_stride += util_format_get_blocksize(layout->formats[i]);
+      }
+
+      input = MALLOC(NUM_VERTS * input_stride);
+      for (i = 0; i < NUM_VERTS * input_stride; i++)
+         input[i] = rand();
+      /* keep the float channels finite */
+      for (i = 0; i < layout->nr; i++) {
+         if (util_format_description(layout->formats[i])->channel[0].type ==
+             UTIL_FORMAT_TYPE_FLOAT) {
+            unsigned v, c;
+            for (v = 0; v < NUM_VERTS; v++) {
+               float *f = (float *)(input + v * input_stride +
+                                    key.element[i].input_offset);
+               for (c = 0; c < util_format_get_nr_components(layout->formats[i]); c++)
+                  f[c] = (float) rand() / RAND_MAX;
+            }
+         }
+      }
+
+      output[0] = MALLOC(NUM_VERTS * key.output_stride);
+      output[1] = MALLOC(NUM_VERTS * key.output_stride);
+
+      generic = translate_generic_create(&key);
+      simd = translate_simd_create(&key);
+      if (!simd) {
+         printf("%-28s no simd kernels\n", layout->name);
+         ret = 1;
+         goto next;
+      }
+
+      generic->set_buffer(generic, 0, input, input_stride, NUM_VERTS - 1);
+      simd->set_buffer(simd, 0, input, input_stride, NUM_VERTS - 1);
+
+      for (pass = 0; pass < 2; pass++) {
+         const unsigned *pass_elts = pass ? elts : NULL;
+         boolean match;
+         double t[2];
+
+         t[0] = run_bench(generic, pass_elts, output[0]);
+         t[1] = run_bench(simd, pass_elts, output[1]);
+         match = !memcmp(output[0], output[1], NUM_VERTS * key.output_stride);
+
+         printf("%-28s %8s %12.1f %12.1f %8.2f%s\n",
+                layout->name, pass ? "yes" : "no",
+                NUM_VERTS / t[0] / 1e6, NUM_VERTS / t[1] / 1e6, t[0] / t[1],
+                match ? "" : "  MISMATCH");
+
+         if (!match)
+            ret = 1;
+      }
+
+      simd->release(simd);
+   next:
+      generic->release(generic);
+      FREE(output[0]);
+      FREE(output[1]);
+      FREE(input);
+   }
+
+   FREE(elts);
+
+   return ret;
+}
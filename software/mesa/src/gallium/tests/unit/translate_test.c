@@ -75,6 +75,8 @@ int main(int argc, char** argv)
       create_fn = translate_create;
    else if (!strcmp(argv[1], "generic"))
       create_fn = translate_generic_create;
+   else if (!strcmp(argv[1], "simd"))
+      create_fn = translate_simd_create;
    else if (!strcmp(argv[1], "x86"))
       create_fn = translate_sse2_create;
    else if (!strcmp(argv[1], "nosse"))
@@ -130,7 +132,7 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|simd|x86|nosse|sse|sse2|sse3|sse4.1]\n");
       return 2;
    }
 
@@ -0,0 +1,669 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Linux framebuffer (fbdev) software rasterizer winsys.
+ *
+ * The framebuffer is mmapped once.  Display targets of the screen's size
+ * and pixel layout are placed directly in its pages when the virtual
+ * resolution has room for two or three of them, and presenting one is a
+ * FBIOPAN_DISPLAY to its page, without copying.  Any other display target
+ * lives in system memory and is presented with a single copy into the
+ * visible page, converting the pixel format on the way if needed.
+ *
+ * The fd may also be a regular file or memfd sized for the given mode,
+ * which stands in for the device when benchmarking without a display;
+ * panning then just records which page would be shown.
+ */
+
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <linux/fb.h>
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_format.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "state_tracker/sw_winsys.h"
+
+#include "fbdev_sw_winsys.h"
+
+
+/** Triple buffering at most */
+#define FBDEV_MAX_PAGES 3
+
+DEBUG_GET_ONCE_BOOL_OPTION(fbdev_no_page_flip, "FBDEV_NO_PAGE_FLIP", FALSE)
+
+
+enum fbdev_conversion
+{
+   FBDEV_CONV_NONE,
+   FBDEV_CONV_COPY,
+   FBDEV_CONV_SWAP_RB,
+   FBDEV_CONV_BGRX_TO_565,
+   FBDEV_CONV_RGBX_TO_565
+};
+
+
+struct fbdev_sw_displaytarget
+{
+   enum pipe_format format;
+   unsigned width;
+   unsigned height;
+   unsigned stride;
+
+   void *data;
+   int page;   /**< framebuffer page holding the pixels, or -1 */
+};
+
+
+struct fbdev_sw_winsys
+{
+   struct sw_winsys base;
+
+   int fd;
+   struct fbdev_sw_mode mode;
+
+   /** Panning state, for actual framebuffer devices only */
+   boolean is_device;
+   struct fb_var_screeninfo var;
+   unsigned initial_page;
+
+   uint8_t *map;
+   size_t map_size;
+
+   unsigned num_pages;     /**< pages available for display targets */
+   unsigned used_pages;    /**< bitmask of pages given to display targets */
+   unsigned front_page;    /**< page being scanned out */
+};
+
+
+static inline struct fbdev_sw_displaytarget *
+fbdev_sw_displaytarget(struct sw_displaytarget *dt)
+{
+   return (struct fbdev_sw_displaytarget *) dt;
+}
+
+
+static inline struct fbdev_sw_winsys *
+fbdev_sw_winsys(struct sw_winsys *ws)
+{
+   return (struct fbdev_sw_winsys *) ws;
+}
+
+
+/**
+ * How pixels of format src are written to a framebuffer of format dst.
+ * The 32bpp formats are handled as native endian words.
+ */
+static enum fbdev_conversion
+fbdev_get_conversion(enum pipe_format src, enum pipe_format dst)
+{
+   if (src == dst)
+      return FBDEV_CONV_COPY;
+
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   switch (dst) {
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+      if (src == PIPE_FORMAT_B8G8R8A8_UNORM ||
+          src == PIPE_FORMAT_B8G8R8X8_UNORM)
+         return FBDEV_CONV_COPY;
+      if (src == PIPE_FORMAT_R8G8B8A8_UNORM ||
+          src == PIPE_FORMAT_R8G8B8X8_UNORM)
+         return FBDEV_CONV_SWAP_RB;
+      break;
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      if (src == PIPE_FORMAT_R8G8B8A8_UNORM ||
+          src == PIPE_FORMAT_R8G8B8X8_UNORM)
+         return FBDEV_CONV_COPY;
+      if (src == PIPE_FORMAT_B8G8R8A8_UNORM ||
+          src == PIPE_FORMAT_B8G8R8X8_UNORM)
+         return FBDEV_CONV_SWAP_RB;
+      break;
+   case PIPE_FORMAT_B5G6R5_UNORM:
+      if (src == PIPE_FORMAT_B8G8R8A8_UNORM ||
+          src == PIPE_FORMAT_B8G8R8X8_UNORM)
+         return FBDEV_CONV_BGRX_TO_565;
+      if (src == PIPE_FORMAT_R8G8B8A8_UNORM ||
+          src == PIPE_FORMAT_R8G8B8X8_UNORM)
+         return FBDEV_CONV_RGBX_TO_565;
+      break;
+   default:
+      break;
+   }
+#endif
+
+   return FBDEV_CONV_NONE;
+}
+
+
+/*
+ * Conversion kernels.  Each is a single pass over the rectangle with a
+ * branch-free inner loop the compiler can vectorize.
+ */
+
+static void
+fbdev_swap_rb(uint8_t *dst, unsigned dst_stride,
+              const uint8_t *src, unsigned src_stride,
+              unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint32_t *s = (const uint32_t *) (src + y * src_stride);
+      uint32_t *d = (uint32_t *) (dst + y * dst_stride);
+
+      for (x = 0; x < width; x++) {
+         uint32_t p = s[x];
+         d[x] = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+      }
+   }
+}
+
+
+static void
+fbdev_bgrx_to_565(uint8_t *dst, unsigned dst_stride,
+                  const uint8_t *src, unsigned src_stride,
+                  unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint32_t *s = (const uint32_t *) (src + y * src_stride);
+      uint16_t *d = (uint16_t *) (dst + y * dst_stride);
+
+      for (x = 0; x < width; x++) {
+         uint32_t p = s[x];
+         d[x] = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+      }
+   }
+}
+
+
+static void
+fbdev_rgbx_to_565(uint8_t *dst, unsigned dst_stride,
+                  const uint8_t *src, unsigned src_stride,
+                  unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      const uint32_t *s = (const uint32_t *) (src + y * src_stride);
+      uint16_t *d = (uint16_t *) (dst + y * dst_stride);
+
+      for (x = 0; x < width; x++) {
+         uint32_t p = s[x];
+         d[x] = ((p << 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 19) & 0x001f);
+      }
+   }
+}
+
+
+/**
+ * Write a rectangle of a display target to the visible page at (x, y),
+ * clipped to the screen.
+ */
+static void
+fbdev_sw_write(struct fbdev_sw_winsys *fbdev,
+               const struct fbdev_sw_displaytarget *fbdt,
+               const struct pipe_box *box, int x, int y)
+{
+   const struct fbdev_sw_mode *mode = &fbdev->mode;
+   unsigned src_cpp = util_format_get_blocksize(fbdt->format);
+   unsigned dst_cpp = util_format_get_blocksize(mode->format);
+   int sx = box->x, sy = box->y, width = box->width, height = box->height;
+   const uint8_t *src;
+   uint8_t *dst;
+
+   x += sx;
+   y += sy;
+   if (x < 0) {
+      sx -= x;
+      width += x;
+      x = 0;
+   }
+   if (y < 0) {
+      sy -= y;
+      height += y;
+      y = 0;
+   }
+   width = MIN2(width, (int) mode->width - x);
+   height = MIN2(height, (int) mode->height - y);
+   if (width <= 0 || height <= 0)
+      return;
+
+   src = (const uint8_t *) fbdt->data + sy * fbdt->stride + sx * src_cpp;
+   dst = fbdev->map + (fbdev->front_page * mode->height + y) * mode->stride +
+         x * dst_cpp;
+
+   switch (fbdev_get_conversion(fbdt->format, mode->format)) {
+   case FBDEV_CONV_COPY:
+      if (width == (int) mode->width && fbdt->stride == mode->stride) {
+         memcpy(dst, src, height * mode->stride);
+      }
+      else {
+         int i;
+         for (i = 0; i < height; i++)
+            memcpy(dst + i * mode->stride, src + i * fbdt->stride,
+                   width * dst_cpp);
+      }
+      break;
+   case FBDEV_CONV_SWAP_RB:
+      fbdev_swap_rb(dst, mode->stride, src, fbdt->stride, width, height);
+      break;
+   case FBDEV_CONV_BGRX_TO_565:
+      fbdev_bgrx_to_565(dst, mode->stride, src, fbdt->stride, width, height);
+      break;
+   case FBDEV_CONV_RGBX_TO_565:
+      fbdev_rgbx_to_565(dst, mode->stride, src, fbdt->stride, width, height);
+      break;
+   default:
+      assert(0);
+      break;
+   }
+}
+
+
+/**
+ * Scan out the page of a display target.
+ */
+static void
+fbdev_sw_flip(struct fbdev_sw_winsys *fbdev,
+              struct fbdev_sw_displaytarget *fbdt)
+{
+   if (fbdt->page == fbdev->front_page)
+      return;
+
+   if (fbdev->is_device) {
+      fbdev->var.xoffset = 0;
+      fbdev->var.yoffset = fbdt->page * fbdev->mode.height;
+      fbdev->var.activate = FB_ACTIVATE_VBL;
+
+      if (ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->var) < 0) {
+         struct pipe_box box;
+
+         /* The driver can't pan after all.  Copy from now on, and don't
+          * hand out pages anymore.
+          */
+         debug_printf("fbdev: FBIOPAN_DISPLAY failed, page flipping "
+                      "disabled\n");
+         fbdev->num_pages = 0;
+
+         u_box_2d(0, 0, fbdt->width, fbdt->height, &box);
+         fbdev_sw_write(fbdev, fbdt, &box, 0, 0);
+         return;
+      }
+   }
+
+   fbdev->front_page = fbdt->page;
+}
+
+
+static boolean
+fbdev_sw_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                           unsigned tex_usage,
+                                           enum pipe_format format)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+
+   return fbdev_get_conversion(format, fbdev->mode.format) !=
+          FBDEV_CONV_NONE;
+}
+
+
+static struct sw_displaytarget *
+fbdev_sw_displaytarget_create(struct sw_winsys *ws,
+                              unsigned tex_usage,
+                              enum pipe_format format,
+                              unsigned width, unsigned height,
+                              unsigned alignment,
+                              const void *front_private,
+                              unsigned *stride)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+   const struct fbdev_sw_mode *mode = &fbdev->mode;
+   struct fbdev_sw_displaytarget *fbdt;
+   enum fbdev_conversion conv = fbdev_get_conversion(format, mode->format);
+
+   if (conv == FBDEV_CONV_NONE)
+      return NULL;
+
+   fbdt = CALLOC_STRUCT(fbdev_sw_displaytarget);
+   if (!fbdt)
+      return NULL;
+
+   fbdt->format = format;
+   fbdt->width = width;
+   fbdt->height = height;
+   fbdt->page = -1;
+
+   /* Render straight into a free page if it can be scanned out as is */
+   if (fbdev->num_pages > 1 &&
+       (tex_usage & PIPE_BIND_DISPLAY_TARGET) &&
+       conv == FBDEV_CONV_COPY &&
+       width == mode->width && height == mode->height &&
+       mode->stride % alignment == 0) {
+      unsigned page;
+
+      /* Never hand out the page being scanned out.  It is not in
+       * used_pages when it is the initial page or when its display target
+       * was destroyed while on screen.
+       */
+      for (page = 0; page < fbdev->num_pages; page++) {
+         if (page != fbdev->front_page &&
+             !(fbdev->used_pages & (1 << page))) {
+            fbdev->used_pages |= 1 << page;
+            fbdt->page = page;
+            fbdt->stride = mode->stride;
+            fbdt->data = fbdev->map + page * mode->height * mode->stride;
+            break;
+         }
+      }
+   }
+
+   if (fbdt->page < 0) {
+      fbdt->stride = align(util_format_get_stride(format, width), alignment);
+      fbdt->data = align_malloc(fbdt->stride *
+                                util_format_get_nblocksy(format, height),
+                                alignment);
+      if (!fbdt->data) {
+         FREE(fbdt);
+         return NULL;
+      }
+   }
+
+   *stride = fbdt->stride;
+   return (struct sw_displaytarget *) fbdt;
+}
+
+
+static struct sw_displaytarget *
+fbdev_sw_displaytarget_from_handle(struct sw_winsys *ws,
+                                   const struct pipe_resource *templat,
+                                   struct winsys_handle *whandle,
+                                   unsigned *stride)
+{
+   return NULL;
+}
+
+
+static boolean
+fbdev_sw_displaytarget_get_handle(struct sw_winsys *ws,
+                                  struct sw_displaytarget *dt,
+                                  struct winsys_handle *whandle)
+{
+   return FALSE;
+}
+
+
+static void *
+fbdev_sw_displaytarget_map(struct sw_winsys *ws,
+                           struct sw_displaytarget *dt,
+                           unsigned flags)
+{
+   return fbdev_sw_displaytarget(dt)->data;
+}
+
+
+static void
+fbdev_sw_displaytarget_unmap(struct sw_winsys *ws,
+                             struct sw_displaytarget *dt)
+{
+}
+
+
+static void
+fbdev_sw_displaytarget_destroy(struct sw_winsys *ws,
+                               struct sw_displaytarget *dt)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+   struct fbdev_sw_displaytarget *fbdt = fbdev_sw_displaytarget(dt);
+
+   if (fbdt->page >= 0)
+      fbdev->used_pages &= ~(1 << fbdt->page);
+   else
+      align_free(fbdt->data);
+
+   FREE(fbdt);
+}
+
+
+static void
+fbdev_sw_displaytarget_display_rects(struct sw_winsys *ws,
+                                     struct sw_displaytarget *dt,
+                                     void *context_private,
+                                     const struct pipe_box *boxes,
+                                     unsigned num_boxes)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+   struct fbdev_sw_displaytarget *fbdt = fbdev_sw_displaytarget(dt);
+   const struct fbdev_drawable *drawable = context_private;
+   unsigned i;
+
+   if (fbdt->page >= 0 && fbdev->num_pages) {
+      fbdev_sw_flip(fbdev, fbdt);
+      return;
+   }
+
+   /* A display target in system memory, or in a page that can't be
+    * scanned out anymore.  Copying it to the visible page overwrites what
+    * is there, so this is meant for single buffered use.
+    */
+   for (i = 0; i < num_boxes; i++) {
+      fbdev_sw_write(fbdev, fbdt, &boxes[i],
+                     drawable ? drawable->x : 0,
+                     drawable ? drawable->y : 0);
+   }
+}
+
+
+static void
+fbdev_sw_displaytarget_display(struct sw_winsys *ws,
+                               struct sw_displaytarget *dt,
+                               void *context_private,
+                               struct pipe_box *box)
+{
+   struct fbdev_sw_displaytarget *fbdt = fbdev_sw_displaytarget(dt);
+   struct pipe_box full;
+
+   if (!box) {
+      u_box_2d(0, 0, fbdt->width, fbdt->height, &full);
+      box = &full;
+   }
+
+   fbdev_sw_displaytarget_display_rects(ws, dt, context_private, box, 1);
+}
+
+
+static void
+fbdev_sw_destroy(struct sw_winsys *ws)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+
+   /* leave the console where it was */
+   if (fbdev->is_device && fbdev->front_page != fbdev->initial_page) {
+      fbdev->var.xoffset = 0;
+      fbdev->var.yoffset = fbdev->initial_page * fbdev->mode.height;
+      fbdev->var.activate = FB_ACTIVATE_NOW;
+      ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->var);
+   }
+
+   munmap(fbdev->map, fbdev->map_size);
+   FREE(fbdev);
+}
+
+
+/**
+ * First row of the framebuffer memory being scanned out.  For a device
+ * this is the panning offset; a file is treated as if it had been panned.
+ */
+unsigned
+fbdev_sw_get_yoffset(struct sw_winsys *ws)
+{
+   struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
+
+   return fbdev->front_page * fbdev->mode.height;
+}
+
+
+/**
+ * Get the layout of a framebuffer device.  Returns FALSE if fd isn't one,
+ * or if its pixel format isn't a supported true color one.
+ */
+boolean
+fbdev_sw_get_mode(int fd, struct fbdev_sw_mode *mode)
+{
+   struct fb_fix_screeninfo fix;
+   struct fb_var_screeninfo var;
+
+   if (ioctl(fd, FBIOGET_FSCREENINFO, &fix) < 0 ||
+       ioctl(fd, FBIOGET_VSCREENINFO, &var) < 0)
+      return FALSE;
+
+   if (fix.type != FB_TYPE_PACKED_PIXELS ||
+       fix.visual != FB_VISUAL_TRUECOLOR ||
+       !fix.line_length || !var.yres)
+      return FALSE;
+
+   mode->format = PIPE_FORMAT_NONE;
+   if (var.bits_per_pixel == 32 &&
+       var.red.length == 8 && var.green.length == 8 && var.blue.length == 8 &&
+       var.green.offset == 8) {
+      if (var.red.offset == 16 && var.blue.offset == 0)
+         mode->format = var.transp.length ? PIPE_FORMAT_B8G8R8A8_UNORM :
+                                            PIPE_FORMAT_B8G8R8X8_UNORM;
+      else if (var.red.offset == 0 && var.blue.offset == 16)
+         mode->format = var.transp.length ? PIPE_FORMAT_R8G8B8A8_UNORM :
+                                            PIPE_FORMAT_R8G8B8X8_UNORM;
+   }
+   else if (var.bits_per_pixel == 16 &&
+            var.red.offset == 11 && var.red.length == 5 &&
+            var.green.offset == 5 && var.green.length == 6 &&
+            var.blue.offset == 0 && var.blue.length == 5) {
+      mode->format = PIPE_FORMAT_B5G6R5_UNORM;
+   }
+   if (mode->format == PIPE_FORMAT_NONE)
+      return FALSE;
+
+   mode->width = var.xres;
+   mode->height = var.yres;
+   mode->stride = fix.line_length;
+   mode->virtual_height = MIN2(var.yres_virtual,
+                               fix.smem_len / fix.line_length);
+
+   return TRUE;
+}
+
+
+/**
+ * Create a winsys presenting to the framebuffer device or file fd, which
+ * remains owned by the caller.  Devices are used in their current mode.
+ * Anything else, e.g. a regular file or memfd, is laid out as described by
+ * mode and grown to its size if needed.
+ */
+struct sw_winsys *
+fbdev_create_sw_winsys(int fd, const struct fbdev_sw_mode *mode)
+{
+   struct fbdev_sw_winsys *fbdev;
+   struct fb_fix_screeninfo fix;
+   unsigned ypanstep = 1;
+
+   fbdev = CALLOC_STRUCT(fbdev_sw_winsys);
+   if (!fbdev)
+      return NULL;
+
+   fbdev->fd = fd;
+
+   if (ioctl(fd, FBIOGET_FSCREENINFO, &fix) == 0 &&
+       ioctl(fd, FBIOGET_VSCREENINFO, &fbdev->var) == 0) {
+      fbdev->is_device = TRUE;
+      ypanstep = fix.ypanstep;
+      if (!fbdev_sw_get_mode(fd, &fbdev->mode))
+         goto fail;
+      mode = &fbdev->mode;
+   }
+   else {
+      struct stat st;
+
+      if (!mode || fstat(fd, &st) < 0)
+         goto fail;
+
+      if (st.st_size < (off_t) mode->stride * mode->virtual_height &&
+          ftruncate(fd, (off_t) mode->stride * mode->virtual_height) < 0)
+         goto fail;
+   }
+
+   fbdev->mode = *mode;
+   fbdev->map_size = mode->stride * mode->virtual_height;
+   fbdev->map = mmap(NULL, fbdev->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+   if (fbdev->map == MAP_FAILED)
+      goto fail;
+
+   if (fbdev->is_device && fbdev->var.yoffset % mode->height == 0)
+      fbdev->initial_page = fbdev->var.yoffset / mode->height;
+   fbdev->front_page = fbdev->initial_page;
+
+   /* Pages are only worth handing out to display targets if there are at
+    * least two to flip between.
+    */
+   fbdev->num_pages = MIN2(mode->virtual_height / mode->height,
+                           FBDEV_MAX_PAGES);
+   if (fbdev->num_pages < 2 || !ypanstep || mode->height % ypanstep ||
+       debug_get_option_fbdev_no_page_flip())
+      fbdev->num_pages = 0;
+
+   fbdev->base.destroy = fbdev_sw_destroy;
+   fbdev->base.is_displaytarget_format_supported =
+      fbdev_sw_is_displaytarget_format_supported;
+   fbdev->base.displaytarget_create = fbdev_sw_displaytarget_create;
+   fbdev->base.displaytarget_from_handle = fbdev_sw_displaytarget_from_handle;
+   fbdev->base.displaytarget_get_handle = fbdev_sw_displaytarget_get_handle;
+   fbdev->base.displaytarget_map = fbdev_sw_displaytarget_map;
+   fbdev->base.displaytarget_unmap = fbdev_sw_displaytarget_unmap;
+   fbdev->base.displaytarget_display = fbdev_sw_displaytarget_display;
+   fbdev->base.displaytarget_display_rects =
+      fbdev_sw_displaytarget_display_rects;
+   fbdev->base.displaytarget_destroy = fbdev_sw_displaytarget_destroy;
+
+   return &fbdev->base;
+
+fail:
+   FREE(fbdev);
+   return NULL;
+}
@@ -0,0 +1,70 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#ifndef FBDEV_SW_WINSYS_H
+#define FBDEV_SW_WINSYS_H
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_format.h"
+
+struct sw_winsys;
+
+
+/**
+ * Layout of the framebuffer memory.  Visible pages of height rows follow
+ * each other in a mapping of virtual_height rows.
+ */
+struct fbdev_sw_mode {
+   unsigned width;
+   unsigned height;
+   unsigned virtual_height;
+   unsigned stride;
+   enum pipe_format format;
+};
+
+
+/* This is what the fbdev software winsys expects to find in the
+ * "private" field of flush_frontbuffer(): where on the framebuffer a
+ * display target that can't be page flipped is copied to.  NULL means
+ * the top left corner.
+ */
+struct fbdev_drawable {
+   int x, y;
+};
+
+
+boolean
+fbdev_sw_get_mode(int fd, struct fbdev_sw_mode *mode);
+
+struct sw_winsys *
+fbdev_create_sw_winsys(int fd, const struct fbdev_sw_mode *mode);
+
+unsigned
+fbdev_sw_get_yoffset(struct sw_winsys *ws);
+
+#endif /* FBDEV_SW_WINSYS_H */
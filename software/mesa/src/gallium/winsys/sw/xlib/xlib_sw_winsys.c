@@ -34,6 +34,7 @@
 
 #include "pipe/p_format.h"
 #include "pipe/p_context.h"
+#include "util/u_box.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
@@ -290,17 +291,22 @@ xlib_displaytarget_destroy(struct sw_winsys *ws,
 
 /**
  * Display/copy the image in the surface into the X window specified
- * by the display target.
+ * by the display target.  If boxes is non-NULL only those regions are
+ * copied, unless the window may not show this display target yet.
  */
 static void
 xlib_sw_display(struct xlib_drawable *xlib_drawable,
-                struct sw_displaytarget *dt)
+                struct sw_displaytarget *dt,
+                const struct pipe_box *boxes,
+                unsigned num_boxes)
 {
    static boolean no_swap = 0;
    static boolean firsttime = 1;
    struct xlib_displaytarget *xlib_dt = xlib_displaytarget(dt);
    Display *display = xlib_dt->display;
    XImage *ximage;
+   struct pipe_box full;
+   unsigned i;
 
    if (firsttime) {
       no_swap = getenv("SP_NO_RAST") != NULL;
@@ -322,6 +328,9 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
       }
 
       xlib_dt->drawable = xlib_drawable->drawable;
+
+      /* new window, it needs all of the image */
+      boxes = NULL;
    }
 
    if (xlib_dt->tempImage == NULL) {
@@ -339,19 +348,16 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
       XSetFunction(display, xlib_dt->gc, GXcopy);
    }
 
-   if (xlib_dt->shm) {
-      ximage = xlib_dt->tempImage;
-      ximage->data = xlib_dt->data;
-
-      /* _debug_printf("XSHM\n"); */
-      XShmPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                   ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height, False);
+   if (!boxes) {
+      u_box_2d(0, 0, xlib_dt->width, xlib_dt->height, &full);
+      boxes = &full;
+      num_boxes = 1;
    }
-   else {
-      /* display image in Window */
-      ximage = xlib_dt->tempImage;
-      ximage->data = xlib_dt->data;
 
+   ximage = xlib_dt->tempImage;
+   ximage->data = xlib_dt->data;
+
+   if (!xlib_dt->shm) {
       /* check that the XImage has been previously initialized */
       assert(ximage->format);
       assert(ximage->bitmap_unit);
@@ -360,10 +366,24 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
       ximage->width = xlib_dt->width;
       ximage->height = xlib_dt->height;
       ximage->bytes_per_line = xlib_dt->stride;
+   }
+
+   for (i = 0; i < num_boxes; i++) {
+      const struct pipe_box *box = &boxes[i];
 
-      /* _debug_printf("XPUT\n"); */
-      XPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height);
+      if (xlib_dt->shm) {
+         /* _debug_printf("XSHM\n"); */
+         XShmPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
+                      ximage, box->x, box->y, box->x, box->y,
+                      box->width, box->height, False);
+      }
+      else {
+         /* display image in Window */
+         /* _debug_printf("XPUT\n"); */
+         XPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
+                   ximage, box->x, box->y, box->x, box->y,
+                   box->width, box->height);
+      }
    }
 
    XFlush(xlib_dt->display);
@@ -381,7 +401,22 @@ xlib_displaytarget_display(struct sw_winsys *ws,
                            struct pipe_box *box)
 {
    struct xlib_drawable *xlib_drawable = (struct xlib_drawable *)context_private;
-   xlib_sw_display(xlib_drawable, dt);
+   xlib_sw_display(xlib_drawable, dt, box, 1);
+}
+
+
+/**
+ * Copy just the damaged regions of the surface into the X window.
+ */
+static void
+xlib_displaytarget_display_rects(struct sw_winsys *ws,
+                                 struct sw_displaytarget *dt,
+                                 void *context_private,
+                                 const struct pipe_box *boxes,
+                                 unsigned num_boxes)
+{
+   struct xlib_drawable *xlib_drawable = (struct xlib_drawable *)context_private;
+   xlib_sw_display(xlib_drawable, dt, boxes, num_boxes);
 }
 
 
@@ -483,6 +518,7 @@ xlib_create_sw_winsys(Display *display)
    ws->base.displaytarget_destroy = xlib_displaytarget_destroy;
 
    ws->base.displaytarget_display = xlib_displaytarget_display;
+   ws->base.displaytarget_display_rects = xlib_displaytarget_display_rects;
 
    return &ws->base;
 }
@@ -50,6 +50,8 @@ struct gl_shader_program;
 struct gl_texture_image;
 struct gl_texture_object;
 struct gl_memory_info;
+struct blob;
+struct blob_reader;
 
 /* GL_ARB_vertex_buffer_object */
 /* Modifies GL_MAP_UNSYNCHRONIZED_BIT to allow driver to fail (return
@@ -515,6 +517,45 @@ struct dd_function_table {
     */
    GLboolean (*LinkShader)(struct gl_context *ctx,
                            struct gl_shader_program *shader);
+
+   /**
+    * Append the driver's translation of a linked program to a shader cache
+    * entry (optional).  Programs are only cached when this is set.
+    */
+   void (*ShaderCacheSerializeDriverBlob)(struct gl_context *ctx,
+                                          struct gl_program *prog,
+                                          struct blob *blob);
+
+   /**
+    * Restore what ShaderCacheSerializeDriverBlob() wrote.  Replaces the
+    * LinkShader() call when a program is loaded from the shader cache.
+    */
+   void (*ShaderCacheDeserializeDriverBlob)(struct gl_context *ctx,
+                                            struct gl_shader_program *shProg,
+                                            struct gl_program *prog,
+                                            struct blob_reader *blob);
+
+   /**
+    * Run \p execute on a driver worker thread (optional).  Used to compile
+    * and link GLSL in the background.  Returns NULL if the job cannot be
+    * queued, in which case the caller does the work itself.
+    *
+    * \p execute must only read context state that does not change after
+    * context creation, such as ctx->Const and ctx->Extensions.
+    */
+   struct gl_shader_job *(*QueueShaderJob)(struct gl_context *ctx,
+                                           void (*execute)(struct gl_context *ctx,
+                                                           void *data),
+                                           void *data);
+
+   /**
+    * Block until a queued job has run.  May be called repeatedly and from
+    * any thread, including from other jobs.
+    */
+   void (*WaitShaderJob)(struct gl_shader_job *job);
+
+   /** Wait for a queued job and free it. */
+   void (*DestroyShaderJob)(struct gl_shader_job *job);
    /*@}*/
 
    /**
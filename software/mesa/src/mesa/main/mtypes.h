@@ -86,6 +86,8 @@ struct prog_instruction;
 struct gl_program_parameter_list;
 struct set;
 struct set_entry;
+struct disk_cache;
+struct gl_shader_job;
 struct vbo_context;
 /*@}*/
 
@@ -2485,6 +2487,25 @@ struct gl_shader
 
    unsigned Version;       /**< GLSL version used for linking */
 
+   /** Shader cache key of the source and the state it was compiled with */
+   unsigned char sha1[20];
+
+   /**
+    * Set when the shader cache knows this shader and compilation was
+    * deferred until link time.  \c ir is NULL in that case.
+    */
+   bool CompileSkipped;
+
+   /**
+    * Background compilation, see ctx->Driver.QueueShaderJob().  Results
+    * like \c ir, \c InfoLog and \c CompileStatus may only be read after
+    * waiting for it, see _mesa_wait_shader_compile().
+    */
+   struct gl_shader_job *CompileJob;
+
+   /** Number of programs whose background link reads this shader */
+   unsigned PendingLinks;
+
    struct exec_list *ir;
    struct glsl_symbol_table *symbols;
 
@@ -2885,6 +2906,15 @@ struct gl_shader_program
     * #extension ARB_fragment_coord_conventions: enable
     */
    GLboolean ARB_fragment_coord_conventions_enable;
+
+   /** Shader cache key of the last link */
+   unsigned char sha1[20];
+
+   /**
+    * Background part of glLinkProgram(), see _mesa_finish_link_program().
+    * Everything set by linking is undefined while this is set.
+    */
+   struct gl_shader_job *LinkJob;
 };   
 
 
@@ -4685,6 +4715,9 @@ struct gl_context
     * Stores the arguments to glPrimitiveBoundingBox
     */
    GLfloat PrimitiveBoundingBox[8];
+
+   /** On-disk cache of linked GLSL programs, or NULL if disabled */
+   struct disk_cache *Cache;
 };
 
 /**
@@ -40,6 +40,7 @@
 #include <stdbool.h>
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/debug_output.h"
 #include "main/dispatch.h"
 #include "main/enums.h"
 #include "main/hash.h"
@@ -53,9 +54,11 @@
 #include "compiler/glsl/ir.h"
 #include "compiler/glsl/ir_uniform.h"
 #include "compiler/glsl/program.h"
+#include "program/ir_to_mesa.h"
 #include "program/program.h"
 #include "program/prog_print.h"
 #include "program/prog_parameter.h"
+#include "program/shader_cache.h"
 #include "util/ralloc.h"
 #include "util/hash_table.h"
 #include "util/mesa-sha1.h"
@@ -891,6 +894,8 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       return;
    }
 
+   _mesa_wait_shader_compile(ctx, shader);
+
    switch (pname) {
    case GL_SHADER_TYPE:
       *params = shader->Type;
@@ -963,6 +968,8 @@ get_shader_info_log(struct gl_context *ctx, GLuint shader, GLsizei bufSize,
       return;
    }
 
+   _mesa_wait_shader_compile(ctx, sh);
+
    _mesa_copy_string(infoLog, bufSize, length, sh->InfoLog);
 }
 
@@ -1008,14 +1015,129 @@ shader_source(struct gl_shader *sh, const GLchar *source)
 
 
 /**
- * Compile a shader.
+ * Whether glCompileShader() and glLinkProgram() may hand their work to
+ * ctx->Driver.QueueShaderJob().  The GLSL debug flags and debug output
+ * expect messages in call order and on the calling thread.
+ */
+static bool
+shader_jobs_allowed(struct gl_context *ctx)
+{
+   return ctx->Driver.QueueShaderJob &&
+          ctx->_Shader->Flags == 0 &&
+          !_mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT);
+}
+
+
+static void
+compile_shader_job(struct gl_context *ctx, void *data)
+{
+   struct gl_shader *sh = (struct gl_shader *) data;
+
+   _mesa_glsl_compile_shader(ctx, sh, false, false);
+}
+
+
+static void
+link_program_job(struct gl_context *ctx, void *data)
+{
+   struct gl_shader_program *shProg = (struct gl_shader_program *) data;
+
+   _mesa_glsl_link_shader_ir(ctx, shProg);
+}
+
+
+/**
+ * Wait for a background compile of \p sh, after which its compile results
+ * may be read.
  */
 void
-_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
+_mesa_wait_shader_compile(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (!sh->CompileJob)
+      return;
+
+   /* Background links wait for the job as well, keep it until they're
+    * done.
+    */
+   if (sh->PendingLinks) {
+      ctx->Driver.WaitShaderJob(sh->CompileJob);
+      return;
+   }
+
+   ctx->Driver.DestroyShaderJob(sh->CompileJob);
+   sh->CompileJob = NULL;
+}
+
+
+struct pending_links
+{
+   struct gl_shader *sh;
+   struct gl_shader_program **programs;
+   unsigned count;
+};
+
+static void
+find_pending_links(GLuint key, void *data, void *userData)
+{
+   struct gl_shader_program *shProg = (struct gl_shader_program *) data;
+   struct pending_links *pending = (struct pending_links *) userData;
+   unsigned i;
+
+   if (shProg->Type != GL_SHADER_PROGRAM_MESA || !shProg->LinkJob)
+      return;
+
+   for (i = 0; i < shProg->NumShaders; i++) {
+      if (shProg->Shaders[i] == pending->sh &&
+          pending->count < pending->sh->PendingLinks) {
+         pending->programs[pending->count++] = shProg;
+         return;
+      }
+   }
+}
+
+
+/**
+ * Wait until no background job uses \p sh any more, so that it can be
+ * modified.
+ */
+static void
+wait_shader_idle(struct gl_context *ctx, struct gl_shader *sh)
+{
+   if (sh->PendingLinks) {
+      struct pending_links pending;
+      unsigned i;
+
+      pending.sh = sh;
+      pending.programs = malloc(sh->PendingLinks * sizeof(pending.programs[0]));
+      pending.count = 0;
+      if (pending.programs) {
+         /* The programs are finished outside of the walk, which holds the
+          * hash table lock.
+          */
+         _mesa_HashWalk(ctx->Shared->ShaderObjects, find_pending_links,
+                        &pending);
+         for (i = 0; i < pending.count; i++)
+            _mesa_finish_link_program(ctx, pending.programs[i]);
+         free(pending.programs);
+      }
+   }
+
+   _mesa_wait_shader_compile(ctx, sh);
+}
+
+
+/**
+ * Compile a shader, in the background if \p background is set and the
+ * driver supports it.
+ */
+static void
+compile_shader(struct gl_context *ctx, struct gl_shader *sh, bool background)
 {
    if (!sh)
       return;
 
+   wait_shader_idle(ctx, sh);
+
    if (!sh->Source) {
       /* If the user called glCompileShader without first calling
        * glShaderSource, we should fail to compile, but not raise a GL_ERROR.
@@ -1028,10 +1150,34 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
          _mesa_log("%s\n", sh->Source);
       }
 
-      /* this call will set the shader->CompileStatus field to indicate if
-       * compilation was successful.
-       */
-      _mesa_glsl_compile_shader(ctx, sh, false, false);
+      if (shader_cache_lookup_shader(ctx, sh)) {
+         /* A program linked from this shader is in the shader cache.
+          * Defer compilation to _mesa_glsl_link_shader(), which only needs
+          * the IR if that program turns out not to be the one being linked.
+          */
+         ralloc_free(sh->ir);
+         sh->ir = NULL;
+         sh->symbols = NULL;
+         ralloc_free(sh->InfoLog);
+         sh->InfoLog = ralloc_strdup(sh, "");
+         sh->CompileStatus = GL_TRUE;
+         sh->CompileSkipped = true;
+      } else if (background && shader_jobs_allowed(ctx)) {
+         sh->CompileSkipped = false;
+         sh->CompileJob = ctx->Driver.QueueShaderJob(ctx, compile_shader_job,
+                                                     sh);
+         if (sh->CompileJob) {
+            /* Nothing below applies without GLSL debug flags. */
+            return;
+         }
+         _mesa_glsl_compile_shader(ctx, sh, false, false);
+      } else {
+         /* this call will set the shader->CompileStatus field to indicate if
+          * compilation was successful.
+          */
+         sh->CompileSkipped = false;
+         _mesa_glsl_compile_shader(ctx, sh, false, false);
+      }
 
       if (ctx->_Shader->Flags & GLSL_LOG) {
          _mesa_write_shader_to_file(sh);
@@ -1068,30 +1214,38 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 }
 
 
+
 /**
- * Link a program's shaders.
+ * Compile a shader.
  */
 void
-_mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
-   if (!shProg)
-      return;
+   compile_shader(ctx, sh, false);
+}
 
-   /* From the ARB_transform_feedback2 specification:
-    * "The error INVALID_OPERATION is generated by LinkProgram if <program> is
-    *  the name of a program being used by one or more transform feedback
-    *  objects, even if the objects are not currently bound or are paused."
-    */
-   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
-      _mesa_error(ctx, GL_INVALID_OPERATION,
-                  "glLinkProgram(transform feedback is using the program)");
-      return;
-   }
 
-   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+static void
+release_link_job(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   unsigned i;
 
-   _mesa_glsl_link_shader(ctx, shProg);
+   ctx->Driver.DestroyShaderJob(shProg->LinkJob);
+   shProg->LinkJob = NULL;
 
+   for (i = 0; i < shProg->NumShaders; i++) {
+      assert(shProg->Shaders[i]->PendingLinks > 0);
+      shProg->Shaders[i]->PendingLinks--;
+   }
+}
+
+
+/**
+ * Everything after the link itself: shader capture and error reporting.
+ */
+static void
+link_program_done(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
    /* Capture .shader_test files. */
    const char *capture_path = _mesa_get_shader_capture_path();
    if (shProg->Name != 0 && shProg->Name != ~0 && capture_path != NULL) {
@@ -1144,6 +1298,109 @@ _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
 }
 
 
+/**
+ * Link a program's shaders, in the background if \p background is set and
+ * the driver supports it.
+ */
+static void
+link_program(struct gl_context *ctx, struct gl_shader_program *shProg,
+             bool background)
+{
+   unsigned i;
+
+   if (!shProg)
+      return;
+
+   /* From the ARB_transform_feedback2 specification:
+    * "The error INVALID_OPERATION is generated by LinkProgram if <program> is
+    *  the name of a program being used by one or more transform feedback
+    *  objects, even if the objects are not currently bound or are paused."
+    */
+   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glLinkProgram(transform feedback is using the program)");
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+
+   if (_mesa_glsl_link_shader_start(ctx, shProg)) {
+      link_program_done(ctx, shProg);
+      return;
+   }
+
+   /* Only programs that nothing but the hash table refers to, i.e. that
+    * are not bound anywhere, can be linked in the background; everything
+    * else finds them through _mesa_lookup_shader_program(), which finishes
+    * the link.  Shaders with deferred compilation are compiled by the
+    * linker, which must not happen behind the application's back.
+    */
+   background = background && shProg->RefCount == 1 &&
+                shader_jobs_allowed(ctx);
+   for (i = 0; i < shProg->NumShaders && background; i++) {
+      if (shProg->Shaders[i]->CompileSkipped)
+         background = false;
+   }
+
+   if (background) {
+      for (i = 0; i < shProg->NumShaders; i++)
+         shProg->Shaders[i]->PendingLinks++;
+
+      shProg->LinkJob = ctx->Driver.QueueShaderJob(ctx, link_program_job,
+                                                   shProg);
+      if (shProg->LinkJob)
+         return;
+
+      for (i = 0; i < shProg->NumShaders; i++)
+         shProg->Shaders[i]->PendingLinks--;
+   }
+
+   _mesa_glsl_link_shader_ir(ctx, shProg);
+   _mesa_glsl_link_shader_finish(ctx, shProg);
+   link_program_done(ctx, shProg);
+}
+
+
+/**
+ * Link a program's shaders.
+ */
+void
+_mesa_link_program(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   link_program(ctx, shProg, false);
+}
+
+
+/**
+ * Wait for the background part of glLinkProgram() and complete the link
+ * on the calling thread.
+ */
+void
+_mesa_finish_link_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg)
+{
+   if (!shProg->LinkJob)
+      return;
+
+   release_link_job(ctx, shProg);
+   _mesa_glsl_link_shader_finish(ctx, shProg);
+   link_program_done(ctx, shProg);
+}
+
+
+/**
+ * Wait for the background part of glLinkProgram() without completing the
+ * link, for programs that are being deleted.
+ */
+void
+_mesa_cancel_link_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg)
+{
+   if (shProg->LinkJob)
+      release_link_job(ctx, shProg);
+}
+
+
 /**
  * Print basic shader info (for debug).
  */
@@ -1343,8 +1600,8 @@ _mesa_CompileShader(GLuint shaderObj)
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glCompileShader %u\n", shaderObj);
-   _mesa_compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
-                                                     "glCompileShader"));
+   compile_shader(ctx, _mesa_lookup_shader_err(ctx, shaderObj,
+                                               "glCompileShader"), true);
 }
 
 
@@ -1591,8 +1848,8 @@ _mesa_LinkProgram(GLuint programObj)
    GET_CURRENT_CONTEXT(ctx);
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glLinkProgram %u\n", programObj);
-   _mesa_link_program(ctx, _mesa_lookup_shader_program_err(ctx, programObj,
-                                                           "glLinkProgram"));
+   link_program(ctx, _mesa_lookup_shader_program_err(ctx, programObj,
+                                                     "glLinkProgram"), true);
 }
 
 #if defined(HAVE_SHA1)
@@ -1797,6 +2054,17 @@ _mesa_ShaderSource(GLuint shaderObj, GLsizei count,
    }
 #endif /* HAVE_SHA1 */
 
+   /* A background compile or link may still read the old source. */
+   wait_shader_idle(ctx, sh);
+
+   /* A compile deferred by a shader cache hit has to see the source that
+    * glCompileShader() was given, not the one replacing it.
+    */
+   if (sh->CompileSkipped) {
+      _mesa_glsl_compile_shader(ctx, sh, false, false);
+      sh->CompileSkipped = false;
+   }
+
    shader_source(sh, source);
 
    free(offsets);
@@ -63,6 +63,17 @@ _mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
 extern void
 _mesa_link_program(struct gl_context *ctx, struct gl_shader_program *sh_prog);
 
+extern void
+_mesa_wait_shader_compile(struct gl_context *ctx, struct gl_shader *sh);
+
+extern void
+_mesa_finish_link_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg);
+
+extern void
+_mesa_cancel_link_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg);
+
 extern unsigned
 _mesa_count_active_attribs(struct gl_shader_program *shProg);
 
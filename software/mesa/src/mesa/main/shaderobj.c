@@ -136,6 +136,8 @@ _mesa_new_linked_shader(gl_shader_stage stage)
 void
 _mesa_delete_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
+   if (sh->CompileJob)
+      ctx->Driver.DestroyShaderJob(sh->CompileJob);
    free((void *)sh->Source);
    free(sh->Label);
    ralloc_free(sh);
@@ -403,6 +405,7 @@ void
 _mesa_delete_shader_program(struct gl_context *ctx,
                             struct gl_shader_program *shProg)
 {
+   _mesa_cancel_link_program(ctx, shProg);
    _mesa_free_shader_program_data(ctx, shProg);
 
    ralloc_free(shProg);
@@ -410,7 +413,8 @@ _mesa_delete_shader_program(struct gl_context *ctx,
 
 
 /**
- * Lookup a GLSL program object.
+ * Lookup a GLSL program object.  A link started by glLinkProgram() in the
+ * background is finished first, so callers see the linked program.
  */
 struct gl_shader_program *
 _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
@@ -426,6 +430,8 @@ _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
       if (shProg && shProg->Type != GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (shProg)
+         _mesa_finish_link_program(ctx, shProg);
       return shProg;
    }
    return NULL;
@@ -454,6 +460,7 @@ _mesa_lookup_shader_program_err(struct gl_context *ctx, GLuint name,
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      _mesa_finish_link_program(ctx, shProg);
       return shProg;
    }
 }
@@ -52,6 +52,7 @@
 #include "program/prog_print.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
+#include "program/shader_cache.h"
 
 
 static int swizzle_for_size(int size);
@@ -3045,10 +3046,20 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 }
 
 /**
- * Link a GLSL shader program.  Called via glLinkProgram().
+ * Serializes the GLSL linker.  It writes to the IR of the attached shaders,
+ * which are commonly shared between programs that may be linked on
+ * different threads.
  */
-void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+static mtx_t link_mutex = _MTX_INITIALIZER_NP;
+
+/**
+ * First step of linking a GLSL program: reset it and try to restore it
+ * from the shader cache.  Returns true if that succeeded, in which case
+ * linking is complete.
+ */
+GLboolean
+_mesa_glsl_link_shader_start(struct gl_context *ctx,
+                             struct gl_shader_program *prog)
 {
    unsigned int i;
 
@@ -3056,22 +3067,78 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 
    prog->LinkStatus = GL_TRUE;
 
+   /* Shaders still being compiled missed the cache, and so does the
+    * program.  Failed shaders are reported by _mesa_glsl_link_shader_ir().
+    */
+   for (i = 0; i < prog->NumShaders; i++) {
+      if (prog->Shaders[i]->CompileJob || !prog->Shaders[i]->CompileStatus)
+         return GL_FALSE;
+   }
+
+   return shader_cache_read_program_metadata(ctx, prog);
+}
+
+/**
+ * Second step: run the GLSL linker.  This only reads context state that
+ * is fixed at context creation, so it may run on a worker thread.
+ */
+void
+_mesa_glsl_link_shader_ir(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
+{
+   unsigned int i;
+
+   mtx_lock(&link_mutex);
+
+   for (i = 0; i < prog->NumShaders; i++) {
+      if (prog->Shaders[i]->CompileJob)
+         ctx->Driver.WaitShaderJob(prog->Shaders[i]->CompileJob);
+   }
+
    for (i = 0; i < prog->NumShaders; i++) {
       if (!prog->Shaders[i]->CompileStatus) {
 	 linker_error(prog, "linking with uncompiled shader");
       }
    }
 
+   /* Shaders whose compilation was deferred because of a cache hit at
+    * compile time are needed after all.
+    */
+   for (i = 0; i < prog->NumShaders && prog->LinkStatus; i++) {
+      struct gl_shader *sh = prog->Shaders[i];
+
+      if (sh->CompileSkipped) {
+         _mesa_glsl_compile_shader(ctx, sh, false, false);
+         sh->CompileSkipped = false;
+         if (!sh->CompileStatus)
+            linker_error(prog, "linking with uncompiled shader");
+      }
+   }
+
    if (prog->LinkStatus) {
       link_shaders(ctx, prog);
    }
 
+   mtx_unlock(&link_mutex);
+}
+
+/**
+ * Last step: translate the linked shaders for the driver.  Must run on
+ * the context's thread.
+ */
+void
+_mesa_glsl_link_shader_finish(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
    if (prog->LinkStatus) {
       if (!ctx->Driver.LinkShader(ctx, prog)) {
 	 prog->LinkStatus = GL_FALSE;
       }
    }
 
+   if (prog->LinkStatus)
+      shader_cache_write_program_metadata(ctx, prog);
+
    if (ctx->_Shader->Flags & GLSL_DUMP) {
       if (!prog->LinkStatus) {
 	 fprintf(stderr, "GLSL shader program %d failed to link\n", prog->Name);
@@ -3084,4 +3151,17 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 }
 
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   if (_mesa_glsl_link_shader_start(ctx, prog))
+      return;
+
+   _mesa_glsl_link_shader_ir(ctx, prog);
+   _mesa_glsl_link_shader_finish(ctx, prog);
+}
+
 } /* extern "C" */
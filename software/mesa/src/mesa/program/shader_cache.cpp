@@ -0,0 +1,926 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file shader_cache.cpp
+ * Serialization of linked GLSL programs for the on-disk shader cache.
+ *
+ * glCompileShader() computes a key for each shader from its source and
+ * the context's compile state.  If the cache has seen the key before,
+ * compilation is skipped and the shader is marked CompileSkipped.  At
+ * glLinkProgram() time a program key is derived from the shader keys and
+ * the pre-link bindings; on a hit the complete post-link state (uniforms,
+ * resource list, linked shaders and their gl_programs plus whatever the
+ * driver stores through ShaderCacheSerializeDriverBlob) is restored
+ * without running the compiler, the linker or ctx->Driver.LinkShader().
+ * On a miss, skipped shaders are compiled before linking as usual.
+ *
+ * Only the common subset of programs is cached: non-separable vertex and
+ * fragment programs without uniform or storage blocks, atomic counters,
+ * images, subroutines, transform feedback or explicit uniform location
+ * holes.  Anything else is silently compiled and linked every time.
+ */
+
+#include "main/core.h"
+#include "main/shaderobj.h"
+#include "main/uniforms.h"
+#include "compiler/glsl/blob.h"
+#include "compiler/glsl/ir_uniform.h"
+#include "compiler/glsl_types.h"
+#include "program/hash_table.h"
+#include "program/ir_to_mesa.h"
+#include "program/prog_parameter.h"
+#include "program/program.h"
+#include "program/shader_cache.h"
+#include "util/disk_cache.h"
+
+/* Bump when the layout of the serialized data changes. */
+#define SHADER_CACHE_FORMAT_VERSION 1
+
+/* UniformRemapTable entries that are not uniform indices */
+#define REMAP_NULL     -1
+#define REMAP_INACTIVE -2
+
+
+static bool
+cache_enabled(struct gl_context *ctx)
+{
+   return ctx->Cache &&
+          ctx->Driver.ShaderCacheSerializeDriverBlob &&
+          ctx->Driver.ShaderCacheDeserializeDriverBlob &&
+          ctx->_Shader->Flags == 0;
+}
+
+
+static bool
+stage_is_cacheable(gl_shader_stage stage)
+{
+   return stage == MESA_SHADER_VERTEX || stage == MESA_SHADER_FRAGMENT;
+}
+
+
+static bool
+sha1_is_zero(const unsigned char *sha1)
+{
+   for (unsigned i = 0; i < 20; i++) {
+      if (sha1[i])
+         return false;
+   }
+   return true;
+}
+
+
+/**
+ * Everything outside the source text that influences the compiler.
+ */
+static void
+write_context_state(struct blob *blob, struct gl_context *ctx)
+{
+   struct gl_constants consts;
+
+   /* Pointers differ from run to run, hash what they point to instead. */
+   memcpy(&consts, &ctx->Const, sizeof(consts));
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      consts.ShaderCompilerOptions[i].NirOptions = NULL;
+
+   blob_write_uint32(blob, SHADER_CACHE_FORMAT_VERSION);
+   blob_write_uint32(blob, ctx->API);
+   blob_write_uint32(blob, ctx->Version);
+   blob_write_bytes(blob, &ctx->Extensions,
+                    offsetof(struct gl_extensions, String));
+   blob_write_bytes(blob, &consts, sizeof(consts));
+}
+
+
+struct string_map_entry {
+   const char *name;
+   unsigned value;
+};
+
+struct string_map_closure {
+   struct string_map_entry *entries;
+   unsigned count;
+   unsigned size;
+};
+
+static void
+collect_string_map_entry(const char *name, unsigned value, void *closure)
+{
+   struct string_map_closure *c = (struct string_map_closure *) closure;
+
+   if (c->count == c->size) {
+      c->size = c->size ? c->size * 2 : 16;
+      c->entries = reralloc(NULL, c->entries, struct string_map_entry,
+                            c->size);
+   }
+   c->entries[c->count].name = name;
+   c->entries[c->count].value = value;
+   c->count++;
+}
+
+static int
+compare_string_map_entry(const void *a, const void *b)
+{
+   return strcmp(((const struct string_map_entry *) a)->name,
+                 ((const struct string_map_entry *) b)->name);
+}
+
+/**
+ * Write the entries of \p map, sorted by name so that the output does not
+ * depend on hash table order.
+ */
+static void
+write_string_map(struct blob *blob, struct string_to_uint_map *map)
+{
+   struct string_map_closure c = { NULL, 0, 0 };
+
+   if (map)
+      map->iterate(collect_string_map_entry, &c);
+
+   if (c.count)
+      qsort(c.entries, c.count, sizeof(c.entries[0]),
+            compare_string_map_entry);
+
+   blob_write_uint32(blob, c.count);
+   for (unsigned i = 0; i < c.count; i++) {
+      blob_write_string(blob, c.entries[i].name);
+      blob_write_uint32(blob, c.entries[i].value);
+   }
+
+   ralloc_free(c.entries);
+}
+
+
+static void
+compute_program_key(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   struct blob *blob = blob_create(NULL);
+
+   for (unsigned i = 0; i < prog->NumShaders; i++)
+      blob_write_bytes(blob, prog->Shaders[i]->sha1,
+                       sizeof(prog->Shaders[i]->sha1));
+
+   write_string_map(blob, prog->AttributeBindings);
+   write_string_map(blob, prog->FragDataBindings);
+   write_string_map(blob, prog->FragDataIndexBindings);
+
+   blob_write_uint32(blob, prog->SeparateShader);
+   blob_write_uint32(blob, prog->TransformFeedback.NumVarying);
+
+   disk_cache_compute_key(ctx->Cache, blob->data, blob->size, prog->sha1);
+   ralloc_free(blob);
+}
+
+
+/**
+ * Pre-link checks: can a program with these shaders and settings come
+ * from the cache at all?
+ */
+static bool
+program_inputs_cacheable(struct gl_shader_program *prog)
+{
+   if (prog->NumShaders == 0 || prog->SeparateShader ||
+       prog->TransformFeedback.NumVarying != 0)
+      return false;
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      struct gl_shader *sh = prog->Shaders[i];
+
+      if (!stage_is_cacheable(sh->Stage) || sha1_is_zero(sh->sha1))
+         return false;
+   }
+
+   return true;
+}
+
+
+/**
+ * Post-link checks: does the linked program only use state that the
+ * serialization below knows about?
+ */
+static bool
+program_outputs_cacheable(struct gl_shader_program *prog)
+{
+   if (prog->NumUniformBlocks || prog->NumShaderStorageBlocks ||
+       prog->NumAtomicBuffers ||
+       !exec_list_is_empty(&prog->EmptyUniformLocations))
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_linked_shader *sh = prog->_LinkedShaders[i];
+
+      if (!sh)
+         continue;
+
+      if (!stage_is_cacheable((gl_shader_stage) i) || !sh->Program ||
+          sh->Program->nir || sh->NumImages || sh->NumAtomicBuffers ||
+          sh->NumSubroutineUniforms || sh->NumSubroutineFunctions ||
+          sh->NumSubroutineUniformRemapTable)
+         return false;
+   }
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      if (uni->block_index != -1 || uni->is_shader_storage ||
+          uni->num_compatible_subroutines)
+         return false;
+   }
+
+   return true;
+}
+
+
+static bool
+write_type(struct blob *blob, const glsl_type *type)
+{
+   blob_write_uint32(blob, type->base_type);
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL:
+      blob_write_uint32(blob, type->vector_elements);
+      blob_write_uint32(blob, type->matrix_columns);
+      return true;
+   case GLSL_TYPE_SAMPLER:
+      blob_write_uint32(blob, type->sampler_dimensionality);
+      blob_write_uint32(blob, type->sampler_shadow);
+      blob_write_uint32(blob, type->sampler_array);
+      blob_write_uint32(blob, type->sampled_type);
+      return true;
+   case GLSL_TYPE_ARRAY:
+      blob_write_uint32(blob, type->length);
+      return write_type(blob, type->fields.array);
+   default:
+      return false;
+   }
+}
+
+static const glsl_type *
+read_type(struct blob_reader *blob)
+{
+   const unsigned base_type = blob_read_uint32(blob);
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_DOUBLE:
+   case GLSL_TYPE_BOOL: {
+      const unsigned rows = blob_read_uint32(blob);
+      const unsigned columns = blob_read_uint32(blob);
+      const glsl_type *type = glsl_type::get_instance(base_type, rows, columns);
+      return type->is_error() ? NULL : type;
+   }
+   case GLSL_TYPE_SAMPLER: {
+      const unsigned dim = blob_read_uint32(blob);
+      const unsigned shadow = blob_read_uint32(blob);
+      const unsigned array = blob_read_uint32(blob);
+      const unsigned sampled_type = blob_read_uint32(blob);
+      const glsl_type *type =
+         glsl_type::get_sampler_instance((enum glsl_sampler_dim) dim,
+                                         shadow, array,
+                                         (glsl_base_type) sampled_type);
+      return type->is_error() ? NULL : type;
+   }
+   case GLSL_TYPE_ARRAY: {
+      const unsigned length = blob_read_uint32(blob);
+      const glsl_type *element = read_type(blob);
+      return element ? glsl_type::get_array_instance(element, length) : NULL;
+   }
+   default:
+      return NULL;
+   }
+}
+
+
+static unsigned
+uniform_storage_slots(const struct gl_uniform_storage *uni)
+{
+   const unsigned per_element =
+      uni->type->is_sampler() ? 1 : uni->type->component_slots();
+
+   return per_element * MAX2(1, uni->array_elements);
+}
+
+static bool
+write_uniforms(struct blob *blob, struct gl_shader_program *prog)
+{
+   union gl_constant_value *data = NULL;
+   unsigned num_slots = 0;
+
+   /* All uniform values live in one array owned by UniformStorage; the
+    * lowest storage pointer is its start.
+    */
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      union gl_constant_value *storage = prog->UniformStorage[i].storage;
+
+      if (storage && (!data || storage < data))
+         data = storage;
+   }
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      if (uni->storage)
+         num_slots = MAX2(num_slots, (unsigned) (uni->storage - data) +
+                                     uniform_storage_slots(uni));
+   }
+
+   blob_write_uint32(blob, prog->NumUniformStorage);
+   blob_write_uint32(blob, prog->NumHiddenUniforms);
+   blob_write_uint32(blob, num_slots);
+   blob_write_bytes(blob, data, num_slots * sizeof(data[0]));
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+
+      blob_write_string(blob, uni->name);
+      if (!write_type(blob, uni->type))
+         return false;
+      blob_write_uint32(blob, uni->array_elements);
+      blob_write_bytes(blob, uni->opaque, sizeof(uni->opaque));
+      blob_write_uint32(blob, uni->storage ? uni->storage - data : ~0u);
+      blob_write_uint32(blob, uni->block_index);
+      blob_write_uint32(blob, uni->offset);
+      blob_write_uint32(blob, uni->matrix_stride);
+      blob_write_uint32(blob, uni->array_stride);
+      blob_write_uint32(blob, uni->row_major);
+      blob_write_uint32(blob, uni->hidden);
+      blob_write_uint32(blob, uni->builtin);
+      blob_write_uint32(blob, uni->is_shader_storage);
+      blob_write_uint32(blob, uni->atomic_buffer_index);
+      blob_write_uint32(blob, uni->remap_location);
+      blob_write_uint32(blob, uni->num_compatible_subroutines);
+      blob_write_uint32(blob, uni->top_level_array_size);
+      blob_write_uint32(blob, uni->top_level_array_stride);
+   }
+
+   blob_write_uint32(blob, prog->NumUniformRemapTable);
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
+      struct gl_uniform_storage *uni = prog->UniformRemapTable[i];
+
+      if (uni == NULL)
+         blob_write_uint32(blob, REMAP_NULL);
+      else if (uni == INACTIVE_UNIFORM_EXPLICIT_LOCATION)
+         blob_write_uint32(blob, REMAP_INACTIVE);
+      else
+         blob_write_uint32(blob, uni - prog->UniformStorage);
+   }
+
+   write_string_map(blob, prog->UniformHash);
+
+   return true;
+}
+
+static bool
+read_uniforms(struct blob_reader *blob, struct gl_shader_program *prog)
+{
+   union gl_constant_value *data;
+   unsigned num_slots;
+
+   prog->NumUniformStorage = blob_read_uint32(blob);
+   prog->NumHiddenUniforms = blob_read_uint32(blob);
+   num_slots = blob_read_uint32(blob);
+   if (blob->overrun)
+      return false;
+
+   prog->UniformStorage = rzalloc_array(prog, struct gl_uniform_storage,
+                                        prog->NumUniformStorage);
+   data = rzalloc_array(prog->UniformStorage, union gl_constant_value,
+                        num_slots);
+   blob_copy_bytes(blob, (uint8_t *) data, num_slots * sizeof(data[0]));
+
+   for (unsigned i = 0; i < prog->NumUniformStorage; i++) {
+      struct gl_uniform_storage *uni = &prog->UniformStorage[i];
+      const char *name = blob_read_string(blob);
+      unsigned storage;
+
+      uni->type = read_type(blob);
+      if (!name || !uni->type)
+         return false;
+
+      uni->name = ralloc_strdup(prog->UniformStorage, name);
+      uni->array_elements = blob_read_uint32(blob);
+      blob_copy_bytes(blob, (uint8_t *) uni->opaque, sizeof(uni->opaque));
+
+      storage = blob_read_uint32(blob);
+      if (storage != ~0u) {
+         if (storage + uniform_storage_slots(uni) > num_slots)
+            return false;
+         uni->storage = data + storage;
+      }
+
+      uni->block_index = blob_read_uint32(blob);
+      uni->offset = blob_read_uint32(blob);
+      uni->matrix_stride = blob_read_uint32(blob);
+      uni->array_stride = blob_read_uint32(blob);
+      uni->row_major = blob_read_uint32(blob);
+      uni->hidden = blob_read_uint32(blob);
+      uni->builtin = blob_read_uint32(blob);
+      uni->is_shader_storage = blob_read_uint32(blob);
+      uni->atomic_buffer_index = blob_read_uint32(blob);
+      uni->remap_location = blob_read_uint32(blob);
+      uni->num_compatible_subroutines = blob_read_uint32(blob);
+      uni->top_level_array_size = blob_read_uint32(blob);
+      uni->top_level_array_stride = blob_read_uint32(blob);
+   }
+
+   prog->NumUniformRemapTable = blob_read_uint32(blob);
+   if (blob->overrun)
+      return false;
+
+   prog->UniformRemapTable = rzalloc_array(prog, struct gl_uniform_storage *,
+                                           prog->NumUniformRemapTable);
+   for (unsigned i = 0; i < prog->NumUniformRemapTable; i++) {
+      const int index = (int) blob_read_uint32(blob);
+
+      if (index == REMAP_NULL)
+         prog->UniformRemapTable[i] = NULL;
+      else if (index == REMAP_INACTIVE)
+         prog->UniformRemapTable[i] = INACTIVE_UNIFORM_EXPLICIT_LOCATION;
+      else if (index >= 0 && (unsigned) index < prog->NumUniformStorage)
+         prog->UniformRemapTable[i] = &prog->UniformStorage[index];
+      else
+         return false;
+   }
+
+   const unsigned num_hash_entries = blob_read_uint32(blob);
+   prog->UniformHash = new string_to_uint_map;
+   for (unsigned i = 0; i < num_hash_entries && !blob->overrun; i++) {
+      const char *name = blob_read_string(blob);
+      const unsigned value = blob_read_uint32(blob);
+
+      if (!name)
+         return false;
+      prog->UniformHash->put(value, name);
+   }
+
+   return !blob->overrun;
+}
+
+
+static bool
+write_resource_list(struct blob *blob, struct gl_shader_program *prog)
+{
+   blob_write_uint32(blob, prog->NumProgramResourceList);
+
+   for (unsigned i = 0; i < prog->NumProgramResourceList; i++) {
+      const struct gl_program_resource *res = &prog->ProgramResourceList[i];
+
+      blob_write_uint32(blob, res->Type);
+      blob_write_uint32(blob, res->StageReferences);
+
+      switch (res->Type) {
+      case GL_UNIFORM:
+         blob_write_uint32(blob, (const struct gl_uniform_storage *) res->Data -
+                                 prog->UniformStorage);
+         break;
+      case GL_PROGRAM_INPUT:
+      case GL_PROGRAM_OUTPUT: {
+         const struct gl_shader_variable *var =
+            (const struct gl_shader_variable *) res->Data;
+
+         if (var->interface_type || var->outermost_struct_type)
+            return false;
+
+         blob_write_string(blob, var->name);
+         if (!write_type(blob, var->type))
+            return false;
+         blob_write_uint32(blob, var->location);
+         blob_write_uint32(blob, var->component);
+         blob_write_uint32(blob, var->index);
+         blob_write_uint32(blob, var->patch);
+         blob_write_uint32(blob, var->mode);
+         blob_write_uint32(blob, var->interpolation);
+         blob_write_uint32(blob, var->explicit_location);
+         blob_write_uint32(blob, var->precision);
+         break;
+      }
+      default:
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool
+read_resource_list(struct blob_reader *blob, struct gl_shader_program *prog)
+{
+   prog->NumProgramResourceList = blob_read_uint32(blob);
+   if (blob->overrun)
+      return false;
+
+   prog->ProgramResourceList =
+      rzalloc_array(prog, struct gl_program_resource,
+                    prog->NumProgramResourceList);
+
+   for (unsigned i = 0; i < prog->NumProgramResourceList; i++) {
+      struct gl_program_resource *res = &prog->ProgramResourceList[i];
+
+      res->Type = blob_read_uint32(blob);
+      res->StageReferences = blob_read_uint32(blob);
+
+      switch (res->Type) {
+      case GL_UNIFORM: {
+         const unsigned index = blob_read_uint32(blob);
+
+         if (index >= prog->NumUniformStorage)
+            return false;
+         res->Data = &prog->UniformStorage[index];
+         break;
+      }
+      case GL_PROGRAM_INPUT:
+      case GL_PROGRAM_OUTPUT: {
+         struct gl_shader_variable *var = rzalloc(prog, gl_shader_variable);
+         const char *name = blob_read_string(blob);
+
+         var->type = read_type(blob);
+         if (!name || !var->type)
+            return false;
+
+         var->name = ralloc_strdup(prog, name);
+         var->location = blob_read_uint32(blob);
+         var->component = blob_read_uint32(blob);
+         var->index = blob_read_uint32(blob);
+         var->patch = blob_read_uint32(blob);
+         var->mode = blob_read_uint32(blob);
+         var->interpolation = blob_read_uint32(blob);
+         var->explicit_location = blob_read_uint32(blob);
+         var->precision = blob_read_uint32(blob);
+         res->Data = var;
+         break;
+      }
+      default:
+         return false;
+      }
+   }
+
+   return !blob->overrun;
+}
+
+
+/**
+ * The plain-data parts of a gl_program and its stage subclass.  Pointers,
+ * the reference count and the mutex are left alone.
+ */
+static void
+get_program_regions(gl_shader_stage stage, size_t offsets[3], size_t sizes[3])
+{
+   offsets[0] = offsetof(struct gl_program, InputsRead);
+   sizes[0] = offsetof(struct gl_program, Parameters) - offsets[0];
+   offsets[1] = offsetof(struct gl_program, SamplerUnits);
+   sizes[1] = sizeof(struct gl_program) - offsets[1];
+
+   if (stage == MESA_SHADER_VERTEX) {
+      offsets[2] = offsetof(struct gl_vertex_program, IsPositionInvariant);
+      sizes[2] = sizeof(struct gl_vertex_program) - offsets[2];
+   } else {
+      offsets[2] = offsetof(struct gl_fragment_program, UsesKill);
+      sizes[2] = sizeof(struct gl_fragment_program) - offsets[2];
+   }
+}
+
+static void
+write_parameters(struct blob *blob, struct gl_program_parameter_list *params)
+{
+   blob_write_uint32(blob, params->NumParameters);
+
+   for (unsigned i = 0; i < params->NumParameters; i++) {
+      const struct gl_program_parameter *p = &params->Parameters[i];
+
+      blob_write_uint32(blob, p->Name != NULL);
+      if (p->Name)
+         blob_write_string(blob, p->Name);
+      blob_write_uint32(blob, p->Type);
+      blob_write_uint32(blob, p->DataType);
+      blob_write_uint32(blob, p->Size);
+      blob_write_uint32(blob, p->Initialized);
+      blob_write_bytes(blob, p->StateIndexes, sizeof(p->StateIndexes));
+   }
+
+   blob_write_bytes(blob, params->ParameterValues,
+                    params->NumParameters * sizeof(params->ParameterValues[0]));
+   blob_write_uint32(blob, params->StateFlags);
+}
+
+static struct gl_program_parameter_list *
+read_parameters(struct blob_reader *blob)
+{
+   const unsigned num = blob_read_uint32(blob);
+   struct gl_program_parameter_list *params;
+
+   if (blob->overrun || num > blob->end - blob->current)
+      return NULL;
+
+   params = _mesa_new_parameter_list_sized(num);
+   if (!params)
+      return NULL;
+
+   for (unsigned i = 0; i < num; i++) {
+      struct gl_program_parameter *p = &params->Parameters[i];
+
+      if (blob_read_uint32(blob)) {
+         const char *name = blob_read_string(blob);
+         p->Name = name ? strdup(name) : NULL;
+      }
+      params->NumParameters = i + 1;
+
+      p->Type = (gl_register_file) blob_read_uint32(blob);
+      p->DataType = blob_read_uint32(blob);
+      p->Size = blob_read_uint32(blob);
+      p->Initialized = blob_read_uint32(blob);
+      blob_copy_bytes(blob, (uint8_t *) p->StateIndexes,
+                      sizeof(p->StateIndexes));
+   }
+
+   if (num)
+      blob_copy_bytes(blob, (uint8_t *) params->ParameterValues,
+                      num * sizeof(params->ParameterValues[0]));
+   params->StateFlags = blob_read_uint32(blob);
+
+   /* Same headroom as after linking, see get_mesa_program(). */
+   _mesa_reserve_parameter_storage(params, 8);
+
+   return params;
+}
+
+
+static void
+write_linked_shader(struct gl_context *ctx, struct blob *blob,
+                    struct gl_linked_shader *sh)
+{
+   struct gl_program *glprog = sh->Program;
+   size_t offsets[3], sizes[3];
+
+   blob_write_uint32(blob, sh->num_samplers);
+   blob_write_uint32(blob, sh->active_samplers);
+   blob_write_uint32(blob, sh->shadow_samplers);
+   blob_write_bytes(blob, sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   blob_write_bytes(blob, sh->SamplerTargets, sizeof(sh->SamplerTargets));
+   blob_write_uint32(blob, sh->num_uniform_components);
+   blob_write_uint32(blob, sh->num_combined_uniform_components);
+   blob_write_bytes(blob, &sh->info, sizeof(sh->info));
+
+   get_program_regions(sh->Stage, offsets, sizes);
+   for (unsigned i = 0; i < 3; i++)
+      blob_write_bytes(blob, (const uint8_t *) glprog + offsets[i], sizes[i]);
+
+   write_parameters(blob, glprog->Parameters);
+
+   ctx->Driver.ShaderCacheSerializeDriverBlob(ctx, glprog, blob);
+}
+
+static bool
+read_linked_shader(struct gl_context *ctx, struct blob_reader *blob,
+                   struct gl_shader_program *prog, gl_shader_stage stage)
+{
+   struct gl_linked_shader *sh = _mesa_new_linked_shader(stage);
+   struct gl_program *glprog;
+   size_t offsets[3], sizes[3];
+
+   prog->_LinkedShaders[stage] = sh;
+
+   sh->num_samplers = blob_read_uint32(blob);
+   sh->active_samplers = blob_read_uint32(blob);
+   sh->shadow_samplers = blob_read_uint32(blob);
+   blob_copy_bytes(blob, sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   blob_copy_bytes(blob, (uint8_t *) sh->SamplerTargets,
+                   sizeof(sh->SamplerTargets));
+   sh->num_uniform_components = blob_read_uint32(blob);
+   sh->num_combined_uniform_components = blob_read_uint32(blob);
+   blob_copy_bytes(blob, (uint8_t *) &sh->info, sizeof(sh->info));
+
+   glprog = ctx->Driver.NewProgram(ctx, _mesa_shader_stage_to_program(stage),
+                                   prog->Name);
+   if (!glprog)
+      return false;
+
+   /* The linked shader holds the only reference from here on. */
+   _mesa_reference_program(ctx, &sh->Program, glprog);
+   _mesa_reference_program(ctx, &glprog, NULL);
+   glprog = sh->Program;
+
+   get_program_regions(stage, offsets, sizes);
+   for (unsigned i = 0; i < 3; i++)
+      blob_copy_bytes(blob, (uint8_t *) glprog + offsets[i], sizes[i]);
+
+   if (glprog->Parameters)
+      _mesa_free_parameter_list(glprog->Parameters);
+   glprog->Parameters = read_parameters(blob);
+   if (!glprog->Parameters || blob->overrun)
+      return false;
+
+   ctx->Driver.ShaderCacheDeserializeDriverBlob(ctx, prog, glprog, blob);
+   if (blob->overrun)
+      return false;
+
+   /* What get_mesa_program() does last, in the same order. */
+   _mesa_update_shader_textures_used(prog, glprog);
+   _mesa_associate_uniform_storage(ctx, prog, glprog->Parameters);
+
+   return prog->LinkStatus;
+}
+
+
+static bool
+write_program(struct gl_context *ctx, struct blob *blob,
+              struct gl_shader_program *prog)
+{
+   unsigned stages = 0;
+
+   blob_write_string(blob, prog->InfoLog);
+   blob_write_uint32(blob, prog->Version);
+   blob_write_uint32(blob, prog->IsES);
+   blob_write_uint32(blob, prog->ARB_fragment_coord_conventions_enable);
+   blob_write_uint32(blob, prog->FragDepthLayout);
+   blob_write_uint32(blob, prog->Vert.ClipDistanceArraySize);
+   blob_write_uint32(blob, prog->Vert.CullDistanceArraySize);
+   blob_write_uint32(blob, prog->LastClipDistanceArraySize);
+   blob_write_uint32(blob, prog->LastCullDistanceArraySize);
+
+   if (!write_uniforms(blob, prog) || !write_resource_list(blob, prog))
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i])
+         stages |= 1 << i;
+   }
+   blob_write_uint32(blob, stages);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i])
+         write_linked_shader(ctx, blob, prog->_LinkedShaders[i]);
+   }
+
+   return true;
+}
+
+static bool
+read_program(struct gl_context *ctx, struct blob_reader *blob,
+             struct gl_shader_program *prog)
+{
+   const char *info_log = blob_read_string(blob);
+   unsigned stages;
+
+   if (!info_log)
+      return false;
+
+   ralloc_free(prog->InfoLog);
+   prog->InfoLog = ralloc_strdup(prog, info_log);
+   prog->Version = blob_read_uint32(blob);
+   prog->IsES = blob_read_uint32(blob);
+   prog->ARB_fragment_coord_conventions_enable = blob_read_uint32(blob);
+   prog->FragDepthLayout = (enum gl_frag_depth_layout) blob_read_uint32(blob);
+   prog->Vert.ClipDistanceArraySize = blob_read_uint32(blob);
+   prog->Vert.CullDistanceArraySize = blob_read_uint32(blob);
+   prog->LastClipDistanceArraySize = blob_read_uint32(blob);
+   prog->LastCullDistanceArraySize = blob_read_uint32(blob);
+
+   if (!read_uniforms(blob, prog) || !read_resource_list(blob, prog))
+      return false;
+
+   stages = blob_read_uint32(blob);
+   if (blob->overrun || stages == 0)
+      return false;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!(stages & (1 << i)))
+         continue;
+
+      if (!stage_is_cacheable((gl_shader_stage) i) ||
+          !read_linked_shader(ctx, blob, prog, (gl_shader_stage) i))
+         return false;
+   }
+
+   return true;
+}
+
+
+extern "C" bool
+shader_cache_lookup_shader(struct gl_context *ctx, struct gl_shader *shader)
+{
+   struct blob *blob;
+
+   memset(shader->sha1, 0, sizeof(shader->sha1));
+
+   if (!cache_enabled(ctx) || !shader->Source ||
+       !stage_is_cacheable(shader->Stage))
+      return false;
+
+   blob = blob_create(NULL);
+   write_context_state(blob, ctx);
+   blob_write_uint32(blob, shader->Stage);
+   blob_write_string(blob, shader->Source);
+   disk_cache_compute_key(ctx->Cache, blob->data, blob->size, shader->sha1);
+   ralloc_free(blob);
+
+   return disk_cache_has_key(ctx->Cache, shader->sha1);
+}
+
+
+extern "C" bool
+shader_cache_read_program_metadata(struct gl_context *ctx,
+                                   struct gl_shader_program *prog)
+{
+   struct blob_reader metadata;
+   uint8_t *buffer;
+   size_t size;
+   bool ok;
+
+   if (!cache_enabled(ctx) || !program_inputs_cacheable(prog))
+      return false;
+
+   compute_program_key(ctx, prog);
+
+   buffer = (uint8_t *) disk_cache_get(ctx->Cache, prog->sha1, &size);
+   if (!buffer)
+      return false;
+
+   /* Same starting point as link_shaders(). */
+   prog->Validated = false;
+   prog->_Used = false;
+
+   ralloc_free(prog->LinkedTransformFeedback.Varyings);
+   ralloc_free(prog->LinkedTransformFeedback.Outputs);
+   memset(&prog->LinkedTransformFeedback, 0,
+          sizeof(prog->LinkedTransformFeedback));
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i]) {
+         _mesa_delete_linked_shader(ctx, prog->_LinkedShaders[i]);
+         prog->_LinkedShaders[i] = NULL;
+      }
+   }
+
+   blob_reader_init(&metadata, buffer, size);
+   ok = read_program(ctx, &metadata, prog) &&
+        !metadata.overrun && metadata.current == metadata.end;
+   free(buffer);
+
+   if (!ok) {
+      /* Drop whatever was restored; the caller links from scratch. */
+      _mesa_clear_shader_program_data(prog);
+      for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+         if (prog->_LinkedShaders[i]) {
+            _mesa_delete_linked_shader(ctx, prog->_LinkedShaders[i]);
+            prog->_LinkedShaders[i] = NULL;
+         }
+      }
+      prog->LinkStatus = GL_TRUE;
+   }
+
+   return ok;
+}
+
+
+extern "C" void
+shader_cache_write_program_metadata(struct gl_context *ctx,
+                                    struct gl_shader_program *prog)
+{
+   struct blob *blob;
+
+   if (!cache_enabled(ctx) || !program_inputs_cacheable(prog) ||
+       !program_outputs_cacheable(prog))
+      return;
+
+   compute_program_key(ctx, prog);
+
+   blob = blob_create(NULL);
+   if (write_program(ctx, blob, prog)) {
+      disk_cache_put(ctx->Cache, prog->sha1, blob->data, blob->size);
+
+      /* Let glCompileShader() skip these shaders from now on. */
+      for (unsigned i = 0; i < prog->NumShaders; i++)
+         disk_cache_put_key(ctx->Cache, prog->Shaders[i]->sha1);
+   }
+   ralloc_free(blob);
+}
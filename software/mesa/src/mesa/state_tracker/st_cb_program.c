@@ -39,6 +39,8 @@
 
 #include "cso_cache/cso_context.h"
 #include "draw/draw_context.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 
 #include "st_context.h"
 #include "st_debug.h"
@@ -290,6 +292,129 @@ st_new_ati_fs(struct gl_context *ctx, struct ati_fragment_shader *curProg)
    return prog;
 }
 
+/**
+ * A GLSL compile or link running on a shader job thread.
+ */
+struct gl_shader_job
+{
+   struct util_queue_fence fence;
+   struct st_context *st;
+   struct gl_context *ctx;
+   void (*execute)(struct gl_context *ctx, void *data);
+   void *data;
+};
+
+static void
+st_execute_shader_job(void *data, int thread_index)
+{
+   struct gl_shader_job *job = (struct gl_shader_job *) data;
+   struct st_context *st = job->st;
+
+   job->execute(job->ctx, job->data);
+
+   /* The job itself may be freed as soon as the fence is signalled, so
+    * account for it here.
+    */
+   pipe_mutex_lock(st->shader_jobs.lock);
+   if (--st->shader_jobs.num_jobs == 0)
+      pipe_condvar_broadcast(st->shader_jobs.idle);
+   pipe_mutex_unlock(st->shader_jobs.lock);
+}
+
+/**
+ * Called via ctx->Driver.QueueShaderJob()
+ */
+static struct gl_shader_job *
+st_queue_shader_job(struct gl_context *ctx,
+                    void (*execute)(struct gl_context *ctx, void *data),
+                    void *data)
+{
+   struct st_context *st = st_context(ctx);
+   struct gl_shader_job *job;
+
+   if (!util_queue_is_initialized(&st->shader_jobs.queue))
+      return NULL;
+
+   job = CALLOC_STRUCT(gl_shader_job);
+   if (!job)
+      return NULL;
+
+   util_queue_fence_init(&job->fence);
+   job->st = st;
+   job->ctx = ctx;
+   job->execute = execute;
+   job->data = data;
+
+   pipe_mutex_lock(st->shader_jobs.lock);
+   st->shader_jobs.num_jobs++;
+   pipe_mutex_unlock(st->shader_jobs.lock);
+
+   util_queue_add_job(&st->shader_jobs.queue, job, &job->fence,
+                      st_execute_shader_job, NULL);
+   return job;
+}
+
+/**
+ * Called via ctx->Driver.WaitShaderJob()
+ */
+static void
+st_wait_shader_job(struct gl_shader_job *job)
+{
+   util_queue_job_wait(&job->fence);
+}
+
+/**
+ * Called via ctx->Driver.DestroyShaderJob()
+ */
+static void
+st_destroy_shader_job(struct gl_shader_job *job)
+{
+   util_queue_job_wait(&job->fence);
+   util_queue_fence_destroy(&job->fence);
+   free(job);
+}
+
+
+/**
+ * Start the shader job threads.  MESA_GLSL_THREADS sets their number, zero
+ * compiles and links on the application's thread as before.
+ */
+void
+st_init_shader_jobs(struct st_context *st)
+{
+   unsigned num_threads;
+
+   pipe_mutex_init(st->shader_jobs.lock);
+   pipe_condvar_init(st->shader_jobs.idle);
+   st->shader_jobs.num_jobs = 0;
+
+   util_cpu_detect();
+   num_threads = debug_get_num_option("MESA_GLSL_THREADS",
+                                      MIN2(util_cpu_caps.nr_cpus, 8));
+   if (num_threads)
+      util_queue_init(&st->shader_jobs.queue, "glsl", 256, num_threads);
+}
+
+/**
+ * Wait for all jobs queued by this context, since they use it, and stop
+ * the threads.
+ */
+void
+st_destroy_shader_jobs(struct st_context *st)
+{
+   pipe_mutex_lock(st->shader_jobs.lock);
+   while (st->shader_jobs.num_jobs)
+      pipe_condvar_wait(st->shader_jobs.idle, st->shader_jobs.lock);
+   pipe_mutex_unlock(st->shader_jobs.lock);
+
+   if (util_queue_is_initialized(&st->shader_jobs.queue))
+      util_queue_destroy(&st->shader_jobs.queue);
+
+   pipe_condvar_destroy(st->shader_jobs.idle);
+   pipe_mutex_destroy(st->shader_jobs.lock);
+}
+
+
 /**
  * Plug in the program and shader-related device driver functions.
  */
@@ -302,4 +427,8 @@ st_init_program_functions(struct dd_function_table *functions)
    functions->NewATIfs = st_new_ati_fs;
    
    functions->LinkShader = st_link_shader;
+
+   functions->QueueShaderJob = st_queue_shader_job;
+   functions->WaitShaderJob = st_wait_shader_job;
+   functions->DestroyShaderJob = st_destroy_shader_job;
 }
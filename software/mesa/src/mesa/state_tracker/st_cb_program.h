@@ -30,9 +30,16 @@
 
 
 struct dd_function_table;
+struct st_context;
 
 extern void
 st_init_program_functions(struct dd_function_table *functions);
 
+extern void
+st_init_shader_jobs(struct st_context *st);
+
+extern void
+st_destroy_shader_jobs(struct st_context *st);
+
 
 #endif
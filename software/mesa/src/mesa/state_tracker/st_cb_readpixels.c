@@ -45,6 +45,7 @@
 #include "state_tracker/st_cb_texture.h"
 #include "state_tracker/st_format.h"
 #include "state_tracker/st_pbo.h"
+#include "state_tracker/st_pixel_copy.h"
 #include "state_tracker/st_texture.h"
 
 /* The readpixels cache caches a blitted staging texture so that back-to-back
@@ -376,13 +377,84 @@ try_cached_readpixels(struct st_context *st, struct st_renderbuffer *strb,
    return dst;
 }
 
+/**
+ * Convert straight from the mapped renderbuffer to the user buffer when
+ * there is a direct conversion for the format and type combo, instead of
+ * going through the generic conversions of _mesa_readpixels.
+ */
+static bool
+try_direct_readpixels(struct st_context *st, struct gl_renderbuffer *rb,
+                      GLint x, GLint y, GLsizei width, GLsizei height,
+                      GLenum format, GLenum type,
+                      const struct gl_pixelstore_attrib *pack,
+                      void *pixels)
+{
+   struct gl_context *ctx = st->ctx;
+   enum pipe_format src_format;
+   st_pixel_copy_func func;
+   GLubyte *map, *dst;
+   GLint stride, dst_stride;
+
+   if (!rb || pack->SwapBytes ||
+       format == GL_STENCIL_INDEX || format == GL_DEPTH_STENCIL)
+      return false;
+
+   if (_mesa_readpixels_needs_slow_path(ctx, format, type, GL_FALSE))
+      return false;
+
+   src_format = st_mesa_format_to_pipe_format(st, rb->Format);
+   src_format = util_format_linear(src_format);
+
+   /* An RGB renderbuffer stored with alpha reads back with alpha = 1. */
+   if (format != GL_DEPTH_COMPONENT &&
+       rb->_BaseFormat != _mesa_get_format_base_format(rb->Format)) {
+      if (rb->_BaseFormat != GL_RGB)
+         return false;
+
+      if (src_format == PIPE_FORMAT_B8G8R8A8_UNORM)
+         src_format = PIPE_FORMAT_B8G8R8X8_UNORM;
+      else if (src_format == PIPE_FORMAT_R8G8B8A8_UNORM)
+         src_format = PIPE_FORMAT_R8G8B8X8_UNORM;
+      else
+         return false;
+   }
+
+   func = st_get_pixel_pack_func(src_format, format, type);
+   if (!func)
+      return false;
+
+   pixels = _mesa_map_pbo_dest(ctx, pack, pixels);
+   if (!pixels)
+      return true;
+
+   ctx->Driver.MapRenderbuffer(ctx, rb, x, y, width, height, GL_MAP_READ_BIT,
+                               &map, &stride);
+   if (!map) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glReadPixels");
+      _mesa_unmap_pbo_dest(ctx, pack);
+      return true;
+   }
+
+   dst_stride = _mesa_image_row_stride(pack, width, format, type);
+   dst = _mesa_image_address2d(pack, pixels, width, height,
+                               format, type, 0, 0);
+
+   st_pixel_copy_rows(st, func, dst, dst_stride, map, stride, width, height);
+
+   ctx->Driver.UnmapRenderbuffer(ctx, rb);
+   _mesa_unmap_pbo_dest(ctx, pack);
+   return true;
+}
+
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
  * We can do arbitrary X/Y/Z/W/0/1 swizzling here as long as there is
  * a format which matches the swizzling.
  *
- * If such a format isn't available, we fall back to _mesa_readpixels.
+ * If such a format isn't available, we try a direct conversion on the CPU
+ * and finally fall back to _mesa_readpixels.
  *
  * NOTE: Some drivers use a blit to convert between tiled and linear
  *       texture layouts during texture uploads/downloads, so the blit
@@ -544,6 +616,10 @@ st_ReadPixels(struct gl_context *ctx, GLint x, GLint y,
    return;
 
 fallback:
+   if (try_direct_readpixels(st, rb, x, y, width, height, format, type,
+                             pack, pixels))
+      return;
+
    _mesa_readpixels(ctx, x, y, width, height, format, type, pack, pixels);
 }
 
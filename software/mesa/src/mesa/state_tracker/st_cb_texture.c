@@ -55,6 +55,7 @@
 #include "state_tracker/st_cb_bufferobjects.h"
 #include "state_tracker/st_format.h"
 #include "state_tracker/st_pbo.h"
+#include "state_tracker/st_pixel_copy.h"
 #include "state_tracker/st_texture.h"
 #include "state_tracker/st_gen_mipmap.h"
 #include "state_tracker/st_atom.h"
@@ -1333,6 +1334,84 @@ try_pbo_upload(struct gl_context *ctx, GLuint dims,
    return success;
 }
 
+/**
+ * Convert the user image straight into the mapped texture when there is a
+ * direct conversion for the format and type combo, instead of going through
+ * the generic conversions of _mesa_texstore.
+ */
+static bool
+try_direct_texsubimage(struct st_context *st, GLuint dims,
+                       struct gl_texture_image *texImage,
+                       struct pipe_resource *dst, unsigned dst_level,
+                       unsigned dstz,
+                       GLint xoffset, GLint yoffset, GLint zoffset,
+                       GLint width, GLint height, GLint depth,
+                       GLenum format, GLenum type, const void *pixels,
+                       const struct gl_pixelstore_attrib *unpack)
+{
+   struct gl_context *ctx = st->ctx;
+   struct pipe_context *pipe = st->pipe;
+   GLenum gl_target = texImage->TexObject->Target;
+   struct pipe_transfer *transfer;
+   st_pixel_copy_func func;
+   const GLubyte *src;
+   GLubyte *map;
+   unsigned stride, layer_stride;
+   GLint z;
+
+   if (!pixels || _mesa_is_bufferobj(unpack->BufferObj) || unpack->SwapBytes)
+      return false;
+
+   if (_mesa_texstore_needs_transfer_ops(ctx, texImage->_BaseFormat,
+                                         texImage->TexFormat))
+      return false;
+
+   /* RGB images stored with alpha are fine, the RGB kernels set alpha to 1. */
+   if (texImage->_BaseFormat !=
+       _mesa_get_format_base_format(texImage->TexFormat) &&
+       !(texImage->_BaseFormat == GL_RGB &&
+         (format == GL_RGB || format == GL_BGR)))
+      return false;
+
+   func = st_get_pixel_unpack_func(format, type,
+                                   util_format_linear(dst->format));
+   if (!func)
+      return false;
+
+   stride = _mesa_image_row_stride(unpack, width, format, type);
+   layer_stride = _mesa_image_image_stride(unpack, width, height, format,
+                                           type);
+   src = _mesa_image_address(dims, unpack, pixels, width, height, format,
+                             type, 0, 0, 0);
+
+   /* Convert to Gallium coordinates. */
+   if (gl_target == GL_TEXTURE_1D_ARRAY) {
+      zoffset = yoffset;
+      yoffset = 0;
+      depth = height;
+      height = 1;
+      layer_stride = stride;
+   }
+
+   map = pipe_transfer_map_3d(pipe, dst, dst_level,
+                              PIPE_TRANSFER_WRITE |
+                              PIPE_TRANSFER_DISCARD_RANGE,
+                              xoffset, yoffset, zoffset + dstz,
+                              width, height, depth, &transfer);
+   if (!map)
+      return false;
+
+   for (z = 0; z < depth; z++) {
+      st_pixel_copy_rows(st, func,
+                         map + z * transfer->layer_stride, transfer->stride,
+                         src + z * layer_stride, stride,
+                         width, height);
+   }
+
+   pipe_transfer_unmap(pipe, transfer);
+   return true;
+}
+
 static void
 st_TexSubImage(struct gl_context *ctx, GLuint dims,
                struct gl_texture_image *texImage,
@@ -1403,6 +1482,12 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    }
 
    if (!st->prefer_blit_based_texture_transfer) {
+      if (try_direct_texsubimage(st, dims, texImage, dst, dst_level, dstz,
+                                 xoffset, yoffset, zoffset,
+                                 width, height, depth,
+                                 format, type, pixels, unpack))
+         return;
+
       goto fallback;
    }
 
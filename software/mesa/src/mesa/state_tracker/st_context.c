@@ -69,7 +69,9 @@
 #include "st_extensions.h"
 #include "st_gen_mipmap.h"
 #include "st_pbo.h"
+#include "st_pixel_copy.h"
 #include "st_program.h"
+#include "st_shader_cache.h"
 #include "st_vdpau.h"
 #include "st_texture.h"
 #include "pipe/p_context.h"
@@ -283,6 +285,7 @@ st_destroy_context_priv(struct st_context *st)
    st_destroy_drawtex(st);
    st_destroy_perfmon(st);
    st_destroy_pbo_helpers(st);
+   st_destroy_pixel_copy(st);
 
    for (shader = 0; shader < ARRAY_SIZE(st->state.sampler_views); shader++) {
       for (i = 0; i < ARRAY_SIZE(st->state.sampler_views[0]); i++) {
@@ -500,6 +503,9 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
       return NULL;
    }
 
+   st_init_shader_cache(st);
+   st_init_shader_jobs(st);
+
    _mesa_initialize_dispatch_tables(ctx);
    _mesa_initialize_vbo_vtxfmt(ctx);
 
@@ -576,6 +582,9 @@ void st_destroy_context( struct st_context *st )
    struct gl_context *ctx = st->ctx;
    GLuint i;
 
+   /* Background compiles and links use the context. */
+   st_destroy_shader_jobs(st);
+
    _mesa_HashWalk(ctx->Shared->TexObjects, destroy_tex_sampler_cb, st);
 
    st_reference_fragprog(st, &st->fp, NULL);
@@ -597,6 +606,8 @@ void st_destroy_context( struct st_context *st )
 
    st_destroy_program_variants(st);
 
+   st_destroy_shader_cache(st);
+
    _mesa_free_context_data(ctx);
 
    /* This will free the st_context too, so 'st' must not be accessed
@@ -639,6 +650,7 @@ void st_init_driver_functions(struct pipe_screen *screen,
    st_init_msaa_functions(functions);
    st_init_perfmon_functions(functions);
    st_init_program_functions(functions);
+   st_init_shader_cache_functions(functions);
    st_init_query_functions(functions);
    st_init_cond_render_functions(functions);
    st_init_readpixels_functions(functions);
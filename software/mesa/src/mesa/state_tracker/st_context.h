@@ -30,6 +30,7 @@
 
 #include "main/mtypes.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "state_tracker/st_api.h"
 #include "main/fbobject.h"
 #include "state_tracker/st_atom.h"
@@ -49,6 +50,7 @@ struct st_context;
 struct st_fragment_program;
 struct st_perf_monitor_group;
 struct u_upload_mgr;
+struct util_queue;
 
 
 /** For drawing quads for glClear, glDraw/CopyPixels, glBitmap, etc. */
@@ -208,6 +210,13 @@ struct st_context
       unsigned hits;
    } readpix_cache;
 
+   /** for the direct glReadPixels / glTexSubImage conversions */
+   struct {
+      struct util_queue *queue;  /**< helper threads for large images */
+      unsigned num_threads;
+      bool initialized;
+   } pixel_copy;
+
    /** for glClear */
    struct {
       struct pipe_rasterizer_state raster;
@@ -253,6 +262,14 @@ struct st_context
    struct st_config_options options;
 
    struct st_perf_monitor_group *perfmon;
+
+   /** Background GLSL compilation, see st_queue_shader_job() */
+   struct {
+      struct util_queue queue;
+      pipe_mutex lock;
+      pipe_condvar idle;
+      unsigned num_jobs;   /**< queued or running jobs */
+   } shader_jobs;
 };
 
 
@@ -0,0 +1,730 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Direct conversions between the resource formats softpipe-like drivers
+ * render to and the format/type combinations applications commonly read
+ * back or upload with.
+ *
+ * _mesa_readpixels and _mesa_texstore handle every combination, but
+ * anything that isn't a plain memcpy goes through the generic swizzle or
+ * pack/unpack code one row at a time.  The kernels here convert the
+ * common cases directly (with SSE2 where it pays off) and large images
+ * are split in bands of rows that are converted on several threads.
+ *
+ * The results are bit for bit the same as those of the generic paths.
+ */
+
+
+#include <string.h>
+
+#include "main/imports.h"
+#include "main/macros.h"
+
+#include "pipe/p_config.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+#include "util/u_sse.h"
+
+#include "st_context.h"
+#include "st_pixel_copy.h"
+
+
+/** Images with fewer pixels than this are converted on one thread */
+#define ST_PIXEL_COPY_MIN_THREAD_PIXELS (256 * 256)
+
+/** Upper limit of the helper threads */
+#define ST_PIXEL_COPY_MAX_THREADS 7
+
+
+static inline uint32_t
+load32(const uint8_t *p)
+{
+   uint32_t v;
+   memcpy(&v, p, 4);
+   return v;
+}
+
+static inline void
+store32(uint8_t *p, uint32_t v)
+{
+   memcpy(p, &v, 4);
+}
+
+static inline uint16_t
+load16(const uint8_t *p)
+{
+   uint16_t v;
+   memcpy(&v, p, 2);
+   return v;
+}
+
+static inline void
+store16(uint8_t *p, uint16_t v)
+{
+   memcpy(p, &v, 2);
+}
+
+
+/*
+ * 32 bit RGBA8 kernels.  Pixels are handled as little endian words, so
+ * byte 0 is the lowest byte.
+ */
+
+static inline uint32_t
+swap_rb(uint32_t v)
+{
+   return (v & 0xff00ff00) | ((v & 0xff) << 16) | ((v >> 16) & 0xff);
+}
+
+static inline void
+swap_rb_row(uint8_t *dst, const uint8_t *src, unsigned width,
+            uint32_t alpha)
+{
+   unsigned i = 0;
+
+#if defined(PIPE_ARCH_SSE)
+   const __m128i ag_mask = _mm_set1_epi32(0xff00ff00);
+   const __m128i rb_mask = _mm_set1_epi32(0x00ff00ff);
+   const __m128i alpha_mask = _mm_set1_epi32(alpha);
+
+   for (; i + 4 <= width; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+      __m128i ag = _mm_and_si128(v, ag_mask);
+      __m128i rb = _mm_and_si128(v, rb_mask);
+
+      rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+      v = _mm_or_si128(_mm_or_si128(ag, rb), alpha_mask);
+      _mm_storeu_si128((__m128i *)(dst + i * 4), v);
+   }
+#endif
+
+   for (; i < width; i++)
+      store32(dst + i * 4, swap_rb(load32(src + i * 4)) | alpha);
+}
+
+static void
+copy_swap_rb(void *dst, const void *src, unsigned width)
+{
+   swap_rb_row(dst, src, width, 0);
+}
+
+static void
+copy_swap_rb_set_alpha(void *dst, const void *src, unsigned width)
+{
+   swap_rb_row(dst, src, width, 0xff000000);
+}
+
+static void
+copy_set_alpha(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i = 0;
+
+#if defined(PIPE_ARCH_SSE)
+   const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+   for (; i + 4 <= width; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(s + i * 4));
+      _mm_storeu_si128((__m128i *)(d + i * 4), _mm_or_si128(v, alpha));
+   }
+#endif
+
+   for (; i < width; i++)
+      store32(d + i * 4, load32(s + i * 4) | 0xff000000);
+}
+
+static void
+copy_rgba(void *dst, const void *src, unsigned width)
+{
+   memcpy(dst, src, width * 4);
+}
+
+
+/*
+ * 24 bit RGB8 <-> 32 bit RGBX8 kernels.
+ */
+
+static void
+copy_rgbx_to_rgb(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      d[0] = s[0];
+      d[1] = s[1];
+      d[2] = s[2];
+      s += 4;
+      d += 3;
+   }
+}
+
+static void
+copy_bgrx_to_rgb(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      d[0] = s[2];
+      d[1] = s[1];
+      d[2] = s[0];
+      s += 4;
+      d += 3;
+   }
+}
+
+static void
+copy_rgb_to_rgbx(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      store32(d, s[0] | (s[1] << 8) | (s[2] << 16) | 0xff000000);
+      s += 3;
+      d += 4;
+   }
+}
+
+static void
+copy_rgb_to_bgrx(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      store32(d, s[2] | (s[1] << 8) | (s[0] << 16) | 0xff000000);
+      s += 3;
+      d += 4;
+   }
+}
+
+
+/*
+ * B5G6R5 kernels.  Expansion replicates the high bits and reduction rounds,
+ * as _mesa_unorm_to_unorm does.
+ */
+
+static inline unsigned
+expand5(unsigned x)
+{
+   return (x << 3) | (x >> 2);
+}
+
+static inline unsigned
+expand6(unsigned x)
+{
+   return (x << 2) | (x >> 4);
+}
+
+static inline unsigned
+reduce5(unsigned x)
+{
+   return (x * 31 + 127) / 255;
+}
+
+static inline unsigned
+reduce6(unsigned x)
+{
+   return (x * 63 + 127) / 255;
+}
+
+/**
+ * Expand \p width B5G6R5 pixels to RGBA8 (or BGRA8 when \p bgra is set).
+ */
+static inline void
+b5g6r5_to_rgba8_row(uint8_t *dst, const uint8_t *src, unsigned width,
+                    boolean bgra)
+{
+   unsigned i = 0;
+
+#if defined(PIPE_ARCH_SSE)
+   const __m128i mask5 = _mm_set1_epi16(0x1f);
+   const __m128i mask6 = _mm_set1_epi16(0x3f);
+   const __m128i alpha = _mm_set1_epi16((short)0xff00);
+
+   for (; i + 8 <= width; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 2));
+      __m128i r = _mm_srli_epi16(v, 11);
+      __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+      __m128i b = _mm_and_si128(v, mask5);
+      __m128i lo, hi;
+
+      r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+      g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+      b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+      /* low half of each pixel is x | g << 8, high half is z | 0xff << 8 */
+      if (bgra) {
+         lo = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+         hi = _mm_or_si128(r, alpha);
+      }
+      else {
+         lo = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+         hi = _mm_or_si128(b, alpha);
+      }
+
+      _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_unpacklo_epi16(lo, hi));
+      _mm_storeu_si128((__m128i *)(dst + i * 4 + 16),
+                       _mm_unpackhi_epi16(lo, hi));
+   }
+#endif
+
+   for (; i < width; i++) {
+      const unsigned v = load16(src + i * 2);
+      const unsigned r = expand5(v >> 11);
+      const unsigned g = expand6((v >> 5) & 0x3f);
+      const unsigned b = expand5(v & 0x1f);
+
+      if (bgra)
+         store32(dst + i * 4, b | (g << 8) | (r << 16) | 0xff000000);
+      else
+         store32(dst + i * 4, r | (g << 8) | (b << 16) | 0xff000000);
+   }
+}
+
+static void
+copy_b5g6r5_to_rgba(void *dst, const void *src, unsigned width)
+{
+   b5g6r5_to_rgba8_row(dst, src, width, FALSE);
+}
+
+static void
+copy_b5g6r5_to_bgra(void *dst, const void *src, unsigned width)
+{
+   b5g6r5_to_rgba8_row(dst, src, width, TRUE);
+}
+
+static void
+copy_b5g6r5_to_rgb(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   uint8_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++) {
+      const unsigned v = load16(s + i * 2);
+
+      d[0] = expand5(v >> 11);
+      d[1] = expand6((v >> 5) & 0x3f);
+      d[2] = expand5(v & 0x1f);
+      d += 3;
+   }
+}
+
+static inline void
+store_b5g6r5(uint8_t *dst, unsigned r, unsigned g, unsigned b)
+{
+   store16(dst, (reduce5(r) << 11) | (reduce6(g) << 5) | reduce5(b));
+}
+
+static void
+copy_rgba_to_b5g6r5(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   unsigned i;
+
+   for (i = 0; i < width; i++, s += 4)
+      store_b5g6r5((uint8_t *)dst + i * 2, s[0], s[1], s[2]);
+}
+
+static void
+copy_bgra_to_b5g6r5(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   unsigned i;
+
+   for (i = 0; i < width; i++, s += 4)
+      store_b5g6r5((uint8_t *)dst + i * 2, s[2], s[1], s[0]);
+}
+
+static void
+copy_rgb_to_b5g6r5(void *dst, const void *src, unsigned width)
+{
+   const uint8_t *s = src;
+   unsigned i;
+
+   for (i = 0; i < width; i++, s += 3)
+      store_b5g6r5((uint8_t *)dst + i * 2, s[0], s[1], s[2]);
+}
+
+
+/*
+ * Depth kernels, with the same arithmetic as _mesa_unpack_float_z_row and
+ * _mesa_unpack_uint_z_row.
+ */
+
+static void
+copy_z24_to_float(void *dst, const void *src, unsigned width)
+{
+   const uint32_t *s = src;
+   float *d = dst;
+   const double scale = 1.0 / (double) 0xffffff;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = (float) ((s[i] & 0xffffff) * scale);
+}
+
+static void
+copy_z24_high_to_float(void *dst, const void *src, unsigned width)
+{
+   const uint32_t *s = src;
+   float *d = dst;
+   const double scale = 1.0 / (double) 0xffffff;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = (float) ((s[i] >> 8) * scale);
+}
+
+static void
+copy_z16_to_float(void *dst, const void *src, unsigned width)
+{
+   const uint16_t *s = src;
+   float *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = s[i] * (1.0F / 65535.0F);
+}
+
+static void
+copy_z32f_s8_to_float(void *dst, const void *src, unsigned width)
+{
+   const float *s = src;
+   float *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = s[i * 2];
+}
+
+static void
+copy_z24_to_uint(void *dst, const void *src, unsigned width)
+{
+   const uint32_t *s = src;
+   uint32_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = (s[i] << 8) | ((s[i] >> 16) & 0xff);
+}
+
+static void
+copy_z24_high_to_uint(void *dst, const void *src, unsigned width)
+{
+   const uint32_t *s = src;
+   uint32_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = (s[i] & 0xffffff00) | (s[i] >> 24);
+}
+
+static void
+copy_z16_to_uint(void *dst, const void *src, unsigned width)
+{
+   const uint16_t *s = src;
+   uint32_t *d = dst;
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+      d[i] = (s[i] << 16) | s[i];
+}
+
+
+struct st_pixel_copy_entry
+{
+   enum pipe_format format;
+   GLenum gl_format;
+   GLenum type;
+   st_pixel_copy_func pack;   /**< resource to client memory */
+   st_pixel_copy_func unpack; /**< client memory to resource */
+};
+
+/**
+ * The supported (resource format, format, type) combinations.
+ * GL_UNSIGNED_INT_8_8_8_8_REV is the same as GL_UNSIGNED_BYTE on little
+ * endian machines and is handled by the lookup.
+ */
+static const struct st_pixel_copy_entry st_pixel_copy_table[] = {
+   { PIPE_FORMAT_B8G8R8A8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE,
+     copy_swap_rb, copy_swap_rb },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE,
+     copy_swap_rb_set_alpha, copy_swap_rb },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE,
+     copy_set_alpha, copy_rgba },
+   { PIPE_FORMAT_B5G6R5_UNORM, GL_RGBA, GL_UNSIGNED_BYTE,
+     copy_b5g6r5_to_rgba, copy_rgba_to_b5g6r5 },
+
+   { PIPE_FORMAT_R8G8B8A8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE,
+     copy_swap_rb, copy_swap_rb },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE,
+     copy_swap_rb_set_alpha, copy_swap_rb },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE,
+     copy_set_alpha, copy_rgba },
+   { PIPE_FORMAT_B5G6R5_UNORM, GL_BGRA, GL_UNSIGNED_BYTE,
+     copy_b5g6r5_to_bgra, copy_bgra_to_b5g6r5 },
+
+   { PIPE_FORMAT_B8G8R8A8_UNORM, GL_RGB, GL_UNSIGNED_BYTE,
+     copy_bgrx_to_rgb, copy_rgb_to_bgrx },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, GL_RGB, GL_UNSIGNED_BYTE,
+     copy_bgrx_to_rgb, copy_rgb_to_bgrx },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, GL_RGB, GL_UNSIGNED_BYTE,
+     copy_rgbx_to_rgb, copy_rgb_to_rgbx },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, GL_RGB, GL_UNSIGNED_BYTE,
+     copy_rgbx_to_rgb, copy_rgb_to_rgbx },
+   { PIPE_FORMAT_B5G6R5_UNORM, GL_RGB, GL_UNSIGNED_BYTE,
+     copy_b5g6r5_to_rgb, copy_rgb_to_b5g6r5 },
+
+   { PIPE_FORMAT_B8G8R8A8_UNORM, GL_BGR, GL_UNSIGNED_BYTE,
+     copy_rgbx_to_rgb, copy_rgb_to_rgbx },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, GL_BGR, GL_UNSIGNED_BYTE,
+     copy_rgbx_to_rgb, copy_rgb_to_rgbx },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, GL_BGR, GL_UNSIGNED_BYTE,
+     copy_bgrx_to_rgb, copy_rgb_to_bgrx },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, GL_BGR, GL_UNSIGNED_BYTE,
+     copy_bgrx_to_rgb, copy_rgb_to_bgrx },
+
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z24_to_float, NULL },
+   { PIPE_FORMAT_Z24X8_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z24_to_float, NULL },
+   { PIPE_FORMAT_S8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z24_high_to_float, NULL },
+   { PIPE_FORMAT_X8Z24_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z24_high_to_float, NULL },
+   { PIPE_FORMAT_Z16_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z16_to_float, NULL },
+   { PIPE_FORMAT_Z32_FLOAT_S8X24_UINT, GL_DEPTH_COMPONENT, GL_FLOAT,
+     copy_z32f_s8_to_float, NULL },
+
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+     copy_z24_to_uint, NULL },
+   { PIPE_FORMAT_Z24X8_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+     copy_z24_to_uint, NULL },
+   { PIPE_FORMAT_S8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+     copy_z24_high_to_uint, NULL },
+   { PIPE_FORMAT_X8Z24_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+     copy_z24_high_to_uint, NULL },
+   { PIPE_FORMAT_Z16_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,
+     copy_z16_to_uint, NULL },
+};
+
+
+static const struct st_pixel_copy_entry *
+find_entry(enum pipe_format format, GLenum gl_format, GLenum type)
+{
+   unsigned i;
+
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   if (type == GL_UNSIGNED_INT_8_8_8_8_REV &&
+       (gl_format == GL_RGBA || gl_format == GL_BGRA))
+      type = GL_UNSIGNED_BYTE;
+
+   for (i = 0; i < ARRAY_SIZE(st_pixel_copy_table); i++) {
+      const struct st_pixel_copy_entry *entry = &st_pixel_copy_table[i];
+
+      if (entry->format == format &&
+          entry->gl_format == gl_format &&
+          entry->type == type)
+         return entry;
+   }
+#else
+   (void) i;
+#endif
+
+   return NULL;
+}
+
+
+/**
+ * Return the function that converts rows of \p format to \p gl_format and
+ * \p type, or NULL if there is none.
+ */
+st_pixel_copy_func
+st_get_pixel_pack_func(enum pipe_format format, GLenum gl_format, GLenum type)
+{
+   const struct st_pixel_copy_entry *entry =
+      find_entry(format, gl_format, type);
+
+   return entry ? entry->pack : NULL;
+}
+
+
+/**
+ * Return the function that converts rows of \p gl_format and \p type to
+ * \p format, or NULL if there is none.
+ */
+st_pixel_copy_func
+st_get_pixel_unpack_func(GLenum gl_format, GLenum type,
+                         enum pipe_format format)
+{
+   const struct st_pixel_copy_entry *entry =
+      find_entry(format, gl_format, type);
+
+   return entry ? entry->unpack : NULL;
+}
+
+
+struct st_pixel_copy_job
+{
+   st_pixel_copy_func func;
+   uint8_t *dst;
+   const uint8_t *src;
+   int dst_stride;
+   int src_stride;
+   unsigned width;
+   unsigned height;
+   struct util_queue_fence fence;
+};
+
+
+static void
+copy_rows(struct st_pixel_copy_job *job)
+{
+   uint8_t *dst = job->dst;
+   const uint8_t *src = job->src;
+   unsigned row;
+
+   for (row = 0; row < job->height; row++) {
+      job->func(dst, src, job->width);
+      dst += job->dst_stride;
+      src += job->src_stride;
+   }
+}
+
+static void
+copy_rows_execute(void *data, int thread_index)
+{
+   copy_rows(data);
+}
+
+
+/**
+ * Start the helper threads on first use.
+ * \return the number of helper threads
+ */
+static unsigned
+init_threads(struct st_context *st)
+{
+   unsigned num_threads;
+
+   if (st->pixel_copy.initialized)
+      return st->pixel_copy.num_threads;
+
+   st->pixel_copy.initialized = true;
+
+   util_cpu_detect();
+   num_threads = debug_get_num_option("ST_PIXEL_COPY_THREADS",
+                                      util_cpu_caps.nr_cpus);
+   num_threads = MIN2(num_threads, ST_PIXEL_COPY_MAX_THREADS + 1);
+
+   /* the calling thread converts a band too */
+   if (num_threads > 1) {
+      st->pixel_copy.queue = CALLOC_STRUCT(util_queue);
+      if (st->pixel_copy.queue &&
+          util_queue_init(st->pixel_copy.queue, "st_pixel_copy",
+                          ST_PIXEL_COPY_MAX_THREADS, num_threads - 1)) {
+         st->pixel_copy.num_threads = num_threads - 1;
+      }
+      else {
+         free(st->pixel_copy.queue);
+         st->pixel_copy.queue = NULL;
+      }
+   }
+
+   return st->pixel_copy.num_threads;
+}
+
+
+/**
+ * Convert \p height rows with \p func.  The strides may be negative.
+ * Large images are split in bands of rows converted in parallel.
+ */
+void
+st_pixel_copy_rows(struct st_context *st, st_pixel_copy_func func,
+                   void *dst, int dst_stride,
+                   const void *src, int src_stride,
+                   unsigned width, unsigned height)
+{
+   struct st_pixel_copy_job jobs[ST_PIXEL_COPY_MAX_THREADS + 1];
+   unsigned num_bands = 1, band_height, i;
+
+   if (width * height >= ST_PIXEL_COPY_MIN_THREAD_PIXELS)
+      num_bands += init_threads(st);
+   band_height = DIV_ROUND_UP(height, num_bands);
+   num_bands = band_height ? DIV_ROUND_UP(height, band_height) : 0;
+
+   for (i = 0; i < num_bands; i++) {
+      struct st_pixel_copy_job *job = &jobs[i];
+      const unsigned y = i * band_height;
+
+      job->func = func;
+      job->dst = (uint8_t *)dst + (ptrdiff_t)y * dst_stride;
+      job->src = (const uint8_t *)src + (ptrdiff_t)y * src_stride;
+      job->dst_stride = dst_stride;
+      job->src_stride = src_stride;
+      job->width = width;
+      job->height = MIN2(band_height, height - y);
+
+      if (i + 1 < num_bands) {
+         util_queue_fence_init(&job->fence);
+         util_queue_add_job(st->pixel_copy.queue, job, &job->fence,
+                            copy_rows_execute, NULL);
+      }
+   }
+
+   if (num_bands)
+      copy_rows(&jobs[num_bands - 1]);
+
+   for (i = 0; i + 1 < num_bands; i++) {
+      util_queue_job_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
+void
+st_destroy_pixel_copy(struct st_context *st)
+{
+   if (st->pixel_copy.queue) {
+      util_queue_destroy(st->pixel_copy.queue);
+      free(st->pixel_copy.queue);
+      st->pixel_copy.queue = NULL;
+   }
+}
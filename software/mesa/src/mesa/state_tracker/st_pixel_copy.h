@@ -0,0 +1,68 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef ST_PIXEL_COPY_H
+#define ST_PIXEL_COPY_H
+
+#include "main/glheader.h"
+#include "pipe/p_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct st_context;
+
+
+/**
+ * Converts one row of \p width pixels from \p src to \p dst.
+ */
+typedef void (*st_pixel_copy_func)(void *dst, const void *src,
+                                   unsigned width);
+
+
+st_pixel_copy_func
+st_get_pixel_pack_func(enum pipe_format format, GLenum gl_format, GLenum type);
+
+st_pixel_copy_func
+st_get_pixel_unpack_func(GLenum gl_format, GLenum type,
+                         enum pipe_format format);
+
+void
+st_pixel_copy_rows(struct st_context *st, st_pixel_copy_func func,
+                   void *dst, int dst_stride,
+                   const void *src, int src_stride,
+                   unsigned width, unsigned height);
+
+void
+st_destroy_pixel_copy(struct st_context *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_PIXEL_COPY_H */
@@ -0,0 +1,233 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file st_shader_cache.c
+ * State tracker part of the on-disk shader cache.
+ *
+ * The core cache (program/shader_cache.cpp) restores the linked GLSL
+ * program; here we add the TGSI translation of each vertex and fragment
+ * program so that glsl_to_tgsi does not have to run either.  Variants are
+ * not stored, they are created from the cached tokens as usual.
+ */
+
+#include <stdio.h>
+
+#include "main/mtypes.h"
+#include "main/shaderobj.h"
+#include "program/program.h"
+#include "compiler/glsl/blob.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/disk_cache.h"
+#include "st_context.h"
+#include "st_debug.h"
+#include "st_program.h"
+#include "st_shader_cache.h"
+#include "git_sha1.h"
+
+
+/**
+ * Create the cache if the driver consumes TGSI for the stages we cache.
+ * The driver id ties entries to this driver and this build of Mesa.
+ */
+void
+st_init_shader_cache(struct st_context *st)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+   char driver_id[256];
+   uint32_t timestamp = 0;
+
+   if (screen->get_shader_param(screen, PIPE_SHADER_VERTEX,
+                                PIPE_SHADER_CAP_PREFERRED_IR) !=
+       PIPE_SHADER_IR_TGSI ||
+       screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT,
+                                PIPE_SHADER_CAP_PREFERRED_IR) !=
+       PIPE_SHADER_IR_TGSI)
+      return;
+
+   disk_cache_get_function_timestamp((void *) st_init_shader_cache,
+                                     &timestamp);
+
+   snprintf(driver_id, sizeof(driver_id), "%s %s Mesa " PACKAGE_VERSION
+#ifdef MESA_GIT_SHA1
+            " (" MESA_GIT_SHA1 ")"
+#endif
+            " %u", screen->get_vendor(screen), screen->get_name(screen),
+            timestamp);
+
+   st->ctx->Cache = disk_cache_create(driver_id);
+}
+
+
+void
+st_destroy_shader_cache(struct st_context *st)
+{
+   if (st->ctx->Cache) {
+      disk_cache_destroy(st->ctx->Cache);
+      st->ctx->Cache = NULL;
+   }
+}
+
+
+static void
+write_tokens(struct blob *blob, const struct tgsi_token *tokens)
+{
+   const unsigned num_tokens = tgsi_num_tokens(tokens);
+
+   blob_write_uint32(blob, num_tokens);
+   blob_write_bytes(blob, tokens, num_tokens * sizeof(struct tgsi_token));
+}
+
+static const struct tgsi_token *
+read_tokens(struct blob_reader *blob)
+{
+   const unsigned num_tokens = blob_read_uint32(blob);
+   struct tgsi_token *tokens;
+
+   if (blob->overrun || num_tokens == 0 ||
+       num_tokens > (blob->end - blob->current) / sizeof(struct tgsi_token)) {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   tokens = tgsi_alloc_tokens(num_tokens);
+   if (tokens)
+      blob_copy_bytes(blob, (uint8_t *) tokens,
+                      num_tokens * sizeof(struct tgsi_token));
+   else
+      blob->overrun = true;
+
+   return tokens;
+}
+
+
+/**
+ * Called via ctx->Driver.ShaderCacheSerializeDriverBlob()
+ */
+static void
+st_serialise_program(struct gl_context *ctx, struct gl_program *prog,
+                     struct blob *blob)
+{
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct st_vertex_program *stvp = (struct st_vertex_program *) prog;
+
+      blob_write_bytes(blob, &stvp->affected_states,
+                       sizeof(stvp->affected_states));
+      blob_write_uint32(blob, stvp->num_inputs);
+      blob_write_bytes(blob, stvp->index_to_input,
+                       sizeof(stvp->index_to_input));
+      blob_write_bytes(blob, stvp->result_to_output,
+                       sizeof(stvp->result_to_output));
+      write_tokens(blob, stvp->tgsi.tokens);
+      break;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct st_fragment_program *stfp = (struct st_fragment_program *) prog;
+
+      blob_write_bytes(blob, &stfp->affected_states,
+                       sizeof(stfp->affected_states));
+      write_tokens(blob, stfp->tgsi.tokens);
+      break;
+   }
+   default:
+      unreachable("unsupported program target in shader cache");
+   }
+}
+
+
+/**
+ * Called via ctx->Driver.ShaderCacheDeserializeDriverBlob()
+ */
+static void
+st_deserialise_program(struct gl_context *ctx,
+                       struct gl_shader_program *shProg,
+                       struct gl_program *prog, struct blob_reader *blob)
+{
+   struct st_context *st = st_context(ctx);
+   gl_shader_stage stage = _mesa_program_enum_to_shader_stage(prog->Target);
+
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct st_vertex_program *stvp = (struct st_vertex_program *) prog;
+
+      st_release_vp_variants(st, stvp);
+
+      blob_copy_bytes(blob, (uint8_t *) &stvp->affected_states,
+                      sizeof(stvp->affected_states));
+      stvp->num_inputs = blob_read_uint32(blob);
+      blob_copy_bytes(blob, (uint8_t *) stvp->index_to_input,
+                      sizeof(stvp->index_to_input));
+      blob_copy_bytes(blob, (uint8_t *) stvp->result_to_output,
+                      sizeof(stvp->result_to_output));
+
+      memset(&stvp->tgsi, 0, sizeof(stvp->tgsi));
+      stvp->tgsi.type = PIPE_SHADER_IR_TGSI;
+      stvp->tgsi.tokens = read_tokens(blob);
+
+      if (st->vp == stvp)
+         st->dirty |= ST_NEW_VERTEX_PROGRAM(st, stvp);
+      break;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct st_fragment_program *stfp = (struct st_fragment_program *) prog;
+
+      st_release_fp_variants(st, stfp);
+
+      blob_copy_bytes(blob, (uint8_t *) &stfp->affected_states,
+                      sizeof(stfp->affected_states));
+
+      memset(&stfp->tgsi, 0, sizeof(stfp->tgsi));
+      stfp->tgsi.type = PIPE_SHADER_IR_TGSI;
+      stfp->tgsi.tokens = read_tokens(blob);
+
+      if (st->fp == stfp)
+         st->dirty |= stfp->affected_states;
+      break;
+   }
+   default:
+      unreachable("unsupported program target in shader cache");
+   }
+
+   if (blob->overrun)
+      return;
+
+   /* Same as st_program_string_notify() after translation. */
+   if (ST_DEBUG & DEBUG_PRECOMPILE ||
+       st->shader_has_one_variant[stage])
+      st_precompile_shader_variant(st, prog);
+}
+
+
+void
+st_init_shader_cache_functions(struct dd_function_table *functions)
+{
+   functions->ShaderCacheSerializeDriverBlob = st_serialise_program;
+   functions->ShaderCacheDeserializeDriverBlob = st_deserialise_program;
+}
@@ -0,0 +1,334 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Check the st_pixel_copy fast paths against the generic code they stand
+ * in for: _mesa_format_convert for colors, _mesa_unpack_*_z_row for depth.
+ * Every (resource format, format, type) combination st_pixel_copy claims
+ * is converted both ways from random data, with widths that do and don't
+ * fill the SSE2 loops and with rows that aren't 4 byte aligned.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "main/glheader.h"
+#include "main/enums.h"
+#include "main/formats.h"
+#include "main/glformats.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "util/half_float.h"
+#include "util/rounding.h"
+#include "state_tracker/st_context.h"
+#include "state_tracker/st_pixel_copy.h"
+
+/* these have no extern "C" of their own, the includes above are theirs */
+extern "C" {
+#include "main/format_unpack.h"
+#include "main/format_utils.h"
+}
+
+
+namespace {
+
+struct pixel_copy_case {
+   enum pipe_format format;
+   mesa_format mformat;
+   GLenum gl_format;
+   GLenum type;
+   bool unpack;   /**< is there a fast path for uploads too? */
+};
+
+const pixel_copy_case cases[] = {
+   { PIPE_FORMAT_B8G8R8A8_UNORM, MESA_FORMAT_B8G8R8A8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, MESA_FORMAT_B8G8R8X8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, MESA_FORMAT_R8G8B8X8_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B5G6R5_UNORM, MESA_FORMAT_B5G6R5_UNORM, GL_RGBA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B8G8R8A8_UNORM, MESA_FORMAT_B8G8R8A8_UNORM, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, true },
+
+   { PIPE_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_R8G8B8A8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, MESA_FORMAT_R8G8B8X8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, MESA_FORMAT_B8G8R8X8_UNORM, GL_BGRA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B5G6R5_UNORM, MESA_FORMAT_B5G6R5_UNORM, GL_BGRA, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_R8G8B8A8_UNORM, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, true },
+
+   { PIPE_FORMAT_B8G8R8A8_UNORM, MESA_FORMAT_B8G8R8A8_UNORM, GL_RGB, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, MESA_FORMAT_B8G8R8X8_UNORM, GL_RGB, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_R8G8B8A8_UNORM, GL_RGB, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, MESA_FORMAT_R8G8B8X8_UNORM, GL_RGB, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B5G6R5_UNORM, MESA_FORMAT_B5G6R5_UNORM, GL_RGB, GL_UNSIGNED_BYTE, true },
+
+   { PIPE_FORMAT_B8G8R8A8_UNORM, MESA_FORMAT_B8G8R8A8_UNORM, GL_BGR, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, MESA_FORMAT_B8G8R8X8_UNORM, GL_BGR, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, MESA_FORMAT_R8G8B8A8_UNORM, GL_BGR, GL_UNSIGNED_BYTE, true },
+   { PIPE_FORMAT_R8G8B8X8_UNORM, MESA_FORMAT_R8G8B8X8_UNORM, GL_BGR, GL_UNSIGNED_BYTE, true },
+
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, MESA_FORMAT_Z24_UNORM_S8_UINT, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+   { PIPE_FORMAT_Z24X8_UNORM, MESA_FORMAT_Z24_UNORM_X8_UINT, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+   { PIPE_FORMAT_S8_UINT_Z24_UNORM, MESA_FORMAT_S8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+   { PIPE_FORMAT_X8Z24_UNORM, MESA_FORMAT_X8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+   { PIPE_FORMAT_Z16_UNORM, MESA_FORMAT_Z_UNORM16, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+   { PIPE_FORMAT_Z32_FLOAT_S8X24_UINT, MESA_FORMAT_Z32_FLOAT_S8X24_UINT, GL_DEPTH_COMPONENT, GL_FLOAT, false },
+
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, MESA_FORMAT_Z24_UNORM_S8_UINT, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false },
+   { PIPE_FORMAT_Z24X8_UNORM, MESA_FORMAT_Z24_UNORM_X8_UINT, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false },
+   { PIPE_FORMAT_S8_UINT_Z24_UNORM, MESA_FORMAT_S8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false },
+   { PIPE_FORMAT_X8Z24_UNORM, MESA_FORMAT_X8_UINT_Z24_UNORM, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false },
+   { PIPE_FORMAT_Z16_UNORM, MESA_FORMAT_Z_UNORM16, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, false },
+};
+
+/** Name the cases in failure messages */
+void
+PrintTo(const pixel_copy_case &c, std::ostream *os)
+{
+   *os << _mesa_get_format_name(c.mformat) << " to "
+       << _mesa_enum_to_string(c.gl_format) << "/"
+       << _mesa_enum_to_string(c.type);
+}
+
+/* 1 to 3 run only the tail loops, 16 and 64 only the vector loops */
+const unsigned widths[] = { 1, 3, 4, 7, 16, 33, 64, 67 };
+
+const unsigned height = 5;
+
+
+class PixelCopyTest : public ::testing::TestWithParam<pixel_copy_case> {
+protected:
+   struct st_context *st;
+
+   virtual void SetUp()
+   {
+      st = (struct st_context *) calloc(1, sizeof(*st));
+      srand(0x5eed);
+   }
+
+   virtual void TearDown()
+   {
+      st_destroy_pixel_copy(st);
+      free(st);
+   }
+
+   unsigned client_cpp() const
+   {
+      const pixel_copy_case &c = GetParam();
+      return _mesa_bytes_per_pixel(c.gl_format, c.type);
+   }
+
+   static void
+   fill_random(std::vector<uint8_t> &buf)
+   {
+      for (size_t i = 0; i < buf.size(); i++)
+         buf[i] = rand();
+   }
+
+   /** The generic conversion of a resource image to client memory */
+   void reference_pack(uint8_t *dst, int dst_stride,
+                       const uint8_t *src, int src_stride,
+                       unsigned width) const;
+
+   /** The generic conversion of client memory to a resource image */
+   void reference_unpack(uint8_t *dst, int dst_stride,
+                         const uint8_t *src, int src_stride,
+                         unsigned width) const;
+
+   /** Is byte i of a resource pixel an X channel, whose value is undefined? */
+   bool is_padding(unsigned i) const;
+};
+
+
+void
+PixelCopyTest::reference_pack(uint8_t *dst, int dst_stride,
+                              const uint8_t *src, int src_stride,
+                              unsigned width) const
+{
+   const pixel_copy_case &c = GetParam();
+
+   for (unsigned y = 0; y < height; y++) {
+      uint8_t *d = dst + (int) y * dst_stride;
+      const uint8_t *s = src + (int) y * src_stride;
+
+      if (c.type == GL_FLOAT)
+         _mesa_unpack_float_z_row(c.mformat, width, s, (GLfloat *) d);
+      else if (c.gl_format == GL_DEPTH_COMPONENT)
+         _mesa_unpack_uint_z_row(c.mformat, width, s, (GLuint *) d);
+      else
+         _mesa_format_convert(d, _mesa_format_from_format_and_type(c.gl_format,
+                                                                   c.type),
+                              0, (void *) s, c.mformat, 0, width, 1,
+                              NULL);
+   }
+}
+
+
+void
+PixelCopyTest::reference_unpack(uint8_t *dst, int dst_stride,
+                                const uint8_t *src, int src_stride,
+                                unsigned width) const
+{
+   const pixel_copy_case &c = GetParam();
+
+   for (unsigned y = 0; y < height; y++) {
+      _mesa_format_convert(dst + (int) y * dst_stride, c.mformat, 0,
+                           (void *) (src + (int) y * src_stride),
+                           _mesa_format_from_format_and_type(c.gl_format,
+                                                             c.type),
+                           0, width, 1, NULL);
+   }
+}
+
+
+bool
+PixelCopyTest::is_padding(unsigned i) const
+{
+   const pixel_copy_case &c = GetParam();
+
+   return (c.mformat == MESA_FORMAT_B8G8R8X8_UNORM ||
+           c.mformat == MESA_FORMAT_R8G8B8X8_UNORM) && i % 4 == 3;
+}
+
+
+/**
+ * Resource to client memory, as glReadPixels does.  The client rows start
+ * one byte past a word boundary and are padded by three bytes.
+ */
+TEST_P(PixelCopyTest, Pack)
+{
+   const pixel_copy_case &c = GetParam();
+   const unsigned cpp = _mesa_get_format_bytes(c.mformat);
+   st_pixel_copy_func func =
+      st_get_pixel_pack_func(c.format, c.gl_format, c.type);
+
+   ASSERT_TRUE(func != NULL);
+
+   for (unsigned w = 0; w < ARRAY_SIZE(widths); w++) {
+      const unsigned width = widths[w];
+      const int src_stride = width * cpp;
+      const int dst_stride = width * client_cpp() + 3;
+      std::vector<uint8_t> src(src_stride * height);
+      std::vector<uint8_t> expected(dst_stride * height + 1);
+      std::vector<uint8_t> actual(dst_stride * height + 1);
+
+      SCOPED_TRACE(width);
+
+      fill_random(src);
+      reference_pack(&expected[1], dst_stride, &src[0], src_stride, width);
+      st_pixel_copy_rows(st, func, &actual[1], dst_stride,
+                         &src[0], src_stride, width, height);
+
+      for (unsigned y = 0; y < height; y++) {
+         EXPECT_EQ(0, memcmp(&expected[1 + y * dst_stride],
+                             &actual[1 + y * dst_stride],
+                             width * client_cpp())) << "row " << y;
+      }
+   }
+}
+
+
+/**
+ * Client memory to resource, as glTexSubImage does.  The client rows are
+ * misaligned and, like a bottom-up image, walked with a negative stride.
+ */
+TEST_P(PixelCopyTest, Unpack)
+{
+   const pixel_copy_case &c = GetParam();
+   const unsigned cpp = _mesa_get_format_bytes(c.mformat);
+   st_pixel_copy_func func =
+      st_get_pixel_unpack_func(c.gl_format, c.type, c.format);
+
+   if (!c.unpack) {
+      EXPECT_TRUE(func == NULL);
+      return;
+   }
+
+   ASSERT_TRUE(func != NULL);
+
+   for (unsigned w = 0; w < ARRAY_SIZE(widths); w++) {
+      const unsigned width = widths[w];
+      const int src_stride = width * client_cpp() + 1;
+      const int dst_stride = width * cpp;
+      std::vector<uint8_t> src(src_stride * height + 1);
+      std::vector<uint8_t> expected(dst_stride * height);
+      std::vector<uint8_t> actual(dst_stride * height);
+      const uint8_t *last_row = &src[1 + (height - 1) * src_stride];
+
+      SCOPED_TRACE(width);
+
+      fill_random(src);
+      reference_unpack(&expected[0], dst_stride, last_row, -src_stride,
+                       width);
+      st_pixel_copy_rows(st, func, &actual[0], dst_stride,
+                         last_row, -src_stride, width, height);
+
+      for (unsigned i = 0; i < expected.size(); i++) {
+         if (is_padding(i % cpp))
+            continue;
+         EXPECT_EQ(expected[i], actual[i])
+            << "row " << i / dst_stride << ", byte " << i % dst_stride;
+      }
+   }
+}
+
+
+/**
+ * Large images are split in bands converted on helper threads.
+ */
+TEST_P(PixelCopyTest, PackThreaded)
+{
+   const pixel_copy_case &c = GetParam();
+   const unsigned cpp = _mesa_get_format_bytes(c.mformat);
+   const unsigned width = 259, rows = 301;
+   const int src_stride = width * cpp;
+   const int dst_stride = width * client_cpp() + 1;
+   st_pixel_copy_func func =
+      st_get_pixel_pack_func(c.format, c.gl_format, c.type);
+   std::vector<uint8_t> src(src_stride * rows);
+   std::vector<uint8_t> expected(dst_stride * rows);
+   std::vector<uint8_t> actual(dst_stride * rows);
+
+   ASSERT_TRUE(func != NULL);
+
+   setenv("ST_PIXEL_COPY_THREADS", "4", 1);
+   fill_random(src);
+   for (unsigned y = 0; y < rows; y++) {
+      func(&expected[y * dst_stride], &src[y * src_stride], width);
+   }
+   st_pixel_copy_rows(st, func, &actual[0], dst_stride,
+                      &src[0], src_stride, width, rows);
+   unsetenv("ST_PIXEL_COPY_THREADS");
+
+   EXPECT_EQ(3u, st->pixel_copy.num_threads);
+   EXPECT_TRUE(expected == actual);
+}
+
+
+INSTANTIATE_TEST_CASE_P(StPixelCopy, PixelCopyTest, ::testing::ValuesIn(cases));
+
+} /* anonymous namespace */
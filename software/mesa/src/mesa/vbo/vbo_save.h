@@ -82,6 +82,18 @@ struct vbo_save_vertex_list {
    struct _mesa_prim *prim;
    GLuint prim_count;
 
+   /* The same geometry as a short list of indexed, independent
+    * primitives, built once at compile time so that strips, fans, quads
+    * and polygons from consecutive glBegin/glEnd blocks replay as a
+    * single draw.  merged_flags records the state the conversion
+    * depends on; playback falls back to prim[] when it doesn't hold.
+    */
+   struct _mesa_prim *merged_prim;
+   GLuint merged_prim_count;
+   GLbitfield merged_flags;
+   struct gl_buffer_object *index_obj;
+   GLenum index_type;
+
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
 };
@@ -89,21 +101,29 @@ struct vbo_save_vertex_list {
 /* These buffers should be a reasonable size to support upload to
  * hardware.  Current vbo implementation will re-upload on any
  * changes, so don't make too big or apps which dynamically create
- * dlists and use only a few times will suffer.
+ * dlists and use only a few times will suffer.  They are large enough
+ * that a typical list of many small glBegin/glEnd blocks lands in a
+ * single vertex list node, which is what lets the merged index list
+ * above replace it with one draw.
  *
  * Consider stategy of uploading regions from the VBO on demand in the
  * case of dynamic vbos.  Then make the dlist code signal that
  * likelyhood as it occurs.  No reason we couldn't change usage
  * internally even though this probably isn't allowed for client VBOs?
  */
-#define VBO_SAVE_BUFFER_SIZE (8*1024) /* dwords */
-#define VBO_SAVE_PRIM_SIZE   128
+#define VBO_SAVE_BUFFER_SIZE (64*1024) /* dwords */
+#define VBO_SAVE_PRIM_SIZE   512
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 #define VBO_SAVE_PRIM_WEAK              0x40
 #define VBO_SAVE_PRIM_NO_CURRENT_UPDATE 0x80
 
 #define VBO_SAVE_FALLBACK    0x10000000
 
+/* vbo_save_vertex_list::merged_flags: state the merged prims rely on */
+#define VBO_SAVE_MERGED_LAST_VERTEX  0x1 /**< GL_LAST_VERTEX_CONVENTION */
+#define VBO_SAVE_MERGED_NO_STIPPLE   0x2 /**< line stipple disabled */
+#define VBO_SAVE_MERGED_FILL         0x4 /**< GL_FILL polygon mode */
+
 /* Storage to be shared among several vertex_lists.
  */
 struct vbo_save_vertex_store {
@@ -406,6 +406,282 @@ convert_line_loop_to_strip(struct vbo_save_context *save,
 }
 
 
+/**
+ * Number of indices needed to draw prim as independent primitives of
+ * its base type (see merged_mode()).
+ */
+static GLuint
+merged_index_count(const struct _mesa_prim *prim)
+{
+   const GLuint n = prim->count;
+
+   switch (prim->mode) {
+   case GL_POINTS:
+      return n;
+   case GL_LINES:
+      return n & ~1u;
+   case GL_LINE_STRIP:
+      return n >= 2 ? 2 * (n - 1) : 0;
+   case GL_TRIANGLES:
+      return n - n % 3;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+      return n >= 3 ? 3 * (n - 2) : 0;
+   case GL_QUADS:
+      return 6 * (n / 4);
+   case GL_QUAD_STRIP:
+      return n >= 4 ? 6 * ((n - 2) / 2) : 0;
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * The independent primitive type prim is converted to, or GL_NONE for
+ * modes we leave alone (line loops, adjacency, patches).
+ */
+static GLenum
+merged_mode(const struct _mesa_prim *prim)
+{
+   switch (prim->mode) {
+   case GL_POINTS:
+      return GL_POINTS;
+   case GL_LINES:
+   case GL_LINE_STRIP:
+      return GL_LINES;
+   case GL_TRIANGLES:
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+   case GL_QUADS:
+   case GL_QUAD_STRIP:
+      return GL_TRIANGLES;
+   default:
+      return GL_NONE;
+   }
+}
+
+
+/**
+ * Write the indices for one prim.  Triangles keep the winding of the
+ * original primitive and put its provoking vertex (for
+ * GL_LAST_VERTEX_CONVENTION) last.
+ */
+static GLuint *
+emit_merged_indices(const struct _mesa_prim *prim, GLuint *out)
+{
+   const GLuint s = prim->start;
+   const GLuint n = prim->count;
+   GLuint i;
+
+   switch (prim->mode) {
+   case GL_POINTS:
+   case GL_LINES:
+   case GL_TRIANGLES:
+      for (i = 0; i < merged_index_count(prim); i++)
+         *out++ = s + i;
+      break;
+   case GL_LINE_STRIP:
+      for (i = 0; i + 1 < n; i++) {
+         *out++ = s + i;
+         *out++ = s + i + 1;
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 2 < n; i++) {
+         *out++ = s + i + (i & 1);
+         *out++ = s + i + 1 - (i & 1);
+         *out++ = s + i + 2;
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 0; i + 2 < n; i++) {
+         *out++ = s;
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+      }
+      break;
+   case GL_POLYGON:
+      for (i = 0; i + 2 < n; i++) {
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+         *out++ = s;
+      }
+      break;
+   case GL_QUADS:
+      for (i = 0; i + 3 < n; i += 4) {
+         *out++ = s + i + 0;
+         *out++ = s + i + 1;
+         *out++ = s + i + 3;
+         *out++ = s + i + 1;
+         *out++ = s + i + 2;
+         *out++ = s + i + 3;
+      }
+      break;
+   case GL_QUAD_STRIP:
+      for (i = 0; i + 3 < n; i += 2) {
+         *out++ = s + i + 0;
+         *out++ = s + i + 1;
+         *out++ = s + i + 3;
+         *out++ = s + i + 2;
+         *out++ = s + i + 0;
+         *out++ = s + i + 3;
+      }
+      break;
+   default:
+      assert(0);
+   }
+
+   return out;
+}
+
+
+/**
+ * Build node->merged_prim: the node's primitives rewritten as indexed
+ * points, lines or triangles, with consecutive prims of the same type
+ * folded into one.  The indices live in a static buffer object next to
+ * the vertex store, so playback is a single indexed draw per type run
+ * and nothing is copied or converted at replay time.
+ *
+ * Nothing is built unless it actually reduces the number of draws, and
+ * the state the conversion is only exact under is recorded in
+ * node->merged_flags.
+ */
+static void
+compile_merged_prims(struct gl_context *ctx,
+                     struct vbo_save_vertex_list *node)
+{
+   struct _mesa_prim *merged;
+   GLuint merged_count = 0, total = 0;
+   GLbitfield flags = 0;
+   GLenum last_mode = GL_NONE;
+   GLuint *indices, *out;
+   GLuint i;
+
+   node->merged_prim = NULL;
+   node->merged_prim_count = 0;
+   node->merged_flags = 0;
+   node->index_obj = NULL;
+   node->index_type = GL_NONE;
+
+   if (node->prim_count < 2 || node->count == 0)
+      return;
+
+   for (i = 0; i < node->prim_count; i++) {
+      const struct _mesa_prim *prim = &node->prim[i];
+      const GLenum mode = merged_mode(prim);
+
+      if (mode == GL_NONE || prim->indexed ||
+          prim->num_instances != 1 || prim->base_instance != 0)
+         return;
+
+      if (merged_index_count(prim) == 0)
+         continue;
+
+      switch (prim->mode) {
+      case GL_LINE_STRIP:
+         flags |= VBO_SAVE_MERGED_NO_STIPPLE;
+         break;
+      case GL_TRIANGLE_STRIP:
+      case GL_TRIANGLE_FAN:
+         flags |= VBO_SAVE_MERGED_LAST_VERTEX;
+         break;
+      case GL_POLYGON:
+      case GL_QUADS:
+      case GL_QUAD_STRIP:
+         flags |= VBO_SAVE_MERGED_LAST_VERTEX | VBO_SAVE_MERGED_FILL;
+         break;
+      default:
+         break;
+      }
+
+      if (mode != last_mode) {
+         merged_count++;
+         last_mode = mode;
+      }
+      total += merged_index_count(prim);
+   }
+
+   if (merged_count >= node->prim_count || total == 0)
+      return;
+
+   /* Edge flags only mean something to unfilled polygons. */
+   if (node->attrsz[VBO_ATTRIB_EDGEFLAG])
+      flags |= VBO_SAVE_MERGED_FILL;
+
+   merged = malloc(merged_count * sizeof(*merged));
+   indices = malloc(total * sizeof(GLuint));
+   if (!merged || !indices) {
+      free(merged);
+      free(indices);
+      return;
+   }
+
+   out = indices;
+   last_mode = GL_NONE;
+   merged_count = 0;
+   for (i = 0; i < node->prim_count; i++) {
+      const GLenum mode = merged_mode(&node->prim[i]);
+      struct _mesa_prim *m;
+
+      if (merged_index_count(&node->prim[i]) == 0)
+         continue;
+
+      if (mode != last_mode) {
+         m = &merged[merged_count++];
+         memset(m, 0, sizeof(*m));
+         m->mode = mode;
+         m->indexed = 1;
+         m->begin = 1;
+         m->end = 1;
+         m->start = out - indices;
+         m->num_instances = 1;
+         last_mode = mode;
+      }
+
+      out = emit_merged_indices(&node->prim[i], out);
+      merged[merged_count - 1].count = (out - indices) -
+                                       merged[merged_count - 1].start;
+   }
+   assert(out - indices == total);
+
+   if (node->count <= 0xffff) {
+      GLushort *indices16 = (GLushort *) indices;
+
+      /* In-place narrowing: element i is read before it is overwritten. */
+      for (i = 0; i < total; i++)
+         indices16[i] = (GLushort) indices[i];
+      node->index_type = GL_UNSIGNED_SHORT;
+   }
+   else {
+      node->index_type = GL_UNSIGNED_INT;
+   }
+
+   /* Like glBufferStorage() with no flags: written once, never mapped. */
+   node->index_obj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+   if (node->index_obj)
+      node->index_obj->Immutable = GL_TRUE;
+   if (node->index_obj &&
+       ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                              total * vbo_sizeof_ib_type(node->index_type),
+                              indices, GL_STATIC_DRAW_ARB, 0,
+                              node->index_obj)) {
+      node->merged_prim = merged;
+      node->merged_prim_count = merged_count;
+      node->merged_flags = flags;
+   }
+   else {
+      /* Not fatal: playback just uses the original prims. */
+      _mesa_reference_buffer_object(ctx, &node->index_obj, NULL);
+      free(merged);
+   }
+
+   free(indices);
+}
+
+
 /**
  * Insert the active immediate struct onto the display list currently
  * being built.
@@ -494,6 +770,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(node->prim, &node->prim_count);
 
+   compile_merged_prims(ctx, node);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1590,7 +1868,6 @@ static void
 vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 {
    struct vbo_save_vertex_list *node = (struct vbo_save_vertex_list *) data;
-   (void) ctx;
 
    if (--node->vertex_store->refcount == 0)
       free_vertex_store(ctx, node->vertex_store);
@@ -1598,6 +1875,10 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   free(node->merged_prim);
+   node->merged_prim = NULL;
+   _mesa_reference_buffer_object(ctx, &node->index_obj, NULL);
+
    free(node->current_data);
    node->current_data = NULL;
 }
@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "main/light.h"
 #include "main/state.h"
+#include "main/transformfeedback.h"
 #include "util/bitscan.h"
 
 #include "vbo_context.h"
@@ -241,6 +242,45 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
 }
 
 
+/**
+ * Can the node's merged, indexed prims stand in for its original ones
+ * under the current state?  See compile_merged_prims().
+ */
+static GLboolean
+use_merged_prims(struct gl_context *ctx,
+                 const struct vbo_save_vertex_list *node)
+{
+   const struct gl_fragment_program *fp = ctx->FragmentProgram._Current;
+
+   if (!node->merged_prim_count)
+      return GL_FALSE;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_LAST_VERTEX) &&
+       ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT)
+      return GL_FALSE;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_NO_STIPPLE) &&
+       ctx->Line.StippleFlag)
+      return GL_FALSE;
+
+   if ((node->merged_flags & VBO_SAVE_MERGED_FILL) &&
+       (ctx->Polygon.FrontMode != GL_FILL ||
+        ctx->Polygon.BackMode != GL_FILL))
+      return GL_FALSE;
+
+   /* Primitive IDs, restart indices and transform feedback would all
+    * see the rewritten primitives.
+    */
+   if (ctx->GeometryProgram._Current ||
+       (fp && (fp->Base.InputsRead & VARYING_BIT_PRIMITIVE_ID)) ||
+       ctx->Array._PrimitiveRestart ||
+       _mesa_is_xfb_active_and_unpaused(ctx))
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
 /**
  * Execute the buffer and save copied verts.
  * This is called from the display list code when executing
@@ -307,7 +347,26 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
-      if (node->count > 0) {
+      if (node->count > 0 && use_merged_prims(ctx, node)) {
+         const struct _mesa_prim *last =
+            &node->merged_prim[node->merged_prim_count - 1];
+         struct _mesa_index_buffer ib;
+
+         ib.count = last->start + last->count;
+         ib.type = node->index_type;
+         ib.obj = node->index_obj;
+         ib.ptr = NULL;
+
+         vbo_context(ctx)->draw_prims(ctx,
+                                      node->merged_prim,
+                                      node->merged_prim_count,
+                                      &ib,
+                                      GL_TRUE,
+                                      0,
+                                      node->count - 1,
+                                      NULL, 0, NULL);
+      }
+      else if (node->count > 0) {
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,
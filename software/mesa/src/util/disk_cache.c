@@ -0,0 +1,564 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file disk_cache.c
+ * On-disk shader cache.
+ *
+ * Every entry lives in its own file, <cache dir>/<xx>/<rest of key>,
+ * where xx are the first two hex digits of the key.  The file holds a
+ * small header (magic, key, payload size and payload SHA-1) followed by
+ * the payload.  Entries are written to a temporary file and renamed into
+ * place, so concurrent readers never observe partial entries.
+ *
+ * The total cache size is computed lazily on the first write and then
+ * tracked incrementally.  When it exceeds the limit, the directory tree
+ * is rescanned and the entries with the oldest modification times are
+ * removed until usage drops below 90% of the limit.  Hits refresh the
+ * modification time, which makes the eviction order LRU.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#ifdef HAVE_DLADDR
+#include <dlfcn.h>
+#endif
+
+#include "c11/threads.h"
+#include "util/debug.h"
+#include "util/mesa-sha1.h"
+#include "util/ralloc.h"
+
+#include "disk_cache.h"
+
+/* "MSC1", little endian */
+#define CACHE_ENTRY_MAGIC 0x3143534d
+
+/* Default size limit: 1 GB */
+#define CACHE_DEFAULT_MAX_SIZE (1024ull * 1024 * 1024)
+
+struct cache_entry_header {
+   uint32_t magic;
+   uint32_t pad;
+   uint64_t size;
+   cache_key key;
+   uint8_t checksum[20];
+};
+
+struct disk_cache {
+   /* Root directory of the cache */
+   char *path;
+
+   /* SHA-1 of the driver ID, mixed into every computed key */
+   cache_key driver_key;
+
+   uint64_t max_size;
+
+   /* Bytes used on disk, valid once size_known is set */
+   uint64_t size;
+   bool size_known;
+
+   mtx_t mutex;
+};
+
+struct cache_file {
+   char *path;
+   time_t mtime;
+   uint64_t size;
+};
+
+
+/**
+ * Create \p path and any missing parent directories.
+ */
+static bool
+mkdir_p(char *path)
+{
+   struct stat sb;
+   char *p;
+
+   for (p = path + 1; *p; p++) {
+      if (*p != '/')
+         continue;
+
+      *p = '\0';
+      if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+         *p = '/';
+         return false;
+      }
+      *p = '/';
+   }
+
+   if (mkdir(path, 0755) != 0 && errno != EEXIST)
+      return false;
+
+   return stat(path, &sb) == 0 && S_ISDIR(sb.st_mode);
+}
+
+
+/**
+ * Parse a size with an optional K, M or G suffix.  A bare number is
+ * taken as gigabytes, matching MESA_GLSL_CACHE_MAX_SIZE.
+ */
+static uint64_t
+parse_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoull(str, &end, 10);
+
+   switch (*end) {
+   case 'K':
+   case 'k':
+      return size * 1024;
+   case 'M':
+   case 'm':
+      return size * 1024 * 1024;
+   case 'G':
+   case 'g':
+   case '\0':
+   default:
+      return size * 1024 * 1024 * 1024;
+   }
+}
+
+
+static char *
+get_cache_root(void *mem_ctx)
+{
+   const char *path = getenv("MESA_GLSL_CACHE_DIR");
+   const char *home;
+
+   if (path)
+      return ralloc_strdup(mem_ctx, path);
+
+   path = getenv("XDG_CACHE_HOME");
+   if (path)
+      return ralloc_asprintf(mem_ctx, "%s/mesa", path);
+
+   home = getenv("HOME");
+   if (!home) {
+      struct passwd *pwd = getpwuid(getuid());
+      if (!pwd || !pwd->pw_dir)
+         return NULL;
+      home = pwd->pw_dir;
+   }
+
+   return ralloc_asprintf(mem_ctx, "%s/.cache/mesa", home);
+}
+
+
+struct disk_cache *
+disk_cache_create(const char *driver_id)
+{
+   struct disk_cache *cache;
+   const char *max_size_str;
+
+   if (env_var_as_boolean("MESA_GLSL_CACHE_DISABLE", false))
+      return NULL;
+
+   cache = rzalloc(NULL, struct disk_cache);
+   if (!cache)
+      return NULL;
+
+   cache->path = get_cache_root(cache);
+   if (!cache->path || !mkdir_p(cache->path)) {
+      ralloc_free(cache);
+      return NULL;
+   }
+
+   max_size_str = getenv("MESA_GLSL_CACHE_MAX_SIZE");
+   cache->max_size = max_size_str ? parse_size(max_size_str)
+                                  : CACHE_DEFAULT_MAX_SIZE;
+   if (cache->max_size == 0)
+      cache->max_size = CACHE_DEFAULT_MAX_SIZE;
+
+   _mesa_sha1_compute(driver_id, strlen(driver_id), cache->driver_key);
+
+   mtx_init(&cache->mutex, mtx_plain);
+
+   return cache;
+}
+
+
+void
+disk_cache_destroy(struct disk_cache *cache)
+{
+   if (!cache)
+      return;
+
+   mtx_destroy(&cache->mutex);
+   ralloc_free(cache);
+}
+
+
+void
+disk_cache_compute_key(struct disk_cache *cache, const void *data,
+                       size_t size, cache_key key)
+{
+   struct mesa_sha1 *ctx = _mesa_sha1_init();
+
+   _mesa_sha1_update(ctx, cache->driver_key, sizeof(cache->driver_key));
+   _mesa_sha1_update(ctx, data, size);
+   _mesa_sha1_final(ctx, key);
+}
+
+
+/**
+ * Format the path of the entry for \p key into \p buf.  If \p dir_only,
+ * stop after the two-digit directory component.
+ */
+static void
+get_entry_path(const struct disk_cache *cache, const cache_key key,
+               bool dir_only, char *buf, size_t buf_size)
+{
+   char hex[41];
+
+   _mesa_sha1_format(hex, key);
+   if (dir_only)
+      snprintf(buf, buf_size, "%s/%c%c", cache->path, hex[0], hex[1]);
+   else
+      snprintf(buf, buf_size, "%s/%c%c/%s", cache->path, hex[0], hex[1],
+               hex + 2);
+}
+
+
+static bool
+write_all(int fd, const void *data, size_t size)
+{
+   const uint8_t *p = data;
+
+   while (size) {
+      ssize_t ret = write(fd, p, size);
+
+      if (ret < 0) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+      p += ret;
+      size -= ret;
+   }
+
+   return true;
+}
+
+
+static bool
+read_all(int fd, void *data, size_t size)
+{
+   uint8_t *p = data;
+
+   while (size) {
+      ssize_t ret = read(fd, p, size);
+
+      if (ret < 0) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+      if (ret == 0)
+         return false;
+      p += ret;
+      size -= ret;
+   }
+
+   return true;
+}
+
+
+/**
+ * Collect all entry files below the cache root and their total size.
+ *
+ * \return the number of files.  If \p files is not NULL, it receives a
+ *         ralloc'ed array describing them.
+ */
+static unsigned
+scan_cache(struct disk_cache *cache, void *mem_ctx, struct cache_file **files,
+           uint64_t *total)
+{
+   unsigned count = 0, allocated = 0;
+   unsigned i;
+
+   if (files)
+      *files = NULL;
+   *total = 0;
+
+   for (i = 0; i < 256; i++) {
+      char *dir_path = ralloc_asprintf(mem_ctx, "%s/%02x", cache->path, i);
+      struct dirent *ent;
+      DIR *dir = opendir(dir_path);
+
+      if (!dir)
+         continue;
+
+      while ((ent = readdir(dir)) != NULL) {
+         struct stat sb;
+         char *path;
+
+         if (ent->d_name[0] == '.')
+            continue;
+
+         path = ralloc_asprintf(mem_ctx, "%s/%s", dir_path, ent->d_name);
+         if (stat(path, &sb) != 0 || !S_ISREG(sb.st_mode))
+            continue;
+
+         if (files) {
+            if (count == allocated) {
+               allocated = allocated ? allocated * 2 : 64;
+               *files = reralloc(mem_ctx, *files, struct cache_file,
+                                 allocated);
+            }
+            (*files)[count].path = path;
+            (*files)[count].mtime = sb.st_mtime;
+            (*files)[count].size = sb.st_size;
+         }
+         count++;
+         *total += sb.st_size;
+      }
+
+      closedir(dir);
+   }
+
+   return count;
+}
+
+
+static int
+compare_mtime(const void *a, const void *b)
+{
+   const struct cache_file *fa = a, *fb = b;
+
+   if (fa->mtime < fb->mtime)
+      return -1;
+   return fa->mtime > fb->mtime;
+}
+
+
+/**
+ * Remove the least recently used entries until the cache is below 90% of
+ * its limit.  The entry at \p keep_path, just written, is never removed.
+ *
+ * Called with the cache mutex held.
+ */
+static void
+evict_lru(struct disk_cache *cache, const char *keep_path)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   const uint64_t target = cache->max_size / 10 * 9;
+   struct cache_file *files;
+   uint64_t total;
+   unsigned count, i;
+
+   count = scan_cache(cache, mem_ctx, &files, &total);
+   if (count)
+      qsort(files, count, sizeof(files[0]), compare_mtime);
+
+   for (i = 0; i < count && total > target; i++) {
+      if (strcmp(files[i].path, keep_path) == 0)
+         continue;
+
+      if (unlink(files[i].path) == 0 || errno == ENOENT)
+         total -= files[i].size;
+   }
+
+   cache->size = total;
+   ralloc_free(mem_ctx);
+}
+
+
+void
+disk_cache_put(struct disk_cache *cache, const cache_key key,
+               const void *data, size_t size)
+{
+   char path[PATH_MAX], tmp_path[PATH_MAX + 16];
+   struct cache_entry_header header;
+   struct mesa_sha1 *sha1;
+   int fd;
+
+   get_entry_path(cache, key, true, path, sizeof(path));
+   if (mkdir(path, 0755) != 0 && errno != EEXIST)
+      return;
+
+   get_entry_path(cache, key, false, path, sizeof(path));
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp%d", path, (int) getpid());
+
+   /* Another process may be writing the same entry; let it win. */
+   fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+   if (fd < 0)
+      return;
+
+   memset(&header, 0, sizeof(header));
+   header.magic = CACHE_ENTRY_MAGIC;
+   header.size = size;
+   memcpy(header.key, key, sizeof(header.key));
+
+   sha1 = _mesa_sha1_init();
+   _mesa_sha1_update(sha1, data, size);
+   _mesa_sha1_final(sha1, header.checksum);
+
+   if (!write_all(fd, &header, sizeof(header)) ||
+       !write_all(fd, data, size)) {
+      close(fd);
+      unlink(tmp_path);
+      return;
+   }
+
+   close(fd);
+
+   if (rename(tmp_path, path) != 0) {
+      unlink(tmp_path);
+      return;
+   }
+
+   mtx_lock(&cache->mutex);
+
+   if (!cache->size_known) {
+      void *mem_ctx = ralloc_context(NULL);
+      scan_cache(cache, mem_ctx, NULL, &cache->size);
+      ralloc_free(mem_ctx);
+      cache->size_known = true;
+   } else {
+      cache->size += sizeof(header) + size;
+   }
+
+   if (cache->size > cache->max_size)
+      evict_lru(cache, path);
+
+   mtx_unlock(&cache->mutex);
+}
+
+
+void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   char path[PATH_MAX];
+   struct cache_entry_header header;
+   uint8_t checksum[20];
+   struct mesa_sha1 *sha1;
+   struct stat sb;
+   void *data = NULL;
+   int fd;
+
+   if (size)
+      *size = 0;
+
+   get_entry_path(cache, key, false, path, sizeof(path));
+
+   fd = open(path, O_RDONLY);
+   if (fd < 0)
+      return NULL;
+
+   if (fstat(fd, &sb) != 0 ||
+       !read_all(fd, &header, sizeof(header)) ||
+       header.magic != CACHE_ENTRY_MAGIC ||
+       memcmp(header.key, key, sizeof(header.key)) != 0 ||
+       header.size != (uint64_t) sb.st_size - sizeof(header))
+      goto corrupt;
+
+   /* Allocate at least one byte so that empty entries are non-NULL. */
+   data = malloc(header.size ? header.size : 1);
+   if (!data) {
+      close(fd);
+      return NULL;
+   }
+
+   if (!read_all(fd, data, header.size))
+      goto corrupt;
+
+   sha1 = _mesa_sha1_init();
+   _mesa_sha1_update(sha1, data, header.size);
+   _mesa_sha1_final(sha1, checksum);
+   if (memcmp(checksum, header.checksum, sizeof(checksum)) != 0)
+      goto corrupt;
+
+   /* Refresh the modification time so that eviction is LRU. */
+   futimens(fd, NULL);
+   close(fd);
+
+   if (size)
+      *size = header.size;
+   return data;
+
+corrupt:
+   free(data);
+   close(fd);
+   unlink(path);
+   return NULL;
+}
+
+
+void
+disk_cache_put_key(struct disk_cache *cache, const cache_key key)
+{
+   disk_cache_put(cache, key, NULL, 0);
+}
+
+
+bool
+disk_cache_has_key(struct disk_cache *cache, const cache_key key)
+{
+   char path[PATH_MAX];
+
+   get_entry_path(cache, key, false, path, sizeof(path));
+
+   /* Refreshing the timestamp doubles as the existence check. */
+   return utime(path, NULL) == 0 || access(path, R_OK) == 0;
+}
+
+
+bool
+disk_cache_get_function_timestamp(void *ptr, uint32_t *timestamp)
+{
+#ifdef HAVE_DLADDR
+   Dl_info info;
+   struct stat st;
+
+   if (!dladdr(ptr, &info) || !info.dli_fname)
+      return false;
+
+   if (stat(info.dli_fname, &st))
+      return false;
+
+   *timestamp = st.st_mtime;
+   return true;
+#else
+   return false;
+#endif
+}
+
+#endif /* ENABLE_SHADER_CACHE */
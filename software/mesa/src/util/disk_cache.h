@@ -0,0 +1,176 @@
+/**************************************************************************
+ *
+ * Copyright 2017 Fabricio Ribeiro Toloczko
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file disk_cache.h
+ * Persistent, size-limited cache of compiled shader data on disk.
+ *
+ * Entries are addressed by a 20-byte SHA-1 key and stored one per file
+ * below $MESA_GLSL_CACHE_DIR, $XDG_CACHE_HOME/mesa or ~/.cache/mesa.
+ * Reading an entry refreshes its modification time, and the least
+ * recently used entries are evicted once the cache grows beyond
+ * MESA_GLSL_CACHE_MAX_SIZE.
+ */
+
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of cache keys in bytes. */
+#define CACHE_KEY_SIZE 20
+
+typedef uint8_t cache_key[CACHE_KEY_SIZE];
+
+struct disk_cache;
+
+#ifdef ENABLE_SHADER_CACHE
+
+/**
+ * Create a new cache object for the driver identified by \p driver_id.
+ *
+ * The driver ID is mixed into every key computed with
+ * disk_cache_compute_key() so that entries written by one driver build
+ * are never returned to another.
+ *
+ * \return NULL if the cache is disabled or its directory is unusable.
+ */
+struct disk_cache *
+disk_cache_create(const char *driver_id);
+
+void
+disk_cache_destroy(struct disk_cache *cache);
+
+/**
+ * Compute the key for \p data, qualified by the cache's driver ID.
+ */
+void
+disk_cache_compute_key(struct disk_cache *cache, const void *data,
+                       size_t size, cache_key key);
+
+/**
+ * Store \p size bytes of \p data under \p key, evicting old entries if
+ * the cache exceeds its size limit.
+ */
+void
+disk_cache_put(struct disk_cache *cache, const cache_key key,
+               const void *data, size_t size);
+
+/**
+ * Retrieve the entry stored under \p key.
+ *
+ * \return a malloc'ed copy of the data, to be released with free(), or
+ *         NULL if there is no valid entry.
+ */
+void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size);
+
+/**
+ * Record the presence of \p key without any data attached to it.
+ */
+void
+disk_cache_put_key(struct disk_cache *cache, const cache_key key);
+
+/**
+ * Test whether \p key was previously stored with disk_cache_put() or
+ * disk_cache_put_key().
+ */
+bool
+disk_cache_has_key(struct disk_cache *cache, const cache_key key);
+
+/**
+ * Return the modification time of the shared object containing \p ptr.
+ *
+ * Useful for building driver IDs that change whenever the driver is
+ * rebuilt.
+ */
+bool
+disk_cache_get_function_timestamp(void *ptr, uint32_t *timestamp);
+
+#else
+
+static inline struct disk_cache *
+disk_cache_create(const char *driver_id)
+{
+   return NULL;
+}
+
+static inline void
+disk_cache_destroy(struct disk_cache *cache)
+{
+}
+
+static inline void
+disk_cache_compute_key(struct disk_cache *cache, const void *data,
+                       size_t size, cache_key key)
+{
+   memset(key, 0, CACHE_KEY_SIZE);
+}
+
+static inline void
+disk_cache_put(struct disk_cache *cache, const cache_key key,
+               const void *data, size_t size)
+{
+}
+
+static inline void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   return NULL;
+}
+
+static inline void
+disk_cache_put_key(struct disk_cache *cache, const cache_key key)
+{
+}
+
+static inline bool
+disk_cache_has_key(struct disk_cache *cache, const cache_key key)
+{
+   return false;
+}
+
+static inline bool
+disk_cache_get_function_timestamp(void *ptr, uint32_t *timestamp)
+{
+   return false;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_H */